@@ -0,0 +1,227 @@
+/**
+ * Arduino.h - Linux implementation of the subset of the Arduino core API
+ *             used by this sketch.
+ *
+ * This header stands in for the AVR core's `Arduino.h` when the sketch is
+ * built as a host executable. Timing functions are backed by a virtual clock
+ * (see host.h) so that the firmware can be run many times faster than
+ * realtime.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_HOST_ARDUINO_H
+#define SUBSONIC_IPT_HOST_ARDUINO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Included by the AVR core as well.
+#include "avr/io.h"
+
+/******************************************************************************\
+ * Constants
+\******************************************************************************/
+
+#ifndef ARDUINO
+#define ARDUINO 10810
+#endif
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#ifndef _BV
+#define _BV(bit) (1u << (bit))
+#endif
+
+/******************************************************************************\
+ * Program memory
+ *
+ * The host has a single address space, so program memory accessors are
+ * plain loads. Defining `__PGMSPACE_H_` prevents the vendored i2cdevlib
+ * headers from providing their own (identical) fallbacks.
+\******************************************************************************/
+
+#ifndef __PGMSPACE_H_
+#define __PGMSPACE_H_ 1
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(str) (str)
+#define pgm_read_byte(addr) (*(const unsigned char*)(addr))
+#define pgm_read_word(addr) (*(const unsigned short*)(addr))
+#define pgm_read_dword(addr) (*(const unsigned long*)(addr))
+#define pgm_read_float(addr) (*(const float*)(addr))
+#define pgm_read_byte_near(addr) pgm_read_byte(addr)
+#endif
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(PSTR(string_literal)))
+
+/******************************************************************************\
+ * Types
+\******************************************************************************/
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef uint16_t word;
+
+/******************************************************************************\
+ * Core functions
+\******************************************************************************/
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : -1))
+void attachInterrupt(uint8_t interrupt_num, void (* user_func)(), int mode);
+void detachInterrupt(uint8_t interrupt_num);
+void interrupts();
+void noInterrupts();
+
+long map(long value, long from_low, long from_high, long to_low, long to_high);
+
+char* dtostrf(double value, signed char width, unsigned char precision, char* buffer);
+
+/*
+ * The AVR core defines these as function-like macros. Templates are used
+ * here instead so that this header may coexist with the C++ standard library
+ * in host-only translation units.
+ */
+template<typename T, typename U>
+constexpr auto min(const T& a, const U& b) -> decltype(a < b ? a : b)
+{
+    return a < b ? a : b;
+}
+
+template<typename T, typename U>
+constexpr auto max(const T& a, const U& b) -> decltype(a > b ? a : b)
+{
+    return a > b ? a : b;
+}
+
+template<typename T, typename L, typename H>
+constexpr T constrain(const T& value, const L& low, const H& high)
+{
+    return value < low ? low : (value > high ? high : value);
+}
+
+/******************************************************************************\
+ * Print
+\******************************************************************************/
+
+class Print {
+  public:
+    virtual ~Print() = default;
+
+    virtual size_t write(uint8_t) = 0;
+
+    virtual size_t write(const uint8_t* buffer, size_t size);
+
+    size_t write(const char* str)
+    {
+        if (str == nullptr) { return 0; }
+        return write(reinterpret_cast<const uint8_t*>(str), strlen(str));
+    }
+
+    size_t write(const char* buffer, size_t size)
+    {
+        return write(reinterpret_cast<const uint8_t*>(buffer), size);
+    }
+
+    virtual int availableForWrite() { return 0; }
+
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper* str);
+    size_t print(const char* str);
+    size_t print(char c);
+    size_t print(unsigned char n, int base = DEC);
+    size_t print(int n, int base = DEC);
+    size_t print(unsigned int n, int base = DEC);
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+
+    size_t println(const __FlashStringHelper* str);
+    size_t println(const char* str);
+    size_t println(char c);
+    size_t println(unsigned char n, int base = DEC);
+    size_t println(int n, int base = DEC);
+    size_t println(unsigned int n, int base = DEC);
+    size_t println(long n, int base = DEC);
+    size_t println(unsigned long n, int base = DEC);
+    size_t println(double n, int digits = 2);
+    size_t println();
+
+  private:
+    size_t print_number(unsigned long n, uint8_t base);
+};
+
+/**
+ * Serial port backed by a host file stream.
+ *
+ * Transmission is paced against the virtual clock: bytes drain from a 64 byte
+ * transmit buffer at the configured baud rate, and writes into a full buffer
+ * block just as they would on the Uno.
+ */
+class HardwareSerial : public Print {
+  public:
+    void begin(unsigned long baud);
+
+    void end() {}
+
+    int available() { return 0; }
+
+    int read() { return -1; }
+
+    int availableForWrite() override;
+
+    void flush() override;
+
+    size_t write(uint8_t byte) override;
+
+    using Print::write;
+
+    explicit operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif //SUBSONIC_IPT_HOST_ARDUINO_H
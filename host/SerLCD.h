@@ -0,0 +1,83 @@
+/**
+ * SerLCD.h - Linux implementation of the SparkFun SerLCD Arduino library.
+ *
+ * The interface and the I2C byte protocol mirror the SparkFun library, as do
+ * the settling delays that the library inserts after each transmission, so
+ * that display updates cost the same virtual time on the host as they would
+ * on the device.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_HOST_SERLCD_H
+#define SUBSONIC_IPT_HOST_SERLCD_H
+
+#include "Arduino.h"
+#include "Wire.h"
+
+#define DISPLAY_ADDRESS1 0x72
+#define MAX_ROWS 4
+#define MAX_COLUMNS 20
+
+#define SPECIAL_COMMAND 254
+#define SETTING_COMMAND 0x7C
+
+#define CLEAR_COMMAND 0x2D
+#define CONTRAST_COMMAND 0x18
+#define SET_RGB_COMMAND 0x2B
+
+#define LCD_RETURNHOME 0x02
+#define LCD_DISPLAYCONTROL 0x08
+#define LCD_SETDDRAMADDR 0x80
+
+#define LCD_DISPLAYON 0x04
+#define LCD_CURSORON 0x02
+#define LCD_BLINKON 0x01
+
+class SerLCD : public Print {
+    TwoWire* m_wire{nullptr};
+    uint8_t m_address{DISPLAY_ADDRESS1};
+    uint8_t m_display_control{LCD_DISPLAYON};
+
+  public:
+    void begin(TwoWire& wire_port, uint8_t address = DISPLAY_ADDRESS1);
+
+    void clear();
+
+    void home();
+
+    void setCursor(uint8_t col, uint8_t row);
+
+    void cursor();
+
+    void noCursor();
+
+    void display();
+
+    void noDisplay();
+
+    void setBacklight(unsigned long rgb);
+
+    void setBacklight(uint8_t r, uint8_t g, uint8_t b);
+
+    void setContrast(uint8_t new_value);
+
+    void command(uint8_t command);
+
+    void specialCommand(uint8_t command);
+
+    size_t write(uint8_t b) override;
+
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+    using Print::write;
+
+  private:
+    void transmit(const uint8_t* data, size_t size);
+};
+
+#endif //SUBSONIC_IPT_HOST_SERLCD_H
@@ -0,0 +1,72 @@
+/**
+ * Wire.h - Linux implementation of the Arduino Wire (I2C master) library.
+ *
+ * Transactions are delivered to simulated devices attached with
+ * `subsonic_ipt::host::attach_i2c_device` and are charged against the
+ * virtual clock at the configured bus rate.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_HOST_WIRE_H
+#define SUBSONIC_IPT_HOST_WIRE_H
+
+#include "Arduino.h"
+
+/// The size of the Wire library's transmit and receive buffers.
+#define BUFFER_LENGTH 32
+
+class TwoWire : public Print {
+    uint8_t m_tx_address{0};
+    uint8_t m_tx_buffer[BUFFER_LENGTH]{};
+    uint8_t m_tx_length{0};
+    bool m_transmitting{false};
+
+    uint8_t m_rx_buffer[BUFFER_LENGTH]{};
+    uint8_t m_rx_length{0};
+    uint8_t m_rx_index{0};
+
+    uint32_t m_clock_hz{100000};
+
+  public:
+    void begin() {}
+
+    void setClock(uint32_t clock_hz) { m_clock_hz = clock_hz; }
+
+    void beginTransmission(uint8_t address);
+
+    void beginTransmission(int address) { beginTransmission(static_cast<uint8_t>(address)); }
+
+    uint8_t endTransmission(bool send_stop = true);
+
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, bool send_stop = true);
+
+    uint8_t requestFrom(int address, int quantity, int send_stop = 1)
+    {
+        return requestFrom(static_cast<uint8_t>(address), static_cast<uint8_t>(quantity), send_stop != 0);
+    }
+
+    size_t write(uint8_t data) override;
+
+    size_t write(const uint8_t* data, size_t quantity) override;
+
+    using Print::write;
+
+    int available() { return m_rx_length - m_rx_index; }
+
+    int read() { return m_rx_index < m_rx_length ? m_rx_buffer[m_rx_index++] : -1; }
+
+    int peek() { return m_rx_index < m_rx_length ? m_rx_buffer[m_rx_index] : -1; }
+
+  private:
+    /// Charges the virtual clock for clocking the given number of bytes.
+    void charge_bus_time(size_t bytes) const;
+};
+
+extern TwoWire Wire;
+
+#endif //SUBSONIC_IPT_HOST_WIRE_H
@@ -0,0 +1,678 @@
+/**
+ * arduino.cpp - Linux implementation of the Arduino core API.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "Arduino.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "host.h"
+
+/// Defined by sketches that handle pin change interrupts with `ISR`.
+extern "C" void subsonic_host_pcint0_vect() __attribute__((weak));
+extern "C" void subsonic_host_pcint1_vect() __attribute__((weak));
+extern "C" void subsonic_host_pcint2_vect() __attribute__((weak));
+
+/******************************************************************************\
+ * Internal definitions
+\******************************************************************************/
+namespace {
+using namespace subsonic_ipt::host;
+
+/// The number of digital pins on the Uno.
+constexpr uint8_t PIN_COUNT = 20;
+
+/// The size of the transmit buffer used by the AVR core's HardwareSerial.
+constexpr double SERIAL_TX_BUFFER_SIZE = 64;
+
+/// The longest stretch of virtual time skipped after an idle pass of the
+/// sketch's loop. Work that becomes due with time alone, such as a task's
+/// release, is picked up at most this late.
+constexpr uint64_t IDLE_SKIP_US = 1000;
+
+/**
+ * A callback scheduled on the virtual clock.
+ */
+struct Event {
+    uint64_t time_us;
+    /// The order in which the event was scheduled, so that events due at the
+    /// same time fire in that order.
+    uint64_t sequence;
+    std::function<void()> callback;
+
+    /// Orders a heap so that the next event to fire is at its front.
+    bool operator<(const Event& other) const noexcept
+    {
+        return time_us != other.time_us ? time_us > other.time_us : sequence > other.sequence;
+    }
+};
+
+/**
+ * A one-shot timer of a simulated peripheral.
+ */
+struct PeripheralTimerState {
+    uint64_t time_us{0};
+    /// The function to run when the timer expires, or null if it is stopped.
+    void (* callback)(){nullptr};
+};
+
+/// The time of the next event when nothing is scheduled.
+constexpr uint64_t NEVER_US = UINT64_MAX;
+
+/**
+ * The virtual clock and the events scheduled against it.
+ *
+ * The events are kept in a binary heap rather than a tree. Peripherals that
+ * schedule an event for every byte they clock use a timer instead, which
+ * does not touch the heap at all.
+ */
+struct {
+    uint64_t now_us{0};
+    std::vector<Event> events;
+    uint64_t next_sequence{0};
+    PeripheralTimerState timers[static_cast<uint8_t>(PeripheralTimer::Count)];
+    /// The time of the next event or timer expiry, kept by `update_next_event`
+    /// so that charging the cost of a core call is a single comparison.
+    uint64_t next_event_us{NEVER_US};
+    /// The timer that expires at `next_event_us`, or `PeripheralTimer::Count`
+    /// if the next event is on the heap.
+    uint8_t next_timer{static_cast<uint8_t>(PeripheralTimer::Count)};
+    bool dispatching{false};
+    CallCosts costs{};
+} g_clock;
+
+/**
+ * The simulated state of a single digital pin.
+ */
+struct PinState {
+    uint8_t mode{INPUT};
+    /// The level last written by the sketch.
+    bool output_level{false};
+    /// Whether the pin is being driven by an external source.
+    bool externally_driven{false};
+    /// The level of the external source driving this pin.
+    bool external_level{false};
+    int analog_value{0};
+};
+
+PinState g_pins[PIN_COUNT]{};
+
+/**
+ * The state of the two external interrupts available on the Uno.
+ */
+struct {
+    void (* handlers[2])(){nullptr, nullptr};
+    int modes[2]{};
+    bool pending[2]{};
+    bool enabled{true};
+    /// Peripheral interrupt handlers raised while interrupts were disabled.
+    std::vector<void (*)()> pending_vectors;
+} g_interrupts;
+
+/**
+ * The number of times the simulated hardware has given the sketch something
+ * to respond to, or been driven by it: events fired, interrupt handlers run,
+ * and bytes sent over the serial port or the I2C bus.
+ */
+uint64_t g_activity{0};
+
+/**
+ * The simulated state of the serial transmitter.
+ */
+struct {
+    FILE* sink{stdout};
+    /// Transmit rate in bytes per microsecond, or 0 before `begin`.
+    double bytes_per_us{0};
+    /// The number of bytes waiting in the transmit buffer.
+    double tx_fill{0};
+    uint64_t last_drain_us{0};
+    uint64_t bytes_written{0};
+} g_serial;
+
+/**
+ * Finds the next scheduled event or timer expiry. Must be called whenever
+ * either changes.
+ */
+void update_next_event()
+{
+    uint64_t next_us = g_clock.events.empty() ? NEVER_US : g_clock.events.front().time_us;
+    uint8_t timer = static_cast<uint8_t>(PeripheralTimer::Count);
+    for (uint8_t i = 0; i < static_cast<uint8_t>(PeripheralTimer::Count); ++i) {
+        const auto& state = g_clock.timers[i];
+        if (state.callback != nullptr && state.time_us < next_us) {
+            next_us = state.time_us;
+            timer = i;
+        }
+    }
+    g_clock.next_event_us = next_us;
+    g_clock.next_timer = timer;
+}
+
+/**
+ * Fires all events that are due at or before the given time, then sets
+ * the clock to that time.
+ */
+void run_clock_until(uint64_t target_us)
+{
+    if (g_clock.dispatching) {
+        // Events may not advance the clock themselves.
+        return;
+    }
+    // Most calls come from charging the cost of a core call, with no event
+    // due before the new time.
+    if (g_clock.next_event_us > target_us) {
+        g_clock.now_us = max(g_clock.now_us, target_us);
+        return;
+    }
+    g_clock.dispatching = true;
+    while (g_clock.next_event_us <= target_us) {
+        ++g_activity;
+        g_clock.now_us = max(g_clock.now_us, g_clock.next_event_us);
+        if (g_clock.next_timer != static_cast<uint8_t>(PeripheralTimer::Count)) {
+            auto& state = g_clock.timers[g_clock.next_timer];
+            const auto callback = state.callback;
+            state.callback = nullptr;
+            update_next_event();
+            callback();
+            continue;
+        }
+        std::pop_heap(g_clock.events.begin(), g_clock.events.end());
+        Event event = std::move(g_clock.events.back());
+        g_clock.events.pop_back();
+        update_next_event();
+        event.callback();
+    }
+    g_clock.now_us = max(g_clock.now_us, target_us);
+    g_clock.dispatching = false;
+}
+
+void charge(uint32_t cost_us)
+{
+    run_clock_until(g_clock.now_us + cost_us);
+}
+
+/**
+ * Runs the interrupt handler for the given interrupt, or marks it pending
+ * if interrupts are currently disabled.
+ */
+void raise_interrupt(uint8_t interrupt_num)
+{
+    if (g_interrupts.handlers[interrupt_num] == nullptr) {
+        return;
+    }
+    if (g_interrupts.enabled) {
+        ++g_activity;
+        g_interrupts.handlers[interrupt_num]();
+    } else {
+        g_interrupts.pending[interrupt_num] = true;
+    }
+}
+
+bool pin_level(const PinState& pin)
+{
+    if (pin.externally_driven) {
+        return pin.external_level;
+    }
+    if (pin.mode == INPUT_PULLUP) {
+        return true;
+    }
+    return pin.output_level;
+}
+
+/**
+ * Raises the pin change interrupt of the given pin's port, if it is enabled
+ * for the pin.
+ */
+void raise_pin_change(uint8_t pin)
+{
+    // Ports D, B and C hold digital pins 0-7, 8-13 and 14-19.
+    const uint8_t group = pin < 8 ? 2 : (pin < 14 ? 0 : 1);
+    const uint8_t bit = pin < 8 ? pin : (pin < 14 ? pin - 8 : pin - 14);
+    const volatile uint8_t* const masks[]{&PCMSK0, &PCMSK1, &PCMSK2};
+    void (* const handlers[])(){subsonic_host_pcint0_vect, subsonic_host_pcint1_vect, subsonic_host_pcint2_vect};
+    if ((PCICR & _BV(group)) && (*masks[group] & _BV(bit)) && handlers[group] != nullptr) {
+        subsonic_ipt::host::raise_vector(handlers[group]);
+    }
+}
+
+void serial_drain()
+{
+    const auto now = g_clock.now_us;
+    g_serial.tx_fill -= static_cast<double>(now - g_serial.last_drain_us) * g_serial.bytes_per_us;
+    if (g_serial.tx_fill < 0) {
+        g_serial.tx_fill = 0;
+    }
+    g_serial.last_drain_us = now;
+}
+
+} // namespace
+
+/******************************************************************************\
+ * Host control interface
+\******************************************************************************/
+namespace subsonic_ipt::host {
+
+uint64_t now_us()
+{
+    return g_clock.now_us;
+}
+
+void advance_us(uint64_t duration_us)
+{
+    run_clock_until(g_clock.now_us + duration_us);
+}
+
+void advance_to_us(uint64_t time_us)
+{
+    run_clock_until(time_us);
+}
+
+void schedule_at(uint64_t time_us, std::function<void()> callback)
+{
+    g_clock.events.push_back({time_us, g_clock.next_sequence++, std::move(callback)});
+    std::push_heap(g_clock.events.begin(), g_clock.events.end());
+    update_next_event();
+}
+
+void set_peripheral_timer(PeripheralTimer timer, uint64_t time_us, void (* callback)())
+{
+    g_clock.timers[static_cast<uint8_t>(timer)] = {time_us, callback};
+    update_next_event();
+}
+
+void record_activity()
+{
+    ++g_activity;
+}
+
+void run_loop_pass(void (* loop)())
+{
+    const uint64_t activity = g_activity;
+    loop();
+    if (g_activity == activity) {
+        run_clock_until(min(g_clock.next_event_us, g_clock.now_us + IDLE_SKIP_US));
+    }
+}
+
+void set_call_costs(const CallCosts& costs)
+{
+    g_clock.costs = costs;
+}
+
+void charge_register_io()
+{
+    charge(g_clock.costs.register_io_us);
+}
+
+void raise_vector(void (* handler)())
+{
+    if (g_interrupts.enabled) {
+        ++g_activity;
+        handler();
+    } else {
+        g_interrupts.pending_vectors.push_back(handler);
+    }
+}
+
+void set_pin_level(uint8_t pin, bool high)
+{
+    if (pin >= PIN_COUNT) {
+        return;
+    }
+    auto& state = g_pins[pin];
+    const bool previous = pin_level(state);
+    state.externally_driven = true;
+    state.external_level = high;
+    if (previous == high) {
+        return;
+    }
+
+    raise_pin_change(pin);
+
+    const int interrupt_num = digitalPinToInterrupt(pin);
+    if (interrupt_num < 0) {
+        return;
+    }
+    const int mode = g_interrupts.modes[interrupt_num];
+    if (mode == CHANGE || (mode == RISING && high) || (mode == FALLING && !high)) {
+        raise_interrupt(static_cast<uint8_t>(interrupt_num));
+    }
+}
+
+int analog_output(uint8_t pin)
+{
+    return pin < PIN_COUNT ? g_pins[pin].analog_value : 0;
+}
+
+void schedule_button_press(uint8_t pin, uint64_t start_us, uint64_t hold_us)
+{
+    schedule_at(start_us, [pin] { set_pin_level(pin, false); });
+    schedule_at(start_us + hold_us, [pin] { set_pin_level(pin, true); });
+}
+
+void set_serial_sink(FILE* sink)
+{
+    g_serial.sink = sink;
+}
+
+uint64_t serial_bytes_written()
+{
+    return g_serial.bytes_written;
+}
+
+} // namespace subsonic_ipt::host
+
+/******************************************************************************\
+ * Arduino core API
+\******************************************************************************/
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin < PIN_COUNT) {
+        g_pins[pin].mode = mode;
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    charge(g_clock.costs.digital_io_us);
+    if (pin < PIN_COUNT) {
+        g_pins[pin].output_level = value != LOW;
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    charge(g_clock.costs.digital_io_us);
+    if (pin >= PIN_COUNT) {
+        return LOW;
+    }
+    return pin_level(g_pins[pin]) ? HIGH : LOW;
+}
+
+int analogRead(uint8_t /* pin */)
+{
+    // A conversion takes ~100us on the Uno.
+    charge(100);
+    return 0;
+}
+
+void analogWrite(uint8_t pin, int value)
+{
+    charge(g_clock.costs.analog_write_us);
+    if (pin < PIN_COUNT) {
+        g_pins[pin].analog_value = value;
+    }
+}
+
+unsigned long millis()
+{
+    charge(g_clock.costs.time_query_us);
+    return static_cast<unsigned long>(g_clock.now_us / 1000);
+}
+
+unsigned long micros()
+{
+    charge(g_clock.costs.time_query_us);
+    // unsigned long is 64 bits wide here, so the full count is returned. A
+    // 32-bit count would wrap while 64-bit sums and differences of it do
+    // not, which no code written for the Uno expects. Code that must survive
+    // the wrap on the Uno keeps its times in uint32_t.
+    return static_cast<unsigned long>(g_clock.now_us);
+}
+
+void delay(unsigned long ms)
+{
+    run_clock_until(g_clock.now_us + static_cast<uint64_t>(ms) * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    run_clock_until(g_clock.now_us + us);
+}
+
+void attachInterrupt(uint8_t interrupt_num, void (* user_func)(), int mode)
+{
+    if (interrupt_num < 2) {
+        g_interrupts.handlers[interrupt_num] = user_func;
+        g_interrupts.modes[interrupt_num] = mode;
+    }
+}
+
+void detachInterrupt(uint8_t interrupt_num)
+{
+    if (interrupt_num < 2) {
+        g_interrupts.handlers[interrupt_num] = nullptr;
+    }
+}
+
+void interrupts()
+{
+    g_interrupts.enabled = true;
+    for (uint8_t i = 0; i < 2; ++i) {
+        if (g_interrupts.pending[i]) {
+            g_interrupts.pending[i] = false;
+            raise_interrupt(i);
+        }
+    }
+    if (g_interrupts.pending_vectors.empty()) {
+        return;
+    }
+    auto pending_vectors = std::move(g_interrupts.pending_vectors);
+    g_interrupts.pending_vectors.clear();
+    for (const auto handler : pending_vectors) {
+        raise_vector(handler);
+    }
+}
+
+void noInterrupts()
+{
+    g_interrupts.enabled = false;
+}
+
+long map(long value, long from_low, long from_high, long to_low, long to_high)
+{
+    return (value - from_low) * (to_high - to_low) / (from_high - from_low) + to_low;
+}
+
+char* dtostrf(double value, signed char width, unsigned char precision, char* buffer)
+{
+    sprintf(buffer, "%*.*f", width, precision, value);
+    return buffer;
+}
+
+/******************************************************************************\
+ * Print
+\******************************************************************************/
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--) {
+        if (write(*buffer++)) {
+            ++n;
+        } else {
+            break;
+        }
+    }
+    return n;
+}
+
+size_t Print::print(const __FlashStringHelper* str)
+{
+    return write(reinterpret_cast<const char*>(str));
+}
+
+size_t Print::print(const char* str)
+{
+    return write(str);
+}
+
+size_t Print::print(char c)
+{
+    return write(static_cast<uint8_t>(c));
+}
+
+size_t Print::print(unsigned char n, int base)
+{
+    return print(static_cast<unsigned long>(n), base);
+}
+
+size_t Print::print(int n, int base)
+{
+    return print(static_cast<long>(n), base);
+}
+
+size_t Print::print(unsigned int n, int base)
+{
+    return print(static_cast<unsigned long>(n), base);
+}
+
+size_t Print::print(long n, int base)
+{
+    if (base == 0) {
+        return write(static_cast<uint8_t>(n));
+    }
+    if (base == DEC && n < 0) {
+        return print('-') + print_number(static_cast<unsigned long>(-n), DEC);
+    }
+    // Non-decimal bases print the two's complement representation, matching
+    // the 32-bit longs of the AVR core.
+    return print_number(static_cast<uint32_t>(n), static_cast<uint8_t>(base));
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+    if (base == 0) {
+        return write(static_cast<uint8_t>(n));
+    }
+    return print_number(n, static_cast<uint8_t>(base));
+}
+
+size_t Print::print(double n, int digits)
+{
+    if (isnan(n)) { return print("nan"); }
+    if (isinf(n)) { return print("inf"); }
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+    return print(buffer);
+}
+
+size_t Print::println(const __FlashStringHelper* str) { return print(str) + println(); }
+size_t Print::println(const char* str) { return print(str) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(unsigned char n, int base) { return print(n, base) + println(); }
+size_t Print::println(int n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned int n, int base) { return print(n, base) + println(); }
+size_t Print::println(long n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned long n, int base) { return print(n, base) + println(); }
+size_t Print::println(double n, int digits) { return print(n, digits) + println(); }
+
+size_t Print::println()
+{
+    return write("\r\n");
+}
+
+size_t Print::print_number(unsigned long n, uint8_t base)
+{
+    if (base < 2) {
+        base = 10;
+    }
+    char buffer[8 * sizeof(long) + 1];
+    char* str = &buffer[sizeof(buffer) - 1];
+    *str = '\0';
+    do {
+        const auto digit = static_cast<char>(n % base);
+        n /= base;
+        *--str = static_cast<char>(digit < 10 ? digit + '0' : digit + 'A' - 10);
+    } while (n);
+    return write(str);
+}
+
+/******************************************************************************\
+ * HardwareSerial
+\******************************************************************************/
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long baud)
+{
+    // 8N1 framing: ten bits on the wire per byte.
+    g_serial.bytes_per_us = static_cast<double>(baud) / 10.0 / 1e6;
+    g_serial.tx_fill = 0;
+    g_serial.last_drain_us = g_clock.now_us;
+}
+
+int HardwareSerial::availableForWrite()
+{
+    if (g_serial.bytes_per_us == 0) {
+        return static_cast<int>(SERIAL_TX_BUFFER_SIZE) - 1;
+    }
+    serial_drain();
+    return static_cast<int>(SERIAL_TX_BUFFER_SIZE - 1 - g_serial.tx_fill);
+}
+
+void HardwareSerial::flush()
+{
+    if (g_serial.bytes_per_us != 0) {
+        serial_drain();
+        run_clock_until(g_clock.now_us + static_cast<uint64_t>(g_serial.tx_fill / g_serial.bytes_per_us));
+        serial_drain();
+    }
+    if (g_serial.sink != nullptr) {
+        fflush(g_serial.sink);
+    }
+}
+
+size_t HardwareSerial::write(uint8_t byte)
+{
+    if (g_serial.bytes_per_us != 0) {
+        serial_drain();
+        // Block while the transmit buffer is full, as the AVR core does.
+        if (g_serial.tx_fill > SERIAL_TX_BUFFER_SIZE - 2) {
+            const double wait = (g_serial.tx_fill - (SERIAL_TX_BUFFER_SIZE - 2)) / g_serial.bytes_per_us;
+            run_clock_until(g_clock.now_us + static_cast<uint64_t>(wait) + 1);
+            serial_drain();
+        }
+        g_serial.tx_fill += 1;
+    }
+    ++g_serial.bytes_written;
+    ++g_activity;
+    if (g_serial.sink != nullptr) {
+        fputc(byte, g_serial.sink);
+    }
+    return 1;
+}
+
+/******************************************************************************\
+ * Port registers
+\******************************************************************************/
+
+const PinInputRegister PINB{8, 6};
+const PinInputRegister PINC{14, 6};
+const PinInputRegister PIND{0, 8};
+
+volatile uint8_t PCICR{0};
+volatile uint8_t PCMSK0{0};
+volatile uint8_t PCMSK1{0};
+volatile uint8_t PCMSK2{0};
+
+PinInputRegister::operator uint8_t() const
+{
+    charge_register_io();
+    uint8_t value = 0;
+    for (uint8_t bit = 0; bit < m_pin_count; ++bit) {
+        if (pin_level(g_pins[m_first_pin + bit])) {
+            value |= _BV(bit);
+        }
+    }
+    return value;
+}
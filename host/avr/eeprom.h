@@ -0,0 +1,40 @@
+/**
+ * eeprom.h - Linux implementation of the avr-libc EEPROM routines used by
+ *            the sketch.
+ *
+ * The EEPROM is simulated in memory and starts out erased (all bytes 0xFF),
+ * as on a new Uno. Host executables may load and save its contents through
+ * host.h. Each byte that is actually changed is charged against the virtual
+ * clock at the EEPROM's programming time.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_HOST_AVR_EEPROM_H
+#define SUBSONIC_IPT_HOST_AVR_EEPROM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// The last EEPROM address of the ATmega328P.
+#define E2END 0x3FF
+
+uint8_t eeprom_read_byte(const uint8_t* address);
+
+uint16_t eeprom_read_word(const uint16_t* address);
+
+void eeprom_read_block(void* destination, const void* source, size_t length);
+
+void eeprom_write_byte(uint8_t* address, uint8_t value);
+
+void eeprom_update_byte(uint8_t* address, uint8_t value);
+
+void eeprom_update_word(uint16_t* address, uint16_t value);
+
+void eeprom_update_block(const void* source, void* destination, size_t length);
+
+#endif //SUBSONIC_IPT_HOST_AVR_EEPROM_H
@@ -0,0 +1,32 @@
+/**
+ * interrupt.h - Linux implementation of the AVR interrupt declarations.
+ *
+ * Interrupt handlers defined with `ISR` become ordinary functions that the
+ * host backend calls from its simulated peripherals.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_HOST_AVR_INTERRUPT_H
+#define SUBSONIC_IPT_HOST_AVR_INTERRUPT_H
+
+#include "../Arduino.h"
+
+#define ISR(vector) extern "C" void vector()
+
+/// The TWI interrupt, run by the simulated TWI peripheral in twi.cpp.
+#define TWI_vect subsonic_host_twi_vect
+
+/// The pin change interrupts of ports B, C and D, run by `set_pin_level`.
+#define PCINT0_vect subsonic_host_pcint0_vect
+#define PCINT1_vect subsonic_host_pcint1_vect
+#define PCINT2_vect subsonic_host_pcint2_vect
+
+#define sei() interrupts()
+#define cli() noInterrupts()
+
+#endif //SUBSONIC_IPT_HOST_AVR_INTERRUPT_H
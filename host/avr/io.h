@@ -0,0 +1,96 @@
+/**
+ * io.h - Linux implementation of the AVR peripheral registers used by the
+ *        sketch.
+ *
+ * The TWI (I2C) peripheral and the digital port input and pin change
+ * interrupt registers are provided. The TWI registers drive the same
+ * simulated bus as the Wire library, and writes to the control register are
+ * charged against the virtual clock at the configured bit rate.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_HOST_AVR_IO_H
+#define SUBSONIC_IPT_HOST_AVR_IO_H
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+/**
+ * The TWI control register.
+ *
+ * Writing to the register with TWINT set starts the requested bus
+ * operation, after which TWINT is raised again (and the TWI interrupt fires,
+ * if enabled) once the operation would have completed on the bus. Reading
+ * the register is charged as a register access against the virtual clock,
+ * so that loops polling TWINT make progress.
+ */
+class TwiControlRegister {
+  public:
+    operator uint8_t() const;
+
+    TwiControlRegister& operator=(uint8_t value);
+};
+
+extern TwiControlRegister TWCR;
+extern volatile uint8_t TWBR;
+extern volatile uint8_t TWSR;
+extern volatile uint8_t TWDR;
+
+// TWCR
+#define TWINT 7
+#define TWEA 6
+#define TWSTA 5
+#define TWSTO 4
+#define TWWC 3
+#define TWEN 2
+#define TWIE 0
+
+// TWSR
+#define TWPS1 1
+#define TWPS0 0
+
+/**
+ * A port input register, which reads the levels of the port's digital pins.
+ *
+ * Reading the register is charged as a register access against the virtual
+ * clock.
+ */
+class PinInputRegister {
+    /// The Arduino pin number of the port's bit 0.
+    uint8_t m_first_pin;
+    uint8_t m_pin_count;
+
+  public:
+    constexpr PinInputRegister(uint8_t first_pin, uint8_t pin_count) : m_first_pin(first_pin), m_pin_count(pin_count) {}
+
+    operator uint8_t() const;
+};
+
+/// Digital pins 8-13.
+extern const PinInputRegister PINB;
+/// Analog pins A0-A5, i.e. digital pins 14-19.
+extern const PinInputRegister PINC;
+/// Digital pins 0-7.
+extern const PinInputRegister PIND;
+
+/// The pin change interrupt enable bits for ports B, C and D.
+extern volatile uint8_t PCICR;
+/// The pins of ports B, C and D whose changes raise their interrupt.
+extern volatile uint8_t PCMSK0;
+extern volatile uint8_t PCMSK1;
+extern volatile uint8_t PCMSK2;
+
+// PCICR
+#define PCIE2 2
+#define PCIE1 1
+#define PCIE0 0
+
+#endif //SUBSONIC_IPT_HOST_AVR_IO_H
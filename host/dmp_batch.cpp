@@ -0,0 +1,162 @@
+/**
+ * dmp_batch.cpp - Batch processing of recorded DMP packets.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "dmp_batch.h"
+
+#include <cmath>
+
+#include "../src/fast_trig.h"
+
+namespace subsonic_ipt::host {
+
+#ifdef SUBSONIC_BATCH_X86
+// Defined in dmp_batch_sse41.cpp and dmp_batch_avx2.cpp, which are compiled
+// for their instruction sets.
+void process_trace_sse41(const DmpTrace& trace, MotionTrace& motion);
+void process_trace_avx2(const DmpTrace& trace, MotionTrace& motion);
+#endif
+
+namespace {
+
+void process_trace_scalar(const DmpTrace& trace, MotionTrace& motion)
+{
+    for (size_t i = 0; i < trace.size(); ++i) {
+        const dmp_math::QuaternionQ14 q{trace.qw[i], trace.qx[i], trace.qy[i], trace.qz[i]};
+        const VectorInt16 accel(trace.accel_x[i], trace.accel_y[i], trace.accel_z[i]);
+
+        const VectorInt16 gravity = dmp_math::gravity(q);
+        const VectorInt16 world = dmp_math::rotate(dmp_math::rotation(q), dmp_math::linear_accel(accel, gravity));
+        motion.gravity_x[i] = gravity.x;
+        motion.gravity_y[i] = gravity.y;
+        motion.gravity_z[i] = gravity.z;
+        motion.world_x[i] = world.x;
+        motion.world_y[i] = world.y;
+        motion.world_z[i] = world.z;
+        motion.yaw[i] = decode_yaw(q);
+        decode_tilt(gravity, motion.pitch[i], motion.roll[i]);
+    }
+}
+
+} // namespace
+
+float decode_yaw(const dmp_math::QuaternionQ14& q) noexcept
+{
+    // atan2(2xy - 2wz, 2ww + 2xx - 1), with both sides halved.
+    const int32_t y = static_cast<int32_t>(q.x) * q.y - static_cast<int32_t>(q.w) * q.z;
+    const int32_t x = static_cast<int32_t>(q.w) * q.w + static_cast<int32_t>(q.x) * q.x - (1L << 27);
+    return static_cast<float>(fast_trig::atan2(static_cast<double>(y), static_cast<double>(x)));
+}
+
+void decode_tilt(const VectorInt16& gravity, float& pitch, float& roll) noexcept
+{
+    using fast_trig::atan2;
+
+    const VectorInt16& g = gravity;
+    const int32_t horizontal = static_cast<int32_t>(g.y) * g.y + static_cast<int32_t>(g.z) * g.z;
+    pitch = static_cast<float>(atan2(static_cast<double>(g.x), std::sqrt(static_cast<double>(horizontal))));
+    roll = static_cast<float>(atan2(static_cast<double>(g.y), static_cast<double>(g.z)));
+    if (g.z < 0) {
+        pitch = static_cast<float>((pitch > 0 ? M_PI : -M_PI) - pitch);
+    }
+}
+
+void DmpTrace::append(const DmpPacketView& packet)
+{
+    qw.push_back(packet.quaternion_q14(0));
+    qx.push_back(packet.quaternion_q14(1));
+    qy.push_back(packet.quaternion_q14(2));
+    qz.push_back(packet.quaternion_q14(3));
+    accel_x.push_back(packet.accel(0));
+    accel_y.push_back(packet.accel(1));
+    accel_z.push_back(packet.accel(2));
+}
+
+void DmpTrace::reserve(size_t count)
+{
+    for (auto* field : {&qw, &qx, &qy, &qz, &accel_x, &accel_y, &accel_z}) {
+        field->reserve(count);
+    }
+}
+
+void DmpTrace::clear()
+{
+    for (auto* field : {&qw, &qx, &qy, &qz, &accel_x, &accel_y, &accel_z}) {
+        field->clear();
+    }
+}
+
+void MotionTrace::resize(size_t count)
+{
+    for (auto* field : {&gravity_x, &gravity_y, &gravity_z, &world_x, &world_y, &world_z}) {
+        field->resize(count);
+    }
+    for (auto* field : {&yaw, &pitch, &roll}) {
+        field->resize(count);
+    }
+}
+
+bool kernel_supported(BatchKernel kernel)
+{
+    switch (kernel) {
+        case BatchKernel::Scalar:
+            return true;
+#ifdef SUBSONIC_BATCH_X86
+        case BatchKernel::Sse41:
+            return __builtin_cpu_supports("sse4.1");
+        case BatchKernel::Avx2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+BatchKernel best_kernel()
+{
+    for (const auto kernel : {BatchKernel::Avx2, BatchKernel::Sse41}) {
+        if (kernel_supported(kernel)) {
+            return kernel;
+        }
+    }
+    return BatchKernel::Scalar;
+}
+
+const char* kernel_name(BatchKernel kernel)
+{
+    switch (kernel) {
+        case BatchKernel::Scalar:
+            return "scalar";
+        case BatchKernel::Sse41:
+            return "sse41";
+        case BatchKernel::Avx2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+void process_trace(const DmpTrace& trace, MotionTrace& motion, BatchKernel kernel)
+{
+    motion.resize(trace.size());
+    switch (kernel) {
+#ifdef SUBSONIC_BATCH_X86
+        case BatchKernel::Sse41:
+            process_trace_sse41(trace, motion);
+            break;
+        case BatchKernel::Avx2:
+            process_trace_avx2(trace, motion);
+            break;
+#endif
+        default:
+            process_trace_scalar(trace, motion);
+            break;
+    }
+}
+
+} // namespace subsonic_ipt::host
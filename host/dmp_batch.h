@@ -0,0 +1,138 @@
+/**
+ * dmp_batch.h - Batch processing of recorded DMP packets.
+ *
+ * The sketch decodes one packet at a time with the integer kernels in
+ * src/inputs/dmp_math.h. Recorded traces hold millions of packets, so on the
+ * host they are stored as a structure of arrays and processed several
+ * packets at a time with SSE4.1 or AVX2 where the CPU supports them.
+ *
+ * The vector kernels reproduce the gravity and world-frame acceleration of
+ * the scalar kernels exactly. The angles use a polynomial arctangent, which
+ * agrees with the scalar angles to within about 1e-6 radians.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_HOST_DMP_BATCH_H
+#define SUBSONIC_IPT_HOST_DMP_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../src/inputs/dmp_math.h"
+#include "../src/inputs/dmp_packet.h"
+
+namespace subsonic_ipt::host {
+
+/**
+ * The fields of a sequence of DMP packets used to compute the device's
+ * attitude, with one array per field.
+ *
+ * The quaternion is kept to 14 fractional bits and the accelerations are in
+ * the DMP's units of 8192 LSB per g, as read by `DmpPacketView`.
+ */
+struct DmpTrace {
+    std::vector<int16_t> qw;
+    std::vector<int16_t> qx;
+    std::vector<int16_t> qy;
+    std::vector<int16_t> qz;
+    std::vector<int16_t> accel_x;
+    std::vector<int16_t> accel_y;
+    std::vector<int16_t> accel_z;
+
+    /// Appends the fields of the given packet.
+    void append(const DmpPacketView& packet);
+
+    /// Reserves space for the given number of packets.
+    void reserve(size_t count);
+
+    /// Removes all packets.
+    void clear();
+
+    [[nodiscard]]
+    size_t size() const noexcept { return qw.size(); }
+};
+
+/**
+ * The motion computed from each packet of a `DmpTrace`.
+ *
+ * Gravity and the world-frame linear acceleration are in units of 8192 LSB
+ * per g. Angles are in radians.
+ */
+struct MotionTrace {
+    std::vector<int16_t> gravity_x;
+    std::vector<int16_t> gravity_y;
+    std::vector<int16_t> gravity_z;
+    std::vector<int16_t> world_x;
+    std::vector<int16_t> world_y;
+    std::vector<int16_t> world_z;
+    std::vector<float> yaw;
+    std::vector<float> pitch;
+    std::vector<float> roll;
+
+    /// Resizes every array to hold the given number of packets.
+    void resize(size_t count);
+
+    [[nodiscard]]
+    size_t size() const noexcept { return yaw.size(); }
+};
+
+[[nodiscard]]
+/**
+ * Returns the yaw in radians that the sketch decodes from a packet with the
+ * given orientation.
+ *
+ * A copy of the sketch's decode in src/inputs/mpu.cpp, which is checked to
+ * give the same bits by the tests.
+ */
+float decode_yaw(const dmp_math::QuaternionQ14& q) noexcept;
+
+/**
+ * Computes the pitch and roll in radians that the sketch decodes from a
+ * packet with the given gravity vector.
+ *
+ * A copy of the sketch's decode in src/inputs/mpu.cpp, which is checked to
+ * give the same bits by the tests.
+ */
+void decode_tilt(const VectorInt16& gravity, float& pitch, float& roll) noexcept;
+
+/**
+ * The implementations of `process_trace`.
+ */
+enum class BatchKernel : uint8_t {
+    /// One packet at a time, with the same arithmetic as the sketch.
+    Scalar,
+    /// Four packets at a time with SSE4.1.
+    Sse41,
+    /// Eight packets at a time with AVX2.
+    Avx2,
+};
+
+[[nodiscard]]
+/// Returns whether the given kernel was built and is supported by this CPU.
+bool kernel_supported(BatchKernel kernel);
+
+[[nodiscard]]
+/// Returns the widest kernel supported by this CPU.
+BatchKernel best_kernel();
+
+[[nodiscard]]
+/// Returns the lowercase name of the given kernel.
+const char* kernel_name(BatchKernel kernel);
+
+/**
+ * Computes the motion for every packet of the given trace with the given
+ * kernel, which must be supported.
+ *
+ * The output is resized to match the trace.
+ */
+void process_trace(const DmpTrace& trace, MotionTrace& motion, BatchKernel kernel);
+
+} // namespace subsonic_ipt::host
+
+#endif //SUBSONIC_IPT_HOST_DMP_BATCH_H
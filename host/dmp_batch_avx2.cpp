@@ -0,0 +1,32 @@
+/**
+ * dmp_batch_avx2.cpp - `process_trace` for AVX2, eight packets at a time.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include <immintrin.h>
+
+#define SUBSONIC_BATCH_LANES 8
+#include "dmp_batch_kernel.h"
+
+namespace {
+
+Floats vector_sqrt(Floats values)
+{
+    return _mm256_sqrt_ps(values);
+}
+
+} // namespace
+
+namespace subsonic_ipt::host {
+
+void process_trace_avx2(const DmpTrace& trace, MotionTrace& motion)
+{
+    process_batch(trace, motion);
+}
+
+} // namespace subsonic_ipt::host
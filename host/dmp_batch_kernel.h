@@ -0,0 +1,246 @@
+/**
+ * dmp_batch_kernel.h - The vector kernel behind the SSE4.1 and AVX2
+ *                      implementations of `process_trace`.
+ *
+ * This file is included once by each of dmp_batch_sse41.cpp and
+ * dmp_batch_avx2.cpp, which are compiled for their instruction sets. Before
+ * including it, each defines `SUBSONIC_BATCH_LANES` as the number of packets
+ * processed at a time and `vector_sqrt` for its vectors of floats. The kernel
+ * is written with GCC's vector extensions, so the same source produces
+ * 128-bit and 256-bit code.
+ *
+ * The integer steps follow src/inputs/dmp_math.cpp operation for operation
+ * in 32-bit lanes, so the gravity and world-frame acceleration match the
+ * scalar kernels bit for bit.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_BATCH_LANES
+#error "SUBSONIC_BATCH_LANES must be defined before including dmp_batch_kernel.h"
+#endif
+
+#include <cmath>
+#include <cstring>
+
+#include "dmp_batch.h"
+#include "../src/inputs/dmp_math.h"
+
+namespace {
+
+constexpr size_t LANES{SUBSONIC_BATCH_LANES};
+
+typedef int16_t Int16s __attribute__((vector_size(2 * LANES)));
+typedef int32_t Int32s __attribute__((vector_size(4 * LANES)));
+typedef float Floats __attribute__((vector_size(4 * LANES)));
+
+Floats vector_sqrt(Floats values);
+
+/// Returns a vector with every lane set to the given value.
+template<typename V, typename T>
+V splat(T value)
+{
+    return V{} + value;
+}
+
+Int32s load(const int16_t* values)
+{
+    Int16s narrow;
+    std::memcpy(&narrow, values, sizeof(narrow));
+    return __builtin_convertvector(narrow, Int32s);
+}
+
+/// Stores the lower 16 bits of each lane.
+void store(int16_t* out, Int32s values)
+{
+    const Int16s narrow = __builtin_convertvector(values, Int16s);
+    std::memcpy(out, &narrow, sizeof(narrow));
+}
+
+void store(float* out, Floats values)
+{
+    std::memcpy(out, &values, sizeof(values));
+}
+
+/**
+ * Shifts each lane right by the given number of bits, rounding to the
+ * nearest integer, and saturates it to 16 bits.
+ */
+Int32s round_shift(Int32s values, int bits)
+{
+    const Int32s rounded = (values + (1 << (bits - 1))) >> bits;
+    const Int32s max = splat<Int32s>(INT16_MAX);
+    const Int32s min = splat<Int32s>(INT16_MIN);
+    return rounded > max ? max : (rounded < min ? min : rounded);
+}
+
+/// Wraps each lane to 16 bits, as a cast to `int16_t` does.
+Int32s wrap(Int32s values)
+{
+    return __builtin_convertvector(__builtin_convertvector(values, Int16s), Int32s);
+}
+
+/**
+ * Returns the four-quadrant arctangent of each lane.
+ *
+ * Uses the degree 15 polynomial of Abramowitz and Stegun 4.4.49 on [0, 1],
+ * which is accurate to about 2e-8 radians, and the octant symmetries
+ * elsewhere. Like `atan2`, returns 0 when both arguments are zero.
+ */
+Floats vector_atan2(Floats y, Floats x)
+{
+    const Floats zero{};
+    const Floats abs_x = x < zero ? -x : x;
+    const Floats abs_y = y < zero ? -y : y;
+    const auto swap = abs_y > abs_x;
+    const Floats numerator = swap ? abs_x : abs_y;
+    const Floats denominator = swap ? abs_y : abs_x;
+    const Floats t = denominator > zero ? numerator / denominator : zero;
+    const Floats s = t * t;
+
+    Floats result = splat<Floats>(-0.0040540580f);
+    for (const float coefficient : {0.0218612288f, -0.0559098861f, 0.0964200441f, -0.1390853351f,
+                                    0.1994653599f, -0.3332985605f, 0.9999993329f}) {
+        result = result * s + coefficient;
+    }
+    result *= t;
+
+    result = swap ? static_cast<float>(M_PI / 2) - result : result;
+    result = x < zero ? static_cast<float>(M_PI) - result : result;
+    return y < zero ? -result : result;
+}
+
+/**
+ * Computes the motion for `LANES` packets.
+ *
+ * `in` points to the quaternion components w, x, y, z and the accelerations
+ * x, y, z. `out` points to gravity x, y, z and the world-frame acceleration
+ * x, y, z, and `angles` to the yaw, pitch and roll.
+ */
+void process_lanes(const int16_t* const in[7], int16_t* const out[6], float* const angles[3])
+{
+    using subsonic_ipt::dmp_math::Q14_BITS;
+
+    const Int32s w = load(in[0]);
+    const Int32s x = load(in[1]);
+    const Int32s y = load(in[2]);
+    const Int32s z = load(in[3]);
+
+    const Int32s ww = w * w;
+    const Int32s xx = x * x;
+    const Int32s yy = y * y;
+    const Int32s zz = z * z;
+    const Int32s xy = x * y;
+    const Int32s xz = x * z;
+    const Int32s yz = y * z;
+    const Int32s wx = w * x;
+    const Int32s wy = w * y;
+    const Int32s wz = w * z;
+
+    const Int32s gravity_x = round_shift(xz - wy, Q14_BITS);
+    const Int32s gravity_y = round_shift(wx + yz, Q14_BITS);
+    const Int32s gravity_z = round_shift(ww - xx - yy + zz, Q14_BITS + 1);
+
+    const Int32s linear_x = wrap(load(in[4]) - gravity_x);
+    const Int32s linear_y = wrap(load(in[5]) - gravity_y);
+    const Int32s linear_z = wrap(load(in[6]) - gravity_z);
+
+    const Int32s rotation[3][3]{
+        {
+            round_shift(ww + xx - yy - zz, Q14_BITS),
+            round_shift(xy - wz, Q14_BITS - 1),
+            round_shift(xz + wy, Q14_BITS - 1),
+        },
+        {
+            round_shift(xy + wz, Q14_BITS - 1),
+            round_shift(ww - xx + yy - zz, Q14_BITS),
+            round_shift(yz - wx, Q14_BITS - 1),
+        },
+        {
+            round_shift(xz - wy, Q14_BITS - 1),
+            round_shift(yz + wx, Q14_BITS - 1),
+            round_shift(ww - xx - yy + zz, Q14_BITS),
+        },
+    };
+
+    store(out[0], gravity_x);
+    store(out[1], gravity_y);
+    store(out[2], gravity_z);
+    for (int row = 0; row < 3; ++row) {
+        store(out[3 + row], round_shift(
+            rotation[row][0] * linear_x + rotation[row][1] * linear_y + rotation[row][2] * linear_z,
+            Q14_BITS
+        ));
+    }
+
+    const Int32s yaw_y = xy - wz;
+    const Int32s yaw_x = ww + xx - (1 << (2 * Q14_BITS - 1));
+    store(angles[0], vector_atan2(__builtin_convertvector(yaw_y, Floats), __builtin_convertvector(yaw_x, Floats)));
+
+    const Floats horizontal = __builtin_convertvector(gravity_y * gravity_y + gravity_z * gravity_z, Floats);
+    Floats pitch = vector_atan2(__builtin_convertvector(gravity_x, Floats), vector_sqrt(horizontal));
+    const Floats roll = vector_atan2(__builtin_convertvector(gravity_y, Floats), __builtin_convertvector(gravity_z, Floats));
+    const Floats half_turn = pitch > Floats{} ? splat<Floats>(static_cast<float>(M_PI)) : splat<Floats>(static_cast<float>(-M_PI));
+    pitch = gravity_z < Int32s{} ? half_turn - pitch : pitch;
+    store(angles[1], pitch);
+    store(angles[2], roll);
+}
+
+/**
+ * Computes the motion for every packet of the given trace, `LANES` at a
+ * time. The packets left over at the end are padded out to a full vector.
+ */
+void process_batch(const subsonic_ipt::host::DmpTrace& trace, subsonic_ipt::host::MotionTrace& motion)
+{
+    const size_t count = trace.size();
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        const int16_t* const in[7]{
+            &trace.qw[i], &trace.qx[i], &trace.qy[i], &trace.qz[i],
+            &trace.accel_x[i], &trace.accel_y[i], &trace.accel_z[i],
+        };
+        int16_t* const out[6]{
+            &motion.gravity_x[i], &motion.gravity_y[i], &motion.gravity_z[i],
+            &motion.world_x[i], &motion.world_y[i], &motion.world_z[i],
+        };
+        float* const angles[3]{&motion.yaw[i], &motion.pitch[i], &motion.roll[i]};
+        process_lanes(in, out, angles);
+    }
+    if (i == count) {
+        return;
+    }
+
+    const size_t remaining = count - i;
+    int16_t in_tail[7][LANES]{};
+    int16_t out_tail[6][LANES]{};
+    float angles_tail[3][LANES]{};
+    const std::vector<int16_t>* const in_fields[7]{
+        &trace.qw, &trace.qx, &trace.qy, &trace.qz, &trace.accel_x, &trace.accel_y, &trace.accel_z,
+    };
+    std::vector<int16_t>* const out_fields[6]{
+        &motion.gravity_x, &motion.gravity_y, &motion.gravity_z, &motion.world_x, &motion.world_y, &motion.world_z,
+    };
+    std::vector<float>* const angle_fields[3]{&motion.yaw, &motion.pitch, &motion.roll};
+
+    for (int field = 0; field < 7; ++field) {
+        std::memcpy(in_tail[field], &(*in_fields[field])[i], remaining * sizeof(int16_t));
+    }
+    const int16_t* const in[7]{
+        in_tail[0], in_tail[1], in_tail[2], in_tail[3], in_tail[4], in_tail[5], in_tail[6],
+    };
+    int16_t* const out[6]{out_tail[0], out_tail[1], out_tail[2], out_tail[3], out_tail[4], out_tail[5]};
+    float* const angles[3]{angles_tail[0], angles_tail[1], angles_tail[2]};
+    process_lanes(in, out, angles);
+    for (int field = 0; field < 6; ++field) {
+        std::memcpy(&(*out_fields[field])[i], out_tail[field], remaining * sizeof(int16_t));
+    }
+    for (int field = 0; field < 3; ++field) {
+        std::memcpy(&(*angle_fields[field])[i], angles_tail[field], remaining * sizeof(float));
+    }
+}
+
+} // namespace
@@ -0,0 +1,250 @@
+/**
+ * dmp_reprocess.cpp - Recomputes the attitude and world-frame acceleration
+ *                     for a capture of raw DMP packets.
+ *
+ * Captures are files of back-to-back 42 byte MotionApps 2.0 packets, such as
+ * those written by `subsonic-host --dmp-capture`. The packets are read into
+ * a `DmpTrace` and processed with the kernels in dmp_batch.h, and the time
+ * spent reading and processing them is reported separately. With --verify,
+ * the chosen kernel is checked against the scalar kernels used by the
+ * sketch.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "dmp_batch.h"
+
+namespace {
+using namespace subsonic_ipt;
+using host::BatchKernel;
+
+/// Largest difference between the angles of two kernels accepted by --verify.
+constexpr double ANGLE_TOLERANCE{1e-4};
+
+/// The number of packets read from the capture at a time.
+constexpr size_t READ_CHUNK_PACKETS{1u << 15u};
+
+struct Options {
+    BatchKernel kernel{host::best_kernel()};
+    bool verify{false};
+    unsigned repeat{1};
+    const char* csv_path{nullptr};
+    const char* capture_path{nullptr};
+};
+
+void print_usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s [--kernel scalar|sse41|avx2] [--verify] [--repeat N]\n"
+        "       [--csv PATH] CAPTURE\n"
+        "\n"
+        "  --kernel NAME  kernel to process the packets with (default: the\n"
+        "                 widest supported by this CPU)\n"
+        "  --verify       compare the results against the scalar kernel\n"
+        "  --repeat N     process the packets N times, for timing\n"
+        "  --csv PATH     write the motion computed for each packet to PATH\n",
+        program
+    );
+}
+
+bool parse_options(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--kernel") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            bool found = false;
+            for (const auto kernel : {BatchKernel::Scalar, BatchKernel::Sse41, BatchKernel::Avx2}) {
+                if (strcmp(name, host::kernel_name(kernel)) == 0) {
+                    options.kernel = kernel;
+                    found = true;
+                }
+            }
+            if (!found) {
+                return false;
+            }
+        } else if (strcmp(arg, "--verify") == 0) {
+            options.verify = true;
+        } else if (strcmp(arg, "--repeat") == 0 && i + 1 < argc) {
+            options.repeat = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(arg, "--csv") == 0 && i + 1 < argc) {
+            options.csv_path = argv[++i];
+        } else if (arg[0] != '-' && options.capture_path == nullptr) {
+            options.capture_path = arg;
+        } else {
+            return false;
+        }
+    }
+    return options.capture_path != nullptr && options.repeat > 0;
+}
+
+/**
+ * Reads every packet of the capture at the given path into the trace.
+ *
+ * Returns false on failure. Trailing bytes that do not form a whole packet
+ * are reported and ignored.
+ */
+bool read_capture(const char* path, host::DmpTrace& trace)
+{
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr) {
+        perror(path);
+        return false;
+    }
+    if (fseek(in, 0, SEEK_END) == 0) {
+        const long size = ftell(in);
+        if (size > 0) {
+            trace.reserve(static_cast<size_t>(size) / DmpPacketView::SIZE);
+        }
+        rewind(in);
+    }
+
+    std::vector<uint8_t> buffer(READ_CHUNK_PACKETS * DmpPacketView::SIZE);
+    size_t pending = 0;
+    size_t read;
+    while ((read = fread(buffer.data() + pending, 1, buffer.size() - pending, in)) > 0) {
+        const size_t available = pending + read;
+        const size_t whole = available - available % DmpPacketView::SIZE;
+        for (size_t offset = 0; offset < whole; offset += DmpPacketView::SIZE) {
+            trace.append(DmpPacketView(&buffer[offset]));
+        }
+        pending = available - whole;
+        std::memmove(buffer.data(), buffer.data() + whole, pending);
+    }
+    const bool failed = ferror(in);
+    fclose(in);
+    if (failed) {
+        perror(path);
+        return false;
+    }
+    if (pending != 0) {
+        fprintf(stderr, "%s: ignoring %zu trailing bytes\n", path, pending);
+    }
+    return true;
+}
+
+/// Returns the absolute difference between two angles, modulo 2pi.
+double angle_error(double first, double second)
+{
+    return std::fabs(std::remainder(first - second, 2 * M_PI));
+}
+
+/**
+ * Compares the motion computed by a kernel against the scalar kernel.
+ *
+ * Returns true if the integer fields are identical and the angles agree to
+ * within `ANGLE_TOLERANCE`.
+ */
+bool verify(const host::MotionTrace& motion, const host::MotionTrace& reference)
+{
+    size_t mismatches = 0;
+    double max_error = 0;
+    for (size_t i = 0; i < motion.size(); ++i) {
+        if (motion.gravity_x[i] != reference.gravity_x[i] || motion.gravity_y[i] != reference.gravity_y[i]
+            || motion.gravity_z[i] != reference.gravity_z[i] || motion.world_x[i] != reference.world_x[i]
+            || motion.world_y[i] != reference.world_y[i] || motion.world_z[i] != reference.world_z[i]) {
+            ++mismatches;
+        }
+        max_error = std::fmax(max_error, std::fmax(
+            angle_error(motion.yaw[i], reference.yaw[i]),
+            std::fmax(angle_error(motion.pitch[i], reference.pitch[i]), angle_error(motion.roll[i], reference.roll[i]))
+        ));
+    }
+    printf("verify:  %zu packets with differing accelerations, largest angle error %.3e rad\n", mismatches, max_error);
+    return mismatches == 0 && max_error <= ANGLE_TOLERANCE;
+}
+
+bool write_csv(const char* path, const host::MotionTrace& motion)
+{
+    FILE* out = fopen(path, "w");
+    if (out == nullptr) {
+        perror(path);
+        return false;
+    }
+    constexpr double DEG_PER_RAD{180 / M_PI};
+    fprintf(out, "packet,gravity_x,gravity_y,gravity_z,world_accel_x,world_accel_y,world_accel_z,yaw_deg,pitch_deg,roll_deg\n");
+    for (size_t i = 0; i < motion.size(); ++i) {
+        fprintf(
+            out,
+            "%zu,%d,%d,%d,%d,%d,%d,%.4f,%.4f,%.4f\n",
+            i,
+            motion.gravity_x[i],
+            motion.gravity_y[i],
+            motion.gravity_z[i],
+            motion.world_x[i],
+            motion.world_y[i],
+            motion.world_z[i],
+            motion.yaw[i] * DEG_PER_RAD,
+            motion.pitch[i] * DEG_PER_RAD,
+            motion.roll[i] * DEG_PER_RAD
+        );
+    }
+    return fclose(out) == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    if (!host::kernel_supported(options.kernel)) {
+        fprintf(stderr, "The %s kernel is not supported on this machine\n", host::kernel_name(options.kernel));
+        return 1;
+    }
+
+    host::DmpTrace trace;
+    const auto read_start = std::chrono::steady_clock::now();
+    if (!read_capture(options.capture_path, trace)) {
+        return 1;
+    }
+    const std::chrono::duration<double> read_s = std::chrono::steady_clock::now() - read_start;
+
+    host::MotionTrace motion;
+    const auto process_start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < options.repeat; ++i) {
+        host::process_trace(trace, motion, options.kernel);
+    }
+    const std::chrono::duration<double> process_s = std::chrono::steady_clock::now() - process_start;
+
+    const double packets = static_cast<double>(trace.size());
+    const double megabytes = packets * DmpPacketView::SIZE / 1e6;
+    const double processed_s = process_s.count() / options.repeat;
+    printf("packets: %zu (%.1f MB)\n", trace.size(), megabytes);
+    printf("read:    %.3f s, %.1f MB/s\n", read_s.count(), megabytes / read_s.count());
+    char label[16];
+    snprintf(label, sizeof(label), "%s:", host::kernel_name(options.kernel));
+    printf(
+        "%-8s %.3f s, %.1f Mpackets/s, %.1f MB/s\n",
+        label,
+        processed_s,
+        packets / processed_s / 1e6,
+        megabytes / processed_s
+    );
+
+    bool ok = true;
+    if (options.verify) {
+        host::MotionTrace reference;
+        host::process_trace(trace, reference, BatchKernel::Scalar);
+        ok = verify(motion, reference);
+    }
+    if (options.csv_path != nullptr && !write_csv(options.csv_path, motion)) {
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
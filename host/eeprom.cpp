@@ -0,0 +1,119 @@
+/**
+ * eeprom.cpp - Linux implementation of the ATmega328P's EEPROM.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+
+#include <array>
+#include <cstring>
+
+#include "host.h"
+
+/******************************************************************************\
+ * Internal definitions
+\******************************************************************************/
+namespace {
+using namespace subsonic_ipt::host;
+
+/// The time taken to erase and program a single byte.
+constexpr uint64_t BYTE_WRITE_US{3400};
+
+std::array<uint8_t, E2END + 1> g_eeprom = [] {
+    std::array<uint8_t, E2END + 1> erased{};
+    erased.fill(0xFF);
+    return erased;
+}();
+
+/**
+ * Converts a pointer into the EEPROM address space to an index into the
+ * simulated memory, wrapping around at the end as the hardware does.
+ */
+size_t eeprom_index(const void* address)
+{
+    return reinterpret_cast<uintptr_t>(address) & E2END;
+}
+
+} // namespace
+
+/******************************************************************************\
+ * Host control interface
+\******************************************************************************/
+namespace subsonic_ipt::host {
+
+void erase_eeprom()
+{
+    g_eeprom.fill(0xFF);
+}
+
+bool load_eeprom(FILE* file)
+{
+    erase_eeprom();
+    return fread(g_eeprom.data(), 1, g_eeprom.size(), file) == g_eeprom.size();
+}
+
+bool save_eeprom(FILE* file)
+{
+    return fwrite(g_eeprom.data(), 1, g_eeprom.size(), file) == g_eeprom.size();
+}
+
+} // namespace subsonic_ipt::host
+
+/******************************************************************************\
+ * avr-libc EEPROM API
+\******************************************************************************/
+
+uint8_t eeprom_read_byte(const uint8_t* address)
+{
+    charge_register_io();
+    return g_eeprom[eeprom_index(address)];
+}
+
+uint16_t eeprom_read_word(const uint16_t* address)
+{
+    uint16_t value;
+    eeprom_read_block(&value, address, sizeof(value));
+    return value;
+}
+
+void eeprom_read_block(void* destination, const void* source, size_t length)
+{
+    auto* out = static_cast<uint8_t*>(destination);
+    const auto* in = static_cast<const uint8_t*>(source);
+    for (size_t i = 0; i < length; ++i) {
+        out[i] = eeprom_read_byte(in + i);
+    }
+}
+
+void eeprom_write_byte(uint8_t* address, uint8_t value)
+{
+    advance_us(BYTE_WRITE_US);
+    g_eeprom[eeprom_index(address)] = value;
+}
+
+void eeprom_update_byte(uint8_t* address, uint8_t value)
+{
+    if (eeprom_read_byte(address) != value) {
+        eeprom_write_byte(address, value);
+    }
+}
+
+void eeprom_update_word(uint16_t* address, uint16_t value)
+{
+    eeprom_update_block(&value, address, sizeof(value));
+}
+
+void eeprom_update_block(const void* source, void* destination, size_t length)
+{
+    const auto* in = static_cast<const uint8_t*>(source);
+    auto* out = static_cast<uint8_t*>(destination);
+    for (size_t i = 0; i < length; ++i) {
+        eeprom_update_byte(out + i, in[i]);
+    }
+}
@@ -0,0 +1,189 @@
+/**
+ * host.h - Control interface for the Linux Arduino backend.
+ *
+ * The host backend replaces the Uno's hardware with a virtual clock, a
+ * simulated pin bank and an in-process I2C bus. This header is used by host
+ * executables to drive that hardware (advance time, toggle pins, attach I2C
+ * devices); it is never included by the sketch itself.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_HOST_HOST_H
+#define SUBSONIC_IPT_HOST_HOST_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <functional>
+
+namespace subsonic_ipt::host {
+
+/******************************************************************************\
+ * Virtual clock
+\******************************************************************************/
+
+/**
+ * Simulated execution cost, in microseconds, of the Arduino core calls that
+ * the sketch polls in tight loops.
+ *
+ * Each call advances the virtual clock by its cost so that busy-wait loops
+ * make progress. The defaults approximate the measured cost of the AVR core
+ * functions on a 16 MHz Uno.
+ */
+struct CallCosts {
+    uint32_t time_query_us{4};
+    uint32_t digital_io_us{4};
+    uint32_t analog_write_us{8};
+    uint32_t register_io_us{1};
+};
+
+/**
+ * Returns the current virtual time in microseconds since startup.
+ *
+ * Unlike `micros()`, querying the time through this function does not
+ * advance the virtual clock.
+ */
+uint64_t now_us();
+
+/**
+ * Advances the virtual clock by the given number of microseconds, firing
+ * any events that become due.
+ */
+void advance_us(uint64_t duration_us);
+
+/**
+ * Advances the virtual clock to the given time if it lies in the future.
+ */
+void advance_to_us(uint64_t time_us);
+
+/**
+ * Schedules the given callback to run once the virtual clock reaches the
+ * given time.
+ *
+ * Callbacks run in "interrupt context": they may toggle pins and schedule
+ * further events, but must not call back into the Arduino timing functions.
+ */
+void schedule_at(uint64_t time_us, std::function<void()> callback);
+
+/**
+ * The one-shot timers available to simulated peripherals.
+ */
+enum class PeripheralTimer : uint8_t {
+    Twi,
+    Count,
+};
+
+/**
+ * Runs the given function once the virtual clock reaches the given time,
+ * in place of any function set earlier on the same timer.
+ *
+ * Cheaper than `schedule_at`, for peripherals that have at most one
+ * operation in flight but schedule one for every byte they clock. The
+ * function runs in interrupt context, as with `schedule_at`.
+ */
+void set_peripheral_timer(PeripheralTimer timer, uint64_t time_us, void (* callback)());
+
+/**
+ * Records that the sketch drove a simulated peripheral, so that the pass of
+ * `loop` that did so is not taken for an idle one by `run_loop_pass`.
+ */
+void record_activity();
+
+/**
+ * Runs one pass of the sketch's `loop`.
+ *
+ * A pass during which no event fired, no interrupt handler ran and no
+ * peripheral was driven only polled for work that had not arrived yet. The
+ * next few passes would do the same, so the virtual clock is moved on to the
+ * next event, or by a millisecond at most, rather than simulating each of
+ * them. The sketch is unaware of this; it only saves host time.
+ */
+void run_loop_pass(void (* loop)());
+
+/**
+ * Replaces the simulated cost of core calls.
+ */
+void set_call_costs(const CallCosts& costs);
+
+/**
+ * Advances the virtual clock by the cost of a peripheral register access.
+ */
+void charge_register_io();
+
+/******************************************************************************\
+ * Pins
+\******************************************************************************/
+
+/**
+ * Drives the given digital pin to the specified level from "outside" the
+ * microcontroller, triggering any attached external interrupt.
+ */
+void set_pin_level(uint8_t pin, bool high);
+
+/**
+ * Returns the value most recently written to the given pin with
+ * `analogWrite`.
+ */
+int analog_output(uint8_t pin);
+
+/**
+ * Runs the given peripheral interrupt handler, or defers it until interrupts
+ * are re-enabled if they are currently disabled.
+ */
+void raise_vector(void (* handler)());
+
+/**
+ * Simulates a button wired between the given pin and ground (as used with
+ * INPUT_PULLUP) being held for the specified duration starting at the given
+ * virtual time.
+ */
+void schedule_button_press(uint8_t pin, uint64_t start_us, uint64_t hold_us);
+
+/******************************************************************************\
+ * Serial
+\******************************************************************************/
+
+/**
+ * Redirects bytes written to `Serial` to the given stream.
+ *
+ * Passing `nullptr` discards serial output (transmit timing is still
+ * simulated).
+ */
+void set_serial_sink(FILE* sink);
+
+/**
+ * Returns the total number of bytes written to `Serial`.
+ */
+uint64_t serial_bytes_written();
+
+/******************************************************************************\
+ * EEPROM
+\******************************************************************************/
+
+/**
+ * Erases the simulated EEPROM, setting every byte to 0xFF.
+ */
+void erase_eeprom();
+
+/**
+ * Replaces the contents of the simulated EEPROM with an image read from the
+ * given file.
+ *
+ * Returns `false` if the file does not hold a complete image, in which case
+ * the missing bytes are left erased.
+ */
+bool load_eeprom(FILE* file);
+
+/**
+ * Writes an image of the simulated EEPROM to the given file.
+ */
+bool save_eeprom(FILE* file);
+
+} // namespace subsonic_ipt::host
+
+#endif //SUBSONIC_IPT_HOST_HOST_H
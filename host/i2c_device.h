@@ -0,0 +1,69 @@
+/**
+ * i2c_device.h - Interface for simulated devices on the host I2C bus.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_HOST_I2C_DEVICE_H
+#define SUBSONIC_IPT_HOST_I2C_DEVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace subsonic_ipt::host {
+
+/**
+ * A slave device attached to the simulated I2C bus.
+ */
+class I2CDevice {
+  public:
+    virtual ~I2CDevice() = default;
+
+    /**
+     * Handles a master write transaction addressed to this device.
+     */
+    virtual void on_write(const uint8_t* data, size_t length) = 0;
+
+    /**
+     * Handles a master read transaction addressed to this device.
+     *
+     * Returns the number of bytes written to `data`.
+     */
+    virtual size_t on_read(uint8_t* data, size_t length) = 0;
+};
+
+/**
+ * Attaches the given device to the bus at the specified 7-bit address.
+ *
+ * The device must outlive its attachment. Passing `nullptr` detaches any
+ * device at that address.
+ */
+void attach_i2c_device(uint8_t address, I2CDevice* device);
+
+/**
+ * Returns the number of bytes (including address bytes) that have been
+ * clocked over the bus to or from the given address.
+ */
+uint64_t i2c_bytes_transferred(uint8_t address);
+
+/**
+ * Returns the device attached at the given 7-bit address, or `nullptr`.
+ *
+ * Used by the simulated bus masters (Wire and the TWI peripheral).
+ */
+I2CDevice* i2c_device(uint8_t address);
+
+/**
+ * Adds the given number of bytes to the traffic counted for an address.
+ *
+ * Used by the simulated bus masters (Wire and the TWI peripheral).
+ */
+void record_i2c_bytes(uint8_t address, uint64_t bytes);
+
+} // namespace subsonic_ipt::host
+
+#endif //SUBSONIC_IPT_HOST_I2C_DEVICE_H
@@ -0,0 +1,247 @@
+/**
+ * main.cpp - Entry point for running the sketch as a Linux executable.
+ *
+ * Runs `setup()` and then `loop()` against the host Arduino backend until the
+ * requested amount of virtual time has elapsed. Because all waiting happens
+ * on a virtual clock, hours of device operation complete in seconds.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "../src/pin.h"
+
+#include "host.h"
+#include "i2c_device.h"
+#include "motion.h"
+#include "mpu6050_emulator.h"
+#include "openlcd.h"
+
+// Sketch entry points defined in sketch.cpp.
+void setup();
+void loop();
+
+namespace {
+using namespace subsonic_ipt;
+
+/**
+ * Command line options accepted by the host runner.
+ */
+struct Options {
+    /// The amount of virtual time to run the sketch for.
+    double seconds{600};
+    /// Path to write the sketch's serial output to, or null for stdout.
+    const char* serial_path{nullptr};
+    /// Whether to discard the sketch's serial output.
+    bool quiet{false};
+    /// Whether to print the final contents of the LCD.
+    bool show_screen{false};
+    /// Path to a recorded motion trace, or null for the synthetic walk.
+    const char* motion_path{nullptr};
+    /// DMP packet rate to force, or 0 to use the rate set by the firmware.
+    double packet_rate_hz{0};
+    /// Path to an EEPROM image loaded before the run and saved after it, or
+    /// null to start from an erased EEPROM.
+    const char* eeprom_path{nullptr};
+    /// Path to write every DMP packet produced by the emulated MPU to, or
+    /// null.
+    const char* dmp_capture_path{nullptr};
+    /// Whether to fail the run if any DMP packet was lost.
+    bool strict{false};
+};
+
+void print_usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s [--seconds N] [--serial PATH | --quiet] [--screen]\n"
+        "       [--motion PATH] [--packet-rate HZ] [--eeprom PATH]\n"
+        "       [--dmp-capture PATH] [--strict]\n"
+        "\n"
+        "  --seconds N       virtual seconds to simulate (default 600)\n"
+        "  --serial PATH     write the sketch's serial output to PATH\n"
+        "  --quiet           discard the sketch's serial output\n"
+        "  --screen          print the LCD contents when the run ends\n"
+        "  --motion PATH     replay the motion trace at PATH (CSV of\n"
+        "                    time_s,yaw_deg,pitch_deg,roll_deg[,ax,ay,az])\n"
+        "  --packet-rate HZ  force the emulated DMP to the given packet rate\n"
+        "  --eeprom PATH     load the EEPROM from PATH, if it exists, and save\n"
+        "                    it there when the run ends\n"
+        "  --dmp-capture PATH\n"
+        "                    write each DMP packet produced to PATH, for\n"
+        "                    dmp-reprocess\n"
+        "  --strict          exit with an error if the MPU's FIFO overflowed\n"
+        "                    or any DMP packet produced was not read\n",
+        program
+    );
+}
+
+bool parse_options(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--seconds") == 0 && i + 1 < argc) {
+            options.seconds = atof(argv[++i]);
+        } else if (strcmp(arg, "--serial") == 0 && i + 1 < argc) {
+            options.serial_path = argv[++i];
+        } else if (strcmp(arg, "--quiet") == 0) {
+            options.quiet = true;
+        } else if (strcmp(arg, "--screen") == 0) {
+            options.show_screen = true;
+        } else if (strcmp(arg, "--motion") == 0 && i + 1 < argc) {
+            options.motion_path = argv[++i];
+        } else if (strcmp(arg, "--packet-rate") == 0 && i + 1 < argc) {
+            options.packet_rate_hz = atof(argv[++i]);
+        } else if (strcmp(arg, "--eeprom") == 0 && i + 1 < argc) {
+            options.eeprom_path = argv[++i];
+        } else if (strcmp(arg, "--dmp-capture") == 0 && i + 1 < argc) {
+            options.dmp_capture_path = argv[++i];
+        } else if (strcmp(arg, "--strict") == 0) {
+            options.strict = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    FILE* serial_file = nullptr;
+    if (options.quiet) {
+        host::set_serial_sink(nullptr);
+    } else if (options.serial_path != nullptr) {
+        serial_file = fopen(options.serial_path, "w");
+        if (serial_file == nullptr) {
+            perror(options.serial_path);
+            return 1;
+        }
+        host::set_serial_sink(serial_file);
+    }
+
+    host::CircleWalk circle_walk;
+    host::RecordedMotion recorded_motion;
+    const host::MotionSource* motion = &circle_walk;
+    if (options.motion_path != nullptr) {
+        std::string error;
+        if (!recorded_motion.load(options.motion_path, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        motion = &recorded_motion;
+    }
+
+    host::OpenLCD lcd;
+    host::attach_i2c_device(0x72, &lcd);
+    host::MPU6050Emulator mpu(motion, INTERRUPT_PIN);
+    host::attach_i2c_device(host::MPU6050Emulator::ADDRESS, &mpu);
+    if (options.packet_rate_hz > 0) {
+        mpu.set_packet_rate_hz(options.packet_rate_hz);
+    }
+    FILE* dmp_capture_file = nullptr;
+    if (options.dmp_capture_path != nullptr) {
+        dmp_capture_file = fopen(options.dmp_capture_path, "wb");
+        if (dmp_capture_file == nullptr) {
+            perror(options.dmp_capture_path);
+            return 1;
+        }
+        mpu.set_packet_capture(dmp_capture_file);
+    }
+
+    if (options.eeprom_path != nullptr) {
+        FILE* eeprom_file = fopen(options.eeprom_path, "rb");
+        if (eeprom_file != nullptr) {
+            host::load_eeprom(eeprom_file);
+            fclose(eeprom_file);
+        }
+    }
+
+    // The sketch waits for a button press before calibrating the MPU, unless
+    // a valid calibration is stored in the EEPROM.
+    host::schedule_button_press(static_cast<Pin>(ButtonPin::Enter), 3000000, 200000);
+
+    const auto end_us = static_cast<uint64_t>(options.seconds * 1e6);
+    const auto wall_start = std::chrono::steady_clock::now();
+
+    setup();
+    uint64_t iterations = 0;
+    while (host::now_us() < end_us) {
+        host::run_loop_pass(loop);
+        ++iterations;
+    }
+
+    const std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wall_start;
+    Serial.flush();
+    if (serial_file != nullptr) {
+        fclose(serial_file);
+    }
+    if (dmp_capture_file != nullptr) {
+        mpu.set_packet_capture(nullptr);
+        fclose(dmp_capture_file);
+    }
+
+    if (options.eeprom_path != nullptr) {
+        FILE* eeprom_file = fopen(options.eeprom_path, "wb");
+        if (eeprom_file == nullptr || !host::save_eeprom(eeprom_file)) {
+            perror(options.eeprom_path);
+        }
+        if (eeprom_file != nullptr) {
+            fclose(eeprom_file);
+        }
+    }
+
+    if (options.show_screen) {
+        lcd.dump(stderr);
+    }
+    const double virtual_s = static_cast<double>(host::now_us()) / 1e6;
+    fprintf(
+        stderr,
+        "Simulated %.1f s in %.3f s wall time (%.0fx realtime)\n"
+        "  loop() iterations: %llu\n"
+        "  serial bytes:      %llu\n"
+        "  LCD bus bytes:     %llu\n"
+        "  DMP packets:       %llu produced at %.0f Hz, %llu read\n"
+        "  FIFO overflows:    %llu\n",
+        virtual_s,
+        wall.count(),
+        virtual_s / wall.count(),
+        static_cast<unsigned long long>(iterations),
+        static_cast<unsigned long long>(host::serial_bytes_written()),
+        static_cast<unsigned long long>(host::i2c_bytes_transferred(0x72)),
+        static_cast<unsigned long long>(mpu.counters().packets_produced),
+        mpu.packet_rate_hz(),
+        static_cast<unsigned long long>(mpu.counters().fifo_bytes_read / host::MPU6050Emulator::PACKET_SIZE),
+        static_cast<unsigned long long>(mpu.counters().overflow_events)
+    );
+
+    if (options.strict) {
+        // Packets still in the FIFO when the run ends are not lost.
+        const host::MPU6050Emulator::Counters& counters = mpu.counters();
+        const uint64_t unread_bytes = counters.packets_produced * host::MPU6050Emulator::PACKET_SIZE
+                                      - counters.fifo_bytes_read;
+        if (counters.overflow_events != 0 || unread_bytes > mpu.fifo_count()) {
+            fprintf(stderr, "DMP packets were lost\n");
+            return 1;
+        }
+    }
+    return 0;
+}
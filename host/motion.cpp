@@ -0,0 +1,161 @@
+/**
+ * motion.cpp - Implementation of simulated device motion sources.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "motion.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+
+namespace {
+using namespace subsonic_ipt::host;
+
+constexpr double DEG = M_PI / 180.0;
+
+/**
+ * Returns `to` shifted by a multiple of 2pi so that it lies within pi of
+ * `from`.
+ */
+double unwrap(double from, double to)
+{
+    while (to - from > M_PI) { to -= 2 * M_PI; }
+    while (to - from < -M_PI) { to += 2 * M_PI; }
+    return to;
+}
+
+} // namespace
+
+namespace subsonic_ipt::host {
+
+CircleWalk::CircleWalk(double still_s, double turn_period_s, double tilt_deg)
+    : m_still_s(still_s), m_turn_period_s(turn_period_s), m_tilt_rad(tilt_deg * DEG) {}
+
+MotionSample CircleWalk::sample(double time_s) const
+{
+    MotionSample sample;
+    const double walk_s = time_s - m_still_s;
+    if (walk_s <= 0) {
+        return sample;
+    }
+    // Tilt the device forward over the first second of the walk.
+    sample.yaw = fmod(walk_s * 2 * M_PI / m_turn_period_s, 2 * M_PI);
+    sample.roll = m_tilt_rad * (walk_s < 1 ? walk_s : 1);
+    return sample;
+}
+
+bool RecordedMotion::load(const std::string& path, std::string& error)
+{
+    std::ifstream file(path);
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    m_times.clear();
+    m_samples.clear();
+
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        double values[7]{};
+        int count = sscanf(
+            line.c_str(),
+            "%lf,%lf,%lf,%lf,%lf,%lf,%lf",
+            &values[0], &values[1], &values[2], &values[3], &values[4], &values[5], &values[6]
+        );
+        if (count <= 0 && m_samples.empty()) {
+            // Header row.
+            continue;
+        }
+        if (count != 4 && count != 7) {
+            error = path + ":" + std::to_string(line_number) + ": expected 4 or 7 columns";
+            return false;
+        }
+        if (!m_times.empty() && values[0] <= m_times.back()) {
+            error = path + ":" + std::to_string(line_number) + ": timestamps must increase";
+            return false;
+        }
+        MotionSample sample;
+        sample.yaw = values[1] * DEG;
+        sample.pitch = values[2] * DEG;
+        sample.roll = values[3] * DEG;
+        sample.accel[0] = values[4];
+        sample.accel[1] = values[5];
+        sample.accel[2] = values[6];
+        m_times.push_back(values[0]);
+        m_samples.push_back(sample);
+    }
+    if (m_samples.empty()) {
+        error = path + ": trace contains no samples";
+        return false;
+    }
+    return true;
+}
+
+MotionSample RecordedMotion::sample(double time_s) const
+{
+    if (m_samples.size() == 1 || duration_s() <= 0) {
+        return m_samples.front();
+    }
+    time_s = fmod(time_s, duration_s());
+    const auto next = std::upper_bound(m_times.begin(), m_times.end(), time_s);
+    if (next == m_times.begin()) {
+        return m_samples.front();
+    }
+    if (next == m_times.end()) {
+        return m_samples.back();
+    }
+    const size_t i = static_cast<size_t>(next - m_times.begin());
+    const auto& a = m_samples[i - 1];
+    const auto& b = m_samples[i];
+    const double f = (time_s - m_times[i - 1]) / (m_times[i] - m_times[i - 1]);
+    const auto lerp = [f](double x, double y) { return x + (y - x) * f; };
+
+    MotionSample sample;
+    sample.yaw = lerp(a.yaw, unwrap(a.yaw, b.yaw));
+    sample.pitch = lerp(a.pitch, unwrap(a.pitch, b.pitch));
+    sample.roll = lerp(a.roll, unwrap(a.roll, b.roll));
+    for (int axis = 0; axis < 3; ++axis) {
+        sample.accel[axis] = lerp(a.accel[axis], b.accel[axis]);
+    }
+    return sample;
+}
+
+UnitQuaternion orientation_quaternion(const MotionSample& sample)
+{
+    const double cy = cos(sample.yaw / 2), sy = sin(sample.yaw / 2);
+    const double cp = cos(sample.pitch / 2), sp = sin(sample.pitch / 2);
+    const double cr = cos(sample.roll / 2), sr = sin(sample.roll / 2);
+    return {
+        cr * cp * cy + sr * sp * sy,
+        sr * cp * cy - cr * sp * sy,
+        cr * sp * cy + sr * cp * sy,
+        cr * cp * sy - sr * sp * cy,
+    };
+}
+
+void world_to_device(const UnitQuaternion& q, const double world[3], double device[3])
+{
+    // v' = conj(q) * v * q, expanded into a rotation matrix transpose.
+    const double ww = q.w * q.w, xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    const double xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    const double wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    device[0] = (ww + xx - yy - zz) * world[0] + 2 * (xy + wz) * world[1] + 2 * (xz - wy) * world[2];
+    device[1] = 2 * (xy - wz) * world[0] + (ww - xx + yy - zz) * world[1] + 2 * (yz + wx) * world[2];
+    device[2] = 2 * (xz + wy) * world[0] + 2 * (yz - wx) * world[1] + (ww - xx - yy + zz) * world[2];
+}
+
+} // namespace subsonic_ipt::host
@@ -0,0 +1,123 @@
+/**
+ * motion.h - Sources of simulated device motion for the host MPU emulator.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_HOST_MOTION_H
+#define SUBSONIC_IPT_HOST_MOTION_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace subsonic_ipt::host {
+
+/**
+ * The true orientation and acceleration of the device at an instant.
+ *
+ * Orientation is given as Z-Y-X (yaw, pitch, roll) Euler angles in radians
+ * with yaw measured counterclockwise about the vertical axis. Acceleration is
+ * the world-frame linear acceleration in meters per second squared, excluding
+ * gravity.
+ */
+struct MotionSample {
+    double yaw{0};
+    double pitch{0};
+    double roll{0};
+    double accel[3]{0, 0, 0};
+};
+
+/**
+ * A unit quaternion in (w, x, y, z) order.
+ */
+struct UnitQuaternion {
+    double w{1};
+    double x{0};
+    double y{0};
+    double z{0};
+};
+
+/**
+ * A continuous-time description of device motion.
+ */
+class MotionSource {
+  public:
+    virtual ~MotionSource() = default;
+
+    /**
+     * Returns the device's motion at the given time in seconds.
+     */
+    virtual MotionSample sample(double time_s) const = 0;
+};
+
+/**
+ * Synthetic motion of a user walking in a slow circle while holding the
+ * device tilted forward.
+ *
+ * The device is held level and still for a while before the walk begins, as
+ * a user would while the sketch calibrates the MPU.
+ */
+class CircleWalk : public MotionSource {
+    double m_still_s;
+    double m_turn_period_s;
+    double m_tilt_rad;
+
+  public:
+    explicit CircleWalk(double still_s = 5.0, double turn_period_s = 60.0, double tilt_deg = 30.0);
+
+    MotionSample sample(double time_s) const override;
+};
+
+/**
+ * Motion replayed from a recorded trace, linearly interpolated between
+ * samples and looped once the end of the trace is reached.
+ *
+ * Traces are CSV files whose rows contain
+ *
+ *     time_s,yaw_deg,pitch_deg,roll_deg[,accel_x,accel_y,accel_z]
+ *
+ * Blank lines, lines starting with '#' and a non-numeric header row are
+ * ignored.
+ */
+class RecordedMotion : public MotionSource {
+    std::vector<double> m_times;
+    std::vector<MotionSample> m_samples;
+
+  public:
+    /**
+     * Loads the trace at the given path.
+     *
+     * Returns false and leaves `error` describing the problem on failure.
+     */
+    bool load(const std::string& path, std::string& error);
+
+    [[nodiscard]]
+    size_t size() const { return m_samples.size(); }
+
+    [[nodiscard]]
+    double duration_s() const { return m_times.empty() ? 0 : m_times.back(); }
+
+    MotionSample sample(double time_s) const override;
+};
+
+/**
+ * Returns the quaternion that rotates the device frame into the world frame
+ * for the given orientation.
+ */
+UnitQuaternion orientation_quaternion(const MotionSample& sample);
+
+/**
+ * Rotates the given world-frame vector into the device frame described by
+ * the given orientation quaternion.
+ */
+void world_to_device(const UnitQuaternion& q, const double world[3], double device[3]);
+
+} // namespace subsonic_ipt::host
+
+#endif //SUBSONIC_IPT_HOST_MOTION_H
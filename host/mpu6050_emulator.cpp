@@ -0,0 +1,446 @@
+/**
+ * mpu6050_emulator.cpp - Implementation of the emulated MPU6050.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "mpu6050_emulator.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "../src/vendor/i2cdevlib/MPU6050.h"
+
+#include "host.h"
+
+/******************************************************************************\
+ * Internal definitions
+\******************************************************************************/
+namespace {
+using namespace subsonic_ipt::host;
+
+/// Length of the interrupt pulse when interrupt latching is disabled.
+constexpr uint64_t INTERRUPT_PULSE_US = 50;
+
+/// Sample rate of the gyroscope output with the DLPF enabled.
+constexpr double GYRO_OUTPUT_RATE_HZ = 1000;
+
+/// Location of the FIFO rate divisor in the MotionApps 2.0 firmware image.
+constexpr uint8_t DMP_RATE_DIVISOR_BANK = 0x02;
+constexpr uint8_t DMP_RATE_DIVISOR_ADDRESS = 0x16;
+
+/// Scale of the accelerometer and gyroscope values in DMP packets.
+constexpr double DMP_ACCEL_LSB_PER_G = 8192;
+constexpr double DMP_GYRO_LSB_PER_DPS = 16.4;
+
+/// Scale of the offset registers, independent of the full scale range.
+constexpr double ACCEL_OFFSET_LSB_PER_G = 2048;
+constexpr double GYRO_OFFSET_LSB_PER_DPS = 32.8;
+
+/// Interval used to differentiate orientation into angular rate.
+constexpr double RATE_STEP_S = 1e-3;
+
+constexpr double RAD_PER_DEG = M_PI / 180.0;
+
+/// Room temperature in the units of the TEMP_OUT registers.
+constexpr int16_t ROOM_TEMPERATURE_RAW = static_cast<int16_t>((25.0 - 36.53) * 340);
+
+int16_t saturate_int16(double value)
+{
+    if (value >= INT16_MAX) { return INT16_MAX; }
+    if (value <= INT16_MIN) { return INT16_MIN; }
+    return static_cast<int16_t>(lround(value));
+}
+
+void put_int32(uint8_t* out, int32_t value)
+{
+    const auto bits = static_cast<uint32_t>(value);
+    out[0] = static_cast<uint8_t>(bits >> 24);
+    out[1] = static_cast<uint8_t>(bits >> 16);
+    out[2] = static_cast<uint8_t>(bits >> 8);
+    out[3] = static_cast<uint8_t>(bits);
+}
+
+/**
+ * Returns the angular rate of the device in its own frame, in degrees per
+ * second, by differentiating the motion source's orientation.
+ */
+void body_rate_dps(const MotionSource& motion, double time_s, double rate[3])
+{
+    const auto q1 = orientation_quaternion(motion.sample(time_s));
+    const auto q2 = orientation_quaternion(motion.sample(time_s + RATE_STEP_S));
+    // The vector part of conj(q1) * q2 is half the rotation between the
+    // two samples, expressed in the body frame.
+    const double dx = q1.w * q2.x - q1.x * q2.w - q1.y * q2.z + q1.z * q2.y;
+    const double dy = q1.w * q2.y + q1.x * q2.z - q1.y * q2.w - q1.z * q2.x;
+    const double dz = q1.w * q2.z - q1.x * q2.y + q1.y * q2.x - q1.z * q2.w;
+    const double scale = 2 / RATE_STEP_S / RAD_PER_DEG;
+    rate[0] = dx * scale;
+    rate[1] = dy * scale;
+    rate[2] = dz * scale;
+}
+
+/**
+ * Returns the specific force measured by an accelerometer in the device
+ * frame, in g.
+ */
+void body_specific_force_g(const MotionSample& sample, const UnitQuaternion& q, double force[3])
+{
+    constexpr double STANDARD_GRAVITY = 9.80665;
+    const double world[3]{
+        sample.accel[0] / STANDARD_GRAVITY,
+        sample.accel[1] / STANDARD_GRAVITY,
+        sample.accel[2] / STANDARD_GRAVITY + 1.0,
+    };
+    world_to_device(q, world, force);
+}
+
+} // namespace
+
+/******************************************************************************\
+ * Public definitions
+\******************************************************************************/
+namespace subsonic_ipt::host {
+
+MPU6050Emulator::MPU6050Emulator(const MotionSource* motion, uint8_t interrupt_pin, const SensorBias& bias)
+    : m_motion(motion), m_interrupt_pin(interrupt_pin), m_bias(bias)
+{
+    reset();
+}
+
+void MPU6050Emulator::on_write(const uint8_t* data, size_t length)
+{
+    if (length == 0) {
+        return;
+    }
+    m_register_pointer = data[0] & 0x7Fu;
+    for (size_t i = 1; i < length; ++i) {
+        const uint8_t address = m_register_pointer;
+        write_register(address, data[i]);
+        if (address != MPU6050_RA_FIFO_R_W && address != MPU6050_RA_MEM_R_W) {
+            m_register_pointer = (m_register_pointer + 1) & 0x7Fu;
+        }
+    }
+}
+
+size_t MPU6050Emulator::on_read(uint8_t* data, size_t length)
+{
+    // Latch the sensor registers once per transaction so that multi-byte
+    // readings are coherent.
+    if (m_register_pointer >= MPU6050_RA_ACCEL_XOUT_H && m_register_pointer <= MPU6050_RA_GYRO_ZOUT_L) {
+        for (uint8_t axis = 0; axis < 3; ++axis) {
+            const auto accel = static_cast<uint16_t>(sensor_reading(false, axis));
+            const auto gyro = static_cast<uint16_t>(sensor_reading(true, axis));
+            m_registers[MPU6050_RA_ACCEL_XOUT_H + 2 * axis] = static_cast<uint8_t>(accel >> 8);
+            m_registers[MPU6050_RA_ACCEL_XOUT_L + 2 * axis] = static_cast<uint8_t>(accel);
+            m_registers[MPU6050_RA_GYRO_XOUT_H + 2 * axis] = static_cast<uint8_t>(gyro >> 8);
+            m_registers[MPU6050_RA_GYRO_XOUT_L + 2 * axis] = static_cast<uint8_t>(gyro);
+        }
+        const auto temperature = static_cast<uint16_t>(ROOM_TEMPERATURE_RAW);
+        m_registers[MPU6050_RA_TEMP_OUT_H] = static_cast<uint8_t>(temperature >> 8);
+        m_registers[MPU6050_RA_TEMP_OUT_L] = static_cast<uint8_t>(temperature);
+    }
+
+    for (size_t i = 0; i < length; ++i) {
+        const uint8_t address = m_register_pointer;
+        data[i] = read_register(address);
+        if (address != MPU6050_RA_FIFO_R_W && address != MPU6050_RA_MEM_R_W) {
+            m_register_pointer = (m_register_pointer + 1) & 0x7Fu;
+        }
+    }
+    return length;
+}
+
+void MPU6050Emulator::set_packet_rate_hz(double rate_hz)
+{
+    m_packet_rate_override_hz = rate_hz;
+    update_production(true);
+}
+
+double MPU6050Emulator::packet_rate_hz() const
+{
+    if (m_packet_rate_override_hz > 0) {
+        return m_packet_rate_override_hz;
+    }
+    const uint8_t* divisor = &m_memory[DMP_RATE_DIVISOR_BANK][DMP_RATE_DIVISOR_ADDRESS];
+    const double dmp_divisor = (divisor[0] << 8u) | divisor[1];
+    return GYRO_OUTPUT_RATE_HZ / (1.0 + m_registers[MPU6050_RA_SMPLRT_DIV]) / (1.0 + dmp_divisor);
+}
+
+/******************************************************************************\
+ * Register file
+\******************************************************************************/
+
+void MPU6050Emulator::reset()
+{
+    memset(m_registers, 0, sizeof(m_registers));
+    m_registers[MPU6050_RA_PWR_MGMT_1] = _BV(MPU6050_PWR1_SLEEP_BIT);
+    m_registers[MPU6050_RA_WHO_AM_I] = ADDRESS;
+    m_fifo_head = 0;
+    m_fifo_count = 0;
+    m_yaw_drift_rad = 0;
+    update_production();
+}
+
+uint8_t MPU6050Emulator::read_register(uint8_t address)
+{
+    switch (address) {
+        case MPU6050_RA_INT_STATUS: {
+            const uint8_t status = m_registers[MPU6050_RA_INT_STATUS];
+            m_registers[MPU6050_RA_INT_STATUS] = 0;
+            if (m_registers[MPU6050_RA_INT_PIN_CFG] & _BV(MPU6050_INTCFG_LATCH_INT_EN_BIT)) {
+                const bool active_low = m_registers[MPU6050_RA_INT_PIN_CFG] & _BV(MPU6050_INTCFG_INT_LEVEL_BIT);
+                set_pin_level(m_interrupt_pin, active_low);
+            }
+            return status;
+        }
+        case MPU6050_RA_FIFO_COUNTH:
+            return static_cast<uint8_t>(m_fifo_count >> 8);
+        case MPU6050_RA_FIFO_COUNTL:
+            return static_cast<uint8_t>(m_fifo_count);
+        case MPU6050_RA_FIFO_R_W: {
+            // Reading an empty FIFO repeats the last byte read.
+            if (m_fifo_count > 0) {
+                m_fifo_last_read = m_fifo[m_fifo_head];
+                m_fifo_head = (m_fifo_head + 1) % FIFO_CAPACITY;
+                --m_fifo_count;
+                ++m_counters.fifo_bytes_read;
+            }
+            return m_fifo_last_read;
+        }
+        case MPU6050_RA_MEM_R_W: {
+            const uint8_t bank = m_registers[MPU6050_RA_BANK_SEL] & 0x1Fu;
+            const uint8_t offset = m_registers[MPU6050_RA_MEM_START_ADDR]++;
+            return bank < MEMORY_BANKS ? m_memory[bank][offset] : 0;
+        }
+        default:
+            return m_registers[address];
+    }
+}
+
+void MPU6050Emulator::write_register(uint8_t address, uint8_t value)
+{
+    switch (address) {
+        case MPU6050_RA_PWR_MGMT_1: {
+            if (value & _BV(MPU6050_PWR1_DEVICE_RESET_BIT)) {
+                reset();
+            } else {
+                m_registers[address] = value;
+                update_production();
+            }
+            break;
+        }
+        case MPU6050_RA_USER_CTRL: {
+            if (value & _BV(MPU6050_USERCTRL_FIFO_RESET_BIT)) {
+                m_fifo_head = 0;
+                m_fifo_count = 0;
+                ++m_counters.fifo_resets;
+            }
+            // The reset bits clear themselves once the reset completes.
+            m_registers[address] = value & 0xF0u;
+            update_production();
+            break;
+        }
+        case MPU6050_RA_SMPLRT_DIV: {
+            m_registers[address] = value;
+            update_production(true);
+            break;
+        }
+        case MPU6050_RA_FIFO_R_W:
+            fifo_push(&value, 1);
+            break;
+        case MPU6050_RA_MEM_R_W: {
+            const uint8_t bank = m_registers[MPU6050_RA_BANK_SEL] & 0x1Fu;
+            const uint8_t offset = m_registers[MPU6050_RA_MEM_START_ADDR]++;
+            if (bank < MEMORY_BANKS) {
+                m_memory[bank][offset] = value;
+            }
+            break;
+        }
+        case MPU6050_RA_INT_STATUS:
+        case MPU6050_RA_FIFO_COUNTH:
+        case MPU6050_RA_FIFO_COUNTL:
+        case MPU6050_RA_WHO_AM_I:
+            // Read only.
+            break;
+        default:
+            if (address >= MPU6050_RA_ACCEL_XOUT_H && address <= MPU6050_RA_GYRO_ZOUT_L) {
+                break;
+            }
+            m_registers[address] = value;
+            break;
+    }
+}
+
+/******************************************************************************\
+ * DMP output
+\******************************************************************************/
+
+void MPU6050Emulator::update_production(bool rate_changed)
+{
+    const uint8_t user_ctrl = m_registers[MPU6050_RA_USER_CTRL];
+    const bool should_produce = (user_ctrl & _BV(MPU6050_USERCTRL_DMP_EN_BIT))
+        && (user_ctrl & _BV(MPU6050_USERCTRL_FIFO_EN_BIT))
+        && !(m_registers[MPU6050_RA_PWR_MGMT_1] & _BV(MPU6050_PWR1_SLEEP_BIT));
+
+    if (should_produce == m_producing && !(m_producing && rate_changed)) {
+        return;
+    }
+    m_producing = should_produce;
+    ++m_packet_generation;
+    if (m_producing) {
+        schedule_packet(m_packet_generation);
+    }
+}
+
+void MPU6050Emulator::schedule_packet(uint32_t generation)
+{
+    const auto period_us = static_cast<uint64_t>(llround(1e6 / packet_rate_hz()));
+    schedule_at(now_us() + period_us, [this, generation]() {
+        if (generation != m_packet_generation) {
+            return;
+        }
+        produce_packet();
+        schedule_packet(generation);
+    });
+}
+
+void MPU6050Emulator::produce_packet()
+{
+    const double time_s = static_cast<double>(now_us()) / 1e6;
+    const double dt = 1.0 / packet_rate_hz();
+
+    // Without a magnetometer, the DMP integrates any residual gyro bias
+    // about the vertical axis into its heading.
+    m_yaw_drift_rad += residual_gyro_dps(2) * RAD_PER_DEG * dt;
+
+    MotionSample sample = m_motion->sample(time_s);
+    const auto true_orientation = orientation_quaternion(sample);
+    sample.yaw += m_yaw_drift_rad;
+    const auto q = orientation_quaternion(sample);
+
+    double force[3];
+    body_specific_force_g(sample, true_orientation, force);
+    double rate[3];
+    body_rate_dps(*m_motion, time_s, rate);
+
+    uint8_t packet[PACKET_SIZE]{};
+    const double components[4]{q.w, q.x, q.y, q.z};
+    for (int i = 0; i < 4; ++i) {
+        put_int32(&packet[4 * i], static_cast<int32_t>(llround(components[i] * (1 << 30))));
+    }
+    for (uint8_t axis = 0; axis < 3; ++axis) {
+        const auto gyro = saturate_int16((rate[axis] + residual_gyro_dps(axis)) * DMP_GYRO_LSB_PER_DPS);
+        const auto accel = saturate_int16(
+            (force[axis] + residual_accel_g(axis)) * DMP_ACCEL_LSB_PER_G + noise()
+        );
+        put_int32(&packet[16 + 4 * axis], static_cast<int32_t>(static_cast<uint32_t>(gyro) << 16u));
+        put_int32(&packet[28 + 4 * axis], static_cast<int32_t>(static_cast<uint32_t>(accel) << 16u));
+    }
+
+    if (m_packet_capture != nullptr) {
+        fwrite(packet, 1, PACKET_SIZE, m_packet_capture);
+    }
+    fifo_push(packet, PACKET_SIZE);
+    ++m_counters.packets_produced;
+    raise_interrupt(_BV(MPU6050_INTERRUPT_DMP_INT_BIT));
+}
+
+void MPU6050Emulator::fifo_push(const uint8_t* data, uint16_t length)
+{
+    const bool overflowed = m_fifo_count + length > FIFO_CAPACITY;
+    const bool keep_oldest = m_registers[MPU6050_RA_CONFIG] & _BV(6);
+    for (uint16_t i = 0; i < length; ++i) {
+        if (m_fifo_count == FIFO_CAPACITY) {
+            ++m_counters.bytes_dropped;
+            if (keep_oldest) {
+                continue;
+            }
+            // Overwrite the oldest byte.
+            m_fifo_head = (m_fifo_head + 1) % FIFO_CAPACITY;
+            --m_fifo_count;
+        }
+        m_fifo[(m_fifo_head + m_fifo_count) % FIFO_CAPACITY] = data[i];
+        ++m_fifo_count;
+    }
+    if (overflowed) {
+        if (!m_fifo_overflowing) {
+            ++m_counters.overflow_events;
+        }
+        raise_interrupt(_BV(MPU6050_INTERRUPT_FIFO_OFLOW_BIT));
+    }
+    m_fifo_overflowing = overflowed;
+}
+
+void MPU6050Emulator::raise_interrupt(uint8_t status_bit)
+{
+    m_registers[MPU6050_RA_INT_STATUS] |= status_bit;
+    if (!(m_registers[MPU6050_RA_INT_ENABLE] & status_bit)) {
+        return;
+    }
+    const uint8_t pin_cfg = m_registers[MPU6050_RA_INT_PIN_CFG];
+    const bool active_low = pin_cfg & _BV(MPU6050_INTCFG_INT_LEVEL_BIT);
+    set_pin_level(m_interrupt_pin, !active_low);
+    if (!(pin_cfg & _BV(MPU6050_INTCFG_LATCH_INT_EN_BIT))) {
+        const uint8_t pin = m_interrupt_pin;
+        schedule_at(now_us() + INTERRUPT_PULSE_US, [pin, active_low]() { set_pin_level(pin, active_low); });
+    }
+}
+
+/******************************************************************************\
+ * Sensor model
+\******************************************************************************/
+
+int16_t MPU6050Emulator::register_word(uint8_t address) const
+{
+    return static_cast<int16_t>((m_registers[address] << 8u) | m_registers[address + 1]);
+}
+
+int16_t MPU6050Emulator::sensor_reading(bool gyro, uint8_t axis)
+{
+    const double time_s = static_cast<double>(now_us()) / 1e6;
+    if (gyro) {
+        const uint8_t range = (m_registers[MPU6050_RA_GYRO_CONFIG] >> 3u) & 0x3u;
+        const double lsb_per_dps = 131.0 / (1u << range);
+        double rate[3];
+        body_rate_dps(*m_motion, time_s, rate);
+        return saturate_int16((rate[axis] + residual_gyro_dps(axis)) * lsb_per_dps + noise());
+    }
+    const uint8_t range = (m_registers[MPU6050_RA_ACCEL_CONFIG] >> 3u) & 0x3u;
+    const double lsb_per_g = 16384.0 / (1u << range);
+    const auto sample = m_motion->sample(time_s);
+    double force[3];
+    body_specific_force_g(sample, orientation_quaternion(sample), force);
+    return saturate_int16((force[axis] + residual_accel_g(axis)) * lsb_per_g + noise());
+}
+
+double MPU6050Emulator::residual_gyro_dps(uint8_t axis) const
+{
+    const int16_t offset = register_word(MPU6050_RA_XG_OFFS_USRH + 2 * axis);
+    return m_bias.gyro_dps[axis] + offset / GYRO_OFFSET_LSB_PER_DPS;
+}
+
+double MPU6050Emulator::residual_accel_g(uint8_t axis) const
+{
+    const int16_t offset = register_word(MPU6050_RA_XA_OFFS_H + 2 * axis);
+    return m_bias.accel_g[axis] + offset / ACCEL_OFFSET_LSB_PER_G;
+}
+
+int16_t MPU6050Emulator::noise()
+{
+    if (m_bias.noise_lsb == 0) {
+        return 0;
+    }
+    // xorshift32; deterministic so that runs are reproducible.
+    m_noise_state ^= m_noise_state << 13u;
+    m_noise_state ^= m_noise_state >> 17u;
+    m_noise_state ^= m_noise_state << 5u;
+    const uint32_t span = 2u * m_bias.noise_lsb + 1u;
+    return static_cast<int16_t>(static_cast<int32_t>(m_noise_state % span) - m_bias.noise_lsb);
+}
+
+} // namespace subsonic_ipt::host
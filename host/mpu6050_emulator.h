@@ -0,0 +1,184 @@
+/**
+ * mpu6050_emulator.h - Register-level simulation of an MPU6050 running the
+ *                      MotionApps 2.0 DMP firmware.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_HOST_MPU6050_EMULATOR_H
+#define SUBSONIC_IPT_HOST_MPU6050_EMULATOR_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "i2c_device.h"
+#include "motion.h"
+
+namespace subsonic_ipt::host {
+
+/**
+ * Uncorrected sensor errors of an emulated MPU6050.
+ */
+struct SensorBias {
+    /// Accelerometer bias in g.
+    double accel_g[3]{0.02, -0.015, 0.03};
+    /// Gyroscope bias in degrees per second.
+    double gyro_dps[3]{1.5, -0.8, 0.6};
+    /// Peak amplitude of the noise added to each sensor reading, in LSB.
+    uint8_t noise_lsb{2};
+};
+
+/**
+ * I2C device that emulates an MPU6050 at the register level.
+ *
+ * The emulator serves the same register transactions that the i2cdevlib
+ * MPU6050 driver performs against real hardware: the register file and its
+ * reset values, the DMP memory banks, the 1024 byte FIFO and the interrupt
+ * status bits. Once the DMP is enabled, 42 byte MotionApps 2.0 packets
+ * describing the motion source are pushed into the FIFO on the virtual clock
+ * and the interrupt pin is pulsed, just as the sketch sees on the device.
+ *
+ * The raw sensor registers carry the configured sensor biases, corrected by
+ * whatever offsets the driver writes to the offset registers, so the
+ * driver's calibration routines converge as they do on hardware. Any bias
+ * left uncorrected shows up as yaw drift in the DMP output.
+ */
+class MPU6050Emulator : public I2CDevice {
+  public:
+    /// The default I2C address of the MPU6050.
+    static constexpr uint8_t ADDRESS = 0x68;
+
+    /// The size of the packets produced by the MotionApps 2.0 firmware.
+    static constexpr uint16_t PACKET_SIZE = 42;
+
+    /// The capacity of the MPU6050's FIFO.
+    static constexpr uint16_t FIFO_CAPACITY = 1024;
+
+    /**
+     * Running totals describing the emulator's activity.
+     */
+    struct Counters {
+        /// DMP packets pushed into the FIFO.
+        uint64_t packets_produced{0};
+        /// Bytes read out of the FIFO by the host.
+        uint64_t fifo_bytes_read{0};
+        /// Times the FIFO filled and began discarding data.
+        uint64_t overflow_events{0};
+        /// Bytes discarded due to FIFO overflow.
+        uint64_t bytes_dropped{0};
+        /// FIFO resets requested through USER_CTRL.
+        uint64_t fifo_resets{0};
+    };
+
+  private:
+    static constexpr uint16_t MEMORY_BANKS = 8;
+    static constexpr uint16_t BANK_SIZE = 256;
+
+    const MotionSource* m_motion;
+    uint8_t m_interrupt_pin;
+    SensorBias m_bias;
+
+    uint8_t m_registers[128]{};
+    uint8_t m_register_pointer{0};
+    uint8_t m_memory[MEMORY_BANKS][BANK_SIZE]{};
+
+    uint8_t m_fifo[FIFO_CAPACITY]{};
+    uint16_t m_fifo_head{0};
+    uint16_t m_fifo_count{0};
+    uint8_t m_fifo_last_read{0};
+    /// Whether the most recent push into the FIFO discarded data.
+    bool m_fifo_overflowing{false};
+
+    /// Packet rate forced by the host, or 0 to follow the configuration.
+    double m_packet_rate_override_hz{0};
+    /// Incremented to cancel the pending packet event.
+    uint32_t m_packet_generation{0};
+    bool m_producing{false};
+
+    /// Yaw error accumulated by the DMP from uncorrected gyro bias.
+    double m_yaw_drift_rad{0};
+    uint32_t m_noise_state{0x2545F491u};
+
+    Counters m_counters{};
+
+    /// File that each produced packet is appended to, or null.
+    FILE* m_packet_capture{nullptr};
+
+  public:
+    /**
+     * Creates an emulated MPU6050 whose motion is described by the given
+     * source and whose interrupt output drives the given pin.
+     *
+     * The motion source must outlive the emulator.
+     */
+    MPU6050Emulator(const MotionSource* motion, uint8_t interrupt_pin, const SensorBias& bias = SensorBias{});
+
+    void on_write(const uint8_t* data, size_t length) override;
+
+    size_t on_read(uint8_t* data, size_t length) override;
+
+    /**
+     * Forces the DMP to produce packets at the given rate regardless of the
+     * rate configured by the driver. Passing 0 restores the configured rate.
+     */
+    void set_packet_rate_hz(double rate_hz);
+
+    /**
+     * Appends every packet produced from now on to the given file, as it is
+     * pushed into the FIFO. Passing null stops the capture.
+     */
+    void set_packet_capture(FILE* capture) { m_packet_capture = capture; }
+
+    [[nodiscard]]
+    /// Returns the rate at which the DMP currently produces packets.
+    double packet_rate_hz() const;
+
+    [[nodiscard]]
+    uint16_t fifo_count() const { return m_fifo_count; }
+
+    [[nodiscard]]
+    const Counters& counters() const { return m_counters; }
+
+  private:
+    void reset();
+
+    uint8_t read_register(uint8_t address);
+
+    void write_register(uint8_t address, uint8_t value);
+
+    /**
+     * Starts or stops packet production to match the current configuration,
+     * restarting the packet schedule if the rate changed.
+     */
+    void update_production(bool rate_changed = false);
+
+    void schedule_packet(uint32_t generation);
+
+    void produce_packet();
+
+    void fifo_push(const uint8_t* data, uint16_t length);
+
+    void raise_interrupt(uint8_t status_bit);
+
+    /// Returns the value of the given big-endian register pair.
+    int16_t register_word(uint8_t address) const;
+
+    /// Returns the raw accelerometer or gyroscope reading on the given axis.
+    int16_t sensor_reading(bool gyro, uint8_t axis);
+
+    /// Returns the residual gyroscope bias on the given axis in degrees/s.
+    double residual_gyro_dps(uint8_t axis) const;
+
+    /// Returns the residual accelerometer bias on the given axis in g.
+    double residual_accel_g(uint8_t axis) const;
+
+    int16_t noise();
+};
+
+} // namespace subsonic_ipt::host
+
+#endif //SUBSONIC_IPT_HOST_MPU6050_EMULATOR_H
@@ -0,0 +1,180 @@
+/**
+ * mpu_bench.cpp - Measures the DMP packet rate the sketch can sustain.
+ *
+ * For each packet rate in a sweep, the sketch is run against the emulated
+ * MPU6050 and the number of packets it consumes is compared against the
+ * number produced. The highest rate at which the sketch never reaches its
+ * "FIFO overflow!" path is reported as the sustainable rate.
+ *
+ * Each rate is measured in a forked child process so that every run starts
+ * from the sketch's initial global state.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include <Arduino.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../src/pin.h"
+
+#include "host.h"
+#include "motion.h"
+#include "mpu6050_emulator.h"
+#include "openlcd.h"
+
+// Sketch entry points defined in sketch.cpp.
+void setup();
+void loop();
+
+namespace {
+using namespace subsonic_ipt;
+
+/**
+ * Results measured for a single packet rate.
+ */
+struct RateResult {
+    double rate_hz;
+    uint64_t packets_produced;
+    uint64_t packets_read;
+    uint64_t loop_iterations;
+    uint64_t overflow_events;
+};
+
+/**
+ * Runs the sketch at the given packet rate for the given number of virtual
+ * seconds after setup completes.
+ */
+RateResult measure_rate(double rate_hz, double seconds)
+{
+    host::set_serial_sink(nullptr);
+
+    host::CircleWalk motion;
+    host::OpenLCD lcd;
+    host::attach_i2c_device(0x72, &lcd);
+    host::MPU6050Emulator mpu(&motion, INTERRUPT_PIN);
+    host::attach_i2c_device(host::MPU6050Emulator::ADDRESS, &mpu);
+    mpu.set_packet_rate_hz(rate_hz);
+
+    host::schedule_button_press(static_cast<Pin>(ButtonPin::Enter), 3000000, 200000);
+    setup();
+
+    // Only count activity after setup, which resets the FIFO itself.
+    const auto baseline = mpu.counters();
+    const uint64_t end_us = host::now_us() + static_cast<uint64_t>(seconds * 1e6);
+    uint64_t iterations = 0;
+    while (host::now_us() < end_us) {
+        host::run_loop_pass(loop);
+        ++iterations;
+    }
+
+    const auto& counters = mpu.counters();
+    return RateResult{
+        rate_hz,
+        counters.packets_produced - baseline.packets_produced,
+        (counters.fifo_bytes_read - baseline.fifo_bytes_read) / host::MPU6050Emulator::PACKET_SIZE,
+        iterations,
+        counters.overflow_events - baseline.overflow_events,
+    };
+}
+
+/**
+ * Measures the given rate in a child process.
+ *
+ * Returns false if the child failed to report a result.
+ */
+bool measure_rate_isolated(double rate_hz, double seconds, RateResult& result)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return false;
+    }
+    const pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        return false;
+    }
+    if (child == 0) {
+        close(fds[0]);
+        const RateResult measured = measure_rate(rate_hz, seconds);
+        const bool ok = write(fds[1], &measured, sizeof(measured)) == sizeof(measured);
+        _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+    const bool ok = read(fds[0], &result, sizeof(result)) == sizeof(result);
+    close(fds[0]);
+    int status = 0;
+    waitpid(child, &status, 0);
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+void print_usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s [--seconds N] [RATE_HZ...]\n"
+        "\n"
+        "  --seconds N  virtual seconds to measure each rate for (default 30)\n"
+        "  RATE_HZ      packet rates to measure (default 5 to 200 Hz)\n",
+        program
+    );
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    double seconds = 30;
+    std::vector<double> rates;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (atof(argv[i]) > 0) {
+            rates.push_back(atof(argv[i]));
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (rates.empty()) {
+        rates = {5, 10, 15, 20, 25, 30, 40, 50, 75, 100, 150, 200};
+    }
+
+    printf("%8s %10s %10s %10s %10s %10s\n", "rate_hz", "produced", "read", "read_hz", "loops", "overflows");
+    double sustained_hz = 0;
+    bool sustained = true;
+    for (const double rate : rates) {
+        RateResult result{};
+        if (!measure_rate_isolated(rate, seconds, result)) {
+            fprintf(stderr, "measurement at %.1f Hz failed\n", rate);
+            return 1;
+        }
+        printf(
+            "%8.1f %10llu %10llu %10.1f %10llu %10llu\n",
+            result.rate_hz,
+            static_cast<unsigned long long>(result.packets_produced),
+            static_cast<unsigned long long>(result.packets_read),
+            static_cast<double>(result.packets_read) / seconds,
+            static_cast<unsigned long long>(result.loop_iterations),
+            static_cast<unsigned long long>(result.overflow_events)
+        );
+        if (result.overflow_events != 0) {
+            sustained = false;
+        } else if (sustained) {
+            sustained_hz = rate;
+        }
+    }
+    printf("Highest rate sustained without FIFO overflow: %.1f Hz\n", sustained_hz);
+    return 0;
+}
@@ -0,0 +1,643 @@
+/**
+ * nav_sweep.cpp - Replays recorded motion traces through the sketch's dead
+ *                 reckoning and guidance for a grid of tuning parameters.
+ *
+ * The traces are listed in a manifest whose rows contain
+ *
+ *     trace_path,end_x_m,end_y_m[,arrive_s]
+ *
+ * where (end_x_m, end_y_m) is the measured position at which the walk
+ * recorded in the trace ended, relative to where it started, and arrive_s is
+ * the time at which the user reached it (the end of the trace by default).
+ * Trace paths are relative to the manifest. Blank lines, lines starting with
+ * '#' and a non-numeric header row are ignored.
+ *
+ * Each trace is sampled at the DMP's packet rate, quantized into the DMP's
+ * quaternion and decoded with src/inputs/dmp_math.h, as the emulated MPU and
+ * the sketch do, and fed to `DeadReckoning` and `Guidance` with the ground
+ * truth endpoint as the destination. Every pairing of a parameter set and a
+ * trace is an independent task on a `WorkStealingPool`, with its own device
+ * state, navigator and guidance, so the sweep scales with the number of
+ * cores. With --scaling, the sweep is run once for each of the given thread
+ * counts, and the time taken by each is printed along with its speedup over
+ * the first. The runs must give identical results.
+ *
+ * Parameter sets are ranked by, in order: the smallest mean distance between
+ * the tracked and true endpoints, the fewest traces whose end was not
+ * reported as an arrival, the least time spent reporting an arrival before
+ * the user arrived, and the fewest changes of the displayed instruction per
+ * minute. The pitch-to-velocity mapping and true pitch axis are therefore
+ * chosen by their tracking error, then the smallest arrival threshold that
+ * still reports every arrival, then the steadiest snap tolerance.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "dmp_batch.h"
+#include "motion.h"
+#include "work_stealing_pool.h"
+#include "../src/dead_reckoning.h"
+#include "../src/guidance.h"
+#include "../src/navigator.h"
+#include "../src/inputs/dmp_math.h"
+
+namespace {
+using namespace subsonic_ipt;
+
+/// The most rows accepted in a pitch-to-velocity mapping.
+constexpr uint8_t MAX_MAPPING_ROWS{8};
+
+/// How often the sketch refreshes the guidance shown on the display.
+constexpr unsigned long GUIDANCE_PERIOD_U{100000};
+
+/**
+ * A recorded walk and where it ended.
+ */
+struct Trace {
+    std::string path;
+    host::RecordedMotion motion;
+    double end_x;
+    double end_y;
+    double arrive_s;
+};
+
+/**
+ * A pitch-to-velocity mapping for `DeadReckoning`.
+ */
+struct Mapping {
+    DeadReckoning::PitchVelocity rows[MAX_MAPPING_ROWS];
+    uint8_t row_count;
+    std::string text;
+};
+
+/**
+ * One point of the parameter grid.
+ */
+struct ParameterSet {
+    const Mapping* mapping;
+    double arrival_threshold;
+    double snap_tolerance_deg;
+    float DeviceMotion::* true_pitch;
+};
+
+/**
+ * The outcome of replaying one trace with one parameter set.
+ */
+struct TraceResult {
+    /// Distance between the tracked and true endpoints, in meters.
+    double end_error;
+    /// Whether the guidance reported an arrival at the end of the trace.
+    bool arrived;
+    /// Seconds during which an arrival was reported before `arrive_s`.
+    double early_arrival_s;
+    /// The number of times the displayed instruction changed.
+    unsigned instruction_changes;
+    /// The number of packets replayed.
+    unsigned long packets;
+};
+
+/**
+ * The outcome of replaying every trace with one parameter set.
+ */
+struct Score {
+    size_t parameters;
+    size_t missed_arrivals;
+    double mean_end_error;
+    double early_arrival_s;
+    double changes_per_minute;
+};
+
+/**
+ * The instructions shown by `GuidanceMenu`.
+ */
+enum class Instruction : uint8_t {
+    Arrived,
+    Forward,
+    Backward,
+    Left,
+    Right,
+};
+
+struct Options {
+    const char* manifest_path{nullptr};
+    std::vector<Mapping> mappings;
+    std::vector<double> arrival_thresholds;
+    std::vector<double> snap_tolerances_deg;
+    std::vector<float DeviceMotion::*> true_pitches;
+    double packet_rate_hz{100};
+    size_t threads{0};
+    /// Thread counts to time the sweep with, or empty to run it once.
+    std::vector<double> scaling;
+    size_t top{10};
+    const char* csv_path{nullptr};
+};
+
+void print_usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s [--mapping P:V,...]... [--arrival M,...] [--snap DEG,...]\n"
+        "       [--true-pitch pitch|roll,...] [--packet-rate HZ] [--threads N]\n"
+        "       [--scaling N,...] [--top N] [--csv PATH] MANIFEST\n"
+        "\n"
+        "  --mapping P:V,...    a pitch-to-velocity mapping to try, as rows of\n"
+        "                       pitch in degrees and velocity in m/s (default\n"
+        "                       10:0,45:1.5,90:2); may be repeated\n"
+        "  --arrival M,...      arrival thresholds to try, in meters (default 0.5)\n"
+        "  --snap DEG,...       snap tolerances to try, in degrees (default 10)\n"
+        "  --true-pitch AXES    the angles to try as the true pitch (default roll)\n"
+        "  --packet-rate HZ     the DMP packet rate to replay at (default 100)\n"
+        "  --threads N          worker threads (default: one per hardware thread)\n"
+        "  --scaling N,...      run the sweep with each number of threads and\n"
+        "                       print how its time scales\n"
+        "  --top N              the number of parameter sets to print (default 10)\n"
+        "  --csv PATH           write the score of every parameter set to PATH\n",
+        program
+    );
+}
+
+/**
+ * Parses a comma separated list of numbers, appending them to `values`.
+ */
+bool parse_list(const char* text, std::vector<double>& values)
+{
+    while (*text != '\0') {
+        char* end;
+        values.push_back(strtod(text, &end));
+        if (end == text || (*end != ',' && *end != '\0')) {
+            return false;
+        }
+        text = *end == ',' ? end + 1 : end;
+    }
+    return true;
+}
+
+/**
+ * Parses a pitch-to-velocity mapping written as "pitch:velocity,...".
+ */
+bool parse_mapping(const char* text, Mapping& mapping)
+{
+    mapping.row_count = 0;
+    mapping.text = text;
+    while (*text != '\0') {
+        if (mapping.row_count == MAX_MAPPING_ROWS) {
+            return false;
+        }
+        char* end;
+        const double pitch = strtod(text, &end);
+        if (end == text || *end != ':') {
+            return false;
+        }
+        text = end + 1;
+        const double velocity = strtod(text, &end);
+        if (end == text || (*end != ',' && *end != '\0')) {
+            return false;
+        }
+        mapping.rows[mapping.row_count][0] = Scalar{pitch};
+        mapping.rows[mapping.row_count][1] = Scalar{velocity};
+        ++mapping.row_count;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return mapping.row_count > 0;
+}
+
+bool parse_true_pitches(const char* text, std::vector<float DeviceMotion::*>& axes)
+{
+    std::string list{text};
+    size_t start = 0;
+    while (start <= list.size()) {
+        const size_t end = std::min(list.find(',', start), list.size());
+        const std::string axis = list.substr(start, end - start);
+        if (axis == "pitch") {
+            axes.push_back(&DeviceMotion::pitch);
+        } else if (axis == "roll") {
+            axes.push_back(&DeviceMotion::roll);
+        } else {
+            return false;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+bool parse_options(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--mapping") == 0 && has_value) {
+            options.mappings.emplace_back();
+            if (!parse_mapping(argv[++i], options.mappings.back())) {
+                return false;
+            }
+        } else if (strcmp(arg, "--arrival") == 0 && has_value) {
+            if (!parse_list(argv[++i], options.arrival_thresholds)) {
+                return false;
+            }
+        } else if (strcmp(arg, "--snap") == 0 && has_value) {
+            if (!parse_list(argv[++i], options.snap_tolerances_deg)) {
+                return false;
+            }
+        } else if (strcmp(arg, "--true-pitch") == 0 && has_value) {
+            if (!parse_true_pitches(argv[++i], options.true_pitches)) {
+                return false;
+            }
+        } else if (strcmp(arg, "--packet-rate") == 0 && has_value) {
+            options.packet_rate_hz = atof(argv[++i]);
+        } else if (strcmp(arg, "--threads") == 0 && has_value) {
+            options.threads = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--scaling") == 0 && has_value) {
+            if (!parse_list(argv[++i], options.scaling)) {
+                return false;
+            }
+        } else if (strcmp(arg, "--top") == 0 && has_value) {
+            options.top = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--csv") == 0 && has_value) {
+            options.csv_path = argv[++i];
+        } else if (arg[0] != '-' && options.manifest_path == nullptr) {
+            options.manifest_path = arg;
+        } else {
+            return false;
+        }
+    }
+
+    // The sketch's own settings.
+    if (options.mappings.empty()) {
+        options.mappings.emplace_back();
+        parse_mapping("10:0,45:1.5,90:2", options.mappings.back());
+    }
+    if (options.arrival_thresholds.empty()) {
+        options.arrival_thresholds.push_back(0.5);
+    }
+    if (options.snap_tolerances_deg.empty()) {
+        options.snap_tolerances_deg.push_back(10);
+    }
+    if (options.true_pitches.empty()) {
+        options.true_pitches.push_back(&DeviceMotion::roll);
+    }
+    return options.manifest_path != nullptr && options.packet_rate_hz > 0;
+}
+
+/**
+ * Loads the manifest at the given path and every trace it lists.
+ *
+ * Returns false and leaves `error` describing the problem on failure.
+ */
+bool load_manifest(const std::string& path, std::vector<Trace>& traces, std::string& error)
+{
+    std::ifstream file(path);
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    const size_t slash = path.rfind('/');
+    const std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        const size_t comma = line.find(',');
+        double values[3]{0, 0, -1};
+        const int count = comma == std::string::npos
+            ? 0
+            : sscanf(line.c_str() + comma + 1, "%lf,%lf,%lf", &values[0], &values[1], &values[2]);
+        if (count <= 0 && traces.empty()) {
+            // Header row.
+            continue;
+        }
+        if (count != 2 && count != 3) {
+            error = path + ":" + std::to_string(line_number) + ": expected trace_path,end_x_m,end_y_m[,arrive_s]";
+            return false;
+        }
+        const std::string trace_path = line.substr(0, comma);
+        Trace& trace = traces.emplace_back();
+        trace.path = trace_path[0] == '/' ? trace_path : directory + trace_path;
+        if (!trace.motion.load(trace.path, error)) {
+            return false;
+        }
+        trace.end_x = values[0];
+        trace.end_y = values[1];
+        trace.arrive_s = count == 3 ? values[2] : trace.motion.duration_s();
+    }
+    if (traces.empty()) {
+        error = path + ": manifest lists no traces";
+        return false;
+    }
+    return true;
+}
+
+Instruction instruction(const GuidanceSnapshot& guidance)
+{
+    if (guidance.arrived) {
+        return Instruction::Arrived;
+    }
+    if (guidance.near_forward) {
+        return Instruction::Forward;
+    }
+    if (guidance.near_backward) {
+        return Instruction::Backward;
+    }
+    return guidance.direction.m_y > 0 ? Instruction::Left : Instruction::Right;
+}
+
+/**
+ * Returns the motion that the sketch would decode from the DMP packet
+ * produced for the given sample.
+ */
+DeviceMotion decode_sample(const host::MotionSample& sample, unsigned long timestamp_u)
+{
+    // Quantized as the emulated MPU writes the quaternion into its packets,
+    // then truncated to the 14 fractional bits that the sketch reads.
+    const host::UnitQuaternion q = host::orientation_quaternion(sample);
+    const auto q14 = [](double component) {
+        return static_cast<int16_t>(std::llround(component * (1 << 30)) >> 16);
+    };
+    const dmp_math::QuaternionQ14 packet_q{q14(q.w), q14(q.x), q14(q.y), q14(q.z)};
+
+    DeviceMotion motion{};
+    motion.timestamp_u = timestamp_u;
+    motion.gravity = dmp_math::gravity(packet_q);
+    motion.yaw = host::decode_yaw(packet_q);
+    host::decode_tilt(motion.gravity, motion.pitch, motion.roll);
+    motion.fields = static_cast<MotionField>(MotionYaw | MotionTilt | MotionGravity);
+    return motion;
+}
+
+/**
+ * Replays the given trace through a freshly started device configured with
+ * the given parameters.
+ */
+TraceResult replay(const Trace& trace, const ParameterSet& parameters, double packet_rate_hz)
+{
+    IPTState state{};
+    Navigator navigator{};
+    navigator.overwrite_destination(Point{Scalar{trace.end_x}, Scalar{trace.end_y}});
+    Guidance guidance(
+        &state,
+        &navigator,
+        BinaryAngle::from_degrees(parameters.snap_tolerance_deg),
+        Scalar{parameters.arrival_threshold}
+    );
+    DeadReckoning dead_reckoning(parameters.mapping->rows, parameters.mapping->row_count, parameters.true_pitch);
+
+    TraceResult result{};
+    const double period_s = 1 / packet_rate_hz;
+    const auto duration_u = static_cast<unsigned long>(trace.motion.duration_s() * 1e6);
+    unsigned long next_guidance_u = 0;
+    bool has_instruction = false;
+    Instruction shown{};
+    // Packets are numbered from one, so the first is sampled one period into
+    // the trace.
+    for (unsigned long packet = 1;; ++packet) {
+        const double time_s = static_cast<double>(packet) * period_s;
+        const auto timestamp_u = static_cast<unsigned long>(std::lround(time_s * 1e6));
+        if (timestamp_u > duration_u) {
+            break;
+        }
+        dead_reckoning.update(state, decode_sample(trace.motion.sample(time_s), timestamp_u));
+        ++result.packets;
+
+        if (timestamp_u < next_guidance_u) {
+            continue;
+        }
+        next_guidance_u = timestamp_u + GUIDANCE_PERIOD_U;
+        const Instruction current = instruction(guidance.snapshot());
+        if (has_instruction && current != shown) {
+            ++result.instruction_changes;
+        }
+        shown = current;
+        has_instruction = true;
+        if (current == Instruction::Arrived && time_s < trace.arrive_s) {
+            result.early_arrival_s += std::min(GUIDANCE_PERIOD_U * 1e-6, trace.arrive_s - time_s);
+        }
+    }
+
+    result.arrived = guidance.snapshot().arrived;
+    result.end_error = std::hypot(
+        static_cast<double>(state.position.m_x) - trace.end_x,
+        static_cast<double>(state.position.m_y) - trace.end_y
+    );
+    return result;
+}
+
+/**
+ * Replays every trace with every parameter set on a pool of the given number
+ * of threads, or one per hardware thread for zero.
+ *
+ * Returns the number of threads used.
+ */
+size_t run_sweep(
+    const std::vector<Trace>& traces,
+    const std::vector<ParameterSet>& grid,
+    double packet_rate_hz,
+    size_t threads,
+    std::vector<TraceResult>& results
+)
+{
+    // One slot per task, so that the workers never write to shared results.
+    results.assign(grid.size() * traces.size(), TraceResult{});
+    host::WorkStealingPool pool(threads);
+    for (size_t p = 0; p < grid.size(); ++p) {
+        for (size_t t = 0; t < traces.size(); ++t) {
+            pool.submit([&, p, t] {
+                results[p * traces.size() + t] = replay(traces[t], grid[p], packet_rate_hz);
+            });
+        }
+    }
+    pool.wait();
+    return pool.size();
+}
+
+/// Returns whether two sweeps gave the same result for every pairing.
+bool same_results(const std::vector<TraceResult>& first, const std::vector<TraceResult>& second)
+{
+    return std::equal(first.begin(), first.end(), second.begin(), second.end(), [](const auto& a, const auto& b) {
+        return a.end_error == b.end_error && a.arrived == b.arrived && a.early_arrival_s == b.early_arrival_s
+               && a.instruction_changes == b.instruction_changes && a.packets == b.packets;
+    });
+}
+
+/// Returns whether the first score ranks above the second.
+bool ranks_above(const Score& first, const Score& second)
+{
+    if (first.mean_end_error != second.mean_end_error) {
+        return first.mean_end_error < second.mean_end_error;
+    }
+    if (first.missed_arrivals != second.missed_arrivals) {
+        return first.missed_arrivals < second.missed_arrivals;
+    }
+    if (first.early_arrival_s != second.early_arrival_s) {
+        return first.early_arrival_s < second.early_arrival_s;
+    }
+    return first.changes_per_minute < second.changes_per_minute;
+}
+
+const char* axis_name(float DeviceMotion::* axis)
+{
+    return axis == &DeviceMotion::pitch ? "pitch" : "roll";
+}
+
+bool write_csv(const char* path, const std::vector<Score>& scores, const std::vector<ParameterSet>& grid)
+{
+    FILE* out = fopen(path, "w");
+    if (out == nullptr) {
+        perror(path);
+        return false;
+    }
+    fprintf(out, "rank,mapping,arrival_m,snap_deg,true_pitch,missed_arrivals,mean_end_error_m,early_arrival_s,changes_per_min\n");
+    for (size_t rank = 0; rank < scores.size(); ++rank) {
+        const Score& score = scores[rank];
+        const ParameterSet& parameters = grid[score.parameters];
+        fprintf(
+            out,
+            "%zu,\"%s\",%g,%g,%s,%zu,%.4f,%.2f,%.2f\n",
+            rank + 1,
+            parameters.mapping->text.c_str(),
+            parameters.arrival_threshold,
+            parameters.snap_tolerance_deg,
+            axis_name(parameters.true_pitch),
+            score.missed_arrivals,
+            score.mean_end_error,
+            score.early_arrival_s,
+            score.changes_per_minute
+        );
+    }
+    return fclose(out) == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<Trace> traces;
+    std::string error;
+    if (!load_manifest(options.manifest_path, traces, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    std::vector<ParameterSet> grid;
+    for (const Mapping& mapping : options.mappings) {
+        for (const double arrival : options.arrival_thresholds) {
+            for (const double snap : options.snap_tolerances_deg) {
+                for (const auto true_pitch : options.true_pitches) {
+                    grid.push_back(ParameterSet{&mapping, arrival, snap, true_pitch});
+                }
+            }
+        }
+    }
+
+    std::vector<TraceResult> results;
+    size_t threads = 0;
+    std::chrono::duration<double> wall{};
+    const auto time_sweep = [&](size_t requested) {
+        const auto start = std::chrono::steady_clock::now();
+        threads = run_sweep(traces, grid, options.packet_rate_hz, requested, results);
+        wall = std::chrono::steady_clock::now() - start;
+    };
+    if (options.scaling.empty()) {
+        time_sweep(options.threads);
+    } else {
+        printf("%7s %9s %8s %10s\n", "threads", "wall (s)", "speedup", "efficiency");
+        std::vector<TraceResult> first;
+        double first_s = 0;
+        size_t first_threads = 0;
+        for (const double requested : options.scaling) {
+            time_sweep(static_cast<size_t>(requested));
+            if (first.empty()) {
+                first = results;
+                first_s = wall.count();
+                first_threads = threads;
+            } else if (!same_results(first, results)) {
+                fprintf(stderr, "results on %zu threads differ from those on %zu\n", threads, first_threads);
+                return 1;
+            }
+            const double speedup = first_s / wall.count();
+            printf(
+                "%7zu %9.3f %7.2fx %9.0f%%\n",
+                threads,
+                wall.count(),
+                speedup,
+                100 * speedup * static_cast<double>(first_threads) / static_cast<double>(threads)
+            );
+        }
+        printf("\n");
+    }
+
+    double minutes = 0;
+    for (const Trace& trace : traces) {
+        minutes += trace.motion.duration_s() / 60;
+    }
+    std::vector<Score> scores;
+    unsigned long packets = 0;
+    for (size_t p = 0; p < grid.size(); ++p) {
+        Score score{p, 0, 0, 0, 0};
+        for (size_t t = 0; t < traces.size(); ++t) {
+            const TraceResult& result = results[p * traces.size() + t];
+            score.missed_arrivals += result.arrived ? 0 : 1;
+            score.mean_end_error += result.end_error / traces.size();
+            score.early_arrival_s += result.early_arrival_s;
+            score.changes_per_minute += result.instruction_changes / minutes;
+            packets += result.packets;
+        }
+        scores.push_back(score);
+    }
+    std::stable_sort(scores.begin(), scores.end(), ranks_above);
+
+    printf(
+        "%zu parameter sets x %zu traces on %zu threads in %.3f s (%.1f Mpackets/s)\n\n",
+        grid.size(),
+        traces.size(),
+        threads,
+        wall.count(),
+        packets / wall.count() / 1e6
+    );
+    printf("%4s  %-24s %7s %6s %5s %6s %9s %8s %9s\n",
+           "rank", "mapping", "arrival", "snap", "pitch", "missed", "end error", "early", "changes");
+    printf("%4s  %-24s %7s %6s %5s %6s %9s %8s %9s\n", "", "(deg:m/s)", "(m)", "(deg)", "", "", "(m)", "(s)", "(/min)");
+    for (size_t rank = 0; rank < std::min(options.top, scores.size()); ++rank) {
+        const Score& score = scores[rank];
+        const ParameterSet& parameters = grid[score.parameters];
+        printf(
+            "%4zu  %-24s %7g %6g %5s %6zu %9.3f %8.2f %9.2f\n",
+            rank + 1,
+            parameters.mapping->text.c_str(),
+            parameters.arrival_threshold,
+            parameters.snap_tolerance_deg,
+            axis_name(parameters.true_pitch),
+            score.missed_arrivals,
+            score.mean_end_error,
+            score.early_arrival_s,
+            score.changes_per_minute
+        );
+    }
+
+    if (options.csv_path != nullptr && !write_csv(options.csv_path, scores, grid)) {
+        return 1;
+    }
+    return 0;
+}
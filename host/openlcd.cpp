@@ -0,0 +1,140 @@
+/**
+ * openlcd.cpp - Implementation of the simulated OpenLCD display.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "openlcd.h"
+
+#include <string.h>
+
+namespace {
+
+constexpr uint8_t SETTING_COMMAND = 0x7C;
+constexpr uint8_t SPECIAL_COMMAND = 0xFE;
+
+constexpr uint8_t SETTING_CLEAR = 0x2D;
+constexpr uint8_t SETTING_CONTRAST = 0x18;
+constexpr uint8_t SETTING_RGB = 0x2B;
+
+constexpr uint8_t HD44780_CLEAR = 0x01;
+constexpr uint8_t HD44780_HOME = 0x02;
+constexpr uint8_t HD44780_SET_DDRAM = 0x80;
+
+/// DDRAM offsets of the first column of each row.
+constexpr uint8_t ROW_OFFSETS[] = {0x00, 0x40, 0x14, 0x54};
+
+} // namespace
+
+namespace subsonic_ipt::host {
+
+OpenLCD::OpenLCD()
+{
+    memset(m_screen, ' ', sizeof(m_screen));
+}
+
+void OpenLCD::on_write(const uint8_t* data, size_t length)
+{
+    for (size_t i = 0; i < length; ++i) {
+        receive(data[i]);
+    }
+}
+
+void OpenLCD::row_text(uint8_t row, char* out) const
+{
+    memcpy(out, m_screen[row], COLUMNS);
+    out[COLUMNS] = '\0';
+}
+
+void OpenLCD::dump(FILE* stream) const
+{
+    char line[COLUMNS + 1];
+    fputs("+--------------------+\n", stream);
+    for (uint8_t row = 0; row < ROWS; ++row) {
+        row_text(row, line);
+        fprintf(stream, "|%s|\n", line);
+    }
+    fputs("+--------------------+\n", stream);
+}
+
+void OpenLCD::receive(uint8_t byte)
+{
+    ++m_bytes_received;
+    switch (m_state) {
+        case State::Text: {
+            if (byte == SETTING_COMMAND) {
+                m_state = State::Setting;
+            } else if (byte == SPECIAL_COMMAND) {
+                m_state = State::Special;
+            } else if (byte >= 0x20) {
+                put_char(static_cast<char>(byte));
+            }
+            // Other control characters (e.g. the CR/LF emitted by println)
+            // are not displayed.
+            break;
+        }
+        case State::Setting: {
+            m_state = State::Text;
+            if (byte == SETTING_CLEAR) {
+                clear_screen();
+            } else if (byte == SETTING_CONTRAST) {
+                m_pending_args = 1;
+                m_state = State::SettingArgs;
+            } else if (byte == SETTING_RGB) {
+                m_pending_args = 3;
+                m_state = State::SettingArgs;
+            }
+            break;
+        }
+        case State::SettingArgs: {
+            if (--m_pending_args == 0) {
+                m_state = State::Text;
+            }
+            break;
+        }
+        case State::Special: {
+            m_state = State::Text;
+            if (byte & HD44780_SET_DDRAM) {
+                const uint8_t address = byte & 0x7Fu;
+                for (uint8_t row = ROWS; row-- > 0;) {
+                    if (address >= ROW_OFFSETS[row] && address < ROW_OFFSETS[row] + COLUMNS) {
+                        m_row = row;
+                        m_column = address - ROW_OFFSETS[row];
+                        break;
+                    }
+                }
+            } else if (byte == HD44780_CLEAR) {
+                clear_screen();
+            } else if (byte == HD44780_HOME) {
+                m_row = 0;
+                m_column = 0;
+            }
+            break;
+        }
+    }
+}
+
+void OpenLCD::clear_screen()
+{
+    ++m_clear_count;
+    memset(m_screen, ' ', sizeof(m_screen));
+    m_row = 0;
+    m_column = 0;
+}
+
+void OpenLCD::put_char(char c)
+{
+    ++m_characters_written;
+    m_screen[m_row][m_column] = c;
+    // OpenLCD wraps onto the following row in display order.
+    if (++m_column == COLUMNS) {
+        m_column = 0;
+        m_row = (m_row + 1) % ROWS;
+    }
+}
+
+} // namespace subsonic_ipt::host
@@ -0,0 +1,92 @@
+/**
+ * openlcd.h - Simulated SparkFun OpenLCD (SerLCD) 20x4 character display.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_HOST_OPENLCD_H
+#define SUBSONIC_IPT_HOST_OPENLCD_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "i2c_device.h"
+
+namespace subsonic_ipt::host {
+
+/**
+ * I2C device that interprets the OpenLCD byte protocol and maintains the
+ * characters currently shown on a 20x4 display.
+ */
+class OpenLCD : public I2CDevice {
+  public:
+    static constexpr uint8_t COLUMNS = 20;
+    static constexpr uint8_t ROWS = 4;
+
+  private:
+    /// Parser states for multi-byte commands.
+    enum class State : uint8_t {
+        Text,
+        Setting,
+        Special,
+        SettingArgs,
+    };
+
+    char m_screen[ROWS][COLUMNS]{};
+    uint8_t m_row{0};
+    uint8_t m_column{0};
+
+    State m_state{State::Text};
+    uint8_t m_pending_args{0};
+
+    uint64_t m_bytes_received{0};
+    uint64_t m_clear_count{0};
+    uint64_t m_characters_written{0};
+
+  public:
+    OpenLCD();
+
+    void on_write(const uint8_t* data, size_t length) override;
+
+    /// The display has nothing to read back.
+    size_t on_read(uint8_t* /* data */, size_t /* length */) override { return 0; }
+
+    [[nodiscard]]
+    /// Returns the character displayed at the given position.
+    char at(uint8_t column, uint8_t row) const { return m_screen[row][column]; }
+
+    /**
+     * Copies the given row into `out`, which must hold at least COLUMNS + 1
+     * characters.
+     */
+    void row_text(uint8_t row, char* out) const;
+
+    /**
+     * Writes the current screen contents, framed, to the given stream.
+     */
+    void dump(FILE* stream) const;
+
+    [[nodiscard]]
+    uint64_t bytes_received() const { return m_bytes_received; }
+
+    [[nodiscard]]
+    uint64_t clear_count() const { return m_clear_count; }
+
+    [[nodiscard]]
+    uint64_t characters_written() const { return m_characters_written; }
+
+  private:
+    void receive(uint8_t byte);
+
+    void clear_screen();
+
+    void put_char(char c);
+};
+
+} // namespace subsonic_ipt::host
+
+#endif //SUBSONIC_IPT_HOST_OPENLCD_H
@@ -0,0 +1,130 @@
+/**
+ * serlcd.cpp - Linux implementation of the SparkFun SerLCD Arduino library.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "SerLCD.h"
+
+namespace {
+
+/// DDRAM offsets of the first column of each row.
+constexpr uint8_t ROW_OFFSETS[MAX_ROWS] = {0x00, 0x40, 0x14, 0x54};
+
+} // namespace
+
+void SerLCD::begin(TwoWire& wire_port, uint8_t address)
+{
+    m_wire = &wire_port;
+    m_address = address;
+    m_display_control = LCD_DISPLAYON;
+    specialCommand(LCD_DISPLAYCONTROL | m_display_control);
+}
+
+void SerLCD::clear()
+{
+    command(CLEAR_COMMAND);
+    delay(10);
+}
+
+void SerLCD::home()
+{
+    specialCommand(LCD_RETURNHOME);
+}
+
+void SerLCD::setCursor(uint8_t col, uint8_t row)
+{
+    row = min(row, static_cast<uint8_t>(MAX_ROWS - 1));
+    specialCommand(LCD_SETDDRAMADDR | (col + ROW_OFFSETS[row]));
+}
+
+void SerLCD::cursor()
+{
+    m_display_control |= LCD_CURSORON;
+    specialCommand(LCD_DISPLAYCONTROL | m_display_control);
+}
+
+void SerLCD::noCursor()
+{
+    m_display_control &= static_cast<uint8_t>(~LCD_CURSORON);
+    specialCommand(LCD_DISPLAYCONTROL | m_display_control);
+}
+
+void SerLCD::display()
+{
+    m_display_control |= LCD_DISPLAYON;
+    specialCommand(LCD_DISPLAYCONTROL | m_display_control);
+}
+
+void SerLCD::noDisplay()
+{
+    m_display_control &= static_cast<uint8_t>(~LCD_DISPLAYON);
+    specialCommand(LCD_DISPLAYCONTROL | m_display_control);
+}
+
+void SerLCD::setBacklight(unsigned long rgb)
+{
+    setBacklight(
+        static_cast<uint8_t>(rgb >> 16u),
+        static_cast<uint8_t>(rgb >> 8u),
+        static_cast<uint8_t>(rgb)
+    );
+}
+
+void SerLCD::setBacklight(uint8_t r, uint8_t g, uint8_t b)
+{
+    const uint8_t bytes[] = {SETTING_COMMAND, SET_RGB_COMMAND, r, g, b};
+    transmit(bytes, sizeof(bytes));
+    delay(10);
+}
+
+void SerLCD::setContrast(uint8_t new_value)
+{
+    const uint8_t bytes[] = {SETTING_COMMAND, CONTRAST_COMMAND, new_value};
+    transmit(bytes, sizeof(bytes));
+    delay(10);
+}
+
+void SerLCD::command(uint8_t command)
+{
+    const uint8_t bytes[] = {SETTING_COMMAND, command};
+    transmit(bytes, sizeof(bytes));
+    delay(10);
+}
+
+void SerLCD::specialCommand(uint8_t command)
+{
+    const uint8_t bytes[] = {SPECIAL_COMMAND, command};
+    transmit(bytes, sizeof(bytes));
+    delay(50);
+}
+
+size_t SerLCD::write(uint8_t b)
+{
+    transmit(&b, 1);
+    delay(10);
+    return 1;
+}
+
+size_t SerLCD::write(const uint8_t* buffer, size_t size)
+{
+    transmit(buffer, size);
+    delay(10);
+    return size;
+}
+
+void SerLCD::transmit(const uint8_t* data, size_t size)
+{
+    if (m_wire == nullptr) {
+        return;
+    }
+    // The library streams everything in a single transmission; the Wire
+    // buffer silently truncates anything beyond BUFFER_LENGTH bytes.
+    m_wire->beginTransmission(m_address);
+    m_wire->write(data, size);
+    m_wire->endTransmission();
+}
@@ -0,0 +1,147 @@
+/**
+ * telemetry_decode.cpp - Converts a captured serial stream of binary
+ *                        telemetry records (src/telemetry.h) to CSV.
+ *
+ * Frames that fail to decode, such as text printed by the sketch between
+ * records, are skipped and counted. Gaps in the record sequence numbers are
+ * reported as lost records, which includes records dropped by the sketch
+ * and records corrupted in transit. With --strict, the exit status is 1 if
+ * any record was lost or dropped, so that a capture can be checked in tests.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "../src/telemetry.h"
+
+namespace {
+using namespace subsonic_ipt::telemetry;
+
+/**
+ * Converts a binary angle to degrees on [0, 360).
+ */
+double turns_to_degrees(uint16_t turns)
+{
+    return turns * (360.0 / 65536.0);
+}
+
+/**
+ * Converts a binary angle to degrees on [-180, 180).
+ */
+double signed_turns_to_degrees(uint16_t turns)
+{
+    return static_cast<int16_t>(turns) * (360.0 / 65536.0);
+}
+
+void print_header(FILE* out)
+{
+    fprintf(out, "sequence,time_s,x_m,y_m,facing_deg,yaw_deg,pitch_deg,roll_deg,"
+                 "world_accel_x,world_accel_y,world_accel_z,latency_us,loop_max_us,fifo_bytes,dropped\n");
+}
+
+void print_record(FILE* out, const MotionRecord& record)
+{
+    fprintf(
+        out,
+        "%u,%.6f,%.4f,%.4f,%.3f,%.3f,%.3f,%.3f,%d,%d,%d,%u,%u,%u,%u\n",
+        record.sequence,
+        record.timestamp_u * 1e-6,
+        record.x,
+        record.y,
+        turns_to_degrees(record.facing),
+        signed_turns_to_degrees(record.ypr[0]),
+        signed_turns_to_degrees(record.ypr[1]),
+        signed_turns_to_degrees(record.ypr[2]),
+        record.world_accel[0],
+        record.world_accel[1],
+        record.world_accel[2],
+        record.latency_u,
+        record.loop_max_u,
+        record.fifo_count,
+        record.dropped
+    );
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool strict = false;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--strict") == 0) {
+            strict = true;
+        } else if (path == nullptr && (argv[i][0] != '-' || argv[i][1] == '\0')) {
+            path = argv[i];
+        } else {
+            fprintf(
+                stderr,
+                "Usage: %s [--strict] [CAPTURE]\n\nReads CAPTURE, or standard input if omitted or -, and writes CSV to standard output.\n"
+                "With --strict, fails if any record was lost or dropped.\n",
+                argv[0]
+            );
+            return 2;
+        }
+    }
+    FILE* in = stdin;
+    if (path != nullptr && strcmp(path, "-") != 0) {
+        in = fopen(path, "rb");
+        if (in == nullptr) {
+            perror(path);
+            return 1;
+        }
+    }
+
+    print_header(stdout);
+
+    unsigned long records = 0;
+    unsigned long skipped = 0;
+    unsigned long lost = 0;
+    int last_sequence = -1;
+    unsigned dropped = 0;
+    std::vector<uint8_t> frame;
+
+    int c;
+    while ((c = fgetc(in)) != EOF) {
+        if (c != 0) {
+            frame.push_back(static_cast<uint8_t>(c));
+            continue;
+        }
+        if (frame.empty()) {
+            continue;
+        }
+        MotionRecord record{};
+        if (decode_motion(frame.data(), frame.size(), record)) {
+            if (last_sequence >= 0) {
+                lost += static_cast<uint8_t>(record.sequence - last_sequence - 1);
+            }
+            last_sequence = record.sequence;
+            dropped = record.dropped;
+            ++records;
+            print_record(stdout, record);
+        } else {
+            ++skipped;
+        }
+        frame.clear();
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+
+    fprintf(
+        stderr,
+        "%lu records decoded, %lu records lost, %u dropped by the sketch, %lu other frames skipped\n",
+        records,
+        lost,
+        dropped,
+        skipped
+    );
+    return strict && (records == 0 || lost != 0 || dropped != 0) ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+/**
+ * trig_bench.cpp - Compares the speed and accuracy of the trigonometry
+ *                  implementations in src/fast_trig.h.
+ *
+ * Every implementation is timed on the host and its error is measured
+ * against the C library, so that an accuracy level can be chosen for a
+ * build with SUBSONIC_TRIG_ACCURACY. Timings are host timings: they rank
+ * the implementations but do not predict AVR cycle counts, where the
+ * software floating point of the C library is far more expensive.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../src/fast_trig.h"
+
+namespace {
+using namespace subsonic_ipt;
+using fast_trig::Phase;
+using fast_trig::SinCos;
+
+/**
+ * Accuracy and speed measured for one implementation.
+ */
+struct Measurement {
+    /// Mean time per call in nanoseconds.
+    double ns_per_call;
+    /// Largest absolute error against the C library.
+    double max_error;
+    /// Root mean square error against the C library.
+    double rms_error;
+};
+
+struct Vector {
+    int32_t x;
+    int32_t y;
+};
+
+/// Prevents the timed loops from being optimized away.
+volatile int64_t g_sink;
+
+uint32_t next_random(uint32_t& state)
+{
+    state ^= state << 13u;
+    state ^= state >> 17u;
+    state ^= state << 5u;
+    return state;
+}
+
+double phase_radians(Phase phase)
+{
+    return phase * (2 * M_PI / 4294967296.0);
+}
+
+/// Returns the absolute difference between two angles, modulo 2pi.
+double angle_error(double first, double second)
+{
+    return std::fabs(std::remainder(first - second, 2 * M_PI));
+}
+
+template<typename F>
+double time_per_call(size_t count, F&& body)
+{
+    const auto start = std::chrono::steady_clock::now();
+    int64_t sum = 0;
+    for (size_t i = 0; i < count; ++i) {
+        sum += body(i);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    g_sink = sum;
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(count);
+}
+
+template<typename F>
+Measurement measure_sin_cos(const std::vector<Phase>& phases, F sin_cos)
+{
+    Measurement result{};
+    double square_sum = 0;
+    for (const Phase phase : phases) {
+        const SinCos value = sin_cos(phase);
+        const double angle = phase_radians(phase);
+        for (const double error : {value.sin / 65536.0 - std::sin(angle), value.cos / 65536.0 - std::cos(angle)}) {
+            result.max_error = std::fmax(result.max_error, std::fabs(error));
+            square_sum += error * error;
+        }
+    }
+    result.rms_error = std::sqrt(square_sum / (2.0 * phases.size()));
+    result.ns_per_call = time_per_call(phases.size(), [&](size_t i) {
+        const SinCos value = sin_cos(phases[i]);
+        return static_cast<int64_t>(value.sin) + value.cos;
+    });
+    return result;
+}
+
+template<typename F>
+Measurement measure_atan2(const std::vector<Vector>& vectors, F atan2)
+{
+    Measurement result{};
+    double square_sum = 0;
+    for (const Vector v : vectors) {
+        const double error = angle_error(phase_radians(atan2(v.y, v.x)), std::atan2(v.y, v.x));
+        result.max_error = std::fmax(result.max_error, error);
+        square_sum += error * error;
+    }
+    result.rms_error = std::sqrt(square_sum / vectors.size());
+    result.ns_per_call = time_per_call(vectors.size(), [&](size_t i) {
+        return static_cast<int64_t>(atan2(vectors[i].y, vectors[i].x));
+    });
+    return result;
+}
+
+void print_row(const char* name, const Measurement& m)
+{
+    printf("  %-22s %9.1f %12.3e %12.3e\n", name, m.ns_per_call, m.max_error, m.rms_error);
+}
+
+void print_header(const char* title, const char* error_unit)
+{
+    printf("%s\n  %-22s %9s %12s %12s\n", title, "implementation", "ns/call", "max error", "rms error");
+    printf("  %-22s %9s %12s %12s\n", "", "", error_unit, error_unit);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t samples = 1000000;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            samples = strtoul(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "Usage: %s [--samples N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    uint32_t state = 0x2545F491u;
+    std::vector<Phase> phases(samples);
+    std::vector<Vector> vectors(samples);
+    for (size_t i = 0; i < samples; ++i) {
+        phases[i] = next_random(state);
+        // Magnitudes spanning the full range of Q16.16 positions.
+        const uint32_t shift = next_random(state) % 24u;
+        vectors[i] = {static_cast<int32_t>(next_random(state)) >> shift, static_cast<int32_t>(next_random(state)) >> shift};
+    }
+
+    printf("Build accuracy level: %d (CORDIC iterations: %d)\n\n", SUBSONIC_TRIG_ACCURACY, SUBSONIC_CORDIC_ITERATIONS);
+
+    print_header("sin/cos", "(unit)");
+    print_row("1: table, nearest", measure_sin_cos(phases, [](Phase p) { return fast_trig::table_sin_cos(p, false); }));
+    print_row("2: table, interpolated", measure_sin_cos(phases, [](Phase p) { return fast_trig::table_sin_cos(p, true); }));
+    for (const uint8_t iterations : {8, 12, 16, 20, 24}) {
+        char name[32];
+        snprintf(name, sizeof(name), "3: CORDIC, %d iter", iterations);
+        print_row(name, measure_sin_cos(phases, [=](Phase p) { return fast_trig::cordic_sin_cos(p, iterations); }));
+    }
+    print_row("4: libm (double)", measure_sin_cos(phases, [](Phase p) {
+        const double angle = phase_radians(p);
+        return SinCos{static_cast<int32_t>(std::lround(std::sin(angle) * 65536)), static_cast<int32_t>(std::lround(std::cos(angle) * 65536))};
+    }));
+
+    printf("\n");
+    print_header("atan2", "(rad)");
+    print_row("1: table, nearest", measure_atan2(vectors, [](int32_t y, int32_t x) { return fast_trig::table_atan2(y, x, false); }));
+    print_row("2: table, interpolated", measure_atan2(vectors, [](int32_t y, int32_t x) { return fast_trig::table_atan2(y, x, true); }));
+    for (const uint8_t iterations : {8, 12, 16, 20, 24}) {
+        char name[32];
+        snprintf(name, sizeof(name), "3: CORDIC, %d iter", iterations);
+        print_row(name, measure_atan2(vectors, [=](int32_t y, int32_t x) { return fast_trig::cordic_atan2(y, x, iterations); }));
+    }
+    print_row("4: libm (double)", measure_atan2(vectors, [](int32_t y, int32_t x) {
+        return static_cast<Phase>(std::llround(std::atan2(y, x) * (4294967296.0 / (2 * M_PI))));
+    }));
+    return 0;
+}
@@ -0,0 +1,235 @@
+/**
+ * twi.cpp - Linux implementation of the AVR TWI (I2C) peripheral.
+ *
+ * Models the master side of the peripheral one bus operation at a time:
+ * each write to TWCR with TWINT set schedules the completion of a start
+ * condition, address byte or data byte on the virtual clock, at which point
+ * TWSR reports the outcome and the TWI interrupt is raised.
+ *
+ * Bytes written to a device are delivered to it in one `on_write` call when
+ * the transfer ends with a stop or repeated start, as with Wire. Bytes read
+ * from a device are requested one at a time.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include <Arduino.h>
+#include <util/twi.h>
+
+#include <cmath>
+#include <vector>
+
+#include "host.h"
+#include "i2c_device.h"
+
+/// Defined by sketches that handle the TWI interrupt with `ISR(TWI_vect)`.
+extern "C" void subsonic_host_twi_vect() __attribute__((weak));
+
+/******************************************************************************\
+ * Internal definitions
+\******************************************************************************/
+namespace {
+using namespace subsonic_ipt::host;
+
+/**
+ * The stage of the bus transfer in progress.
+ */
+enum class Phase {
+    /// No start condition has been sent since the last stop.
+    Idle,
+    /// A start condition was sent; the next byte is an address.
+    Addressing,
+    Writing,
+    Reading,
+};
+
+/**
+ * The simulated state of the TWI peripheral.
+ */
+struct {
+    /// The control bits last written to TWCR, excluding TWINT, TWSTA and TWSTO.
+    uint8_t control{0};
+    /// The TWI interrupt flag.
+    bool flag{false};
+    Phase phase{Phase::Idle};
+    /// The 7-bit address of the device being transferred with.
+    uint8_t address{0};
+    /// The addressed device, or null if the address was not acknowledged.
+    I2CDevice* device{nullptr};
+    /// Bytes written to the device since it was addressed.
+    std::vector<uint8_t> written;
+    /// The status that TWSR reports once the operation in progress is done.
+    uint8_t next_status{TW_NO_INFO};
+} g_twi;
+
+/**
+ * Returns the number of microseconds needed to clock the given number of
+ * bits at the rate configured by TWBR and TWSR.
+ */
+uint64_t bus_time_us(uint32_t bits)
+{
+    // The times of a start condition and of a byte are kept for the last
+    // rate seen, since one is needed for every operation.
+    static uint8_t cached_twbr{0};
+    static uint8_t cached_prescale{0xFF};
+    static uint64_t cached_us[2]{};
+
+    const uint8_t prescale = TWSR & (_BV(TWPS1) | _BV(TWPS0));
+    const auto compute = [prescale](uint32_t count) {
+        const uint32_t prescaler = 1u << (2u * prescale);
+        const double clock_hz = static_cast<double>(F_CPU) / (16.0 + 2.0 * TWBR * prescaler);
+        return static_cast<uint64_t>(std::ceil(count * 1e6 / clock_hz));
+    };
+    if (bits != 1 && bits != 9) {
+        return compute(bits);
+    }
+    if (TWBR != cached_twbr || prescale != cached_prescale) {
+        cached_twbr = TWBR;
+        cached_prescale = prescale;
+        cached_us[0] = compute(1);
+        cached_us[1] = compute(9);
+    }
+    return cached_us[bits == 9];
+}
+
+/**
+ * Delivers the bytes written during the current transfer to the device.
+ */
+void flush_written()
+{
+    if (g_twi.phase == Phase::Writing && g_twi.device != nullptr) {
+        g_twi.device->on_write(g_twi.written.data(), g_twi.written.size());
+    }
+    g_twi.written.clear();
+}
+
+/**
+ * Ends the operation in progress, reporting its status and raising TWINT.
+ */
+void complete_operation()
+{
+    TWSR = static_cast<uint8_t>((TWSR & ~TW_STATUS_MASK) | g_twi.next_status);
+    g_twi.flag = true;
+    if ((g_twi.control & _BV(TWIE)) && (g_twi.control & _BV(TWEN)) && subsonic_host_twi_vect != nullptr) {
+        raise_vector(subsonic_host_twi_vect);
+    }
+}
+
+/**
+ * Raises TWINT with the given status once the given number of bits would
+ * have been clocked.
+ */
+void complete_after(uint32_t bits, uint8_t status)
+{
+    g_twi.next_status = status;
+    set_peripheral_timer(PeripheralTimer::Twi, now_us() + bus_time_us(bits), complete_operation);
+}
+
+/**
+ * Clocks the byte in TWDR as the address of a new transfer.
+ */
+void send_address()
+{
+    g_twi.address = TWDR >> 1u;
+    g_twi.device = i2c_device(g_twi.address);
+    record_i2c_bytes(g_twi.address, 1);
+
+    const bool read = TWDR & TW_READ;
+    g_twi.phase = read ? Phase::Reading : Phase::Writing;
+    if (g_twi.device == nullptr) {
+        complete_after(9, read ? TW_MR_SLA_NACK : TW_MT_SLA_NACK);
+    } else {
+        complete_after(9, read ? TW_MR_SLA_ACK : TW_MT_SLA_ACK);
+    }
+}
+
+/**
+ * Carries out the bus operation requested by a write to TWCR.
+ */
+void start_operation(uint8_t value)
+{
+    if (value & _BV(TWSTO)) {
+        flush_written();
+        g_twi.phase = Phase::Idle;
+        if (!(value & _BV(TWSTA))) {
+            return;
+        }
+    }
+    if (value & _BV(TWSTA)) {
+        flush_written();
+        const bool repeated = g_twi.phase != Phase::Idle;
+        g_twi.phase = Phase::Addressing;
+        complete_after(1, repeated ? TW_REP_START : TW_START);
+        return;
+    }
+
+    switch (g_twi.phase) {
+        case Phase::Idle: {
+            // Nothing to clock without a start condition.
+            break;
+        }
+        case Phase::Addressing: {
+            send_address();
+            break;
+        }
+        case Phase::Writing: {
+            record_i2c_bytes(g_twi.address, 1);
+            if (g_twi.device == nullptr) {
+                complete_after(9, TW_MT_DATA_NACK);
+                break;
+            }
+            g_twi.written.push_back(static_cast<uint8_t>(TWDR));
+            complete_after(9, TW_MT_DATA_ACK);
+            break;
+        }
+        case Phase::Reading: {
+            record_i2c_bytes(g_twi.address, 1);
+            uint8_t data = 0xFF;
+            if (g_twi.device != nullptr) {
+                g_twi.device->on_read(&data, 1);
+            }
+            TWDR = data;
+            complete_after(9, (value & _BV(TWEA)) ? TW_MR_DATA_ACK : TW_MR_DATA_NACK);
+            break;
+        }
+    }
+}
+
+} // namespace
+
+/******************************************************************************\
+ * Registers
+\******************************************************************************/
+
+TwiControlRegister TWCR;
+volatile uint8_t TWBR{0};
+volatile uint8_t TWSR{TW_NO_INFO};
+volatile uint8_t TWDR{0xFF};
+
+TwiControlRegister::operator uint8_t() const
+{
+    charge_register_io();
+    return static_cast<uint8_t>(g_twi.control | (g_twi.flag ? _BV(TWINT) : 0));
+}
+
+TwiControlRegister& TwiControlRegister::operator=(uint8_t value)
+{
+    g_twi.control = value & ~(_BV(TWINT) | _BV(TWSTA) | _BV(TWSTO));
+    if (!(value & _BV(TWEN))) {
+        // Disabling the peripheral abandons any transfer in progress.
+        g_twi.flag = false;
+        g_twi.phase = Phase::Idle;
+        g_twi.written.clear();
+        return *this;
+    }
+    // Writing a one to TWINT clears the flag and starts the next operation.
+    if (value & _BV(TWINT)) {
+        g_twi.flag = false;
+        start_operation(value);
+    }
+    return *this;
+}
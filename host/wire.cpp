@@ -0,0 +1,133 @@
+/**
+ * wire.cpp - Linux implementation of the Arduino Wire library.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "Wire.h"
+
+#include "host.h"
+#include "i2c_device.h"
+
+/******************************************************************************\
+ * Internal definitions
+\******************************************************************************/
+namespace {
+
+/**
+ * Fixed software overhead of a single Wire transaction, in microseconds.
+ */
+constexpr uint64_t TRANSACTION_OVERHEAD_US = 10;
+
+/// Devices attached to the simulated bus, indexed by 7-bit address.
+subsonic_ipt::host::I2CDevice* g_devices[128]{};
+
+/// Per-address byte counters.
+uint64_t g_bytes_transferred[128]{};
+
+} // namespace
+
+/******************************************************************************\
+ * Host control interface
+\******************************************************************************/
+namespace subsonic_ipt::host {
+
+void attach_i2c_device(uint8_t address, I2CDevice* device)
+{
+    g_devices[address & 0x7Fu] = device;
+}
+
+uint64_t i2c_bytes_transferred(uint8_t address)
+{
+    return g_bytes_transferred[address & 0x7Fu];
+}
+
+I2CDevice* i2c_device(uint8_t address)
+{
+    return g_devices[address & 0x7Fu];
+}
+
+void record_i2c_bytes(uint8_t address, uint64_t bytes)
+{
+    g_bytes_transferred[address & 0x7Fu] += bytes;
+    record_activity();
+}
+
+} // namespace subsonic_ipt::host
+
+/******************************************************************************\
+ * TwoWire
+\******************************************************************************/
+
+TwoWire Wire;
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    m_tx_address = address & 0x7Fu;
+    m_tx_length = 0;
+    m_transmitting = true;
+}
+
+uint8_t TwoWire::endTransmission(bool /* send_stop */)
+{
+    m_transmitting = false;
+    charge_bus_time(m_tx_length + 1u);
+    g_bytes_transferred[m_tx_address] += m_tx_length + 1u;
+
+    auto* device = g_devices[m_tx_address];
+    if (device == nullptr) {
+        // Address NACK, matching the AVR twi driver's status code.
+        return 2;
+    }
+    device->on_write(m_tx_buffer, m_tx_length);
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool /* send_stop */)
+{
+    address &= 0x7Fu;
+    if (quantity > BUFFER_LENGTH) {
+        quantity = BUFFER_LENGTH;
+    }
+    m_rx_index = 0;
+    m_rx_length = 0;
+
+    auto* device = g_devices[address];
+    charge_bus_time((device != nullptr ? quantity : 0u) + 1u);
+    if (device == nullptr) {
+        g_bytes_transferred[address] += 1;
+        return 0;
+    }
+    m_rx_length = static_cast<uint8_t>(device->on_read(m_rx_buffer, quantity));
+    g_bytes_transferred[address] += m_rx_length + 1u;
+    return m_rx_length;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (!m_transmitting || m_tx_length >= BUFFER_LENGTH) {
+        return 0;
+    }
+    m_tx_buffer[m_tx_length++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t quantity)
+{
+    size_t written = 0;
+    while (written < quantity && write(data[written])) {
+        ++written;
+    }
+    return written;
+}
+
+void TwoWire::charge_bus_time(size_t bytes) const
+{
+    // Nine clocks per byte (eight data bits plus ACK).
+    const uint64_t bus_us = (static_cast<uint64_t>(bytes) * 9 * 1000000) / m_clock_hz;
+    subsonic_ipt::host::advance_us(bus_us + TRANSACTION_OVERHEAD_US);
+}
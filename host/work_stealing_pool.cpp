@@ -0,0 +1,125 @@
+/**
+ * work_stealing_pool.cpp - Implementation of the work stealing thread pool.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "work_stealing_pool.h"
+
+namespace {
+
+/// The pool and index of the worker running on this thread, if any.
+thread_local const void* t_pool{nullptr};
+thread_local size_t t_worker_index{0};
+
+} // namespace
+
+namespace subsonic_ipt::host {
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+{
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        m_threads.emplace_back([this, i] { run_worker(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_stopping = true;
+    }
+    m_work_available.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task)
+{
+    const size_t index = t_pool == this
+        ? t_worker_index
+        : m_next_worker.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+    m_pending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(m_workers[index]->mutex);
+        m_workers[index]->tasks.push_back(std::move(task));
+        m_queued.fetch_add(1);
+    }
+    // Taking the lock orders this notification after any worker that just
+    // found the queues empty has started waiting.
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+    }
+    m_work_available.notify_one();
+}
+
+void WorkStealingPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_sleep_mutex);
+    m_all_done.wait(lock, [this] { return m_pending.load() == 0; });
+}
+
+void WorkStealingPool::run_worker(size_t index)
+{
+    t_pool = this;
+    t_worker_index = index;
+    Task task;
+    while (true) {
+        if (take_task(index, task)) {
+            task();
+            task = nullptr;
+            if (m_pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(m_sleep_mutex);
+                m_all_done.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        m_work_available.wait(lock, [this] { return m_stopping || m_queued.load() > 0; });
+        if (m_stopping && m_queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+bool WorkStealingPool::take_task(size_t index, Task& task)
+{
+    {
+        Worker& own = *m_workers[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            m_queued.fetch_sub(1);
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < m_workers.size(); ++offset) {
+        Worker& victim = *m_workers[(index + offset) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            m_queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace subsonic_ipt::host
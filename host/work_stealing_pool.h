@@ -0,0 +1,105 @@
+/**
+ * work_stealing_pool.h - A thread pool whose idle workers take queued tasks
+ *                        from busy ones.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_HOST_WORK_STEALING_POOL_H
+#define SUBSONIC_IPT_HOST_WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace subsonic_ipt::host {
+
+/**
+ * A fixed set of worker threads, each with its own queue of tasks.
+ *
+ * A worker runs the newest task in its own queue first, which keeps the
+ * data of related tasks in its cache. A worker whose queue is empty steals
+ * the oldest task from another worker's queue, so tasks of very different
+ * lengths still keep every worker busy. Tasks submitted from outside the
+ * pool are dealt to the workers in turn, and tasks submitted by a task are
+ * queued on its own worker.
+ */
+class WorkStealingPool {
+  public:
+    using Task = std::function<void()>;
+
+  private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+
+    /// The number of tasks in the workers' queues.
+    std::atomic<size_t> m_queued{0};
+
+    /// The number of tasks submitted that have not finished.
+    std::atomic<size_t> m_pending{0};
+
+    /// The worker that the next task from outside the pool is queued on.
+    std::atomic<size_t> m_next_worker{0};
+
+    /// Guards sleeping on `m_work_available` and `m_all_done`.
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_work_available;
+    std::condition_variable m_all_done;
+    bool m_stopping{false};
+
+  public:
+    /**
+     * Starts the given number of workers, or one per hardware thread if
+     * zero.
+     */
+    explicit WorkStealingPool(size_t threads = 0);
+
+    /// Finishes every submitted task, then stops the workers.
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    [[nodiscard]]
+    size_t size() const noexcept { return m_threads.size(); }
+
+    /// Queues the given task to be run by one of the workers.
+    void submit(Task task);
+
+    /**
+     * Blocks until every submitted task has finished, including tasks
+     * submitted by other tasks. Must not be called from a task.
+     */
+    void wait();
+
+  private:
+    void run_worker(size_t index);
+
+    /**
+     * Takes the newest task from the given worker's queue or, failing that,
+     * the oldest task from another worker's queue.
+     *
+     * Returns false if every queue was empty.
+     */
+    bool take_task(size_t index, Task& task);
+};
+
+} // namespace subsonic_ipt::host
+
+#endif //SUBSONIC_IPT_HOST_WORK_STEALING_POOL_H
@@ -15,10 +15,19 @@
 
 #include "src/point.h"
 #include "src/navigator.h"
+#include "src/async_i2c.h"
+#include "src/dead_reckoning.h"
+#include "src/guidance.h"
 #include "src/inputs/buttons.h"
 #include "src/inputs/mpu.h"
 #include "src/pin.h"
+#include "src/profiler.h"
+#include "src/ring_buffer.h"
+#include "src/scheduler.h"
 #include "src/state.h"
+#include "src/telemetry.h"
+#include "src/tui/framebuffer.h"
+#include "src/tui/lcd_writer.h"
 #include "src/tui/menu_manager.h"
 #include "src/tui/menus/guidance_menu.h"
 #include "src/tui/menus/destination_menu.h"
@@ -34,6 +43,11 @@
 // to the Serial output.
 #define SUBSONIC_DEBUG_SERIAL_POSITION
 
+// When defined, the device's position is reported as a binary telemetry
+// record after every MPU packet instead of as text after every batch. Use
+// host/telemetry_decode to convert a captured stream to CSV.
+#define SUBSONIC_DEBUG_SERIAL_TELEMETRY
+
 // When defined, a message will be printed to the Serial output whenever
 // the devices maximum distance from a waypoint is updated.
 #define SUBSONIC_DEBUG_SERIAL_MAX_DIST
@@ -42,19 +56,47 @@
 // the LED array is illuminated
 //#define SUBSONIC_DEBUG_SERIAL_LEDS
 
+// When defined, the run and overrun counts of each scheduler task will be
+// printed periodically to the Serial output.
+//#define SUBSONIC_DEBUG_SERIAL_SCHEDULER
+
+// When defined, the shortest, mean and longest time recorded by each
+// profiler probe will be printed periodically to the Serial output, in
+// microseconds. Requires SUBSONIC_PROFILE.
+#define SUBSONIC_DEBUG_SERIAL_PROFILE
+
 using namespace subsonic_ipt;
 
 /**
- * The period of time elapsed between updates for
+ * The period of time in microseconds elapsed between updates for
  * the LCD and LED array.
  */
-constexpr int REFRESH_PERIOD_MILLI = 100;
+constexpr unsigned long REFRESH_PERIOD_MICRO = 100000;
+
+/**
+ * The period of time in microseconds elapsed between deliveries of button
+ * presses to the menus.
+ */
+constexpr unsigned long INPUT_PERIOD_MICRO = 5000;
+
+/**
+ * The number of telemetry records that may be waiting to be sent. A record
+ * is produced for each MPU packet, so this matches the number of packets
+ * read ahead of decoding.
+ */
+constexpr uint8_t TELEMETRY_QUEUE_LENGTH = SUBSONIC_MPU_PACKET_RING;
 
 /**
  * Whenever the device is with this distance of a target, it is considered
  * to have "arrived".
  */
-constexpr double ARRIVAL_THRESHOLD = 0.5;
+constexpr Scalar ARRIVAL_THRESHOLD = 0.5;
+
+/**
+ * Directions within this many degrees of straight ahead or straight behind
+ * are shown as "forward" or "backward".
+ */
+constexpr double SNAP_TOLERANCE_DEG = 10.0;
 
 /**
  * The clock rate used for I2C communication with the MPU.
@@ -62,9 +104,11 @@ constexpr double ARRIVAL_THRESHOLD = 0.5;
 constexpr uint32_t I2C_CLOCK_RATE = 400000;
 
 /**
- * The port used by `Serial` for printing debugging information.
+ * The baud rate used by `Serial` for printing debugging information. Must
+ * carry a telemetry record for every DMP packet: at 100 Hz, the records
+ * alone need 42000 bits per second.
  */
-constexpr uint16_t SERIAL_PORT = 9600;
+constexpr uint32_t SERIAL_PORT = 115200;
 
 /**
  * The dimensions of the LCD screen used by this sketch.
@@ -74,18 +118,46 @@ constexpr struct {
     uint8_t y = 4;
 } LCD_DIMENSIONS;
 
+/**
+ * The fields decoded from each MPU packet: the yaw and tilt that position
+ * tracking and the debug menu use, and the world-frame acceleration when it
+ * is sent as telemetry.
+ */
+#if defined(SUBSONIC_DEBUG_SERIAL_POSITION) && defined(SUBSONIC_DEBUG_SERIAL_TELEMETRY)
+constexpr MotionField MOTION_FIELDS = static_cast<MotionField>(MotionYaw | MotionTilt | MotionWorldAccel);
+#else
+constexpr MotionField MOTION_FIELDS = static_cast<MotionField>(MotionYaw | MotionTilt);
+#endif
+
+/**
+ * The number of stars in the welcome sequence once the DMP has loaded.
+ */
+constexpr uint8_t SPLASH_STARS = (LCD_DIMENSIONS.x / 2) - 2;
+
 //constexpr double EXPECTED_GRAVITY = 9.81;
 
 /**
  * An angle-to-velocity mapping for simulating device movement
  * based on it gyroscopic orientation.
  */
-constexpr double PITCH_VEL_MAPPING[][2] = {
+constexpr DeadReckoning::PitchVelocity PITCH_VEL_MAPPING[] = {
     {10, 0},
     {45, 1.5},
     {90, 2},
 };
 
+/**
+ * Member pointer to the member of DeviceMotion that contains the "true
+ * pitch" of the device.
+ *
+ * Update this pointer if the MPU is mounted in an orientation different
+ * from the expected orientation of the device.
+ *
+ * e.g. if the MPU is rotated 90 degrees, the "true pitch" will be the
+ * roll.
+ */
+constexpr float DeviceMotion::* TRUE_PITCH = &DeviceMotion::roll;
+
 
 /******************************************************************************\
  * Internal definitions
@@ -100,23 +172,32 @@ namespace {
  */
 Navigator g_nav{};
 
-SerLCD g_lcd{};
+/**
+ * Off-screen copy of the LCD that the menus render into.
+ */
+Framebuffer g_framebuffer{};
+
+/**
+ * Sends each rendered frame to the LCD a chunk at a time.
+ */
+LcdWriter g_lcd_writer{g_framebuffer, DISPLAY_ADDRESS1};
 
 IPTState g_device_state{};
 
-GuidanceMenu g_guidance_menu(
+Guidance g_guidance(
     &g_device_state,
     &g_nav,
-    Angle::from_degrees(10.0),
-    ARRIVAL_THRESHOLD,
-    500
+    BinaryAngle::from_degrees(SNAP_TOLERANCE_DEG),
+    ARRIVAL_THRESHOLD
 );
 
+GuidanceMenu g_guidance_menu(&g_device_state, &g_nav, &g_guidance, 500);
+
 DestinationMenu g_destination_menu(&g_device_state, &g_nav);
 
 UnitMenu g_unit_menu(&g_device_state);
 
-DebugMenu g_debug_menu(&g_device_state, 500);
+DebugMenu g_debug_menu(&g_device_state, &g_guidance, 500);
 
 BrightnessMenu g_brightness_menu{};
 
@@ -136,25 +217,97 @@ MenuManager<5> g_menu_manager{g_menus};
  * Initialized to 1e-9 to prevent division by zero when used to compute
  * percentages.
  */
-double g_max_distance{1e-9};
+Scalar g_max_distance{1e-9};
 
 /**
- * The time in milliseconds since device startup when the device's display
- * was last updated.
+ * Moves the device's position with each MPU packet.
  */
-unsigned long g_last_display_update{0};
+DeadReckoning g_dead_reckoning{PITCH_VEL_MAPPING, TRUE_PITCH};
 
 /**
- * The time in microseconds since device startup when the device's position
- * was last updated.
+ * The longest time in microseconds taken by a pass of the scheduler since
+ * the last telemetry record was sent.
  */
-unsigned long g_last_position_update_u{0};
+unsigned long g_loop_max_u{0};
 
 /**
- * Callback function that is run repeatedly while the MPU is waiting
- * for new data.
+ * Binary telemetry sent over the Serial output.
  */
-void subsonic_loop();
+telemetry::TelemetryStream g_telemetry{Serial};
+
+/**
+ * Telemetry records for integrated packets, waiting to be sent.
+ */
+RingBuffer<telemetry::MotionRecord, TELEMETRY_QUEUE_LENGTH> g_telemetry_queue{};
+
+#if defined(SUBSONIC_DEBUG_SERIAL_POSITION) && !defined(SUBSONIC_DEBUG_SERIAL_TELEMETRY)
+/**
+ * Flag indicating whether the position has been updated from a complete
+ * batch of packets since it was last printed.
+ */
+bool g_position_report_pending{false};
+#endif
+
+/**
+ * Renders the welcome sequence with the given number of stars.
+ */
+void render_splash(uint8_t stars);
+
+/**
+ * Shows the given two lines on the LCD, waiting until they have been sent.
+ */
+void show_message(const char* first_line, const char* second_line);
+
+/**
+ * Callback function that asks the user to hold the device still and waits
+ * for them to press a button before the MPU is calibrated.
+ */
+void prompt_calibration();
+
+/**
+ * Task that integrates any packets read from the MPU.
+ */
+void ingest_motion();
+
+/**
+ * Task that hands button presses to the menus.
+ */
+void handle_input();
+
+/**
+ * Task that computes the guidance for the current position and updates
+ * the LED array.
+ */
+void update_guidance();
+
+/**
+ * Task that renders a new frame for the LCD.
+ */
+void render_display();
+
+/**
+ * Task that sends the next few bytes of the frame being displayed.
+ */
+void flush_display();
+
+/**
+ * Task that sends the position over the Serial output.
+ */
+void send_telemetry();
+
+#ifdef SUBSONIC_DEBUG_SERIAL_SCHEDULER
+/**
+ * Task that prints the counters of each scheduler task.
+ */
+void report_tasks();
+#endif
+
+#if defined(SUBSONIC_DEBUG_SERIAL_PROFILE) && SUBSONIC_PROFILE
+/**
+ * Task that prints the times recorded by the next profiler probe.
+ */
+void report_probe();
+#endif
 
 /**
  * Callback function to update the device's position each time a motion
@@ -163,9 +316,32 @@ void subsonic_loop();
 void update_position(const DeviceMotion& device_motion);
 
 /**
- * Returns the horizonal velocity associated with the specified pitched.
+ * The work done by the sketch after setup, from most to least urgent.
+ *
+ * Packets are integrated on every pass, so that the MPU's FIFO never fills
+ * up. The deadlines are the time after each release by which the task should
+ * be done, including the time spent waiting for the tasks before it. Tasks
+ * that run on every pass are released when the pass starts.
  */
-double pitch_to_vel(Angle pitch);
+const Task g_tasks[]{
+    {"imu", ingest_motion, 0, 2000, 0},
+    {"input", handle_input, INPUT_PERIOD_MICRO, INPUT_PERIOD_MICRO, 1},
+    {"guide", update_guidance, REFRESH_PERIOD_MICRO, 10000, 2},
+    {"render", render_display, REFRESH_PERIOD_MICRO, 20000, 3},
+    {"lcd", flush_display, 0, 4000, 3},
+    {"telem", send_telemetry, 0, 4000, 4},
+#ifdef SUBSONIC_DEBUG_SERIAL_SCHEDULER
+    {"tasks", report_tasks, 10000000, 10000000, 5},
+#endif
+#if defined(SUBSONIC_DEBUG_SERIAL_PROFILE) && SUBSONIC_PROFILE
+    {"prof", report_probe, 1000000, 1000000, 4},
+#endif
+};
+
+// With the TWI flag polled, the bus is moved on between tasks as well as
+// from the IMU task, so that a FIFO read keeps the bus busy during the rest of
+// the pass rather than clocking one byte per pass.
+Scheduler g_scheduler{g_tasks, i2c_advance};
 
 } // namespace
 
@@ -179,63 +355,71 @@ double pitch_to_vel(Angle pitch);
  */
 void setup()
 {
-    // Open a serial connection on port 9600
+    // Open a serial connection at SERIAL_PORT baud
     Serial.begin(SERIAL_PORT);
     Serial.println("Starting setup routine...");
 
     Wire.begin();
     Wire.setClock(I2C_CLOCK_RATE);
-    // Initialize the LCD library
-    g_lcd.begin(Wire);
-    g_lcd.setContrast(5);
-    g_lcd.clear();
-
-    // Set the pin modes of the button pins.
-    for (auto button : BUTTON_PINS) {
-        pinMode(button, INPUT_PULLUP);
-    }
+    i2c_begin(I2C_CLOCK_RATE);
+#if SUBSONIC_PROFILE
+    profiler::begin();
+#endif
+
+    // Set the pin modes of the button pins and start watching them.
+    setup_buttons();
 
     // Set the pin modes of the LED pins.
     for (auto led : LED_PINS) {
         pinMode(led, OUTPUT);
     }
 
-    // Display interactive welcome sequence
-    g_lcd.print("Subsonic IPT");
-    g_lcd.setCursor(0, 1);
-    g_lcd.noCursor();
-    g_lcd.setBacklight(0x808080);
-
-    for (int i = 0; i < (LCD_DIMENSIONS.x / 2) - 2; ++i) {
-        g_lcd.print("* ");
-        delay(250);
+    // Load the DMP firmware while showing the welcome sequence, whose stars
+    // track the load's progress. Both are sent through the I2C engine a
+    // transaction at a time, so neither holds up the other.
+    g_framebuffer.setContrast(5);
+    g_framebuffer.setBacklight(0x808080);
+    begin_dmp_load();
+    auto dmp_state = DmpLoadState::Resetting;
+    uint8_t stars_shown = 0xFF;
+    while (dmp_state < DmpLoadState::Done || g_lcd_writer.busy()) {
+        if (dmp_state < DmpLoadState::Done) {
+            dmp_state = service_dmp_load();
+        }
+        const auto stars = static_cast<uint8_t>(dmp_load_percent() * SPLASH_STARS / 100);
+        if (stars != stars_shown && !g_lcd_writer.busy()) {
+            stars_shown = stars;
+            render_splash(stars);
+            g_lcd_writer.begin_frame();
+        }
+        g_lcd_writer.service();
+        i2c_poll();
     }
+    Serial.print("DMP firmware loaded after ");
+    Serial.print(millis());
+    Serial.println(" ms");
 
-    Serial.println("Waiting for use input to calibrate...");
-    g_lcd.clear();
-    g_lcd.setCursor(0, 0);
-    g_lcd.print("Press any button");
-    g_lcd.setCursor(0, 1);
-    g_lcd.print("for calibration");
-    while (!button_any_tap_once()) { refresh_buttons(); } // Wait for any button to be pressed
-
-    g_lcd.clear();
-    g_lcd.setCursor(0, 0);
-    g_lcd.print("Initializing MPU");
-    g_lcd.setCursor(0, 1);
-    g_lcd.print("Calibrating...");
+    // Holding any button while the device starts requests a fresh
+    // calibration, even if a valid one is stored.
+    const bool recalibrate = !button_open(static_cast<Button>(ButtonLeft | ButtonRight | ButtonUp | ButtonDown | ButtonEnter));
 
     Serial.println("Beginning MPU setup...");
-    auto mpu_status = setup_mpu();
+    auto mpu_status = setup_mpu(recalibrate, prompt_calibration);
     if (mpu_status != 0) {
-        g_lcd.clear();
-        g_lcd.setCursor(0, 0);
-        g_lcd.print("FAILED TO START");
-        g_lcd.setCursor(0, 1);
-        g_lcd.print("MPU - [STOPPING]");
+        show_message("FAILED TO START", "MPU - [STOPPING]");
         while (true) { /* loop forever */ }
     }
+    set_motion_fields(MOTION_FIELDS);
     Serial.println("Setup successful.");
+    Serial.print("Boot time: ");
+    Serial.print(millis());
+    Serial.println(" ms");
+
+    // Presses made during setup were not meant for the menus.
+    ButtonEvent event{};
+    while (next_button_event(event)) {}
+
+    g_scheduler.start();
 }
 
 /**
@@ -243,7 +427,9 @@ void setup()
  */
 void loop()
 {
-    run_mpu_loop(subsonic_loop, update_position);
+    const auto pass_start_u = micros();
+    g_scheduler.run_pass();
+    g_loop_max_u = max(g_loop_max_u, micros() - pass_start_u);
 }
 
 /******************************************************************************\
@@ -251,131 +437,258 @@ void loop()
 \******************************************************************************/
 namespace {
 
-void subsonic_loop()
+void render_splash(uint8_t stars)
+{
+    g_framebuffer.clear();
+    g_framebuffer.print("Subsonic IPT");
+    g_framebuffer.setCursor(0, 1);
+    for (uint8_t i = 0; i < stars; ++i) {
+        g_framebuffer.print("* ");
+    }
+}
+
+void show_message(const char* first_line, const char* second_line)
+{
+    g_framebuffer.clear();
+    g_framebuffer.print(first_line);
+    g_framebuffer.setCursor(0, 1);
+    g_framebuffer.print(second_line);
+    while (g_lcd_writer.busy()) {
+        g_lcd_writer.service();
+        i2c_poll();
+    }
+    g_lcd_writer.begin_frame();
+    while (g_lcd_writer.busy()) {
+        g_lcd_writer.service();
+        i2c_poll();
+    }
+}
+
+void prompt_calibration()
+{
+    Serial.println("Waiting for use input to calibrate...");
+    show_message("Press any button", "for calibration");
+    // Wait for any button to be pressed. The press is captured by its
+    // interrupt, so it is enough to check for it occasionally. Presses made
+    // before the prompt appeared are ignored.
+    ButtonEvent event{};
+    while (next_button_event(event)) {}
+    do {
+        delay(1);
+        refresh_buttons();
+    } while (!next_button_event(event) || !event.closed);
+
+    show_message("Initializing MPU", "Calibrating...");
+}
+
+void ingest_motion()
 {
-    // Update the state of the buttons/switches
+    service_mpu(update_position);
+}
+
+void handle_input()
+{
+    // Finish debouncing any recent button changes, then hand each press to
+    // the menus in the order they happened.
     refresh_buttons();
 
-    const Menu::Input input{
-        button_closed_once(ButtonLeft),
-        button_closed_once(ButtonRight),
-        button_closed_once(ButtonUp),
-        button_closed_once(ButtonDown),
-        button_closed_once(ButtonEnter),
-    };
-
-    g_menu_manager.interact(input);
-
-    const auto time = millis();
-    // Check if sufficient time has passed since the last display update.
-    if (time - g_last_display_update >= REFRESH_PERIOD_MILLI) {
-        g_last_display_update = time;
-
-        g_menu_manager.refresh_display(g_lcd);
-
-        // Compute the guidance direction that should be displayed to the user.
-        Point user_direction = g_nav.compute_direction(
-            g_device_state.position,
-            g_device_state.facing
-        );
-        auto direction_dist = user_direction.norm();
-
-        // Check if the device has reached a new maximum distance from
-        // a target.
-        if (direction_dist > g_max_distance) {
-            g_max_distance = direction_dist;
-#ifdef SUBSONIC_DEBUG_SERIAL_MAX_DIST
-            Serial.print("Setting new max distance to ");
-            Serial.println(direction_dist);
+    ButtonEvent event{};
+    while (next_button_event(event)) {
+#ifdef SUBSONIC_DEBUG_SERIAL_BUTTONS
+        Serial.print(event.closed ? "Button closed: " : "Button opened: ");
+        Serial.print(event.button);
+        Serial.print(" at ");
+        Serial.println(event.time_u);
 #endif
+        if (!event.closed) {
+            continue;
         }
+        const Menu::Input input{
+            event.button == ButtonLeft,
+            event.button == ButtonRight,
+            event.button == ButtonUp,
+            event.button == ButtonDown,
+            event.button == ButtonEnter,
+        };
+        g_menu_manager.interact(input);
+    }
+}
+
+void update_guidance()
+{
+    // Guidance computed for the current state epoch, shared with the
+    // menus.
+    const auto direction_dist = g_guidance.snapshot().distance;
+
+    // Check if the device has reached a new maximum distance from
+    // a target.
+    if (direction_dist > g_max_distance) {
+        g_max_distance = direction_dist;
+#ifdef SUBSONIC_DEBUG_SERIAL_MAX_DIST
+        Serial.print("Setting new max distance to ");
+        Serial.println(static_cast<double>(direction_dist));
+#endif
+    }
 
 #ifdef SUBSONIC_DEBUG_SERIAL_LEDS
-        Serial.print("Illuminating ");
-        Serial.print(direction_dist / g_max_distance);
-        Serial.println(" percent of LEDs");
+    Serial.print("Illuminating ");
+    Serial.print(static_cast<double>(direction_dist) / static_cast<double>(g_max_distance));
+    Serial.println(" percent of LEDs");
 #endif
-        // Temporary arbitrary waypoint colors.
-        switch (g_nav.current_destination_index()) {
-            case 0: {
-                analogWrite(LED_PINS[0], 30);
-                analogWrite(LED_PINS[1], 127);
-                analogWrite(LED_PINS[2], 30);
-                break;
-            }
-            case 1: {
-                analogWrite(LED_PINS[0], 255);
-                analogWrite(LED_PINS[1], 127);
-                analogWrite(LED_PINS[2], 0);
-                break;
-            }
-            case 2: {
-                analogWrite(LED_PINS[0], 0);
-                analogWrite(LED_PINS[1], 255);
-                analogWrite(LED_PINS[2], 255);
-                break;
-            }
-            case 3: {
-                analogWrite(LED_PINS[0], 100);
-                analogWrite(LED_PINS[1], 0);
-                analogWrite(LED_PINS[2], 0);
-                break;
-            }
+    // Temporary arbitrary waypoint colors.
+    switch (g_nav.current_destination_index()) {
+        case 0: {
+            analogWrite(LED_PINS[0], 30);
+            analogWrite(LED_PINS[1], 127);
+            analogWrite(LED_PINS[2], 30);
+            break;
+        }
+        case 1: {
+            analogWrite(LED_PINS[0], 255);
+            analogWrite(LED_PINS[1], 127);
+            analogWrite(LED_PINS[2], 0);
+            break;
+        }
+        case 2: {
+            analogWrite(LED_PINS[0], 0);
+            analogWrite(LED_PINS[1], 255);
+            analogWrite(LED_PINS[2], 255);
+            break;
+        }
+        case 3: {
+            analogWrite(LED_PINS[0], 100);
+            analogWrite(LED_PINS[1], 0);
+            analogWrite(LED_PINS[2], 0);
+            break;
         }
-//        g_led_array.activate_led_percent(1 - (direction_dist / g_max_distance));
     }
+//    g_led_array.activate_led_percent(1 - (direction_dist / g_max_distance));
 }
 
-void update_position(const DeviceMotion& device_motion)
+void render_display()
 {
-    // Member pointer to the member of DeviceMotion that contains the "true
-    // pitch" of the device.
-    //
-    // Update this pointer if the MPU is mounted in an orientation different
-    // from the expected orientation of the device.
-    //
-    // e.g. if the MPU is rotated 90 degrees, the "true pitch" will be the
-    // roll.
-    constexpr static float DeviceMotion::*true_pitch = &DeviceMotion::roll;
+    // The next frame is only rendered once the previous one has been sent in
+    // full, so that each appears at once.
+    if (g_lcd_writer.busy()) {
+        return;
+    }
+    // Render the frame and start sending the cells that changed since the
+    // last one.
+    g_menu_manager.refresh_display(g_framebuffer);
+    g_lcd_writer.begin_frame();
+}
 
-    // Copy new motion measurements into device state storage.
-    g_device_state.device_motion = device_motion;
-    g_device_state.device_motion.yaw = device_motion.yaw;
-    g_device_state.device_motion.pitch = device_motion.pitch;
-    g_device_state.device_motion.roll = device_motion.roll;
-    auto current_time = micros();
-    auto time_delta = static_cast<double>(current_time - g_last_position_update_u);
-    time_delta /= 1e6;             // convert microseconds to seconds
-
-    // Yaw is reported as a clockwise rotation, so we flip its sign
-    // to change to the counterclockwise rotation used by the navigation
-    // logic.
-    auto yaw_angle = Angle{-device_motion.yaw};
-    yaw_angle.normalize();
-    g_device_state.facing = yaw_angle;
-    const auto displacement =
-        time_delta * pitch_to_vel(Angle{device_motion.*true_pitch}) * Point::unit_from_angle(yaw_angle);
-    g_device_state.position = g_device_state.position + displacement;
-
-    // Recompute current time to account for time lost to arithmetic
-    g_last_position_update_u = micros();
+void flush_display()
+{
+    g_lcd_writer.service();
+}
+
+void send_telemetry()
+{
+#if defined(SUBSONIC_DEBUG_SERIAL_POSITION) && defined(SUBSONIC_DEBUG_SERIAL_TELEMETRY)
+    // Records wait in the queue until the serial transmit buffer has room
+    // for them, and are only dropped if the queue fills up.
+    while (!g_telemetry_queue.empty() && g_telemetry.writable()) {
+        auto& record = g_telemetry_queue.front();
+        record.loop_max_u = static_cast<uint16_t>(min(g_loop_max_u, 0xFFFFUL));
+        if (g_telemetry.send(record)) {
+            g_loop_max_u = 0;
+        }
+        g_telemetry_queue.pop();
+    }
+#elif defined(SUBSONIC_DEBUG_SERIAL_POSITION)
+    if (!g_position_report_pending) {
+        return;
+    }
+    g_position_report_pending = false;
     Serial.print("From (");
-    Serial.print(g_device_state.position.m_x);
+    Serial.print(static_cast<double>(g_device_state.position.m_x));
     Serial.print(',');
-    Serial.print(g_device_state.position.m_y);
+    Serial.print(static_cast<double>(g_device_state.position.m_y));
     Serial.print(")@");
-    Serial.println(g_device_state.facing.deg());
+    Serial.println(g_device_state.facing.deg<double>());
+#endif
 }
 
-double pitch_to_vel(Angle pitch)
+#ifdef SUBSONIC_DEBUG_SERIAL_SCHEDULER
+void report_tasks()
 {
-    for (const auto pair : PITCH_VEL_MAPPING) {
-        if (pitch.deg() < pair[0]) {
-            return pair[1];
-        }
+    for (uint8_t i = 0; i < g_scheduler.size(); ++i) {
+        const auto& stats = g_scheduler.stats(i);
+        Serial.print(g_scheduler.task(i).name);
+        Serial.print(": ");
+        Serial.print(stats.runs);
+        Serial.print(" runs, ");
+        Serial.print(stats.overruns);
+        Serial.print(" overruns, max ");
+        Serial.print(stats.max_run_u);
+        Serial.print(" us run, ");
+        Serial.print(stats.max_response_u);
+        Serial.println(" us response");
     }
-    constexpr size_t last_pos = (sizeof(PITCH_VEL_MAPPING) / sizeof(PITCH_VEL_MAPPING[0])) - 1;
-    return 1; //PITCH_VEL_MAPPING[last_pos][1];
+}
+#endif
+
+#if defined(SUBSONIC_DEBUG_SERIAL_PROFILE) && SUBSONIC_PROFILE
+void report_probe()
+{
+    // The index of the probe to print next.
+    static uint8_t next_probe{0};
+
+    // The line is only written if it fits in the serial transmit buffer, so
+    // that printing never holds up the IMU. Otherwise it is tried again on
+    // the next run.
+    char line[32];
+    const auto probe = static_cast<profiler::Probe>(next_probe);
+    const int length = profiler::format_stats(line, sizeof(line), probe);
+    if (length <= 0 || Serial.availableForWrite() < length + 2) {
+        return;
+    }
+    Serial.println(line);
+    next_probe = (next_probe + 1) % profiler::PROBE_COUNT;
+}
+#endif
+
+void update_position(const DeviceMotion& device_motion)
+{
+    SUBSONIC_PROFILE_SCOPE(profiler::Probe::UpdatePosition);
+
+    // Copy new motion measurements into device state storage.
+    g_device_state.device_motion = device_motion;
+    g_device_state.device_motion.yaw = device_motion.yaw;
+    g_device_state.device_motion.pitch = device_motion.pitch;
+    g_device_state.device_motion.roll = device_motion.roll;
+    g_dead_reckoning.update(g_device_state, device_motion);
+
+#if defined(SUBSONIC_DEBUG_SERIAL_POSITION) && defined(SUBSONIC_DEBUG_SERIAL_TELEMETRY)
+    // The record is sent by the telemetry task. If the queue is full, the
+    // oldest record is sent, or dropped, to make room.
+    if (g_telemetry_queue.full()) {
+        g_telemetry.send(g_telemetry_queue.front());
+        g_telemetry_queue.pop();
+    }
+    telemetry::MotionRecord& record = g_telemetry_queue.back();
+    record = telemetry::MotionRecord{};
+    record.timestamp_u = device_motion.timestamp_u;
+    record.x = static_cast<float>(static_cast<double>(g_device_state.position.m_x));
+    record.y = static_cast<float>(static_cast<double>(g_device_state.position.m_y));
+    record.facing = g_device_state.facing.raw();
+    for (uint8_t i = 0; i < 3; ++i) {
+        record.ypr[i] = BinaryAngle::from_radians(static_cast<double>(device_motion.ypr[i])).raw();
+    }
+    record.world_accel[0] = device_motion.world_accel.x;
+    record.world_accel[1] = device_motion.world_accel.y;
+    record.world_accel[2] = device_motion.world_accel.z;
+    record.latency_u = static_cast<uint16_t>(min(micros() - device_motion.timestamp_u, 0xFFFFUL));
+    record.fifo_count = mpu_fifo_count();
+    g_telemetry_queue.push();
+#elif defined(SUBSONIC_DEBUG_SERIAL_POSITION)
+    // Only report the position once per batch of packets, since printing
+    // is far slower than integrating.
+    if (device_motion.batch_remaining == 0) {
+        g_position_report_pending = true;
+    }
+#endif
 }
 
 } // namespace
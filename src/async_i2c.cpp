@@ -0,0 +1,260 @@
+/**
+ * async_i2c.cpp - Implementation for queued, non-blocking I2C transactions.
+ *
+ * The TWI peripheral raises its interrupt flag once it has finished each bus
+ * operation (start condition, address or data byte). Each time, `twi_step`
+ * inspects the status register and issues the next operation of the active
+ * transaction, so the CPU is free between bytes.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include <util/twi.h>
+
+#include "async_i2c.h"
+#include "ring_buffer.h"
+
+/******************************************************************************\
+ * Internal definitions
+\******************************************************************************/
+namespace {
+using namespace subsonic_ipt;
+
+/**
+ * The TWI control bits that are set for every bus operation.
+ */
+constexpr uint8_t TWCR_ENABLE = _BV(TWEN) | (SUBSONIC_TWI_ISR ? _BV(TWIE) : 0);
+
+/**
+ * Queues shared between the main loop and `twi_step`.
+ *
+ * The main loop must disable interrupts while accessing them.
+ */
+struct {
+    /// Transactions waiting for the bus.
+    RingBuffer<I2CTransaction*, SUBSONIC_I2C_QUEUE> queued;
+    /// Finished transactions waiting for their callbacks to be run.
+    RingBuffer<I2CTransaction*, SUBSONIC_I2C_QUEUE> completed;
+    /// The transaction that currently holds the bus.
+    I2CTransaction* active;
+    /// The index of the next byte of the active transaction's current phase.
+    uint8_t index;
+    /// Whether the active transaction is in its read phase.
+    bool reading;
+} g_twi{};
+
+void twi_start() noexcept
+{
+    TWCR = TWCR_ENABLE | _BV(TWINT) | _BV(TWSTA);
+}
+
+/**
+ * Clocks the next byte, acknowledging it if it is a byte being read and
+ * `ack` is set.
+ */
+void twi_continue(bool ack) noexcept
+{
+    TWCR = TWCR_ENABLE | _BV(TWINT) | (ack ? _BV(TWEA) : 0);
+}
+
+/**
+ * Makes the given transaction active. The caller is responsible for
+ * issuing its start condition.
+ */
+void twi_activate(I2CTransaction* transaction) noexcept
+{
+    g_twi.active = transaction;
+    g_twi.index = 0;
+    g_twi.reading = transaction->write_length == 0 && transaction->read_length != 0;
+}
+
+/**
+ * Completes the active transaction with the given result and releases the
+ * bus to the next queued transaction, if any.
+ */
+void twi_finish(I2CResult result) noexcept
+{
+    g_twi.active->result = result;
+    g_twi.completed.push(g_twi.active);
+    g_twi.active = nullptr;
+
+    if (g_twi.queued.empty()) {
+        TWCR = TWCR_ENABLE | _BV(TWINT) | _BV(TWSTO);
+        return;
+    }
+    twi_activate(g_twi.queued.front());
+    g_twi.queued.pop();
+    // Stop, then start the next transaction as soon as the bus is free.
+    TWCR = TWCR_ENABLE | _BV(TWINT) | _BV(TWSTO) | _BV(TWSTA);
+}
+
+/**
+ * Advances the active transaction in response to the TWI interrupt flag.
+ */
+void twi_step() noexcept
+{
+    I2CTransaction* const transaction = g_twi.active;
+    if (transaction == nullptr) {
+        return;
+    }
+
+    switch (TW_STATUS) {
+        case TW_START:
+        case TW_REP_START: {
+            TWDR = static_cast<uint8_t>(transaction->address << 1u) | (g_twi.reading ? TW_READ : TW_WRITE);
+            twi_continue(false);
+            break;
+        }
+        case TW_MT_SLA_ACK:
+        case TW_MT_DATA_ACK: {
+            if (g_twi.index < transaction->write_length) {
+                TWDR = transaction->write_data[g_twi.index++];
+                twi_continue(false);
+            } else if (transaction->read_length != 0) {
+                g_twi.reading = true;
+                g_twi.index = 0;
+                twi_start();
+            } else {
+                twi_finish(I2CResult::Success);
+            }
+            break;
+        }
+        case TW_MR_DATA_ACK: {
+            transaction->read_data[g_twi.index++] = TWDR;
+            // Acknowledge every byte but the last.
+            twi_continue(g_twi.index + 1 < transaction->read_length);
+            break;
+        }
+        case TW_MR_SLA_ACK: {
+            twi_continue(transaction->read_length > 1);
+            break;
+        }
+        case TW_MR_DATA_NACK: {
+            transaction->read_data[g_twi.index++] = TWDR;
+            twi_finish(I2CResult::Success);
+            break;
+        }
+        case TW_MT_SLA_NACK:
+        case TW_MR_SLA_NACK: {
+            twi_finish(I2CResult::AddressNack);
+            break;
+        }
+        case TW_MT_DATA_NACK: {
+            twi_finish(I2CResult::DataNack);
+            break;
+        }
+        default: {
+            twi_finish(I2CResult::BusError);
+            break;
+        }
+    }
+}
+
+/**
+ * Advances the active transaction if the TWI interrupt is not used to do so.
+ */
+void twi_service() noexcept
+{
+#if !SUBSONIC_TWI_ISR
+    if (TWCR & _BV(TWINT)) {
+        twi_step();
+    }
+#endif
+}
+
+} // namespace
+
+#if SUBSONIC_TWI_ISR
+ISR(TWI_vect)
+{
+    twi_step();
+}
+#endif
+
+/******************************************************************************\
+ * Public definitions
+\******************************************************************************/
+namespace subsonic_ipt {
+
+void i2c_begin(uint32_t clock_hz)
+{
+    // No prescaler.
+    TWSR = 0;
+    TWBR = static_cast<uint8_t>(((F_CPU / clock_hz) - 16) / 2);
+    TWCR = TWCR_ENABLE;
+}
+
+bool i2c_submit(I2CTransaction& transaction)
+{
+    noInterrupts();
+    // Bound the outstanding transactions so that the completed queue can
+    // never overflow, even if callbacks are not run for a while. A pending
+    // transaction is already in one of the queues, which it must not join
+    // twice.
+    const uint8_t outstanding = g_twi.queued.size() + g_twi.completed.size() + (g_twi.active != nullptr);
+    if (outstanding >= SUBSONIC_I2C_QUEUE || transaction.result == I2CResult::Pending) {
+        interrupts();
+        return false;
+    }
+    transaction.result = I2CResult::Pending;
+    if (g_twi.active == nullptr) {
+        twi_activate(&transaction);
+        twi_start();
+    } else {
+        g_twi.queued.push(&transaction);
+    }
+    interrupts();
+    return true;
+}
+
+void i2c_poll()
+{
+    twi_service();
+    while (true) {
+        noInterrupts();
+        if (g_twi.completed.empty()) {
+            interrupts();
+            return;
+        }
+        I2CTransaction* const transaction = g_twi.completed.front();
+        g_twi.completed.pop();
+        interrupts();
+
+        if (transaction->on_complete != nullptr) {
+            transaction->on_complete(*transaction);
+        }
+    }
+}
+
+void i2c_advance()
+{
+    twi_service();
+}
+
+bool i2c_idle()
+{
+    noInterrupts();
+    const bool idle = g_twi.active == nullptr && g_twi.queued.empty();
+    interrupts();
+    return idle;
+}
+
+void i2c_wait_idle()
+{
+    while (!i2c_idle()) {
+        twi_service();
+#if SUBSONIC_TWI_ISR
+        // Spin on the control register so that the simulated bus of the
+        // host build makes progress.
+        (void) static_cast<uint8_t>(TWCR);
+#endif
+    }
+}
+
+} // namespace subsonic_ipt
@@ -0,0 +1,135 @@
+/**
+ * async_i2c.h - Interface for queued, non-blocking I2C transactions.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_ASYNC_I2C_H
+#define SUBSONIC_IPT_ASYNC_I2C_H
+
+#include <stdint.h>
+
+// When nonzero, transactions are advanced from the TWI interrupt. Otherwise
+// they are advanced by polling the TWI interrupt flag from `i2c_poll` and
+// `i2c_advance`.
+//
+// On the Uno, the Wire library also defines the TWI interrupt handler, so the
+// interrupt may only be used by builds that do not link Wire's twi.c.
+#ifndef SUBSONIC_TWI_ISR
+#ifdef __AVR__
+#define SUBSONIC_TWI_ISR 0
+#else
+#define SUBSONIC_TWI_ISR 1
+#endif
+#endif
+
+// The number of transactions that may be waiting for the bus at once.
+#ifndef SUBSONIC_I2C_QUEUE
+#define SUBSONIC_I2C_QUEUE 4
+#endif
+
+namespace subsonic_ipt {
+
+/**
+ * The outcome of an I2C transaction.
+ */
+enum class I2CResult : uint8_t {
+    /// The transaction is queued or in progress.
+    Pending,
+    Success,
+    /// No device acknowledged the address.
+    AddressNack,
+    /// The device did not acknowledge a written byte.
+    DataNack,
+    /// Arbitration was lost or an illegal bus condition occurred.
+    BusError,
+};
+
+struct I2CTransaction;
+
+/**
+ * Function run from `i2c_poll` once a transaction has finished.
+ */
+using I2CCallback = void (*)(I2CTransaction& transaction);
+
+/**
+ * A transfer with a single device: a write, a read, or a write followed by
+ * a read after a repeated start (e.g. a register address, then its value).
+ *
+ * The transaction and its buffers are owned by the submitter and must
+ * remain valid until the transaction completes. Nothing is copied.
+ */
+struct I2CTransaction {
+    /// The 7-bit address of the device.
+    uint8_t address;
+    /// The bytes to write before any read.
+    const uint8_t* write_data;
+    uint8_t write_length;
+    /// The buffer that bytes read from the device are written to.
+    uint8_t* read_data;
+    uint8_t read_length;
+    /// Run once the transaction finishes, or null.
+    I2CCallback on_complete;
+    /// Free for the submitter's use from `on_complete`.
+    void* context;
+    /// Set to `Pending` on submission and to the outcome on completion.
+    volatile I2CResult result;
+};
+
+/**
+ * Configures the TWI peripheral for the given bus clock rate.
+ *
+ * The Wire library may still be used while the transaction queue is idle,
+ * e.g. by the vendored MPU and SerLCD drivers, so long as `i2c_wait_idle`
+ * is called first.
+ */
+void i2c_begin(uint32_t clock_hz);
+
+[[nodiscard]]
+/**
+ * Queues the given transaction, starting it immediately if the bus is idle.
+ *
+ * Returns `false` if the queue is full or the transaction is still pending
+ * from a previous submission.
+ */
+bool i2c_submit(I2CTransaction& transaction);
+
+/**
+ * Advances the transaction in progress when the TWI interrupt is not used,
+ * then runs the callbacks of every completed transaction.
+ *
+ * Must be called regularly from the main loop. Callbacks may submit
+ * further transactions.
+ */
+void i2c_poll();
+
+/**
+ * Advances the transaction in progress when the TWI interrupt is not used,
+ * without running any completion callbacks.
+ *
+ * Each call issues at most one bus operation, so it is cheap enough to call
+ * between other pieces of work to keep the bus busy while they run.
+ */
+void i2c_advance();
+
+[[nodiscard]]
+/**
+ * Returns `true` if no transaction is queued or in progress.
+ *
+ * Completion callbacks may still be waiting to run from `i2c_poll`.
+ */
+bool i2c_idle();
+
+/**
+ * Blocks until no transaction is queued or in progress, without running any
+ * completion callbacks.
+ */
+void i2c_wait_idle();
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_ASYNC_I2C_H
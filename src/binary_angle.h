@@ -0,0 +1,174 @@
+/**
+ * binary_angle.h - Binary angle measurement (BAM) representation of angles.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_BINARY_ANGLE_H
+#define SUBSONIC_IPT_BINARY_ANGLE_H
+
+#include <stdint.h>
+#include <math.h> // cmath not available
+
+#include "fixed.h"
+
+namespace subsonic_ipt {
+
+/**
+ * An angle stored as a fraction of a full turn in a `uint16_t`.
+ *
+ * A full turn maps onto the 2^16 values of the representation, so every
+ * value is already normalized to [0, 2pi) and wraparound is the natural
+ * overflow of unsigned arithmetic. Addition, subtraction, conjugation and
+ * comparison each cost a single integer operation. The resolution is
+ * 360 / 2^16 (about 0.0055) degrees.
+ */
+class BinaryAngle {
+    /// This angle in units of 2^-16 turns.
+    uint16_t m_turns;
+
+  public:
+    /// The number of representable angles in a full turn, as a double.
+    static constexpr double STEPS_PER_TURN{65536.0};
+
+    constexpr BinaryAngle() noexcept: m_turns(0) {}
+
+    [[nodiscard]]
+    /// Constructs an angle from a raw count of 2^-16 turns.
+    static constexpr BinaryAngle from_raw(uint16_t turns) noexcept
+    {
+        BinaryAngle angle;
+        angle.m_turns = turns;
+        return angle;
+    }
+
+    [[nodiscard]]
+    /**
+     * Constructs an angle with the given value in degrees.
+     */
+    static constexpr BinaryAngle from_degrees(double degrees) noexcept
+    {
+        return from_radians(degrees * M_PI / 180);
+    }
+
+    [[nodiscard]]
+    /**
+     * Constructs an angle with the given value in radians.
+     *
+     * The value must lie within 32768 turns of zero. NaN maps to zero.
+     */
+    static constexpr BinaryAngle from_radians(double radians) noexcept
+    {
+        if (radians != radians) {
+            return BinaryAngle{};
+        }
+        const double turns = radians * (STEPS_PER_TURN / (2 * M_PI));
+        return from_raw(static_cast<uint16_t>(static_cast<int32_t>(turns + (turns < 0 ? -0.5 : 0.5))));
+    }
+
+    [[nodiscard]]
+    /**
+     * Constructs an angle with the given fixed-point value in radians.
+     */
+    static constexpr BinaryAngle from_radians(Fixed radians) noexcept
+    {
+        // 2^16 / 2pi == 10430.378 in Q16.16
+        constexpr int64_t TURNS_PER_RADIAN_Q16{683565276};
+        const int64_t turns = (static_cast<int64_t>(radians.raw()) * TURNS_PER_RADIAN_Q16 + (static_cast<int64_t>(1) << 31)) >> 32;
+        return from_raw(isnan(radians) ? 0 : static_cast<uint16_t>(turns));
+    }
+
+    [[nodiscard]]
+    /// Returns the raw count of 2^-16 turns in this angle.
+    constexpr uint16_t raw() const noexcept
+    {
+        return m_turns;
+    }
+
+    /// Returns this angle in radians on the interval [0, 2pi).
+    template<typename T>
+    [[nodiscard]] constexpr T radians() const noexcept;
+
+    /// Returns this angle in degrees on the interval [0, 360).
+    template<typename T>
+    [[nodiscard]] constexpr T deg() const noexcept;
+
+    [[nodiscard]]
+    /**
+     * Returns the conjugate of this angle.
+     */
+    constexpr BinaryAngle conjugate() const noexcept
+    {
+        return -*this;
+    }
+
+    constexpr BinaryAngle operator-() const noexcept
+    {
+        return from_raw(static_cast<uint16_t>(-m_turns));
+    }
+
+    friend constexpr BinaryAngle operator+(BinaryAngle first, BinaryAngle second) noexcept
+    {
+        return from_raw(static_cast<uint16_t>(first.m_turns + second.m_turns));
+    }
+
+    friend constexpr BinaryAngle operator-(BinaryAngle first, BinaryAngle second) noexcept
+    {
+        return from_raw(static_cast<uint16_t>(first.m_turns - second.m_turns));
+    }
+
+    friend constexpr bool operator==(BinaryAngle first, BinaryAngle second) noexcept
+    {
+        return first.m_turns == second.m_turns;
+    }
+
+    friend constexpr bool operator!=(BinaryAngle first, BinaryAngle second) noexcept
+    {
+        return first.m_turns != second.m_turns;
+    }
+
+    friend constexpr bool operator<(BinaryAngle first, BinaryAngle second) noexcept
+    {
+        return first.m_turns < second.m_turns;
+    }
+
+    friend constexpr bool operator>(BinaryAngle first, BinaryAngle second) noexcept
+    {
+        return first.m_turns > second.m_turns;
+    }
+};
+
+template<>
+constexpr double BinaryAngle::radians<double>() const noexcept
+{
+    return m_turns * (2 * M_PI / STEPS_PER_TURN);
+}
+
+template<>
+constexpr Fixed BinaryAngle::radians<Fixed>() const noexcept
+{
+    // raw = turns * 2pi, split so that the product fits in 32 bits.
+    const uint32_t turns = m_turns;
+    return Fixed::from_raw(static_cast<int32_t>(turns * 6 + ((turns * 18559u + 32768u) >> 16u)));
+}
+
+template<>
+constexpr double BinaryAngle::deg<double>() const noexcept
+{
+    return m_turns * (360.0 / STEPS_PER_TURN);
+}
+
+template<>
+constexpr Fixed BinaryAngle::deg<Fixed>() const noexcept
+{
+    // A turn is exactly 360 in Q16.16 units of 2^-16 degrees.
+    return Fixed::from_raw(static_cast<int32_t>(m_turns) * 360);
+}
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_BINARY_ANGLE_H
@@ -0,0 +1,29 @@
+/**
+ * crc16.cpp - Implementation for the CRC-16/CCITT-FALSE.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "crc16.h"
+
+namespace subsonic_ipt {
+
+uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc) noexcept
+{
+    // A byte at a time, without a table: the shifts fold the eight steps of
+    // the polynomial division into one, as in avr-libc's _crc_xmodem_update.
+    for (size_t i = 0; i < length; ++i) {
+        crc = static_cast<uint16_t>((crc >> 8u) | (crc << 8u));
+        crc ^= data[i];
+        crc ^= static_cast<uint8_t>(crc) >> 4u;
+        crc ^= static_cast<uint16_t>(crc << 12u);
+        crc ^= static_cast<uint16_t>(static_cast<uint8_t>(crc) << 5u);
+    }
+    return crc;
+}
+
+} // namespace subsonic_ipt
@@ -0,0 +1,29 @@
+/**
+ * crc16.h - CRC used to check telemetry records, stored calibrations and
+ *           the DMP firmware.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_CRC16_H
+#define SUBSONIC_IPT_CRC16_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace subsonic_ipt {
+
+[[nodiscard]]
+/**
+ * Returns the CRC-16/CCITT-FALSE of the given bytes, continuing from the
+ * given CRC.
+ */
+uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF) noexcept;
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_CRC16_H
@@ -0,0 +1,56 @@
+/**
+ * dead_reckoning.cpp - Implementation for tracking the device's position
+ *                      from its orientation.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "dead_reckoning.h"
+
+#include "scalar.h"
+
+namespace subsonic_ipt {
+
+Scalar DeadReckoning::pitch_to_vel(Angle pitch) const
+{
+    for (uint8_t i = 0; i < m_pitch_vel_rows; ++i) {
+        if (pitch.deg() < m_pitch_vel_mapping[i][0]) {
+            return m_pitch_vel_mapping[i][1];
+        }
+    }
+    return 1;
+}
+
+void DeadReckoning::update(IPTState& state, const DeviceMotion& device_motion)
+{
+    // Each packet is integrated over the time since the previous packet was
+    // sampled, as captured by the MPU interrupt, rather than since it was
+    // processed, so the display and serial load do not affect the distance
+    // travelled. The first packet only starts the clock, since the time since
+    // startup was spent in setup. Packets lost to a FIFO overflow are bridged
+    // at the current velocity.
+    // The elapsed time is taken modulo 2^32 so that it stays correct across
+    // the wrap of micros().
+    const uint32_t timestamp_u = device_motion.timestamp_u;
+    const uint32_t elapsed_u = m_updated ? timestamp_u - m_last_update_u : 0;
+    const auto time_delta = seconds_from_micros<Scalar>(elapsed_u);
+    m_last_update_u = timestamp_u;
+    m_updated = true;
+
+    // Yaw is reported as a clockwise rotation, so we flip its sign
+    // to change to the counterclockwise rotation used by the navigation
+    // logic. The binary angle wraps onto [0, 2pi) for free, and its sine
+    // and cosine are computed here once for every consumer of the facing.
+    state.update_facing(BinaryAngle::from_radians(-device_motion.yaw));
+    const auto displacement =
+        time_delta * pitch_to_vel(Angle{device_motion.*m_true_pitch}) * state.facing_rotation.unit();
+    state.position = state.position + displacement;
+    // Invalidate the guidance computed for the previous position.
+    state.advance_epoch();
+}
+
+} // namespace subsonic_ipt
@@ -0,0 +1,86 @@
+/**
+ * dead_reckoning.h - Tracking the device's position from its orientation.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_DEAD_RECKONING_H
+#define SUBSONIC_IPT_DEAD_RECKONING_H
+
+#include <stdint.h>
+
+#include "point.h"
+#include "state.h"
+#include "inputs/mpu.h"
+
+namespace subsonic_ipt {
+
+/**
+ * Moves the device through the world one MPU packet at a time.
+ *
+ * The user walks in the direction the device is facing, at a speed chosen
+ * by how far the device is pitched forward.
+ */
+class DeadReckoning {
+  public:
+    /**
+     * A row of a pitch-to-velocity mapping, as a pitch in degrees and a
+     * velocity in meters per second.
+     *
+     * A device pitched less than a row's pitch, and at least the previous
+     * row's pitch, moves at that row's velocity.
+     */
+    using PitchVelocity = Scalar[2];
+
+  private:
+    /// The rows of the pitch-to-velocity mapping, in increasing pitch.
+    const PitchVelocity* m_pitch_vel_mapping;
+
+    /// The number of rows in `m_pitch_vel_mapping`.
+    uint8_t m_pitch_vel_rows;
+
+    /// The member of `DeviceMotion` that contains the "true pitch" of the
+    /// device.
+    float DeviceMotion::* m_true_pitch;
+
+    /**
+     * The timestamp in microseconds since device startup, modulo 2^32, of
+     * the MPU packet that the position was last updated from.
+     */
+    uint32_t m_last_update_u{0};
+
+    /// Whether the position has been updated from a packet yet.
+    bool m_updated{false};
+
+  public:
+    DeadReckoning(const PitchVelocity* pitch_vel_mapping, uint8_t pitch_vel_rows, float DeviceMotion::* true_pitch)
+        : m_pitch_vel_mapping(pitch_vel_mapping),
+          m_pitch_vel_rows(pitch_vel_rows),
+          m_true_pitch(true_pitch) {}
+
+    template<uint8_t N>
+    DeadReckoning(const PitchVelocity (& pitch_vel_mapping)[N], float DeviceMotion::* true_pitch)
+        : DeadReckoning(pitch_vel_mapping, N, true_pitch) {}
+
+    [[nodiscard]]
+    /**
+     * Returns the horizontal velocity associated with the specified pitch.
+     *
+     * Pitches beyond the last row of the mapping move at 1 m/s.
+     */
+    Scalar pitch_to_vel(Angle pitch) const;
+
+    /**
+     * Updates the facing and position in the given state from a newly
+     * delivered MPU packet, and advances the state's epoch.
+     */
+    void update(IPTState& state, const DeviceMotion& device_motion);
+};
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_DEAD_RECKONING_H
@@ -0,0 +1,412 @@
+/**
+ * fast_trig.cpp - Implementation of table-driven and CORDIC trigonometry.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "fast_trig.h"
+
+#include <math.h> // cmath not available
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#ifndef pgm_read_word
+#define pgm_read_word(addr) (*(const unsigned short*)(addr))
+#endif
+#ifndef pgm_read_dword
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#endif
+#endif
+
+namespace {
+using subsonic_ipt::Fixed;
+using subsonic_ipt::fast_trig::Phase;
+using subsonic_ipt::fast_trig::SinCos;
+
+/// The number of table steps in a quarter turn.
+constexpr uint8_t QUARTER_STEPS{128};
+
+/// Phases of commonly used fractions of a turn.
+constexpr Phase QUARTER_TURN{static_cast<Phase>(1) << 30u};
+constexpr Phase HALF_TURN{static_cast<Phase>(1) << 31u};
+
+/// Raw Q16.16 representation of 2pi.
+constexpr int32_t TWO_PI_RAW{411775};
+
+/// Phase per Q16.16 radian (2^32 / 2pi / 2^16) in Q16.16.
+constexpr uint64_t PHASE_PER_RADIAN_Q16{683565276};
+
+/// The CORDIC gain correction, prod(1 / sqrt(1 + 2^-2i)), in Q2.30.
+constexpr int32_t CORDIC_GAIN_Q30{652032874};
+
+/**
+ * sin(i * pi / 256) in Q16.16 for i in [0, 128). The entry for i = 128
+ * (exactly 1.0) does not fit in 16 bits and is supplied by `sine_entry`.
+ */
+const uint16_t SINE_TABLE[QUARTER_STEPS] PROGMEM = {
+    0, 804, 1608, 2412, 3216, 4019, 4821, 5623,
+    6424, 7224, 8022, 8820, 9616, 10411, 11204, 11996,
+    12785, 13573, 14359, 15143, 15924, 16703, 17479, 18253,
+    19024, 19792, 20557, 21320, 22078, 22834, 23586, 24335,
+    25080, 25821, 26558, 27291, 28020, 28745, 29466, 30182,
+    30893, 31600, 32303, 33000, 33692, 34380, 35062, 35738,
+    36410, 37076, 37736, 38391, 39040, 39683, 40320, 40951,
+    41576, 42194, 42806, 43412, 44011, 44604, 45190, 45769,
+    46341, 46906, 47464, 48015, 48559, 49095, 49624, 50146,
+    50660, 51166, 51665, 52156, 52639, 53114, 53581, 54040,
+    54491, 54934, 55368, 55794, 56212, 56621, 57022, 57414,
+    57798, 58172, 58538, 58896, 59244, 59583, 59914, 60235,
+    60547, 60851, 61145, 61429, 61705, 61971, 62228, 62476,
+    62714, 62943, 63162, 63372, 63572, 63763, 63944, 64115,
+    64277, 64429, 64571, 64704, 64827, 64940, 65043, 65137,
+    65220, 65294, 65358, 65413, 65457, 65492, 65516, 65531,
+};
+
+/**
+ * atan(i / 128) in Q16.16 for i in [0, 128].
+ */
+const uint16_t ARCTANGENT_TABLE[QUARTER_STEPS + 1] PROGMEM = {
+    0, 512, 1024, 1536, 2047, 2559, 3070, 3580,
+    4091, 4600, 5110, 5618, 6126, 6633, 7140, 7645,
+    8150, 8653, 9156, 9657, 10158, 10657, 11155, 11652,
+    12147, 12641, 13133, 13624, 14114, 14601, 15088, 15572,
+    16055, 16536, 17015, 17492, 17968, 18441, 18913, 19382,
+    19850, 20315, 20779, 21240, 21699, 22156, 22610, 23062,
+    23512, 23960, 24406, 24849, 25289, 25727, 26163, 26597,
+    27028, 27456, 27882, 28306, 28727, 29145, 29561, 29975,
+    30386, 30794, 31200, 31603, 32003, 32401, 32797, 33190,
+    33580, 33968, 34353, 34735, 35115, 35492, 35867, 36239,
+    36608, 36975, 37340, 37701, 38060, 38417, 38771, 39123,
+    39472, 39818, 40162, 40503, 40842, 41178, 41512, 41844,
+    42172, 42499, 42823, 43145, 43464, 43780, 44095, 44407,
+    44716, 45024, 45328, 45631, 45931, 46229, 46525, 46818,
+    47109, 47398, 47685, 47969, 48251, 48531, 48809, 49085,
+    49359, 49630, 49899, 50167, 50432, 50695, 50956, 51215,
+    51472,
+};
+
+/**
+ * atan(2^-i) as a phase for i in [0, 24).
+ */
+const uint32_t CORDIC_ARCTANGENT_TABLE[24] PROGMEM = {
+    536870912, 316933406, 167458907, 85004756, 42667331, 21354465, 10679838, 5340245,
+    2670163, 1335087, 667544, 333772, 166886, 83443, 41722, 20861,
+    10430, 5215, 2608, 1304, 652, 326, 163, 81,
+};
+
+int32_t sine_entry(uint8_t index)
+{
+    return index >= QUARTER_STEPS ? Fixed::ONE : static_cast<int32_t>(pgm_read_word(&SINE_TABLE[index]));
+}
+
+/**
+ * Returns the sine of the angle given in table steps (512 per turn) with
+ * 16 fractional bits, as a raw Q16.16 value.
+ */
+int32_t sine_of_steps(uint32_t steps)
+{
+    const auto whole = static_cast<uint16_t>((steps >> 16u) & 0x1FFu);
+    const auto fraction = static_cast<int32_t>(steps & 0xFFFFu);
+    const uint8_t quadrant = whole / QUARTER_STEPS;
+    const uint8_t index = whole % QUARTER_STEPS;
+
+    int32_t value;
+    if (quadrant % 2 == 0) {
+        const int32_t low = sine_entry(index);
+        value = low + (((sine_entry(index + 1) - low) * fraction) >> 16);
+    } else {
+        // Descending side of the wave: walk the table backwards.
+        const int32_t high = sine_entry(QUARTER_STEPS - index);
+        value = high + (((sine_entry(QUARTER_STEPS - index - 1) - high) * fraction) >> 16);
+    }
+    return quadrant >= 2 ? -value : value;
+}
+
+/**
+ * Returns atan(ratio) for a raw Q16.16 ratio in [0, 1], as a raw Q16.16
+ * value.
+ */
+int32_t arctangent_unit(uint32_t ratio, bool interpolate)
+{
+    if (!interpolate) {
+        return pgm_read_word(&ARCTANGENT_TABLE[(ratio + 0x100u) >> 9u]);
+    }
+    const auto index = static_cast<uint8_t>(ratio >> 9u);
+    if (index >= QUARTER_STEPS) {
+        return pgm_read_word(&ARCTANGENT_TABLE[QUARTER_STEPS]);
+    }
+    const auto fraction = static_cast<int32_t>((ratio & 0x1FFu) << 7u);
+    const auto low = static_cast<int32_t>(pgm_read_word(&ARCTANGENT_TABLE[index]));
+    const auto high = static_cast<int32_t>(pgm_read_word(&ARCTANGENT_TABLE[index + 1]));
+    return low + (((high - low) * fraction) >> 16);
+}
+
+int32_t cordic_arctangent(uint8_t index)
+{
+    return static_cast<int32_t>(pgm_read_dword(&CORDIC_ARCTANGENT_TABLE[index]));
+}
+
+uint32_t magnitude(int32_t raw)
+{
+    return raw < 0 ? static_cast<uint32_t>(-static_cast<int64_t>(raw)) : static_cast<uint32_t>(raw);
+}
+
+/// Rounds a Q2.30 value to Q16.16.
+int32_t round_q30(int32_t value)
+{
+    return (value + (static_cast<int32_t>(1) << 13u)) >> 14u;
+}
+
+} // namespace
+
+namespace subsonic_ipt {
+namespace fast_trig {
+
+Phase phase_from_radians(Fixed radians) noexcept
+{
+    int32_t reduced = radians.raw() % TWO_PI_RAW;
+    if (reduced < 0) {
+        reduced += TWO_PI_RAW;
+    }
+    return static_cast<Phase>((static_cast<uint64_t>(reduced) * PHASE_PER_RADIAN_Q16) >> 16u);
+}
+
+Phase phase_from_radians(double radians) noexcept
+{
+    double turns = radians * (1 / (2 * M_PI));
+    turns -= floor(turns);
+    if (turns >= 1) {
+        // Negative values very close to zero round up to a full turn.
+        turns = 0;
+    }
+    return static_cast<Phase>(turns * 4294967296.0);
+}
+
+int32_t radians_raw_from_phase(Phase phase) noexcept
+{
+    return static_cast<int32_t>((static_cast<uint64_t>(phase) * TWO_PI_RAW) >> 32u);
+}
+
+double signed_radians_from_phase(Phase phase) noexcept
+{
+    return static_cast<int32_t>(phase) * (2 * M_PI / 4294967296.0);
+}
+
+SinCos table_sin_cos(Phase phase, bool interpolate) noexcept
+{
+    // 512 table steps per turn, with 16 fractional bits.
+    uint32_t steps = phase >> 7u;
+    if (!interpolate) {
+        steps = (steps + 0x8000u) & 0xFFFF0000u;
+    }
+    constexpr uint32_t QUARTER_TURN_STEPS = static_cast<uint32_t>(QUARTER_STEPS) << 16u;
+    return {sine_of_steps(steps), sine_of_steps(steps + QUARTER_TURN_STEPS)};
+}
+
+SinCos cordic_sin_cos(Phase phase, uint8_t iterations) noexcept
+{
+    // Rotation mode converges for angles within a quarter turn of zero, so
+    // rotate the remaining half of the circle by a half turn first.
+    auto angle = static_cast<int32_t>(phase);
+    const bool flip = phase > QUARTER_TURN && phase < HALF_TURN + QUARTER_TURN;
+    if (flip) {
+        angle = static_cast<int32_t>(phase - HALF_TURN);
+    }
+
+    int32_t x = CORDIC_GAIN_Q30;
+    int32_t y = 0;
+    for (uint8_t i = 0; i < iterations; ++i) {
+        const int32_t dx = x >> i;
+        const int32_t dy = y >> i;
+        if (angle >= 0) {
+            x -= dy;
+            y += dx;
+            angle -= cordic_arctangent(i);
+        } else {
+            x += dy;
+            y -= dx;
+            angle += cordic_arctangent(i);
+        }
+    }
+    const SinCos result{round_q30(y), round_q30(x)};
+    return flip ? SinCos{-result.sin, -result.cos} : result;
+}
+
+Phase table_atan2(int32_t y, int32_t x, bool interpolate) noexcept
+{
+    if (x == 0 && y == 0) {
+        return 0;
+    }
+    uint32_t adjacent = magnitude(x);
+    uint32_t opposite = magnitude(y);
+    const bool steep = opposite > adjacent;
+    uint32_t high = steep ? opposite : adjacent;
+    uint32_t low = steep ? adjacent : opposite;
+
+    // Scale the operands down until the ratio can be formed in 32 bits.
+    while (high >= (static_cast<uint32_t>(1) << 16u)) {
+        high >>= 1u;
+        low >>= 1u;
+    }
+    const uint32_t ratio = (low << 16u) / high;
+
+    // Angle within the first octant, then unfolded into the full turn.
+    const auto octant = static_cast<uint32_t>(arctangent_unit(ratio, interpolate));
+    auto angle = static_cast<Phase>((octant * PHASE_PER_RADIAN_Q16) >> 16u);
+    if (steep) {
+        angle = QUARTER_TURN - angle;
+    }
+    if (x < 0) {
+        angle = HALF_TURN - angle;
+    }
+    if (y < 0) {
+        angle = -angle;
+    }
+    return angle;
+}
+
+Phase cordic_atan2(int32_t y, int32_t x, uint8_t iterations) noexcept
+{
+    if (x == 0 && y == 0) {
+        return 0;
+    }
+    // Vectoring mode converges for vectors in the right half plane, so
+    // reflect the left half plane through the origin first.
+    int64_t wide_x = x;
+    int64_t wide_y = y;
+    Phase angle = 0;
+    if (wide_x < 0) {
+        wide_x = -wide_x;
+        wide_y = -wide_y;
+        angle = HALF_TURN;
+    }
+    // Normalize the vector so that the CORDIC gain cannot overflow while
+    // keeping as many significant bits as possible.
+    const int64_t opposite = wide_y < 0 ? -wide_y : wide_y;
+    int64_t largest = wide_x > opposite ? wide_x : opposite;
+    while (largest >= (static_cast<int64_t>(1) << 29u)) {
+        largest >>= 1u;
+        wide_x >>= 1u;
+        wide_y >>= 1u;
+    }
+    while (largest < (static_cast<int64_t>(1) << 28u)) {
+        largest <<= 1u;
+        wide_x *= 2;
+        wide_y *= 2;
+    }
+
+    auto cx = static_cast<int32_t>(wide_x);
+    auto cy = static_cast<int32_t>(wide_y);
+    int32_t accumulated = 0;
+    for (uint8_t i = 0; i < iterations; ++i) {
+        const int32_t dx = cx >> i;
+        const int32_t dy = cy >> i;
+        if (cy > 0) {
+            cx += dy;
+            cy -= dx;
+            accumulated += cordic_arctangent(i);
+        } else {
+            cx -= dy;
+            cy += dx;
+            accumulated -= cordic_arctangent(i);
+        }
+    }
+    return angle + static_cast<Phase>(accumulated);
+}
+
+SinCos sin_cos(Phase phase) noexcept
+{
+    switch (TRIG_ACCURACY) {
+        case TrigAccuracy::TableNearest:
+            return table_sin_cos(phase, false);
+        case TrigAccuracy::Cordic:
+            return cordic_sin_cos(phase);
+        default:
+            return table_sin_cos(phase, true);
+    }
+}
+
+Phase atan2(int32_t y, int32_t x) noexcept
+{
+    switch (TRIG_ACCURACY) {
+        case TrigAccuracy::TableNearest:
+            return table_atan2(y, x, false);
+        case TrigAccuracy::Cordic:
+            return cordic_atan2(y, x);
+        default:
+            return table_atan2(y, x, true);
+    }
+}
+
+double atan2(double y, double x) noexcept
+{
+    if constexpr (TRIG_ACCURACY == TrigAccuracy::Library) {
+        return ::atan2(y, x);
+    }
+    if (isnan(x) || isnan(y)) {
+        return NAN;
+    }
+    // Scale both components to integers sharing the exponent of the larger.
+    int exponent = 0;
+    frexp(fabs(x) > fabs(y) ? x : y, &exponent);
+    const auto scaled_x = static_cast<int32_t>(ldexp(x, 30 - exponent));
+    const auto scaled_y = static_cast<int32_t>(ldexp(y, 30 - exponent));
+    return signed_radians_from_phase(atan2(scaled_y, scaled_x));
+}
+
+} // namespace fast_trig
+
+void sin_cos(double radians, double& sine, double& cosine) noexcept
+{
+    if constexpr (fast_trig::TRIG_ACCURACY == fast_trig::TrigAccuracy::Library) {
+        sine = ::sin(radians);
+        cosine = ::cos(radians);
+        return;
+    }
+    if (isnan(radians)) {
+        sine = cosine = NAN;
+        return;
+    }
+    const auto result = fast_trig::sin_cos(fast_trig::phase_from_radians(radians));
+    sine = result.sin * (1.0 / Fixed::ONE);
+    cosine = result.cos * (1.0 / Fixed::ONE);
+}
+
+void sin_cos(Fixed radians, Fixed& sine, Fixed& cosine) noexcept
+{
+    if (isnan(radians)) {
+        sine = cosine = radians;
+        return;
+    }
+    const auto result = fast_trig::sin_cos(fast_trig::phase_from_radians(radians));
+    sine = Fixed::from_raw(result.sin);
+    cosine = Fixed::from_raw(result.cos);
+}
+
+void sin_cos(BinaryAngle angle, double& sine, double& cosine) noexcept
+{
+    if constexpr (fast_trig::TRIG_ACCURACY == fast_trig::TrigAccuracy::Library) {
+        sin_cos(angle.radians<double>(), sine, cosine);
+        return;
+    }
+    const auto result = fast_trig::sin_cos(fast_trig::phase_from_binary(angle));
+    sine = result.sin * (1.0 / Fixed::ONE);
+    cosine = result.cos * (1.0 / Fixed::ONE);
+}
+
+void sin_cos(BinaryAngle angle, Fixed& sine, Fixed& cosine) noexcept
+{
+    const auto result = fast_trig::sin_cos(fast_trig::phase_from_binary(angle));
+    sine = Fixed::from_raw(result.sin);
+    cosine = Fixed::from_raw(result.cos);
+}
+
+} // namespace subsonic_ipt
@@ -0,0 +1,159 @@
+/**
+ * fast_trig.h - Table-driven and CORDIC trigonometry with a build-time
+ *               accuracy level.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_FAST_TRIG_H
+#define SUBSONIC_IPT_FAST_TRIG_H
+
+#include <stdint.h>
+
+#include "binary_angle.h"
+#include "fixed.h"
+
+// Selects the trigonometry used for navigation and attitude extraction:
+//   1: 512 entry lookup table, nearest entry
+//   2: 512 entry lookup table with linear interpolation
+//   3: CORDIC with SUBSONIC_CORDIC_ITERATIONS iterations
+//   4: the C library (fixed-point scalars use the interpolated table)
+#ifndef SUBSONIC_TRIG_ACCURACY
+#define SUBSONIC_TRIG_ACCURACY 4
+#endif
+
+// The number of CORDIC iterations, at most 24. Each iteration adds roughly
+// one bit of accuracy.
+#ifndef SUBSONIC_CORDIC_ITERATIONS
+#define SUBSONIC_CORDIC_ITERATIONS 16
+#endif
+
+namespace subsonic_ipt {
+namespace fast_trig {
+
+/**
+ * The trigonometry implementations that may be selected.
+ */
+enum class TrigAccuracy : uint8_t {
+    TableNearest = 1,
+    TableInterpolated = 2,
+    Cordic = 3,
+    Library = 4,
+};
+
+/// The implementation selected for this build.
+constexpr TrigAccuracy TRIG_ACCURACY{static_cast<TrigAccuracy>(SUBSONIC_TRIG_ACCURACY)};
+
+/// The number of CORDIC iterations performed by `Cordic`.
+constexpr uint8_t CORDIC_ITERATIONS{SUBSONIC_CORDIC_ITERATIONS};
+
+static_assert(SUBSONIC_TRIG_ACCURACY >= 1 && SUBSONIC_TRIG_ACCURACY <= 4, "unknown trigonometry accuracy level");
+static_assert(CORDIC_ITERATIONS >= 1 && CORDIC_ITERATIONS <= 24, "CORDIC supports 1 to 24 iterations");
+
+/**
+ * An angle in units of 2^-32 turns.
+ *
+ * Like `BinaryAngle`, wraparound is the natural overflow of the unsigned
+ * representation, but with enough resolution to carry Q16.16 radians
+ * without loss.
+ */
+using Phase = uint32_t;
+
+/**
+ * A sine and cosine pair as raw Q16.16 values.
+ */
+struct SinCos {
+    int32_t sin;
+    int32_t cos;
+};
+
+[[nodiscard]]
+/// Returns the phase of the given binary angle.
+constexpr Phase phase_from_binary(BinaryAngle angle) noexcept
+{
+    return static_cast<Phase>(angle.raw()) << 16u;
+}
+
+[[nodiscard]]
+/// Returns the phase of the given fixed-point angle in radians.
+Phase phase_from_radians(Fixed radians) noexcept;
+
+[[nodiscard]]
+/// Returns the phase of the given angle in radians.
+Phase phase_from_radians(double radians) noexcept;
+
+[[nodiscard]]
+/// Returns the given phase in radians on the interval [0, 2pi) as a raw Q16.16 value.
+int32_t radians_raw_from_phase(Phase phase) noexcept;
+
+[[nodiscard]]
+/// Returns the given phase in radians on the interval [-pi, pi).
+double signed_radians_from_phase(Phase phase) noexcept;
+
+/*
+ * Implementations for each accuracy level. These are always available so
+ * that the benchmark can compare them within a single build.
+ */
+
+[[nodiscard]]
+SinCos table_sin_cos(Phase phase, bool interpolate) noexcept;
+
+[[nodiscard]]
+SinCos cordic_sin_cos(Phase phase, uint8_t iterations = CORDIC_ITERATIONS) noexcept;
+
+[[nodiscard]]
+/**
+ * Returns the phase of the vector (x, y), or zero for the zero vector.
+ */
+Phase table_atan2(int32_t y, int32_t x, bool interpolate) noexcept;
+
+[[nodiscard]]
+Phase cordic_atan2(int32_t y, int32_t x, uint8_t iterations = CORDIC_ITERATIONS) noexcept;
+
+[[nodiscard]]
+/**
+ * Returns the sine and cosine of the given phase using the integer
+ * implementation selected for this build.
+ */
+SinCos sin_cos(Phase phase) noexcept;
+
+[[nodiscard]]
+/**
+ * Returns the phase of the vector (x, y) using the integer implementation
+ * selected for this build, or zero for the zero vector.
+ */
+Phase atan2(int32_t y, int32_t x) noexcept;
+
+[[nodiscard]]
+/**
+ * Returns the angle of the vector (x, y) in radians on the interval
+ * [-pi, pi], with the same conventions as the C library's `atan2`.
+ */
+double atan2(double y, double x) noexcept;
+
+} // namespace fast_trig
+
+/*
+ * Scalar overloads used by point.h. The results of each pair of functions
+ * are computed together, since every implementation produces both at once.
+ */
+
+/// Computes the sine and cosine of the given angle in radians.
+void sin_cos(double radians, double& sine, double& cosine) noexcept;
+
+/// Computes the sine and cosine of the given angle in radians.
+void sin_cos(Fixed radians, Fixed& sine, Fixed& cosine) noexcept;
+
+/// Computes the sine and cosine of the given binary angle.
+void sin_cos(BinaryAngle angle, double& sine, double& cosine) noexcept;
+
+/// Computes the sine and cosine of the given binary angle.
+void sin_cos(BinaryAngle angle, Fixed& sine, Fixed& cosine) noexcept;
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_FAST_TRIG_H
@@ -0,0 +1,110 @@
+/**
+ * fixed.cpp - Implementation of mathematical functions for fixed-point
+ *             scalars.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "fixed.h"
+
+#include "fast_trig.h"
+
+namespace {
+
+/**
+ * Returns sqrt(value), rounded to the nearest integer.
+ */
+uint16_t integer_sqrt(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = static_cast<uint32_t>(1) << 30u;
+    while (bit > value) {
+        bit >>= 2u;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1u) + bit;
+        } else {
+            root >>= 1u;
+        }
+        bit >>= 2u;
+    }
+    // The remainder `value` is now the input less root^2.
+    if (value > root) {
+        ++root;
+    }
+    return static_cast<uint16_t>(root);
+}
+
+uint32_t magnitude(int32_t raw)
+{
+    return raw < 0 ? static_cast<uint32_t>(-static_cast<int64_t>(raw)) : static_cast<uint32_t>(raw);
+}
+
+} // namespace
+
+namespace subsonic_ipt {
+
+Fixed fmod(Fixed numerator, Fixed denominator) noexcept
+{
+    if (isnan(numerator) || isnan(denominator) || denominator.raw() == 0) {
+        return Fixed::nan();
+    }
+    return Fixed::from_raw(numerator.raw() % denominator.raw());
+}
+
+Fixed sin(Fixed angle) noexcept
+{
+    Fixed sine;
+    Fixed cosine;
+    sin_cos(angle, sine, cosine);
+    return sine;
+}
+
+Fixed cos(Fixed angle) noexcept
+{
+    Fixed sine;
+    Fixed cosine;
+    sin_cos(angle, sine, cosine);
+    return cosine;
+}
+
+Fixed vector_angle(Fixed x, Fixed y) noexcept
+{
+    if (isnan(x) || isnan(y) || (x.raw() == 0 && y.raw() == 0)) {
+        return Fixed::nan();
+    }
+    return Fixed::from_raw(fast_trig::radians_raw_from_phase(fast_trig::atan2(y.raw(), x.raw())));
+}
+
+Fixed vector_norm(Fixed x, Fixed y) noexcept
+{
+    if (isnan(x) || isnan(y)) {
+        return Fixed::nan();
+    }
+    uint32_t a = magnitude(x.raw());
+    uint32_t b = magnitude(y.raw());
+
+    // Scale the components down until the sum of their squares fits in
+    // 32 bits, then scale the root back up.
+    uint8_t shift = 0;
+    for (uint32_t largest = a | b; largest >= (static_cast<uint32_t>(1) << 15u); largest >>= 1u) {
+        ++shift;
+    }
+    if (shift != 0) {
+        const uint32_t half = static_cast<uint32_t>(1) << (shift - 1u);
+        a = (a + half) >> shift;
+        b = (b + half) >> shift;
+    }
+    // With both components below 2^15, the root is exact in Q16.16 when no
+    // scaling was needed.
+    const uint32_t root = static_cast<uint32_t>(integer_sqrt(a * a + b * b)) << shift;
+    return Fixed::from_raw(root > static_cast<uint32_t>(Fixed::MAX_RAW) ? Fixed::MAX_RAW : static_cast<int32_t>(root));
+}
+
+} // namespace subsonic_ipt
@@ -0,0 +1,250 @@
+/**
+ * fixed.h - Q16.16 fixed-point scalar type.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_FIXED_H
+#define SUBSONIC_IPT_FIXED_H
+
+#include <stdint.h>
+
+namespace subsonic_ipt {
+
+/**
+ * A signed Q16.16 fixed-point number with saturating arithmetic.
+ *
+ * Values span roughly +/-32767.99998 with a resolution of 2^-16. Arithmetic
+ * that would exceed this range saturates at its bounds instead of wrapping.
+ * The most negative raw value is reserved to represent NaN, which propagates
+ * through arithmetic so that code written against `double` keeps working.
+ *
+ * On the AVR, where `double` is a 32-bit software float, every operation on
+ * this type reduces to a handful of integer instructions. The mathematical
+ * functions below (found by argument-dependent lookup) are table driven or
+ * use CORDIC, as selected in fast_trig.h.
+ */
+class Fixed {
+    /// The raw Q16.16 representation of this value.
+    int32_t m_raw;
+
+  public:
+    /// The number of fractional bits in the representation.
+    static constexpr uint8_t FRACTION_BITS{16};
+
+    /// The raw representation of 1.0.
+    static constexpr int32_t ONE{static_cast<int32_t>(1) << FRACTION_BITS};
+
+    /// The raw representation of NaN.
+    static constexpr int32_t NAN_RAW{INT32_MIN};
+
+    /// The largest and smallest raw values that represent numbers.
+    static constexpr int32_t MAX_RAW{INT32_MAX};
+    static constexpr int32_t MIN_RAW{INT32_MIN + 1};
+
+    constexpr Fixed() noexcept: m_raw(0) {}
+
+    /**
+     * Converts the given integer, saturating if it is out of range.
+     */
+    constexpr Fixed(int value) noexcept: m_raw(from_integer(value)) {}
+
+    /**
+     * Converts the given floating point value, rounding to the nearest
+     * representable value.
+     *
+     * This conversion is implicit so that constants may be written naturally
+     * in code that is generic over the scalar type. On the AVR it should
+     * only be applied to compile-time constants.
+     */
+    constexpr Fixed(double value) noexcept: m_raw(from_floating(value)) {}
+
+    [[nodiscard]]
+    /// Constructs a value from its raw Q16.16 representation.
+    static constexpr Fixed from_raw(int32_t raw) noexcept
+    {
+        Fixed value;
+        value.m_raw = raw;
+        return value;
+    }
+
+    [[nodiscard]]
+    static constexpr Fixed nan() noexcept
+    {
+        return from_raw(NAN_RAW);
+    }
+
+    [[nodiscard]]
+    /// Returns the raw Q16.16 representation of this value.
+    constexpr int32_t raw() const noexcept
+    {
+        return m_raw;
+    }
+
+    explicit constexpr operator double() const noexcept
+    {
+        return m_raw == NAN_RAW ? __builtin_nan("") : static_cast<double>(m_raw) / ONE;
+    }
+
+    /// Truncates this value toward zero.
+    explicit constexpr operator int() const noexcept
+    {
+        return static_cast<int>(m_raw / ONE);
+    }
+
+    friend constexpr bool isnan(Fixed value) noexcept
+    {
+        return value.m_raw == NAN_RAW;
+    }
+
+    friend constexpr Fixed operator+(Fixed first, Fixed second) noexcept
+    {
+        if (isnan(first) || isnan(second)) {
+            return nan();
+        }
+        int32_t sum{0};
+        if (__builtin_add_overflow(first.m_raw, second.m_raw, &sum) || sum == NAN_RAW) {
+            return from_raw(first.m_raw < 0 ? MIN_RAW : MAX_RAW);
+        }
+        return from_raw(sum);
+    }
+
+    friend constexpr Fixed operator-(Fixed first, Fixed second) noexcept
+    {
+        return first + -second;
+    }
+
+    friend constexpr Fixed operator*(Fixed first, Fixed second) noexcept
+    {
+        if (isnan(first) || isnan(second)) {
+            return nan();
+        }
+        int64_t product = static_cast<int64_t>(first.m_raw) * second.m_raw;
+        product = (product + (ONE / 2)) >> FRACTION_BITS;
+        if (product > MAX_RAW) {
+            return from_raw(MAX_RAW);
+        }
+        if (product < MIN_RAW) {
+            return from_raw(MIN_RAW);
+        }
+        return from_raw(static_cast<int32_t>(product));
+    }
+
+    constexpr Fixed operator-() const noexcept
+    {
+        // Negating NaN leaves it unchanged, and the range is symmetric.
+        return from_raw(m_raw == NAN_RAW ? NAN_RAW : -m_raw);
+    }
+
+    constexpr Fixed& operator+=(Fixed other) noexcept
+    {
+        return *this = *this + other;
+    }
+
+    constexpr Fixed& operator-=(Fixed other) noexcept
+    {
+        return *this = *this - other;
+    }
+
+    constexpr Fixed& operator*=(Fixed other) noexcept
+    {
+        return *this = *this * other;
+    }
+
+    /*
+     * Comparisons order raw values. Unlike IEEE floats, NaN compares less
+     * than every number and equal to itself.
+     */
+
+    friend constexpr bool operator==(Fixed first, Fixed second) noexcept
+    {
+        return first.m_raw == second.m_raw;
+    }
+
+    friend constexpr bool operator!=(Fixed first, Fixed second) noexcept
+    {
+        return first.m_raw != second.m_raw;
+    }
+
+    friend constexpr bool operator<(Fixed first, Fixed second) noexcept
+    {
+        return first.m_raw < second.m_raw;
+    }
+
+    friend constexpr bool operator>(Fixed first, Fixed second) noexcept
+    {
+        return first.m_raw > second.m_raw;
+    }
+
+    friend constexpr bool operator<=(Fixed first, Fixed second) noexcept
+    {
+        return first.m_raw <= second.m_raw;
+    }
+
+    friend constexpr bool operator>=(Fixed first, Fixed second) noexcept
+    {
+        return first.m_raw >= second.m_raw;
+    }
+
+    /**
+     * Returns the remainder of dividing `numerator` by `denominator`, with
+     * the sign of the numerator.
+     */
+    friend Fixed fmod(Fixed numerator, Fixed denominator) noexcept;
+
+    /// Returns the sine of the given angle in radians.
+    friend Fixed sin(Fixed angle) noexcept;
+
+    /// Returns the cosine of the given angle in radians.
+    friend Fixed cos(Fixed angle) noexcept;
+
+    /**
+     * Returns the angle in [0, 2pi) between the vector (x, y) and the +x
+     * axis, or NaN for the zero vector.
+     */
+    friend Fixed vector_angle(Fixed x, Fixed y) noexcept;
+
+    /**
+     * Returns the euclidean norm of the vector (x, y).
+     *
+     * Intermediate squares are never formed at Q16.16 precision, so the
+     * result is valid across the full range of the type.
+     */
+    friend Fixed vector_norm(Fixed x, Fixed y) noexcept;
+
+  private:
+    static constexpr int32_t from_integer(int value) noexcept
+    {
+        constexpr int32_t limit = INT32_MAX >> FRACTION_BITS;
+        if (value > limit) {
+            return MAX_RAW;
+        }
+        if (value < -limit) {
+            return MIN_RAW;
+        }
+        return static_cast<int32_t>(value) * ONE;
+    }
+
+    static constexpr int32_t from_floating(double value) noexcept
+    {
+        if (value != value) {
+            return NAN_RAW;
+        }
+        const double scaled = value * ONE;
+        if (scaled >= static_cast<double>(MAX_RAW)) {
+            return MAX_RAW;
+        }
+        if (scaled <= static_cast<double>(MIN_RAW)) {
+            return MIN_RAW;
+        }
+        return static_cast<int32_t>(scaled + (scaled < 0 ? -0.5 : 0.5));
+    }
+};
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_FIXED_H
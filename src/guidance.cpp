@@ -0,0 +1,51 @@
+/**
+ * guidance.cpp - Implementation for memoized travel directions.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "guidance.h"
+
+#include <math.h> // cmath not available
+
+namespace subsonic_ipt {
+
+const GuidanceSnapshot& Guidance::snapshot()
+{
+    if (!m_snapshot_valid || m_snapshot_epoch != m_device_state->epoch) {
+        compute_snapshot();
+        m_snapshot_epoch = m_device_state->epoch;
+        m_snapshot_valid = true;
+    }
+    return m_snapshot;
+}
+
+void Guidance::compute_snapshot()
+{
+    constexpr BinaryAngle backwards = BinaryAngle::from_degrees(180);
+
+    m_snapshot.direction = m_navigator->compute_direction(
+        m_device_state->position,
+        m_device_state->facing_rotation
+    );
+    m_snapshot.distance = m_snapshot.direction.norm();
+    m_snapshot.localized_distance = fabs(
+        meters_to_unit(static_cast<double>(m_snapshot.distance), m_device_state->localized_unit)
+    );
+
+    // When the device is at its destination, the travel angle is NaN.
+    const auto bearing = m_snapshot.direction.angle();
+    m_snapshot.relative_angle = bearing.binary();
+    m_snapshot.arrived = m_snapshot.distance <= m_arrival_tolerance || bearing.is_nan();
+
+    const auto travel_angle = m_snapshot.relative_angle;
+    m_snapshot.near_forward = (travel_angle < m_snap_tolerance) || (travel_angle > m_snap_tolerance.conjugate());
+    m_snapshot.near_backward = (travel_angle > (backwards - m_snap_tolerance))
+        && (travel_angle < (backwards + m_snap_tolerance));
+}
+
+} // namespace subsonic_ipt
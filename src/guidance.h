@@ -0,0 +1,106 @@
+/**
+ * guidance.h - Memoized travel directions to the current destination.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_GUIDANCE_H
+#define SUBSONIC_IPT_GUIDANCE_H
+
+#include "binary_angle.h"
+#include "navigator.h"
+#include "state.h"
+
+namespace subsonic_ipt {
+
+/**
+ * The directions to the current destination for a single state epoch.
+ */
+struct GuidanceSnapshot {
+    /// The displacement to the destination relative to the direction facing.
+    Point direction;
+    /// The distance to the destination in meters.
+    Scalar distance;
+    /// The distance to the destination in the user-selected unit.
+    double localized_distance;
+    /// The angle of `direction`, counterclockwise from straight ahead.
+    BinaryAngle relative_angle;
+    /// Whether the user is within the arrival tolerance of the destination.
+    bool arrived;
+    /// Whether `relative_angle` is within the snap tolerance of straight ahead.
+    bool near_forward;
+    /// Whether `relative_angle` is within the snap tolerance of straight behind.
+    bool near_backward;
+};
+
+/**
+ * Computes the directions to a navigator's current destination at most once
+ * per state epoch, so that the sketch loop and every menu share one result.
+ *
+ * Anything that changes the position, facing, destination or unit must
+ * advance the state's epoch for the change to be observed.
+ */
+class Guidance {
+    /// The global IPT device state.
+    const IPTState* const m_device_state;
+
+    /// The global navigator instance for tracking the user's waypoints.
+    const Navigator* const m_navigator;
+
+    /**
+     * The tolerance used when determining whether the user needs to travel
+     * "forward" or "backward".
+     *
+     * Angles within this tolerance of `0` or `pi` radians will result in
+     * the direction "snapping" to a forward or backward directions instead of
+     * a small rotation direction.
+     */
+    const BinaryAngle m_snap_tolerance;
+
+    /**
+     * The tolerance used when determining whether the user has arrived at
+     * a waypoint.
+     *
+     * Whenever the user is within this distance in meters of a waypoint, they
+     * will receive a "you have arrived" message instead of a direction.
+     */
+    const Scalar m_arrival_tolerance;
+
+    /// The most recently computed snapshot.
+    GuidanceSnapshot m_snapshot{};
+
+    /// The state epoch that `m_snapshot` was computed for.
+    uint16_t m_snapshot_epoch{0};
+
+    /// Whether `m_snapshot` has been computed at all.
+    bool m_snapshot_valid{false};
+
+  public:
+    Guidance(
+        const IPTState* device_state,
+        const Navigator* navigator,
+        BinaryAngle snap_tolerance,
+        Scalar arrival_tolerance
+    )
+        : m_device_state(device_state),
+          m_navigator(navigator),
+          m_snap_tolerance(snap_tolerance),
+          m_arrival_tolerance(arrival_tolerance) {}
+
+    /**
+     * Returns the directions for the current state epoch, computing them
+     * if they are out of date.
+     */
+    const GuidanceSnapshot& snapshot();
+
+  private:
+    void compute_snapshot();
+};
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_GUIDANCE_H
@@ -1,6 +1,13 @@
 /**
  * buttons.cpp - Implementation for switch state detection.
  *
+ * The buttons are read straight from the input registers of ports B and D
+ * by their pin change interrupts, so the main loop only pays for a button
+ * when it changes. A change is accepted as soon as it is seen, and further
+ * changes to the same button are ignored for the debounce interval. Any
+ * difference remaining once the interval has passed is picked up by
+ * `refresh_buttons`.
+ *
  * Copyright (c) 2019 Brian Schubert
  *
  * This file is distributed under the MIT License. If a copy of the
@@ -9,8 +16,12 @@
  */
 
 #include <Arduino.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
 
 #include "../pin.h"
+#include "../profiler.h"
+#include "../spsc_ring.h"
 
 #include "buttons.h"
 
@@ -21,95 +32,201 @@ namespace {
 using namespace subsonic_ipt;
 
 /**
- * The current and previous state of the buttons used by this sketch.
+ * The pin that each button is wired to.
  */
-struct {
-    /// The state of the buttons during the previous refresh.
-    Button previous_buttons{ButtonNone};
-    /// The current state of the buttons since the last refresh.
-    Button current_buttons{ButtonNone};
-} button_status;
+struct ButtonWiring {
+    Button button;
+    Pin pin;
+};
+
+constexpr ButtonWiring BUTTON_WIRING[]{
+    {ButtonLeft, static_cast<Pin>(ButtonPin::Left)},
+    {ButtonRight, static_cast<Pin>(ButtonPin::Right)},
+    {ButtonUp, static_cast<Pin>(ButtonPin::Up)},
+    {ButtonDown, static_cast<Pin>(ButtonPin::Down)},
+    {ButtonEnter, static_cast<Pin>(ButtonPin::Enter)},
+};
+
+constexpr uint8_t BUTTON_COUNT = sizeof(BUTTON_WIRING) / sizeof(BUTTON_WIRING[0]);
 
 /**
- * Returns the one-bit mask associated with the given button pin.
+ * Returns `true` if the given pin belongs to port D (digital pins 0-7) rather
+ * than port B (digital pins 8-13).
  */
-Button pin_to_flag(ButtonPin pin) noexcept
+constexpr bool on_port_d(Pin pin) noexcept
 {
-    switch (pin) {
-        case ButtonPin::Left: {
-            return Button::ButtonLeft;
-        }
-        case ButtonPin::Right: {
-            return Button::ButtonRight;
-        }
-        case ButtonPin::Up: {
-            return Button::ButtonUp;
-        }
-        case ButtonPin::Down: {
-            return Button::ButtonDown;
+    return pin < 8;
+}
+
+/**
+ * Returns the bit of the given pin within its port's registers.
+ */
+constexpr uint8_t port_bit(Pin pin) noexcept
+{
+    return on_port_d(pin) ? pin : pin - 8;
+}
+
+/**
+ * Returns the pin change mask bits of the buttons on port B or D.
+ */
+constexpr uint8_t port_mask(bool port_d) noexcept
+{
+    uint8_t mask = 0;
+    for (const auto& wiring : BUTTON_WIRING) {
+        if (on_port_d(wiring.pin) == port_d) {
+            mask |= static_cast<uint8_t>(1u << port_bit(wiring.pin));
         }
-        case ButtonPin::Enter: {
-            return Button::ButtonEnter;
+    }
+    return mask;
+}
+
+constexpr bool all_on_ports_b_d() noexcept
+{
+    for (const auto& wiring : BUTTON_WIRING) {
+        if (wiring.pin > 13) {
+            return false;
         }
-        default: {
-            return Button::ButtonNone;
+    }
+    return true;
+}
+
+static_assert(all_on_ports_b_d(), "button pins must belong to port B or D");
+
+/**
+ * The debounced state of the buttons, shared with the pin change interrupts.
+ */
+struct {
+    /// The buttons that are currently closed.
+    volatile uint8_t closed{ButtonNone};
+    /// The buttons that may differ from their pins, because they changed
+    /// within the debounce interval.
+    volatile uint8_t unsettled{ButtonNone};
+    /// The time in microseconds that each button last changed.
+    unsigned long changed_u[BUTTON_COUNT]{};
+} button_status;
+
+/**
+ * Debounced button changes waiting for the main loop.
+ */
+SpscRing<ButtonEvent, SUBSONIC_BUTTON_EVENTS> g_button_events;
+
+/**
+ * Returns the buttons whose pins are currently pulled low.
+ */
+uint8_t read_button_pins() noexcept
+{
+    // The buttons pull their pins low when closed.
+    const uint8_t port_b = static_cast<uint8_t>(~PINB);
+    const uint8_t port_d = static_cast<uint8_t>(~PIND);
+    uint8_t closed = ButtonNone;
+    for (const auto& wiring : BUTTON_WIRING) {
+        const uint8_t port = on_port_d(wiring.pin) ? port_d : port_b;
+        if (port & (1u << port_bit(wiring.pin))) {
+            closed |= wiring.button;
         }
     }
+    return closed;
 }
 
 /**
- * Returns `true`  if all of the bits set in the given mask are 1s in
- * the specified target.
+ * Compares the button pins with the debounced state at the given time and
+ * queues an event for each button that changed.
+ *
+ * Must not be interrupted by another call.
  */
-inline bool button_mask_matches(Button target, Button mask) noexcept
+void sample_buttons(unsigned long now_u) noexcept
 {
-    return (target & mask) == mask;
+    const uint8_t pins = read_button_pins();
+    uint8_t closed = button_status.closed;
+    uint8_t unsettled = ButtonNone;
+
+    for (uint8_t i = 0; i < BUTTON_COUNT; ++i) {
+        const Button button = BUTTON_WIRING[i].button;
+        if (now_u - button_status.changed_u[i] < SUBSONIC_BUTTON_DEBOUNCE_US) {
+            // Still bouncing from the last change; look again afterwards.
+            unsettled |= button;
+            continue;
+        }
+        if ((pins ^ closed) & button) {
+            closed ^= button;
+            button_status.changed_u[i] = now_u;
+            unsettled |= button;
+            g_button_events.push(ButtonEvent{button, (closed & button) != 0, now_u});
+        }
+    }
+
+    button_status.closed = closed;
+    button_status.unsettled = unsettled;
 }
+
 } // namespace
 
+ISR(PCINT0_vect)
+{
+    sample_buttons(micros());
+}
+
+ISR(PCINT2_vect)
+{
+    sample_buttons(micros());
+}
+
 /******************************************************************************\
  * Public definitions
 \******************************************************************************/
 namespace subsonic_ipt {
 
-void refresh_buttons()
+void setup_buttons()
 {
-    button_status.previous_buttons = button_status.current_buttons;
-    button_status.current_buttons = ButtonNone;
-
-    // Check each button bin for a low voltage.
-    for (auto pin : BUTTON_PINS) {
-        if (digitalRead(pin) == LOW) {
-            auto flag = pin_to_flag(static_cast<ButtonPin>(pin));
-            button_status.current_buttons = static_cast<Button>(button_status.current_buttons | flag);
-        }
+    for (const auto& wiring : BUTTON_WIRING) {
+        pinMode(wiring.pin, INPUT_PULLUP);
     }
-}
 
-bool button_closed(Button button_flag) noexcept
-{
-    return button_mask_matches(button_status.current_buttons, button_flag);
+    noInterrupts();
+    // Start from the current levels, with no debounce interval pending.
+    const auto now_u = micros();
+    button_status.closed = read_button_pins();
+    button_status.unsettled = ButtonNone;
+    for (auto& changed_u : button_status.changed_u) {
+        changed_u = now_u - SUBSONIC_BUTTON_DEBOUNCE_US;
+    }
+
+    PCMSK0 |= port_mask(false);
+    PCMSK2 |= port_mask(true);
+    PCICR |= _BV(PCIE0) | _BV(PCIE2);
+    interrupts();
 }
 
-bool button_open(Button button_flag) noexcept
+void refresh_buttons()
 {
-    return button_mask_matches(static_cast<Button>(~button_status.current_buttons), button_flag);
+    SUBSONIC_PROFILE_SCOPE(profiler::Probe::RefreshButtons);
+
+    if (button_status.unsettled == ButtonNone) {
+        return;
+    }
+    noInterrupts();
+    sample_buttons(micros());
+    interrupts();
 }
 
-bool button_closed_once(Button button_flag) noexcept
+bool next_button_event(ButtonEvent& event)
 {
-    return button_closed(button_flag) && !button_mask_matches(button_status.previous_buttons, button_flag);
+    if (g_button_events.empty()) {
+        return false;
+    }
+    event = g_button_events.front();
+    g_button_events.pop();
+    return true;
 }
 
-bool button_open_once(Button button_flag) noexcept
+bool button_closed(Button button_flag) noexcept
 {
-    return button_open(button_flag) && button_mask_matches(button_status.previous_buttons, button_flag);
+    return (button_status.closed & button_flag) == button_flag;
 }
 
-bool button_any_tap_once() noexcept
+bool button_open(Button button_flag) noexcept
 {
-    return (~button_status.previous_buttons & button_status.current_buttons);
+    return (button_status.closed & button_flag) == ButtonNone;
 }
 
 } // namespace subsonic_ipt
-
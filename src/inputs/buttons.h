@@ -14,6 +14,18 @@
 
 #include <stdint.h> // cstdint not available
 
+// The time in microseconds after a button changes state during which further
+// changes are treated as contact bounce.
+#ifndef SUBSONIC_BUTTON_DEBOUNCE_US
+#define SUBSONIC_BUTTON_DEBOUNCE_US 20000
+#endif
+
+// The number of button events that may wait for the main loop. Must be a
+// power of two. Each event occupies 6 bytes of RAM.
+#ifndef SUBSONIC_BUTTON_EVENTS
+#define SUBSONIC_BUTTON_EVENTS 8
+#endif
+
 namespace subsonic_ipt {
 enum Button : uint8_t {
     ButtonNone = 0,
@@ -25,44 +37,54 @@ enum Button : uint8_t {
 };
 
 /**
- * Refreshes the state of the buttons used by this sketch.
- *
- * This function should be called prior to checking for changes in the
- * states of the buttons.
+ * A debounced change in the state of a single button.
  */
-void refresh_buttons();
+struct ButtonEvent {
+    Button button;
+    /// Whether the button was closed (pressed) or opened (released).
+    bool closed;
+    /// The time in microseconds since startup when the change was detected.
+    unsigned long time_u;
+};
 
-[[nodiscard]]
 /**
- * Returns `true` if all of the given buttons are closed (i.e. pressed).
+ * Configures the button pins and enables their pin change interrupts.
+ *
+ * From then on, the buttons are sampled from their port registers whenever
+ * one of their pins changes, rather than polled.
  */
-bool button_closed(Button button_flag) noexcept;
+void setup_buttons();
 
-[[nodiscard]]
 /**
- * Returns `true` is all of the given buttons are open (i.e. not pressed).
+ * Finishes debouncing any button whose pin changed during its debounce
+ * interval.
+ *
+ * Does nothing unless a button changed recently. Should be called regularly
+ * from the main loop.
  */
-bool button_open(Button button_flag) noexcept;
+void refresh_buttons();
 
 [[nodiscard]]
 /**
- * Returns `true` if all of the given buttons are closed (i.e. pressed)
- * and the buttons were not all closed during the previous refresh.
+ * Removes the oldest button event from the event queue and copies it into
+ * `event`.
+ *
+ * Returns `false` if no event is waiting. Events are dropped if the queue
+ * fills up.
  */
-bool button_closed_once(Button button_flag) noexcept;
+bool next_button_event(ButtonEvent& event);
 
 [[nodiscard]]
 /**
- * Returns `true` if all of the given buttons are open (i.e. not pressed)
- * and the buttons were not all open during the previous refresh.
+ * Returns `true` if all of the given buttons are closed (i.e. pressed).
  */
-bool button_open_once(Button button_flag) noexcept;
+bool button_closed(Button button_flag) noexcept;
 
 [[nodiscard]]
 /**
- * Returns true if any button was closed since the last refresh.
+ * Returns `true` is all of the given buttons are open (i.e. not pressed).
  */
-bool button_any_tap_once() noexcept;
+bool button_open(Button button_flag) noexcept;
 
 }
 
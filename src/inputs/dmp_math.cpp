@@ -0,0 +1,106 @@
+/**
+ * dmp_math.cpp - Integer quaternion and vector math for DMP packets.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "dmp_math.h"
+
+namespace {
+
+/**
+ * Returns the product of two Q14 values as a Q28 value.
+ */
+inline int32_t mul(int16_t a, int16_t b) noexcept
+{
+    return static_cast<int32_t>(a) * b;
+}
+
+/**
+ * Shifts the given value right by the given number of bits, rounding to the
+ * nearest integer, and saturates it to 16 bits.
+ */
+inline int16_t round_shift(int32_t value, uint8_t bits) noexcept
+{
+    const int32_t rounded = (value + (static_cast<int32_t>(1) << (bits - 1))) >> bits;
+    if (rounded > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (rounded < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return static_cast<int16_t>(rounded);
+}
+
+} // namespace
+
+namespace subsonic_ipt {
+namespace dmp_math {
+
+VectorInt16 gravity(const QuaternionQ14& q) noexcept
+{
+    // The last row of the rotation matrix, halved from Q14 to 8192 per g.
+    return VectorInt16(
+        round_shift(mul(q.x, q.z) - mul(q.w, q.y), Q14_BITS),
+        round_shift(mul(q.w, q.x) + mul(q.y, q.z), Q14_BITS),
+        round_shift(mul(q.w, q.w) - mul(q.x, q.x) - mul(q.y, q.y) + mul(q.z, q.z), Q14_BITS + 1)
+    );
+}
+
+VectorInt16 linear_accel(const VectorInt16& accel, const VectorInt16& gravity) noexcept
+{
+    return VectorInt16(
+        static_cast<int16_t>(accel.x - gravity.x),
+        static_cast<int16_t>(accel.y - gravity.y),
+        static_cast<int16_t>(accel.z - gravity.z)
+    );
+}
+
+RotationQ14 rotation(const QuaternionQ14& q) noexcept
+{
+    const int32_t ww = mul(q.w, q.w);
+    const int32_t xx = mul(q.x, q.x);
+    const int32_t yy = mul(q.y, q.y);
+    const int32_t zz = mul(q.z, q.z);
+    const int32_t xy = mul(q.x, q.y);
+    const int32_t xz = mul(q.x, q.z);
+    const int32_t yz = mul(q.y, q.z);
+    const int32_t wx = mul(q.w, q.x);
+    const int32_t wy = mul(q.w, q.y);
+    const int32_t wz = mul(q.w, q.z);
+
+    // The diagonal is written without assuming a unit quaternion. The other
+    // entries are doubled by shifting one bit less.
+    return RotationQ14{{
+        {
+            round_shift(ww + xx - yy - zz, Q14_BITS),
+            round_shift(xy - wz, Q14_BITS - 1),
+            round_shift(xz + wy, Q14_BITS - 1),
+        },
+        {
+            round_shift(xy + wz, Q14_BITS - 1),
+            round_shift(ww - xx + yy - zz, Q14_BITS),
+            round_shift(yz - wx, Q14_BITS - 1),
+        },
+        {
+            round_shift(xz - wy, Q14_BITS - 1),
+            round_shift(yz + wx, Q14_BITS - 1),
+            round_shift(ww - xx - yy + zz, Q14_BITS),
+        },
+    }};
+}
+
+VectorInt16 rotate(const RotationQ14& r, const VectorInt16& v) noexcept
+{
+    const auto row = [&v](const int16_t (& entries)[3]) {
+        return round_shift(mul(entries[0], v.x) + mul(entries[1], v.y) + mul(entries[2], v.z), Q14_BITS);
+    };
+    return VectorInt16(row(r.m[0]), row(r.m[1]), row(r.m[2]));
+}
+
+} // namespace dmp_math
+} // namespace subsonic_ipt
@@ -0,0 +1,103 @@
+/**
+ * dmp_math.h - Integer quaternion and vector math for DMP packets.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_DMP_MATH_H
+#define SUBSONIC_IPT_DMP_MATH_H
+
+#include <math.h> // Used by helper_3dmath.h
+#include <stdint.h>
+
+#include "dmp_packet.h"
+#include "../vendor/i2cdevlib/helper_3dmath.h"
+
+namespace subsonic_ipt {
+namespace dmp_math {
+
+/*
+ * Replacements for the gravity, linear acceleration and world-frame
+ * acceleration computed by `MPU6050::dmpGet*` and `VectorInt16::rotate`.
+ *
+ * Those convert the DMP's integers to floats, which are emulated in software
+ * on the Uno. These functions only use 16-bit by 16-bit multiplications
+ * with 32-bit sums. Accelerations are in the DMP's units of 8192 LSB per g,
+ * and agree with the float versions to within a few LSB.
+ */
+
+/**
+ * The number of fractional bits in the quaternion components and the
+ * rotation matrix entries.
+ */
+constexpr uint8_t Q14_BITS{14};
+
+/**
+ * An orientation quaternion with each component scaled by 2^14, as used by
+ * `MPU6050::dmpGetQuaternion`.
+ */
+struct QuaternionQ14 {
+    int16_t w;
+    int16_t x;
+    int16_t y;
+    int16_t z;
+};
+
+/**
+ * A 3x3 rotation matrix with each entry scaled by 2^14.
+ */
+struct RotationQ14 {
+    int16_t m[3][3];
+};
+
+[[nodiscard]]
+/**
+ * Returns the orientation quaternion of the given packet.
+ */
+constexpr QuaternionQ14 quaternion(const DmpPacketView& packet) noexcept
+{
+    return QuaternionQ14{
+        packet.quaternion_q14(0),
+        packet.quaternion_q14(1),
+        packet.quaternion_q14(2),
+        packet.quaternion_q14(3),
+    };
+}
+
+[[nodiscard]]
+/**
+ * Returns the direction of gravity in the device frame, with a magnitude of
+ * one g.
+ */
+VectorInt16 gravity(const QuaternionQ14& q) noexcept;
+
+[[nodiscard]]
+/**
+ * Returns the given acceleration with gravity removed.
+ */
+VectorInt16 linear_accel(const VectorInt16& accel, const VectorInt16& gravity) noexcept;
+
+[[nodiscard]]
+/**
+ * Returns the matrix that rotates a vector in the device frame into the
+ * world frame.
+ *
+ * Equivalent to conjugating the vector by `q`, so the quaternion does not
+ * need to be normalized.
+ */
+RotationQ14 rotation(const QuaternionQ14& q) noexcept;
+
+[[nodiscard]]
+/**
+ * Returns the given vector rotated by the given matrix.
+ */
+VectorInt16 rotate(const RotationQ14& r, const VectorInt16& v) noexcept;
+
+} // namespace dmp_math
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_DMP_MATH_H
@@ -0,0 +1,140 @@
+/**
+ * dmp_packet.h - Typed access to the fields of a MotionApps 2.0 DMP packet.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_DMP_PACKET_H
+#define SUBSONIC_IPT_DMP_PACKET_H
+
+#include <math.h> // Used by helper_3dmath.h
+#include <stdint.h>
+
+#include "../vendor/i2cdevlib/helper_3dmath.h"
+
+namespace subsonic_ipt {
+
+/**
+ * A read-only view over the bytes of a single 42 byte DMP packet, as read
+ * from the MPU's FIFO.
+ *
+ * The packet holds big-endian 32-bit words: the orientation quaternion in
+ * Q30 fixed point, then the gyro rates and the accelerations, each with its
+ * value in the upper 16 bits. Each accessor reads its field straight out of
+ * the packet at a fixed offset, in place of the `MPU6050::dmpGet*` functions.
+ * Nothing is copied, so the view must not outlive the packet.
+ */
+class DmpPacketView {
+    const uint8_t* m_bytes;
+
+  public:
+    /// The number of bytes in a packet.
+    constexpr static uint8_t SIZE{42};
+
+    /// The offsets of the first byte of each field.
+    constexpr static uint8_t QUATERNION_OFFSET{0};
+    constexpr static uint8_t GYRO_OFFSET{16};
+    constexpr static uint8_t ACCEL_OFFSET{28};
+
+    /// The value of one in the quaternion's components.
+    constexpr static int32_t QUATERNION_ONE{1L << 30};
+
+    /// The value of one g in the accelerations.
+    constexpr static int16_t ACCEL_ONE_G{8192};
+
+    constexpr explicit DmpPacketView(const uint8_t* bytes) noexcept : m_bytes(bytes) {}
+
+    [[nodiscard]]
+    /**
+     * Returns the given component of the orientation quaternion, in the
+     * order w, x, y, z, with one represented by `QUATERNION_ONE`.
+     */
+    constexpr int32_t quaternion(uint8_t component) const noexcept
+    {
+        return read_int32(QUATERNION_OFFSET + 4 * component);
+    }
+
+    [[nodiscard]]
+    /**
+     * Returns the given component of the orientation quaternion to 14
+     * fractional bits, as used by `MPU6050::dmpGetQuaternion`.
+     */
+    constexpr int16_t quaternion_q14(uint8_t component) const noexcept
+    {
+        return read_int16(QUATERNION_OFFSET + 4 * component);
+    }
+
+    [[nodiscard]]
+    /**
+     * Returns the rotation rate about the given device axis, in units of
+     * 1/16.4 deg/s.
+     */
+    constexpr int16_t gyro(uint8_t axis) const noexcept
+    {
+        return read_int16(GYRO_OFFSET + 4 * axis);
+    }
+
+    [[nodiscard]]
+    /**
+     * Returns the acceleration along the given device axis, including
+     * gravity, with one g represented by `ACCEL_ONE_G`.
+     */
+    constexpr int16_t accel(uint8_t axis) const noexcept
+    {
+        return read_int16(ACCEL_OFFSET + 4 * axis);
+    }
+
+    [[nodiscard]]
+    /**
+     * Returns the orientation quaternion as floats, equal to the result of
+     * `MPU6050::dmpGetQuaternion`.
+     */
+    Quaternion quaternion() const noexcept
+    {
+        constexpr float scale = 1.0f / 16384.0f;
+        return Quaternion(
+            quaternion_q14(0) * scale,
+            quaternion_q14(1) * scale,
+            quaternion_q14(2) * scale,
+            quaternion_q14(3) * scale
+        );
+    }
+
+    [[nodiscard]]
+    /// Returns the rotation rates about each device axis.
+    VectorInt16 gyro() const noexcept
+    {
+        return VectorInt16(gyro(0), gyro(1), gyro(2));
+    }
+
+    [[nodiscard]]
+    /// Returns the accelerations along each device axis.
+    VectorInt16 accel() const noexcept
+    {
+        return VectorInt16(accel(0), accel(1), accel(2));
+    }
+
+  private:
+    constexpr int16_t read_int16(uint8_t offset) const noexcept
+    {
+        return static_cast<int16_t>((static_cast<uint16_t>(m_bytes[offset]) << 8u) | m_bytes[offset + 1]);
+    }
+
+    constexpr int32_t read_int32(uint8_t offset) const noexcept
+    {
+        return static_cast<int32_t>(
+            (static_cast<uint32_t>(m_bytes[offset]) << 24u)
+            | (static_cast<uint32_t>(m_bytes[offset + 1]) << 16u)
+            | (static_cast<uint32_t>(m_bytes[offset + 2]) << 8u)
+            | m_bytes[offset + 3]
+        );
+    }
+};
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_DMP_PACKET_H
@@ -0,0 +1,93 @@
+/**
+ * gyro_bias.cpp - Implementation for gyroscope bias estimation.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "gyro_bias.h"
+
+/******************************************************************************\
+ * Internal definitions
+\******************************************************************************/
+namespace {
+
+/**
+ * The largest rotation rate on any axis, about 2 deg/s, for which the device
+ * may be still. Larger rates cannot be bias left over from calibration.
+ */
+constexpr int16_t STILL_GYRO_LSB{33};
+
+/**
+ * The largest spread of the rotation rate on any axis over a window, about
+ * 0.5 deg/s. Wider than the sensor noise, but narrower than any slow turn
+ * made by hand.
+ */
+constexpr int16_t STILL_GYRO_SPREAD_LSB{8};
+
+/**
+ * The largest linear acceleration on any axis, about 0.05 g, for which the
+ * device may be still.
+ */
+constexpr int16_t STILL_ACCEL_LSB{410};
+
+inline bool within(int16_t value, int16_t limit) noexcept
+{
+    return -limit <= value && value <= limit;
+}
+
+} // namespace
+
+/******************************************************************************\
+ * Public definitions
+\******************************************************************************/
+namespace subsonic_ipt {
+
+bool GyroBiasTracker::update(const VectorInt16& gyro, const VectorInt16& real_accel) noexcept
+{
+    const int16_t rates[3]{gyro.x, gyro.y, gyro.z};
+    if (!within(real_accel.x, STILL_ACCEL_LSB) || !within(real_accel.y, STILL_ACCEL_LSB)
+        || !within(real_accel.z, STILL_ACCEL_LSB)) {
+        m_count = 0;
+        return false;
+    }
+
+    for (uint8_t axis = 0; axis < 3; ++axis) {
+        const int16_t rate = rates[axis];
+        if (!within(rate, STILL_GYRO_LSB)) {
+            m_count = 0;
+            return false;
+        }
+        if (m_count == 0) {
+            m_sums[axis] = 0;
+            m_min[axis] = rate;
+            m_max[axis] = rate;
+        } else if (rate < m_min[axis]) {
+            m_min[axis] = rate;
+        } else if (rate > m_max[axis]) {
+            m_max[axis] = rate;
+        }
+        if (m_max[axis] - m_min[axis] > STILL_GYRO_SPREAD_LSB) {
+            m_count = 0;
+            return false;
+        }
+        m_sums[axis] += rate;
+    }
+
+    if (++m_count < SUBSONIC_GYRO_BIAS_WINDOW) {
+        return false;
+    }
+    m_count = 0;
+    for (uint8_t axis = 0; axis < 3; ++axis) {
+        // Twice the mean rate, rounded to the nearest offset register unit.
+        const long doubled = 2 * m_sums[axis];
+        const long half = SUBSONIC_GYRO_BIAS_WINDOW / 2;
+        m_correction[axis] = static_cast<int16_t>((doubled + (doubled < 0 ? -half : half)) / SUBSONIC_GYRO_BIAS_WINDOW);
+    }
+    return true;
+}
+
+} // namespace subsonic_ipt
@@ -0,0 +1,98 @@
+/**
+ * gyro_bias.h - Estimation of the residual gyroscope bias while the device
+ *               is at rest.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_GYRO_BIAS_H
+#define SUBSONIC_IPT_GYRO_BIAS_H
+
+#include <math.h> // Used by helper_3dmath.h
+#include <stdint.h>
+
+#include "../vendor/i2cdevlib/helper_3dmath.h"
+
+// When nonzero, the MPU's gyro offsets are refined in the background
+// whenever the device is held still, so that yaw does not drift as the
+// sensor warms up.
+#ifndef SUBSONIC_GYRO_BIAS_TRACKING
+#define SUBSONIC_GYRO_BIAS_TRACKING 1
+#endif
+
+// The number of consecutive still packets averaged for each bias estimate.
+// Must be a power of two no greater than 128.
+#ifndef SUBSONIC_GYRO_BIAS_WINDOW
+#define SUBSONIC_GYRO_BIAS_WINDOW 128
+#endif
+
+namespace subsonic_ipt {
+
+/**
+ * Detects when the device is at rest from the gyro rates and linear
+ * accelerations in DMP packets, and measures the gyro bias over each run of
+ * `SUBSONIC_GYRO_BIAS_WINDOW` still packets.
+ *
+ * The device is considered still while its linear acceleration and rotation
+ * rate are small on every axis and the rotation rate stays within a narrow
+ * band. Each packet takes a constant amount of work.
+ */
+class GyroBiasTracker {
+    static_assert(
+        (SUBSONIC_GYRO_BIAS_WINDOW & (SUBSONIC_GYRO_BIAS_WINDOW - 1)) == 0 && SUBSONIC_GYRO_BIAS_WINDOW <= 128,
+        "window must be a power of two no greater than 128"
+    );
+
+    /// The sum of each gyro axis over the current window.
+    long m_sums[3]{};
+
+    /// The extremes of each gyro axis over the current window.
+    int16_t m_min[3]{};
+    int16_t m_max[3]{};
+
+    /// The number of packets in the current window.
+    uint8_t m_count{0};
+
+    /// The offset correction measured over the last complete window.
+    int16_t m_correction[3]{};
+
+  public:
+    /**
+     * Adds the gyro rates and linear acceleration from a single DMP packet,
+     * in the DMP's units of 16.4 LSB per deg/s and 8192 LSB per g.
+     *
+     * Returns `true` if the packet completed a window of still packets, in
+     * which case `correction` holds the window's bias. Any moving packet
+     * discards the current window.
+     */
+    bool update(const VectorInt16& gyro, const VectorInt16& real_accel) noexcept;
+
+    [[nodiscard]]
+    /**
+     * Returns the amounts to subtract from the MPU's three gyro offset
+     * registers to cancel the bias measured over the last complete window.
+     *
+     * The offset registers have twice the resolution of the DMP's gyro
+     * rates.
+     */
+    const int16_t* correction() const noexcept
+    {
+        return m_correction;
+    }
+
+    /**
+     * Discards the current window.
+     */
+    void reset() noexcept
+    {
+        m_count = 0;
+    }
+};
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_GYRO_BIAS_H
@@ -25,10 +25,46 @@
 #include "Wire.h"
 
 #include "mpu.h"
+#include "dmp_math.h"
+#include "dmp_packet.h"
+#include "gyro_bias.h"
+#include "mpu_calibration.h"
+#include "../async_i2c.h"
+#include "../crc16.h"
+#include "../fast_trig.h"
 #include "../pin.h"
+#include "../profiler.h"
+#include "../ring_buffer.h"
+#include "../spsc_ring.h"
 
 constexpr uint8_t CALIBRATION_LOOPS{20};
 
+/**
+ * The number of raw samples averaged when checking stored offsets.
+ */
+constexpr uint8_t CHECK_SAMPLES{16};
+
+/**
+ * The largest difference from 1 g in the magnitude of the averaged
+ * acceleration, and the largest averaged rotation rate on any axis, with
+ * which stored offsets are accepted. In the units of the DMP's full scale
+ * ranges of 2 g and 2000 deg/s.
+ */
+constexpr long CHECK_ACCEL_TOLERANCE{16384 / 10};
+constexpr long CHECK_GYRO_TOLERANCE{33};
+
+/**
+ * The size in bytes of the packets produced by the MotionApps 2.0 DMP
+ * firmware.
+ */
+constexpr uint8_t DMP_PACKET_SIZE{subsonic_ipt::DmpPacketView::SIZE};
+
+/**
+ * The rate in hertz of the gyroscope output that the DMP samples from, with
+ * the low pass filter enabled.
+ */
+constexpr unsigned long GYRO_OUTPUT_RATE_HZ{1000};
+
 
 /******************************************************************************\
  * Internal definitions
@@ -43,43 +79,747 @@ MPU6050 g_mpu;
  * Global state variables for controlling the MPU.
  */
 struct mpu_control_t {
-    uint8_t fifo_buffer[64];
     uint16_t fifo_count;
     uint16_t packet_size;
     bool dmp_ready;
     uint8_t mpu_int_status;
     uint8_t dev_status;
+    // The nominal time in microseconds between DMP packets.
+    unsigned long packet_period_u;
+    // The nominal timestamp of the last packet that was read.
+    unsigned long last_timestamp_u;
 } g_mpu_control{};
 
 /**
- * Whether an interupt was raised by the MPU.
+ * A single undecoded DMP packet.
  */
-volatile bool g_mpu_interrupt = false;
+struct DmpPacket {
+    uint8_t bytes[DMP_PACKET_SIZE];
+    /// The nominal time the packet was sampled.
+    unsigned long timestamp_u;
+    /// The number of packets read after this one from the same FIFO count.
+    uint8_t batch_remaining;
+
+    /// Returns a view over the fields of this packet, in place in the ring.
+    subsonic_ipt::DmpPacketView view() const noexcept
+    {
+        return subsonic_ipt::DmpPacketView(bytes);
+    }
+};
+
+/**
+ * Packets read from the FIFO that are waiting to be decoded.
+ *
+ * Reading packets ahead of decoding them frees space in the MPU's FIFO
+ * before the comparatively slow decoding and integration.
+ */
+subsonic_ipt::RingBuffer<DmpPacket, SUBSONIC_MPU_PACKET_RING> g_packet_ring;
+
+/**
+ * An interrupt raised by the MPU once a packet was written to its FIFO.
+ */
+struct MotionEvent {
+    /// The time the interrupt was handled.
+    unsigned long capture_u;
+};
+
+/**
+ * Interrupts waiting to be serviced, pushed by the interrupt handler and
+ * popped by the main loop.
+ */
+subsonic_ipt::SpscRing<MotionEvent, SUBSONIC_MPU_EVENT_RING> g_motion_events;
+
+/**
+ * The fields decoded from each packet.
+ */
+subsonic_ipt::MotionField g_motion_fields{subsonic_ipt::MotionAll};
+
+void on_status_read(subsonic_ipt::I2CTransaction& transaction);
+
+void on_count_read(subsonic_ipt::I2CTransaction& transaction);
+
+void on_packet_read(subsonic_ipt::I2CTransaction& transaction);
+
+/// Register addresses written ahead of each FIFO reader transaction.
+constexpr uint8_t INT_STATUS_REGISTER{MPU6050_RA_INT_STATUS};
+constexpr uint8_t FIFO_COUNT_REGISTER{MPU6050_RA_FIFO_COUNTH};
+constexpr uint8_t FIFO_DATA_REGISTER{MPU6050_RA_FIFO_R_W};
+
+/**
+ * State of the background reads of the MPU's FIFO.
+ *
+ * After each MPU interrupt, the interrupt status and FIFO count are read,
+ * followed by every counted packet, one transaction at a time. Each step is
+ * started from the completion callback of the previous one, so the main
+ * loop is never blocked on the bus.
+ */
+struct {
+    subsonic_ipt::I2CTransaction status_read{
+        MPU6050_DEFAULT_ADDRESS, &INT_STATUS_REGISTER, 1, &g_mpu_control.mpu_int_status, 1, on_status_read,
+        nullptr, subsonic_ipt::I2CResult::Success
+    };
+    subsonic_ipt::I2CTransaction count_read{
+        MPU6050_DEFAULT_ADDRESS, &FIFO_COUNT_REGISTER, 1, nullptr, 2, on_count_read,
+        nullptr, subsonic_ipt::I2CResult::Success
+    };
+    subsonic_ipt::I2CTransaction packet_read{
+        MPU6050_DEFAULT_ADDRESS, &FIFO_DATA_REGISTER, 1, nullptr, DMP_PACKET_SIZE, on_packet_read,
+        nullptr, subsonic_ipt::I2CResult::Success
+    };
+    uint8_t count_bytes[2];
+    /// Whether a sequence of reads is in progress.
+    bool busy;
+    /// Whether the sequence is waiting for room in the packet ring, or in the
+    /// I2C queue, before reading the next packet. No read is in flight.
+    bool stalled;
+    /// Whether the last FIFO count found that the FIFO overflowed.
+    bool overflow;
+    /// The number of motion events queued when the status read was started.
+    /// Their packets were in the FIFO before it was counted.
+    uint8_t events;
+    /// The number of counted packets that have not been read yet.
+    uint16_t unread;
+    /// The nominal timestamp of the newest counted packet.
+    unsigned long batch_time_u;
+    /// The nominal time between the counted packets.
+    unsigned long batch_period_u;
+} g_fifo_reader;
 
 /**
  * Arduino interupt handler to allow signal the presence of a DMP interupt.
  */
 void dmp_data_ready() noexcept
 {
-    g_mpu_interrupt = true;
+    subsonic_ipt::mpu_capture_interrupt(micros());
+}
+
+/**
+ * Decodes the fields of a single DMP packet into a `DeviceMotion` on first
+ * access.
+ *
+ * Each field, along with the quaternion and the other fields it is derived
+ * from, is computed at most once and only if it is asked for. Everything up
+ * to the final angles is computed with integer math.
+ */
+class LazyMotion {
+    subsonic_ipt::DeviceMotion& m_motion;
+
+    const subsonic_ipt::DmpPacketView m_packet;
+
+    subsonic_ipt::dmp_math::QuaternionQ14 m_quaternion{};
+
+    bool m_have_quaternion{false};
+
+  public:
+    LazyMotion(subsonic_ipt::DeviceMotion& motion, subsonic_ipt::DmpPacketView packet)
+        : m_motion(motion), m_packet(packet)
+    {
+        m_motion.fields = subsonic_ipt::MotionNone;
+    }
+
+    const subsonic_ipt::dmp_math::QuaternionQ14& quaternion()
+    {
+        if (!m_have_quaternion) {
+            m_have_quaternion = true;
+            m_quaternion = subsonic_ipt::dmp_math::quaternion(m_packet);
+        }
+        return m_quaternion;
+    }
+
+    const VectorInt16& gravity()
+    {
+        if (begin(subsonic_ipt::MotionGravity)) {
+            m_motion.gravity = subsonic_ipt::dmp_math::gravity(quaternion());
+        }
+        return m_motion.gravity;
+    }
+
+    const VectorInt16& raw_accel()
+    {
+        if (begin(subsonic_ipt::MotionRawAccel)) {
+            m_motion.raw_accel = m_packet.accel();
+        }
+        return m_motion.raw_accel;
+    }
+
+    const VectorInt16& real_accel()
+    {
+        if (begin(subsonic_ipt::MotionRealAccel)) {
+            m_motion.real_accel = subsonic_ipt::dmp_math::linear_accel(raw_accel(), gravity());
+        }
+        return m_motion.real_accel;
+    }
+
+    const VectorInt16& world_accel()
+    {
+        using namespace subsonic_ipt::dmp_math;
+
+        if (begin(subsonic_ipt::MotionWorldAccel)) {
+            m_motion.world_accel = rotate(rotation(quaternion()), real_accel());
+        }
+        return m_motion.world_accel;
+    }
+
+    const VectorInt16& gyro()
+    {
+        if (begin(subsonic_ipt::MotionGyro)) {
+            m_motion.gyro = m_packet.gyro();
+        }
+        return m_motion.gyro;
+    }
+
+    /**
+     * Computes the yaw of the device.
+     *
+     * Equivalent to the yaw of `MPU6050::dmpGetYawPitchRoll`, but using the
+     * trigonometry selected in fast_trig.h.
+     */
+    void yaw()
+    {
+        if (begin(subsonic_ipt::MotionYaw)) {
+            const auto& q = quaternion();
+            // atan2(2xy - 2wz, 2ww + 2xx - 1), with both sides halved.
+            const int32_t y = static_cast<int32_t>(q.x) * q.y - static_cast<int32_t>(q.w) * q.z;
+            const int32_t x = static_cast<int32_t>(q.w) * q.w + static_cast<int32_t>(q.x) * q.x - (1L << 27);
+            m_motion.yaw = subsonic_ipt::fast_trig::atan2(static_cast<double>(y), static_cast<double>(x));
+        }
+    }
+
+    /**
+     * Computes the pitch and roll of the device.
+     *
+     * Equivalent to the pitch and roll of `MPU6050::dmpGetYawPitchRoll`, but
+     * using the trigonometry selected in fast_trig.h.
+     */
+    void tilt()
+    {
+        using subsonic_ipt::fast_trig::atan2;
+
+        if (begin(subsonic_ipt::MotionTilt)) {
+            const VectorInt16& g = gravity();
+            const int32_t horizontal = static_cast<int32_t>(g.y) * g.y + static_cast<int32_t>(g.z) * g.z;
+            // pitch: (nose up/down, about Y axis)
+            m_motion.pitch = atan2(static_cast<double>(g.x), sqrt(static_cast<double>(horizontal)));
+            // roll: (tilt left/right, about X axis)
+            m_motion.roll = atan2(static_cast<double>(g.y), static_cast<double>(g.z));
+            if (g.z < 0) {
+                m_motion.pitch = (m_motion.pitch > 0 ? PI : -PI) - m_motion.pitch;
+            }
+        }
+    }
+
+  private:
+    /**
+     * Marks the given field as decoded, and returns `true` if it was not
+     * already.
+     */
+    bool begin(subsonic_ipt::MotionField field)
+    {
+        if (m_motion.fields & field) {
+            return false;
+        }
+        m_motion.fields = static_cast<subsonic_ipt::MotionField>(m_motion.fields | field);
+        return true;
+    }
+};
+
+/// Register addresses used to access the MPU's memory banks.
+constexpr uint8_t BANK_SELECT_REGISTER{MPU6050_RA_BANK_SEL};
+constexpr uint8_t MEMORY_ADDRESS_REGISTER{MPU6050_RA_MEM_START_ADDR};
+constexpr uint8_t MEMORY_REGISTER{MPU6050_RA_MEM_R_W};
+
+/**
+ * The number of firmware bytes written or read back per transaction, as
+ * used by i2cdevlib.
+ */
+constexpr uint8_t DMP_CHUNK_SIZE{MPU6050_DMP_MEMORY_CHUNK_SIZE};
+
+/**
+ * How long the MPU takes to restart after a device reset and after an I2C
+ * master reset.
+ */
+constexpr unsigned long DEVICE_RESET_U{30000};
+constexpr unsigned long MASTER_RESET_U{20000};
+
+/**
+ * How many times a chunk of the DMP firmware, or with SUBSONIC_DMP_VERIFY=2
+ * the whole image, is written before the load is given up on.
+ */
+constexpr uint8_t DMP_LOAD_ATTEMPTS{3};
+
+/**
+ * The steps taken for each chunk of the firmware image.
+ */
+enum class ChunkStep : uint8_t {
+    SelectBank,
+    SelectAddress,
+    Transfer,
+    RewindAddress,
+    ReadBack,
+    Check,
+};
+
+/**
+ * State of the DMP firmware load started by `begin_dmp_load`.
+ *
+ * This performs the same steps as `MPU6050::dmpInitialize`. The image is
+ * sent one transaction at a time through the I2C engine. The MPU advances
+ * its memory address after every byte it reads or writes, so the bank and
+ * address only need to be selected at the start of each 256 byte bank. The
+ * register setup before and after the upload is done with short blocking
+ * driver calls.
+ */
+struct {
+    subsonic_ipt::DmpLoadState state;
+    ChunkStep step;
+    /// When the current wait for the MPU started, and how long it lasts.
+    unsigned long wait_start_u;
+    unsigned long wait_u;
+    /// The number of bytes of the image written, or read back.
+    uint16_t position;
+    /// The number of bytes in the current chunk.
+    uint8_t chunk_length;
+    /// The CRC of the image as written and as read back.
+    uint16_t image_crc;
+    uint16_t readback_crc;
+    /// The number of times the current chunk, or image, failed its check.
+    uint8_t failures;
+    uint8_t bank_write[2]{BANK_SELECT_REGISTER, 0};
+    uint8_t address_write[2]{MEMORY_ADDRESS_REGISTER, 0};
+    /// The memory register, followed by the current chunk.
+    uint8_t chunk[1 + DMP_CHUNK_SIZE]{MEMORY_REGISTER};
+#if SUBSONIC_DMP_VERIFY == 1
+    uint8_t readback[DMP_CHUNK_SIZE];
+#endif
+    subsonic_ipt::I2CTransaction transaction{
+        MPU6050_DEFAULT_ADDRESS, nullptr, 0, nullptr, 0, nullptr, nullptr, subsonic_ipt::I2CResult::Success
+    };
+} g_dmp_loader;
+
+/**
+ * Starts a non-blocking wait of the given length before the DMP load
+ * continues.
+ */
+void wait_for_mpu(unsigned long duration_u)
+{
+    g_dmp_loader.wait_start_u = micros();
+    g_dmp_loader.wait_u = duration_u;
+}
+
+/**
+ * Submits a transaction for the DMP load that writes the given bytes and
+ * then reads `read_length` bytes into `read_data`.
+ *
+ * Marks the load as failed if the transaction cannot be queued.
+ */
+void submit_dmp_transfer(const uint8_t* write_data, uint8_t write_length, uint8_t* read_data, uint8_t read_length)
+{
+    auto& transaction = g_dmp_loader.transaction;
+    transaction.write_data = write_data;
+    transaction.write_length = write_length;
+    transaction.read_data = read_data;
+    transaction.read_length = read_length;
+    if (!subsonic_ipt::i2c_submit(transaction)) {
+        g_dmp_loader.state = subsonic_ipt::DmpLoadState::Failed;
+    }
+}
+
+/**
+ * Configures the MPU to sample for the DMP, once it has restarted.
+ */
+void configure_dmp_sampling()
+{
+    subsonic_ipt::i2c_wait_idle();
+    g_mpu.setClockSource(MPU6050_CLOCK_PLL_ZGYRO);
+    g_mpu.setIntEnabled(1u << MPU6050_INTERRUPT_FIFO_OFLOW_BIT | 1u << MPU6050_INTERRUPT_DMP_INT_BIT);
+    g_mpu.setRate(4); // 1khz / (1 + 4) = 200 Hz
+    g_mpu.setExternalFrameSync(MPU6050_EXT_SYNC_TEMP_OUT_L);
+    g_mpu.setDLPFMode(MPU6050_DLPF_BW_42);
+    g_mpu.setFullScaleGyroRange(MPU6050_GYRO_FS_2000);
+}
+
+/**
+ * Points the MPU at the loaded firmware and configures the DMP's motion
+ * detection and FIFO, leaving the DMP disabled.
+ */
+void finish_dmp_load()
+{
+    subsonic_ipt::i2c_wait_idle();
+    // Set the FIFO rate divisor in the DMP firmware's memory
+    const uint8_t dmp_update[] = {0x00, MPU6050_DMP_FIFO_RATE_DIVISOR};
+    g_mpu.writeMemoryBlock(dmp_update, 0x02, 0x02, 0x16);
+
+    // Write the firmware's start address
+    g_mpu.setDMPConfig1(0x03);
+    g_mpu.setDMPConfig2(0x00);
+    g_mpu.setOTPBankValid(false);
+
+    g_mpu.setMotionDetectionThreshold(2);
+    g_mpu.setZeroMotionDetectionThreshold(156);
+    g_mpu.setMotionDetectionDuration(80);
+    g_mpu.setZeroMotionDetectionDuration(0);
+    g_mpu.setFIFOEnabled(true);
+    g_mpu.resetDMP();
+    g_mpu.setDMPEnabled(false);
+    g_mpu.resetFIFO();
+    g_mpu.getIntStatus();
+    g_dmp_loader.state = subsonic_ipt::DmpLoadState::Done;
+}
+
+/**
+ * Takes the next step of writing or reading back the current chunk of the
+ * firmware image.
+ */
+void step_dmp_chunk()
+{
+    auto& loader = g_dmp_loader;
+    const bool uploading = loader.state == subsonic_ipt::DmpLoadState::Uploading;
+    switch (loader.step) {
+        case ChunkStep::SelectBank: {
+            loader.bank_write[1] = static_cast<uint8_t>(loader.position >> 8u);
+            submit_dmp_transfer(loader.bank_write, sizeof(loader.bank_write), nullptr, 0);
+            loader.step = ChunkStep::SelectAddress;
+            return;
+        }
+        case ChunkStep::SelectAddress:
+        case ChunkStep::RewindAddress: {
+            loader.address_write[1] = static_cast<uint8_t>(loader.position);
+            submit_dmp_transfer(loader.address_write, sizeof(loader.address_write), nullptr, 0);
+            loader.step = loader.step == ChunkStep::SelectAddress ? ChunkStep::Transfer : ChunkStep::ReadBack;
+            return;
+        }
+        case ChunkStep::Transfer: {
+            // Chunks never cross a bank boundary.
+            const uint16_t bank_remaining = 256 - (loader.position & 0xFFu);
+            const uint16_t image_remaining = MPU6050_DMP_CODE_SIZE - loader.position;
+            uint16_t length = bank_remaining < image_remaining ? bank_remaining : image_remaining;
+            loader.chunk_length = static_cast<uint8_t>(length < DMP_CHUNK_SIZE ? length : DMP_CHUNK_SIZE);
+            if (uploading) {
+                for (uint8_t i = 0; i < loader.chunk_length; ++i) {
+                    loader.chunk[1 + i] = pgm_read_byte(dmpMemory + loader.position + i);
+                }
+                submit_dmp_transfer(loader.chunk, static_cast<uint8_t>(1 + loader.chunk_length), nullptr, 0);
+                loader.step = SUBSONIC_DMP_VERIFY == 1 ? ChunkStep::RewindAddress : ChunkStep::Check;
+            } else {
+                submit_dmp_transfer(&MEMORY_REGISTER, 1, loader.chunk + 1, loader.chunk_length);
+                loader.step = ChunkStep::Check;
+            }
+            return;
+        }
+        case ChunkStep::ReadBack: {
+#if SUBSONIC_DMP_VERIFY == 1
+            submit_dmp_transfer(&MEMORY_REGISTER, 1, loader.readback, loader.chunk_length);
+#endif
+            loader.step = ChunkStep::Check;
+            return;
+        }
+        case ChunkStep::Check: {
+            if (uploading) {
+#if SUBSONIC_DMP_VERIFY == 1
+                if (memcmp(loader.chunk + 1, loader.readback, loader.chunk_length) != 0) {
+                    // Write the chunk again
+                    if (++loader.failures == DMP_LOAD_ATTEMPTS) {
+                        loader.state = subsonic_ipt::DmpLoadState::Failed;
+                    } else {
+                        Serial.println(F("DMP firmware chunk did not verify, retrying"));
+                        loader.step = ChunkStep::SelectAddress;
+                    }
+                    return;
+                }
+                loader.failures = 0;
+#endif
+                loader.image_crc = subsonic_ipt::crc16(loader.chunk + 1, loader.chunk_length, loader.image_crc);
+            } else {
+                loader.readback_crc = subsonic_ipt::crc16(loader.chunk + 1, loader.chunk_length, loader.readback_crc);
+            }
+            loader.position += loader.chunk_length;
+            loader.step = (loader.position & 0xFFu) == 0 ? ChunkStep::SelectBank : ChunkStep::Transfer;
+            if (loader.position < MPU6050_DMP_CODE_SIZE) {
+                step_dmp_chunk();
+                return;
+            }
+
+            loader.position = 0;
+            loader.step = ChunkStep::SelectBank;
+            if (uploading && SUBSONIC_DMP_VERIFY == 2) {
+                loader.state = subsonic_ipt::DmpLoadState::Verifying;
+                loader.readback_crc = 0xFFFF;
+                step_dmp_chunk();
+            } else if (!uploading && loader.readback_crc != loader.image_crc) {
+                // Write the whole image again
+                if (++loader.failures == DMP_LOAD_ATTEMPTS) {
+                    loader.state = subsonic_ipt::DmpLoadState::Failed;
+                } else {
+                    Serial.println(F("DMP firmware did not verify, retrying"));
+                    loader.state = subsonic_ipt::DmpLoadState::Uploading;
+                    loader.image_crc = 0xFFFF;
+                }
+            } else {
+                finish_dmp_load();
+            }
+            return;
+        }
+    }
+}
+
+/**
+ * Starts reading the next counted packet into the packet ring, or ends the
+ * sequence of reads once every counted packet has been read.
+ *
+ * Must only be called once the previous read of the sequence has completed.
+ * If the ring or the I2C queue is full, the sequence stalls until
+ * `service_mpu` resumes it.
+ */
+void read_next_packet()
+{
+    auto& reader = g_fifo_reader;
+    reader.stalled = false;
+    if (reader.unread == 0) {
+        reader.busy = false;
+        return;
+    }
+    if (!g_packet_ring.full()) {
+        reader.packet_read.read_data = g_packet_ring.back().bytes;
+        reader.packet_read.read_length = static_cast<uint8_t>(g_mpu_control.packet_size);
+        if (subsonic_ipt::i2c_submit(reader.packet_read)) {
+            return;
+        }
+    }
+    reader.stalled = true;
+}
+
+/**
+ * Starts a sequence of reads in response to an MPU interrupt.
+ */
+void start_fifo_read()
+{
+    g_fifo_reader.events = g_motion_events.size();
+    g_fifo_reader.busy = subsonic_ipt::i2c_submit(g_fifo_reader.status_read);
+}
+
+void on_status_read(subsonic_ipt::I2CTransaction& transaction)
+{
+    auto& reader = g_fifo_reader;
+    reader.count_read.read_data = reader.count_bytes;
+    reader.busy = transaction.result == subsonic_ipt::I2CResult::Success
+        && subsonic_ipt::i2c_submit(reader.count_read);
+}
+
+/**
+ * Checks the FIFO count that was just read, and returns the number of
+ * packets to read.
+ *
+ * The packets are stamped as if they were sampled at the DMP's nominal
+ * rate, with the newest sampled when the latest interrupt was captured. If
+ * more packets are pending than could have been produced at that rate since
+ * the last packet, they are spaced evenly over the elapsed time instead, so
+ * timestamps never go backwards.
+ */
+uint16_t count_packets()
+{
+    auto& control = g_mpu_control;
+    auto& reader = g_fifo_reader;
+    control.fifo_count = (static_cast<uint16_t>(reader.count_bytes[0]) << 8u) | reader.count_bytes[1];
+
+    // The interrupts captured before the status read were raised for packets
+    // that are now counted. Later ones are left for the next read, since
+    // their packets may have arrived after the count.
+    unsigned long capture_u = micros();
+    for (; reader.events != 0; --reader.events) {
+        capture_u = g_motion_events.front().capture_u;
+        g_motion_events.pop();
+    }
+
+    // check for overflow (this should never happen unless our code is too inefficient)
+    if ((control.mpu_int_status & _BV(MPU6050_INTERRUPT_FIFO_OFLOW_BIT)) || control.fifo_count >= 1024) {
+        reader.overflow = true;
+        return 0;
+    }
+    // We got an interrupt from another event, or a partial packet
+    if (!(control.mpu_int_status & _BV(MPU6050_INTERRUPT_DMP_INT_BIT)) || control.fifo_count < control.packet_size) {
+        return 0;
+    }
+
+    const uint16_t packets = control.fifo_count / control.packet_size;
+    reader.batch_time_u = capture_u;
+    reader.batch_period_u = control.packet_period_u;
+    // Taken modulo 2^32, like micros() on the AVR, so that the interval is
+    // right across its wrap.
+    const uint32_t elapsed_u = static_cast<uint32_t>(reader.batch_time_u) - static_cast<uint32_t>(control.last_timestamp_u);
+    if (control.last_timestamp_u != 0 && elapsed_u / packets < reader.batch_period_u) {
+        reader.batch_period_u = elapsed_u / packets;
+    }
+    return packets;
+}
+
+void on_count_read(subsonic_ipt::I2CTransaction& transaction)
+{
+    g_fifo_reader.unread = transaction.result == subsonic_ipt::I2CResult::Success ? count_packets() : 0;
+    read_next_packet();
+}
+
+void on_packet_read(subsonic_ipt::I2CTransaction& transaction)
+{
+    auto& reader = g_fifo_reader;
+    if (transaction.result != subsonic_ipt::I2CResult::Success) {
+        // Abandon the batch. The remaining packets will be counted again
+        // after the next interrupt.
+        reader.unread = 0;
+        reader.busy = false;
+        return;
+    }
+
+    --reader.unread;
+    DmpPacket& packet = g_packet_ring.back();
+    packet.timestamp_u = reader.batch_time_u - reader.unread * reader.batch_period_u;
+    // The DMP only ever reports 24 packets at once, since its FIFO holds
+    // 1024 bytes.
+    packet.batch_remaining = static_cast<uint8_t>(reader.unread);
+    g_mpu_control.last_timestamp_u = packet.timestamp_u;
+    g_packet_ring.push();
+
+    read_next_packet();
+}
+
+#if SUBSONIC_GYRO_BIAS_TRACKING
+/**
+ * Measures the residual gyro bias whenever the device is still.
+ */
+subsonic_ipt::GyroBiasTracker g_gyro_bias;
+
+/**
+ * I2C callback that adopts the gyro offsets just written, if the MPU
+ * accepted them.
+ */
+void on_gyro_offsets_written(subsonic_ipt::I2CTransaction& transaction);
+
+/**
+ * The gyro offsets in use, and the background write that updates them.
+ */
+struct {
+    int16_t offsets[3];
+    /// The offsets being written, which replace `offsets` once the write
+    /// succeeds.
+    int16_t pending[3];
+    /// The first offset register, followed by the big-endian offsets.
+    uint8_t bytes[1 + 6];
+    subsonic_ipt::I2CTransaction write{
+        MPU6050_DEFAULT_ADDRESS, bytes, sizeof(bytes), nullptr, 0, on_gyro_offsets_written, nullptr,
+        subsonic_ipt::I2CResult::Success
+    };
+} g_gyro_offsets;
+
+void on_gyro_offsets_written(subsonic_ipt::I2CTransaction& transaction)
+{
+    // After a failed write, the bias is still there to be measured again,
+    // and the next correction is made from the offsets last known to be set.
+    if (transaction.result != subsonic_ipt::I2CResult::Success) {
+        return;
+    }
+    for (uint8_t axis = 0; axis < 3; ++axis) {
+        g_gyro_offsets.offsets[axis] = g_gyro_offsets.pending[axis];
+    }
+}
+
+/**
+ * Feeds the given packet to the bias tracker, and corrects the MPU's gyro
+ * offsets by each new bias estimate.
+ *
+ * The offsets are written through the I2C engine, so the main loop carries
+ * on while they are sent, and are only taken as the MPU's offsets once the
+ * write has succeeded. An estimate is dropped if the previous write is still
+ * in progress.
+ */
+void refine_gyro_offsets(const subsonic_ipt::DeviceMotion& device_motion)
+{
+    if (!g_gyro_bias.update(device_motion.gyro, device_motion.real_accel)) {
+        return;
+    }
+    auto& writer = g_gyro_offsets;
+    if (writer.write.result == subsonic_ipt::I2CResult::Pending) {
+        return;
+    }
+    const int16_t* const correction = g_gyro_bias.correction();
+    if (correction[0] == 0 && correction[1] == 0 && correction[2] == 0) {
+        return;
+    }
+
+    writer.bytes[0] = MPU6050_RA_XG_OFFS_USRH;
+    for (uint8_t axis = 0; axis < 3; ++axis) {
+        const auto offset = static_cast<int16_t>(writer.offsets[axis] - correction[axis]);
+        writer.pending[axis] = offset;
+        writer.bytes[1 + 2 * axis] = static_cast<uint8_t>(static_cast<uint16_t>(offset) >> 8u);
+        writer.bytes[2 + 2 * axis] = static_cast<uint8_t>(offset);
+    }
+    // If the queue is full, this estimate is dropped like one made while the
+    // previous write is in progress.
+    (void) subsonic_ipt::i2c_submit(writer.write);
+}
+#endif
+
+/**
+ * Loads the given offsets into the MPU.
+ */
+void apply_calibration(const subsonic_ipt::MpuCalibration& calibration)
+{
+    g_mpu.setXAccelOffset(calibration.accel_offsets[0]);
+    g_mpu.setYAccelOffset(calibration.accel_offsets[1]);
+    g_mpu.setZAccelOffset(calibration.accel_offsets[2]);
+    g_mpu.setXGyroOffset(calibration.gyro_offsets[0]);
+    g_mpu.setYGyroOffset(calibration.gyro_offsets[1]);
+    g_mpu.setZGyroOffset(calibration.gyro_offsets[2]);
 }
 
 /**
- * Read the world-frame acceleration and yaw-pitch-roll orientation of the
- * device from the given MPU fifo buffer.
+ * Returns the MPU's current offsets, stamped with its temperature and the
+ * given boot number.
  */
-void compute_device_motion(subsonic_ipt::DeviceMotion& device_motion, const uint8_t* fifo_buffer)
+subsonic_ipt::MpuCalibration measure_calibration(uint16_t boot)
 {
-    // Orientation and motion data from the packet in the fifo buffer.
-    Quaternion device_quaternion;
+    return subsonic_ipt::MpuCalibration{
+        {g_mpu.getXAccelOffset(), g_mpu.getYAccelOffset(), g_mpu.getZAccelOffset()},
+        {g_mpu.getXGyroOffset(), g_mpu.getYGyroOffset(), g_mpu.getZGyroOffset()},
+        g_mpu.getTemperature(),
+        boot,
+    };
+}
 
-    // Populate the device_motion structure from the fifo buffer packet
-    g_mpu.dmpGetQuaternion(&device_quaternion, fifo_buffer);
-    g_mpu.dmpGetAccel(&device_motion.raw_accel, fifo_buffer);
-    g_mpu.dmpGetGravity(&device_motion.gravity, &device_quaternion);
-    g_mpu.dmpGetLinearAccel(&device_motion.real_accel, &device_motion.raw_accel, &device_motion.gravity);
-    g_mpu.dmpGetLinearAccelInWorld(&device_motion.world_accel, &device_motion.real_accel, &device_quaternion);
-    g_mpu.dmpGetYawPitchRoll(device_motion.ypr, &device_quaternion, &device_motion.gravity);
+/**
+ * Returns `true` if the MPU's raw readings with its current offsets are
+ * consistent with a device at rest, or nearly so.
+ *
+ * Unlike the offsets it corrects, gravity always has the same magnitude,
+ * whichever way the device is held. Offsets that have gone badly wrong skew
+ * the measured magnitude or show as a steady rotation.
+ */
+bool calibration_plausible()
+{
+    long accel_sum[3]{};
+    long gyro_sum[3]{};
+    for (uint8_t i = 0; i < CHECK_SAMPLES; ++i) {
+        int16_t accel[3];
+        int16_t gyro[3];
+        g_mpu.getMotion6(&accel[0], &accel[1], &accel[2], &gyro[0], &gyro[1], &gyro[2]);
+        for (uint8_t axis = 0; axis < 3; ++axis) {
+            accel_sum[axis] += accel[axis];
+            gyro_sum[axis] += gyro[axis];
+        }
+        delay(1);
+    }
+
+    // The DMP firmware configures the 2 g range, where 1 g is 16384.
+    float magnitude_squared = 0;
+    for (uint8_t axis = 0; axis < 3; ++axis) {
+        const float mean = static_cast<float>(accel_sum[axis]) / CHECK_SAMPLES;
+        magnitude_squared += mean * mean;
+        const long gyro_mean = gyro_sum[axis] / CHECK_SAMPLES;
+        if (gyro_mean > CHECK_GYRO_TOLERANCE || gyro_mean < -CHECK_GYRO_TOLERANCE) {
+            return false;
+        }
+    }
+    constexpr float MIN_MAGNITUDE = 16384 - CHECK_ACCEL_TOLERANCE;
+    constexpr float MAX_MAGNITUDE = 16384 + CHECK_ACCEL_TOLERANCE;
+    return MIN_MAGNITUDE * MIN_MAGNITUDE <= magnitude_squared && magnitude_squared <= MAX_MAGNITUDE * MAX_MAGNITUDE;
 }
 
 } // namespace
@@ -89,12 +829,9 @@ void compute_device_motion(subsonic_ipt::DeviceMotion& device_motion, const uint
 \******************************************************************************/
 namespace subsonic_ipt {
 
-uint8_t setup_mpu()
+void begin_dmp_load()
 {
-    // Initialize device
-    Serial.println("Initializing I2C devices...");
-
-    g_mpu.initialize();
+    i2c_wait_idle();
     pinMode(INTERRUPT_PIN, INPUT);
 
     // Verify connection
@@ -103,14 +840,118 @@ uint8_t setup_mpu()
 
     // Load and configure the DMP
     Serial.println("Initializing DMP...");
-    g_mpu_control.dev_status = g_mpu.dmpInitialize();
+    auto& loader = g_dmp_loader;
+    loader.state = DmpLoadState::Resetting;
+    loader.step = ChunkStep::SelectBank;
+    loader.position = 0;
+    loader.image_crc = 0xFFFF;
+    loader.failures = 0;
+    g_mpu.reset();
+    wait_for_mpu(DEVICE_RESET_U);
+}
+
+DmpLoadState service_dmp_load()
+{
+    i2c_poll();
+    auto& loader = g_dmp_loader;
+    const auto now_u = micros();
+    if (loader.transaction.result == I2CResult::Pending || now_u - loader.wait_start_u < loader.wait_u) {
+        return loader.state;
+    }
+    loader.wait_u = 0;
+    if (loader.transaction.result != I2CResult::Success) {
+        loader.state = DmpLoadState::Failed;
+    }
+
+    switch (loader.state) {
+        case DmpLoadState::Resetting: {
+            i2c_wait_idle();
+            g_mpu.setSleepEnabled(false);
+            // Set up the auxiliary I2C master as i2cdevlib does
+            g_mpu.setSlaveAddress(0, 0x7F);
+            g_mpu.setI2CMasterModeEnabled(false);
+            g_mpu.setSlaveAddress(0, 0x68);
+            g_mpu.resetI2CMaster();
+            loader.state = DmpLoadState::Configuring;
+            wait_for_mpu(MASTER_RESET_U);
+            break;
+        }
+        case DmpLoadState::Configuring: {
+            configure_dmp_sampling();
+            loader.state = DmpLoadState::Uploading;
+            break;
+        }
+        case DmpLoadState::Uploading:
+        case DmpLoadState::Verifying: {
+            step_dmp_chunk();
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+    return loader.state;
+}
+
+uint8_t dmp_load_percent()
+{
+    const auto& loader = g_dmp_loader;
+    constexpr uint32_t TOTAL = MPU6050_DMP_CODE_SIZE * (SUBSONIC_DMP_VERIFY == 2 ? 2u : 1u);
+    switch (loader.state) {
+        case DmpLoadState::Uploading: {
+            return static_cast<uint8_t>(100u * loader.position / TOTAL);
+        }
+        case DmpLoadState::Verifying: {
+            return static_cast<uint8_t>(100u * (MPU6050_DMP_CODE_SIZE + loader.position) / TOTAL);
+        }
+        case DmpLoadState::Done: {
+            return 100;
+        }
+        default: {
+            return 0;
+        }
+    }
+}
+
+uint8_t setup_mpu(bool recalibrate, void prepare_calibration())
+{
+    i2c_wait_idle();
+
+    // 1 = initial memory load failed
+    g_mpu_control.dev_status = g_dmp_loader.state == DmpLoadState::Done ? 0 : 1;
 
     // make sure it worked (returns 0 if so)
     if (g_mpu_control.dev_status == 0) {
-        // Calibration Time: generate offsets and calibrate our MPU6050
-        g_mpu.CalibrateAccel(CALIBRATION_LOOPS);
-        g_mpu.CalibrateGyro(CALIBRATION_LOOPS);
+        // Use the stored offsets if they still apply
+        const uint16_t boot = count_boot();
+        MpuCalibration calibration{};
+        auto status = CalibrationStatus::Missing;
+        if (!recalibrate) {
+            status = load_calibration(calibration, boot, g_mpu.getTemperature());
+            Serial.print("Stored calibration: ");
+            Serial.println(calibration_status_name(status));
+        }
+        if (status == CalibrationStatus::Valid) {
+            apply_calibration(calibration);
+            if (!calibration_plausible()) {
+                Serial.println("Stored calibration rejected by sanity check");
+                status = CalibrationStatus::Missing;
+            }
+        }
+
+        if (status != CalibrationStatus::Valid) {
+            prepare_calibration();
+            // Calibration Time: generate offsets and calibrate our MPU6050
+            g_mpu.CalibrateAccel(CALIBRATION_LOOPS);
+            g_mpu.CalibrateGyro(CALIBRATION_LOOPS);
+            store_calibration(measure_calibration(boot));
+        }
         g_mpu.PrintActiveOffsets();
+#if SUBSONIC_GYRO_BIAS_TRACKING
+        g_gyro_offsets.offsets[0] = g_mpu.getXGyroOffset();
+        g_gyro_offsets.offsets[1] = g_mpu.getYGyroOffset();
+        g_gyro_offsets.offsets[2] = g_mpu.getZGyroOffset();
+#endif
 
         // turn on the DMP, now that it's ready
         Serial.println("Enabling DMP...");
@@ -128,7 +969,9 @@ uint8_t setup_mpu()
         g_mpu_control.dmp_ready = true;
 
         // get expected DMP packet size for later comparison
-        g_mpu_control.packet_size = g_mpu.dmpGetFIFOPacketSize();
+        g_mpu_control.packet_size = DMP_PACKET_SIZE;
+        g_mpu_control.packet_period_u = 1000000UL / GYRO_OUTPUT_RATE_HZ
+            * (1 + g_mpu.getRate()) * (1 + MPU6050_DMP_FIFO_RATE_DIVISOR);
     } else {
         // ERROR!
         // 1 = initial memory load failed
@@ -142,59 +985,106 @@ uint8_t setup_mpu()
     return g_mpu_control.dev_status;
 }
 
-void run_mpu_loop(
-    void waiting_callback(),
-    void update_state(const DeviceMotion&)
-)
+bool service_mpu(void update_state(const DeviceMotion&))
 {
-    // If programming failed, don't try to do anything
-    if (!g_mpu_control.dmp_ready) { return; }
+    SUBSONIC_PROFILE_SCOPE(profiler::Probe::ServiceMpu);
 
-    // Wait for MPU interrupt or extra packet(s) available
-    do {
-        if (g_mpu_interrupt && g_mpu_control.fifo_count < g_mpu_control.packet_size) {
-            // Try to get out of the infinite loop
-            g_mpu_control.fifo_count = g_mpu.getFIFOCount();
-        }
-        waiting_callback();
-    } while (!g_mpu_interrupt && g_mpu_control.fifo_count < g_mpu_control.packet_size);
+    // If programming failed, don't try to do anything, but keep completing
+    // transactions for the other devices on the bus
+    if (!g_mpu_control.dmp_ready) {
+        i2c_poll();
+        return false;
+    }
 
-    // Reset interrupt flag and get INT_STATUS byte
-    g_mpu_interrupt = false;
-    g_mpu_control.mpu_int_status = g_mpu.getIntStatus();
+    // Packets are read from the FIFO in the background
+    if (!g_motion_events.empty() && !g_fifo_reader.busy) {
+        start_fifo_read();
+    }
+    i2c_poll();
+    if (g_packet_ring.empty() && !g_fifo_reader.overflow) {
+        return false;
+    }
 
-    // get current FIFO count
-    g_mpu_control.fifo_count = g_mpu.getFIFOCount();
-    if (g_mpu_control.fifo_count < g_mpu_control.packet_size) {
-        // Lets go back and wait for another interrupt. We shouldn't be here, we got an interrupt from another event
-        // This is blocking so don't do it   while (fifoCount < packetSize) fifoCount = mpu.getFIFOCount();
+    // Send the acceleration and orientation data from each packet to the
+    // `update_state` callback.
+    while (!g_packet_ring.empty()) {
+        const DmpPacket& packet = g_packet_ring.front();
+#if !SUBSONIC_MPU_BATCH
+        // Only the newest packet of each FIFO count is used
+        if (packet.batch_remaining == 0)
+#endif
+        {
+            DeviceMotion device_motion;
+            decode_device_motion(device_motion, packet.view(), g_motion_fields);
+#if SUBSONIC_GYRO_BIAS_TRACKING
+            refine_gyro_offsets(device_motion);
+#endif
+            device_motion.timestamp_u = packet.timestamp_u;
+            device_motion.batch_remaining = packet.batch_remaining;
+            update_state(device_motion);
+        }
+        g_packet_ring.pop();
     }
-        // check for overflow (this should never happen unless our code is too inefficient)
-    else if ((g_mpu_control.mpu_int_status & _BV(MPU6050_INTERRUPT_FIFO_OFLOW_BIT))
-        || g_mpu_control.fifo_count >= 1024) {
+    // Continue reading if the ring or the I2C queue filled up
+    if (g_fifo_reader.stalled) {
+        read_next_packet();
+    }
+
+    if (g_fifo_reader.overflow) {
+        g_fifo_reader.overflow = false;
         // reset so we can continue cleanly
+        i2c_wait_idle();
         g_mpu.resetFIFO();
-        //  fifoCount = mpu.getFIFOCount();  // will be zero after reset no need to ask
         Serial.println(F("FIFO overflow!"));
+    }
+    return true;
+}
 
-        // otherwise, check for DMP data ready interrupt (this should happen frequently)
-    } else if (g_mpu_control.mpu_int_status & _BV(MPU6050_INTERRUPT_DMP_INT_BIT)) {
-
-        // Read a packet from FIFO
-        while (g_mpu_control.fifo_count >= g_mpu_control.packet_size) {
-            // Lets catch up to NOW, someone is using the dreaded delay()!
-            g_mpu.getFIFOBytes(g_mpu_control.fifo_buffer, g_mpu_control.packet_size);
-            // track FIFO count here in case there is > 1 packet available
-            // (this lets us immediately read more without waiting for an interrupt)
-            g_mpu_control.fifo_count -= g_mpu_control.packet_size;
-        }
+void decode_device_motion(DeviceMotion& device_motion, DmpPacketView packet, MotionField fields)
+{
+    SUBSONIC_PROFILE_SCOPE(profiler::Probe::DecodeMotion);
 
-        // Send the acceleration and orientation data to the `update_state`
-        // callback.
-        DeviceMotion device_motion;
-        compute_device_motion(device_motion, g_mpu_control.fifo_buffer);
-        update_state(device_motion);
+    LazyMotion decoder(device_motion, packet);
+    if (fields & MotionYaw) {
+        decoder.yaw();
+    }
+    if (fields & MotionTilt) {
+        decoder.tilt();
+    }
+    if (fields & MotionGravity) {
+        decoder.gravity();
+    }
+    if (fields & MotionRawAccel) {
+        decoder.raw_accel();
     }
+    if (fields & MotionRealAccel) {
+        decoder.real_accel();
+    }
+    if (fields & MotionWorldAccel) {
+        decoder.world_accel();
+    }
+    if (fields & MotionGyro) {
+        decoder.gyro();
+    }
+}
+
+void set_motion_fields(MotionField fields)
+{
+#if SUBSONIC_GYRO_BIAS_TRACKING
+    // The bias is measured from the gyro rates while the device is still.
+    fields = static_cast<MotionField>(fields | MotionGyro | MotionRealAccel);
+#endif
+    g_motion_fields = fields;
+}
+
+bool mpu_capture_interrupt(unsigned long capture_u) noexcept
+{
+    return g_motion_events.push({capture_u});
+}
+
+uint16_t mpu_fifo_count()
+{
+    return g_mpu_control.fifo_count;
 }
 
 }
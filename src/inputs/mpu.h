@@ -16,18 +16,89 @@
 #include "../vendor/i2cdevlib/helper_3dmath.h"
 #include "../vendor/i2cdevlib/MPU6050.h"
 
+#include "dmp_packet.h"
+
+// When nonzero, every packet drained from the MPU's FIFO is decoded and
+// passed to `update_state` with its own nominal timestamp. Otherwise only the
+// newest packet of each drain is used.
+#ifndef SUBSONIC_MPU_BATCH
+#define SUBSONIC_MPU_BATCH 1
+#endif
+
+// The number of packets read from the MPU's FIFO ahead of decoding. Each
+// packet occupies 48 bytes of RAM.
+#ifndef SUBSONIC_MPU_PACKET_RING
+#define SUBSONIC_MPU_PACKET_RING 4
+#endif
+
+// The number of MPU interrupts that may be waiting for the main loop. Must be
+// a power of two. Each interrupt occupies 4 bytes of RAM.
+#ifndef SUBSONIC_MPU_EVENT_RING
+#define SUBSONIC_MPU_EVENT_RING 8
+#endif
+
+// How the DMP firmware is checked once it has been written to the MPU. 0
+// skips the check, 1 reads back and compares each chunk as it is written
+// (as i2cdevlib does), and 2 reads the whole image back once and compares
+// its CRC. A chunk or image that does not match is written again, a few
+// times at most.
+#ifndef SUBSONIC_DMP_VERIFY
+#define SUBSONIC_DMP_VERIFY 2
+#endif
+
 namespace subsonic_ipt {
 
+/**
+ * The stages of loading the DMP firmware onto the MPU.
+ */
+enum class DmpLoadState : uint8_t {
+    /// Waiting for the MPU to restart after being reset.
+    Resetting,
+    /// Setting up the MPU's clock, sample rate and filters.
+    Configuring,
+    /// Writing the firmware image into the MPU's memory banks.
+    Uploading,
+    /// Reading the firmware image back.
+    Verifying,
+    /// The firmware is loaded and `setup_mpu` may be called.
+    Done,
+    /// The firmware could not be written, or still did not read back
+    /// correctly after being written again.
+    Failed,
+};
+
+/**
+ * The fields of `DeviceMotion` that can be decoded from a DMP packet.
+ */
+enum MotionField : uint8_t {
+    MotionNone = 0,
+    /// `yaw`, from the quaternion alone.
+    MotionYaw = 1u << 0u,
+    /// `pitch` and `roll`, from the gravity vector.
+    MotionTilt = 1u << 1u,
+    MotionGravity = 1u << 2u,
+    MotionRawAccel = 1u << 3u,
+    MotionRealAccel = 1u << 4u,
+    MotionWorldAccel = 1u << 5u,
+    MotionGyro = 1u << 6u,
+    MotionAll = 0x7Fu,
+};
+
 /**
  * Structure containing the world-frame acceleration and
  * yaw-pitch-roll orientation of the device from a single MPU
  * packet.
+ *
+ * Only the fields in `fields` were decoded. The others are zero.
  */
 struct DeviceMotion {
     VectorInt16 world_accel{};
     VectorInt16 real_accel{};
     VectorInt16 raw_accel{};
-    VectorFloat gravity{};
+    /// The direction of gravity in the device frame, in units of 1/8192 g.
+    VectorInt16 gravity{};
+    /// The rotation rate about each device axis, in units of 1/16.4 deg/s.
+    VectorInt16 gyro{};
     union {
         struct {
             float yaw{};
@@ -36,29 +107,108 @@ struct DeviceMotion {
         };
         float ypr[3];
     };
+    /// The time in microseconds since startup when the packet was sampled,
+    /// derived from the time its interrupt was captured.
+    unsigned long timestamp_u{};
+    /// The number of packets from the same drain still to be delivered.
+    uint8_t batch_remaining{};
+    /// The fields that were decoded from the packet.
+    MotionField fields{};
 };
 
+/**
+ * Resets the MPU and starts loading the DMP firmware onto it.
+ *
+ * The load is carried out by `service_dmp_load`. `i2c_begin` must be called
+ * first.
+ */
+void begin_dmp_load();
+
+/**
+ * Advances the DMP firmware load started by `begin_dmp_load` by one short
+ * step, and returns the load's state afterwards.
+ *
+ * The firmware is sent through the asynchronous I2C engine and the MPU's
+ * restarts are waited out without blocking, so a call never takes longer
+ * than a few register accesses. Other startup work, such as updating the
+ * LCD, may be done between calls. Should be called repeatedly until the load
+ * is `Done` or has `Failed`.
+ */
+DmpLoadState service_dmp_load();
+
 [[nodiscard]]
 /**
- * Configures the MPU for DMP over I2C..
+ * Returns how far the DMP firmware load has progressed, from 0 to 100.
+ */
+uint8_t dmp_load_percent();
+
+[[nodiscard]]
+/**
+ * Completes the MPU's setup once the DMP firmware load has finished.
+ *
+ * The offsets stored in EEPROM by an earlier calibration are used if they
+ * are still valid and give plausible readings. Otherwise, or if `recalibrate`
+ * is `true`, the `prepare_calibration` function is called so that the user
+ * can hold the device still, and then the offsets are measured and stored.
+ *
+ * Returns the device status from the DMP library, with 0 indicating success
+ * and 1 indicating that the firmware failed to load.
+ */
+uint8_t setup_mpu(bool recalibrate, void prepare_calibration());
+
+/**
+ * Services the MPU once, without waiting for it.
+ *
+ * Packets are read from the MPU over the asynchronous I2C engine between
+ * calls, so `i2c_begin` must be called during setup.
+ *
+ * The `update_state` function will be executed once for each packet read from
+ * the MPU since the last call, oldest first. Packets drained together are
+ * given nominal timestamps spaced at the DMP's output rate and ending at the
+ * time they were counted. Without SUBSONIC_MPU_BATCH, only the newest packet
+ * is delivered.
  *
- * Returns the device status from the DMP library, with 0 indicating success.
+ * Returns `true` if any packets were read since the last call.
  */
-uint8_t setup_mpu();
+bool service_mpu(void update_state(const DeviceMotion& world_accel));
 
 /**
- * Arduino loop body function for handling data from the MPU.
+ * Decodes the given fields of the device's motion from a DMP packet.
  *
- * The `waiting_callback` function will be executed repeatedly while waiting
- * for sufficient data to be produced by the MPU.
+ * Fields that the requested ones are derived from, such as the gravity
+ * vector for the tilt, are decoded as well, and `fields` is set to every
+ * field decoded. The other fields of `device_motion` are left untouched.
+ */
+void decode_device_motion(DeviceMotion& device_motion, DmpPacketView packet, MotionField fields);
+
+/**
+ * Selects the fields of `DeviceMotion` that `service_mpu` decodes from each
+ * packet. All fields are decoded by default.
  *
- * The `update_position` function will be executed each time a packet is read
- * from the MPU.
+ * The floating point math for the other fields is skipped, and each value
+ * shared by several fields is computed once. Fields needed internally, such
+ * as those used to track the gyro bias, are decoded regardless.
+ */
+void set_motion_fields(MotionField fields);
+
+/**
+ * Records an MPU interrupt captured at the given time, in microseconds since
+ * startup, for `service_mpu` to service.
  *
- * Note that this function does not internally loop and must be called
- * repeatedly by the Arduino `loop` function.
+ * Called from the MPU's interrupt handler. May instead be called by a single
+ * thread standing in for the sensor, concurrently with `service_mpu`.
+ *
+ * Returns `false` if too many interrupts are already waiting, in which case
+ * the packets will still be read after the next interrupt.
+ */
+bool mpu_capture_interrupt(unsigned long capture_u) noexcept;
+
+[[nodiscard]]
+/**
+ * Returns the number of bytes that the MPU's FIFO held when it was last
+ * counted.
  */
-void run_mpu_loop(void waiting_callback(), void update_state(const DeviceMotion& world_accel));
+uint16_t mpu_fifo_count();
 
 } // namespace subsonic_ipt
 #endif //SUBSONIC_IPT_MPU_H
@@ -0,0 +1,133 @@
+/**
+ * mpu_calibration.cpp - Implementation for calibration storage.
+ *
+ * The EEPROM holds the boot counter, followed by the version of the
+ * calibration layout, the calibration itself and a CRC of the version and
+ * calibration.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include <avr/eeprom.h>
+
+#include "mpu_calibration.h"
+#include "../crc16.h"
+
+/******************************************************************************\
+ * Internal definitions
+\******************************************************************************/
+namespace {
+using namespace subsonic_ipt;
+
+/**
+ * The version of the stored layout. Must be incremented whenever
+ * `MpuCalibration` changes.
+ */
+constexpr uint8_t CALIBRATION_VERSION{1};
+
+/// The number of TEMP_OUT units per degree Celsius.
+constexpr int16_t TEMPERATURE_LSB_PER_C{340};
+
+static_assert(
+    SUBSONIC_CALIBRATION_EEPROM_ADDRESS + CALIBRATION_EEPROM_SIZE <= E2END + 1,
+    "calibration must fit in EEPROM"
+);
+
+/**
+ * Returns a pointer to the given offset from the start of the calibration
+ * storage, in the EEPROM address space.
+ */
+inline uint8_t* eeprom_address(uint8_t offset) noexcept
+{
+    return reinterpret_cast<uint8_t*>(SUBSONIC_CALIBRATION_EEPROM_ADDRESS + offset);
+}
+
+uint16_t* const BOOT_ADDRESS = reinterpret_cast<uint16_t*>(eeprom_address(0));
+uint8_t* const VERSION_ADDRESS = eeprom_address(2);
+uint8_t* const CALIBRATION_ADDRESS = eeprom_address(3);
+uint16_t* const CRC_ADDRESS = reinterpret_cast<uint16_t*>(eeprom_address(3 + sizeof(MpuCalibration)));
+
+/**
+ * Returns the CRC stored alongside the given calibration.
+ */
+uint16_t calibration_crc(const MpuCalibration& calibration) noexcept
+{
+    const uint16_t crc = crc16(&CALIBRATION_VERSION, 1);
+    return crc16(reinterpret_cast<const uint8_t*>(&calibration), sizeof(calibration), crc);
+}
+
+} // namespace
+
+/******************************************************************************\
+ * Public definitions
+\******************************************************************************/
+namespace subsonic_ipt {
+
+uint16_t count_boot()
+{
+    // An erased EEPROM reads as 0xFFFF, so the first boot is boot 0.
+    const auto boot = static_cast<uint16_t>(eeprom_read_word(BOOT_ADDRESS) + 1);
+    eeprom_update_word(BOOT_ADDRESS, boot);
+    return boot;
+}
+
+CalibrationStatus load_calibration(MpuCalibration& calibration, uint16_t boot, int16_t temperature_raw)
+{
+    if (eeprom_read_byte(VERSION_ADDRESS) != CALIBRATION_VERSION) {
+        return CalibrationStatus::Missing;
+    }
+    MpuCalibration stored;
+    eeprom_read_block(&stored, CALIBRATION_ADDRESS, sizeof(stored));
+    if (eeprom_read_word(CRC_ADDRESS) != calibration_crc(stored)) {
+        return CalibrationStatus::Missing;
+    }
+    calibration = stored;
+
+    // Boot numbers wrap, so only their difference is meaningful.
+    if (static_cast<uint16_t>(boot - stored.boot) > SUBSONIC_CALIBRATION_MAX_BOOTS) {
+        return CalibrationStatus::Expired;
+    }
+    const long drift = static_cast<long>(temperature_raw) - stored.temperature_raw;
+    constexpr long MAX_DRIFT = static_cast<long>(SUBSONIC_CALIBRATION_MAX_DRIFT_C) * TEMPERATURE_LSB_PER_C;
+    if (drift > MAX_DRIFT || drift < -MAX_DRIFT) {
+        return CalibrationStatus::TemperatureDrift;
+    }
+    return CalibrationStatus::Valid;
+}
+
+void store_calibration(const MpuCalibration& calibration)
+{
+    // Invalidate the old calibration first, so that a reset partway through
+    // never leaves a mix of the two behind a valid CRC.
+    eeprom_update_byte(VERSION_ADDRESS, 0xFF);
+    eeprom_update_block(&calibration, CALIBRATION_ADDRESS, sizeof(calibration));
+    eeprom_update_word(CRC_ADDRESS, calibration_crc(calibration));
+    eeprom_update_byte(VERSION_ADDRESS, CALIBRATION_VERSION);
+}
+
+const char* calibration_status_name(CalibrationStatus status) noexcept
+{
+    switch (status) {
+        case CalibrationStatus::Valid: {
+            return "valid";
+        }
+        case CalibrationStatus::Missing: {
+            return "missing";
+        }
+        case CalibrationStatus::Expired: {
+            return "expired";
+        }
+        case CalibrationStatus::TemperatureDrift: {
+            return "temperature drift";
+        }
+        default: {
+            return "unknown";
+        }
+    }
+}
+
+} // namespace subsonic_ipt
@@ -0,0 +1,100 @@
+/**
+ * mpu_calibration.h - Storage of the MPU's calibrated offsets in EEPROM.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_MPU_CALIBRATION_H
+#define SUBSONIC_IPT_MPU_CALIBRATION_H
+
+#include <stdint.h>
+
+// The EEPROM address of the stored calibration, which occupies
+// `CALIBRATION_EEPROM_SIZE` bytes.
+#ifndef SUBSONIC_CALIBRATION_EEPROM_ADDRESS
+#define SUBSONIC_CALIBRATION_EEPROM_ADDRESS 0
+#endif
+
+// The number of boots after which a stored calibration is measured again.
+#ifndef SUBSONIC_CALIBRATION_MAX_BOOTS
+#define SUBSONIC_CALIBRATION_MAX_BOOTS 100
+#endif
+
+// The change in the MPU's die temperature, in degrees Celsius, beyond which
+// a stored calibration is measured again. The MPU's offsets drift with
+// temperature.
+#ifndef SUBSONIC_CALIBRATION_MAX_DRIFT_C
+#define SUBSONIC_CALIBRATION_MAX_DRIFT_C 10
+#endif
+
+namespace subsonic_ipt {
+
+/**
+ * The MPU's accelerometer and gyroscope offsets, as found by calibration.
+ */
+struct MpuCalibration {
+    /// The values of the XA/YA/ZA_OFFS registers.
+    int16_t accel_offsets[3];
+    /// The values of the XG/YG/ZG_OFFS_USR registers.
+    int16_t gyro_offsets[3];
+    /// The MPU's die temperature when calibrated, in TEMP_OUT units.
+    int16_t temperature_raw;
+    /// The boot number when calibrated.
+    uint16_t boot;
+};
+
+/**
+ * The outcome of loading a stored calibration.
+ */
+enum class CalibrationStatus : uint8_t {
+    /// The stored calibration may be used.
+    Valid,
+    /// No calibration is stored, or it was written by an incompatible
+    /// version of the sketch or corrupted.
+    Missing,
+    /// The calibration was stored too many boots ago.
+    Expired,
+    /// The MPU's temperature has changed too much since calibration.
+    TemperatureDrift,
+};
+
+/**
+ * The number of EEPROM bytes used by the boot counter and stored calibration.
+ */
+constexpr uint8_t CALIBRATION_EEPROM_SIZE{2 + 1 + sizeof(MpuCalibration) + 2};
+
+/**
+ * Increments the boot counter kept in EEPROM and returns the new boot number.
+ *
+ * Should be called once per boot, before loading the calibration.
+ */
+uint16_t count_boot();
+
+[[nodiscard]]
+/**
+ * Loads the stored calibration into `calibration` and checks that it is
+ * still usable for the given boot number and current MPU temperature.
+ *
+ * `calibration` is only filled in if the stored calibration is intact,
+ * i.e. if the result is not `CalibrationStatus::Missing`.
+ */
+CalibrationStatus load_calibration(MpuCalibration& calibration, uint16_t boot, int16_t temperature_raw);
+
+/**
+ * Stores the given calibration, replacing any previous one.
+ */
+void store_calibration(const MpuCalibration& calibration);
+
+[[nodiscard]]
+/**
+ * Returns a short description of the given calibration status.
+ */
+const char* calibration_status_name(CalibrationStatus status) noexcept;
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_MPU_CALIBRATION_H
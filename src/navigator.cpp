@@ -9,25 +9,24 @@
  */
 
 #include "navigator.h"
+#include "profiler.h"
 
 namespace subsonic_ipt {
 
-Point Navigator::compute_direction(const Point pos, const Angle facing) const
+template<typename T>
+BasicPoint<T> BasicNavigator<T>::compute_direction(const Point pos, const Rotation& facing) const
 {
+    SUBSONIC_PROFILE_SCOPE(profiler::Probe::ComputeDirection);
+
     // Compute the difference vector between the current position and
     // the destination.
-    Point displacement = current_destination() - pos;
-    // Compute the true direction that the device must travel relative
-    // to the direction it is currently facing.
-    Angle direction = displacement.angle() - facing;
-
-    // Compute the true displacement vector that the device must travel
-    // along relative to the direction it is currently facing.
-    if (direction.is_nan()) {
-        return {0, 0};
-    } else {
-        return displacement.norm() * Point::unit_from_angle(direction);
-    }
+    const Point displacement = current_destination() - pos;
+    // Rotate the displacement into the frame of the direction the device
+    // is currently facing.
+    return facing.rotate_inverse(displacement);
 }
 
+template class BasicNavigator<double>;
+template class BasicNavigator<Fixed>;
+
 } // namespace subsonic_ipt
@@ -21,8 +21,15 @@ namespace subsonic_ipt {
 /**
  * A Navigator that provides directions to one of several target destinations
  * by maintaining a current position and direction facing.
+ *
+ * Generic over the scalar type used for positions and angles. Explicit
+ * instantiations for `double` and `Fixed` are provided in navigator.cpp.
  */
-class Navigator {
+template<typename T>
+class BasicNavigator {
+    using Point = BasicPoint<T>;
+    using Angle = BasicAngle<T>;
+    using Rotation = BasicRotation<T>;
 
     /// The number of destinations that a Navigator should store.
     static inline constexpr size_t DESTINATION_COUNT{4};
@@ -34,7 +41,7 @@ class Navigator {
     size_t m_current_dest{0};
 
   public:
-    Navigator() = default;
+    BasicNavigator() = default;
 
     [[nodiscard]]
     constexpr size_t destination_count() const  {
@@ -45,8 +52,11 @@ class Navigator {
     /**
      * Computes the vector relative to this navigator's current position
      * and direction facing that leads to this navigator's target destination.
+     *
+     * The direction facing is given as a rotation so that its sine and
+     * cosine can be computed once and shared between callers.
      */
-    Point compute_direction(const Point pos, const Angle facing) const;
+    Point compute_direction(const Point pos, const Rotation& facing) const;
 
     [[nodiscard]]
     /**
@@ -91,6 +101,12 @@ class Navigator {
     }
 };
 
+extern template class BasicNavigator<double>;
+extern template class BasicNavigator<Fixed>;
+
+/// Navigator using the scalar type selected for this sketch.
+using Navigator = BasicNavigator<Scalar>;
+
 } // namespace subsonic_ipt
 
 #endif //SUBSONIC_IPT_NAVIGATOR_H
@@ -12,20 +12,72 @@
 #define SUBSONIC_IPT_POINT_H
 #include <math.h> // cmath not available
 
+#include "binary_angle.h"
+#include "fast_trig.h"
+#include "scalar.h"
+
 namespace subsonic_ipt {
 
+/**
+ * Returns the euclidean norm of the vector (x, y).
+ *
+ * The fixed-point overload is provided by `Fixed`.
+ */
+inline double vector_norm(double x, double y)
+{
+    return sqrt(x * x + y * y);
+}
+
+/**
+ * Returns the angle between the vector (x, y) and the +x axis, or NaN for
+ * the zero vector.
+ *
+ * The fixed-point overload is provided by `Fixed`.
+ */
+inline double vector_angle(double x, double y)
+{
+    if constexpr (fast_trig::TRIG_ACCURACY != fast_trig::TrigAccuracy::Library) {
+        if (x == 0 && y == 0) {
+            return NAN;
+        }
+        const double angle = fast_trig::atan2(y, x);
+        return angle < 0 ? angle + 2 * M_PI : angle;
+    }
+
+    if (x == 0) {
+        if (y == 0) {
+            return NAN;
+        }
+        return y > 0 ? M_PI / 2 : M_PI * 3.0 / 2.0;
+    }
+
+    double offset = atan(y / x);
+
+    if (x > 0 && y > 0) {
+        // This point is in Q1.
+        return offset;
+    } else if (x < 0) {
+        // This point is in Q2 or Q3.
+        return offset + M_PI;
+    } else {
+        // This point is in Q4.
+        return offset + 2 * M_PI;
+    }
+}
+
 /**
  * A POD angle in two-dimensional space.
  */
-struct Angle {
+template<typename T>
+struct BasicAngle {
     /// This angle expressed in radians.
-    double m_rad;
+    T m_rad;
 
     [[nodiscard]]
     /// Returns this angle expressed in degrees.
-    double deg() const noexcept
+    T deg() const noexcept
     {
-        return m_rad * 180.0 / M_PI;
+        return m_rad * T{180.0 / M_PI};
     }
 
     [[nodiscard]]
@@ -38,11 +90,11 @@ struct Angle {
     /**
      * Normalizes this angles value to a radian on the interval [0, 2pi).
      */
-    Angle& normalize()
+    BasicAngle& normalize()
     {
-        m_rad = fmod(m_rad, 2 * M_PI);
+        m_rad = fmod(m_rad, T{2 * M_PI});
         if (m_rad < 0) {
-            m_rad += 2 * M_PI;
+            m_rad += T{2 * M_PI};
         }
         return *this;
     }
@@ -51,8 +103,8 @@ struct Angle {
     /**
      * Returns the conjugate of this angle.
      */
-    Angle conjugate() const {
-        auto conj = Angle{-m_rad};
+    BasicAngle conjugate() const {
+        auto conj = BasicAngle{-m_rad};
         conj.normalize();
         return conj;
     }
@@ -61,32 +113,53 @@ struct Angle {
     /**
      * Constructs an angle with the given value in degrees.
      */
-    static Angle from_degrees(double degrees)
+    static BasicAngle from_degrees(double degrees)
     {
-        return Angle{degrees * M_PI / 180}.normalize();
+        return BasicAngle{T{degrees * M_PI / 180}}.normalize();
     }
 
-    friend Angle operator+(Angle first, Angle second)
+    [[nodiscard]]
+    /**
+     * Returns the binary angle nearest to this angle.
+     *
+     * NaN maps to a zero angle, so callers that care must check `is_nan`
+     * first.
+     */
+    BinaryAngle binary() const noexcept
     {
-        return Angle{first.m_rad + second.m_rad}.normalize();
+        return BinaryAngle::from_radians(m_rad);
     }
 
-    friend Angle operator-(Angle first, Angle second)
+    [[nodiscard]]
+    /**
+     * Constructs an angle on the interval [0, 2pi) from a binary angle.
+     */
+    static BasicAngle from_binary(BinaryAngle angle) noexcept
     {
-        return Angle{first.m_rad - second.m_rad}.normalize();
+        return {angle.radians<T>()};
     }
 
-    friend bool operator<(Angle first, Angle second)
+    friend BasicAngle operator+(BasicAngle first, BasicAngle second)
+    {
+        return BasicAngle{first.m_rad + second.m_rad}.normalize();
+    }
+
+    friend BasicAngle operator-(BasicAngle first, BasicAngle second)
+    {
+        return BasicAngle{first.m_rad - second.m_rad}.normalize();
+    }
+
+    friend bool operator<(BasicAngle first, BasicAngle second)
     {
         return first.m_rad < second.m_rad;
     }
 
-    friend bool operator>(Angle first, Angle second)
+    friend bool operator>(BasicAngle first, BasicAngle second)
     {
         return first.m_rad > second.m_rad;
     }
 
-    Angle operator-() const
+    BasicAngle operator-() const
     {
         return {-m_rad};
     }
@@ -95,26 +168,27 @@ struct Angle {
 /**
  * A POD representation of a point in two-dimensional space.
  */
-struct Point {
+template<typename T>
+struct BasicPoint {
 
     /// The horizontal displacement of this point.
-    double m_x;
+    T m_x;
 
     /// The vertical displacement of this point.
-    double m_y;
+    T m_y;
 
     [[nodiscard]]
     /// Returns the norm of the R2 vector associated with this point.
-    double norm() const
+    T norm() const
     {
-        return sqrt(m_x * m_x + m_y * m_y);
+        return vector_norm(m_x, m_y);
     }
 
     /**
      * Returns the euclidean distance between this point and the specified
      * point.
      */
-    double dist_to(Point other)
+    T dist_to(BasicPoint other)
     {
         return (*this - other).norm();
     }
@@ -124,63 +198,114 @@ struct Point {
      * Returns the angle between the vector associated with this point and
      * the +x axis.
      */
-    Angle angle() const
-    {
-        if (m_x == 0) {
-            if (m_y == 0) {
-                return {NAN};
-            }
-            return Angle{
-                (m_y > 0
-                    ? M_PI / 2
-                    : M_PI * 3.0 / 2.0
-                )
-            };
-        }
-
-        double offset = atan(m_y / m_x);
-
-        if (m_x > 0 && m_y > 0) {
-            // This point is in Q1.
-            return {offset};
-        } else if (m_x < 0) {
-            // This point is in Q2 or Q3.
-            return {offset + M_PI};
-        } else {
-            // This point is in Q4.
-            return {offset + 2 * M_PI};
-        }
+    BasicAngle<T> angle() const
+    {
+        return {vector_angle(m_x, m_y)};
     }
 
     /**
      * Constructs a point that corresponds to the unit vector with the given
      * angle between itself and the +x axis.
      */
-    static Point unit_from_angle(Angle angle)
+    static BasicPoint unit_from_angle(BasicAngle<T> angle)
     {
-        return {cos(angle.m_rad), sin(angle.m_rad)};
+        BasicPoint unit;
+        sin_cos(angle.m_rad, unit.m_y, unit.m_x);
+        return unit;
     }
 
-    friend Point operator+(Point first, Point second) noexcept
+    /**
+     * Constructs a point that corresponds to the unit vector with the given
+     * binary angle between itself and the +x axis.
+     */
+    static BasicPoint unit_from_angle(BinaryAngle angle)
+    {
+        BasicPoint unit;
+        sin_cos(angle, unit.m_y, unit.m_x);
+        return unit;
+    }
+
+    friend BasicPoint operator+(BasicPoint first, BasicPoint second) noexcept
     {
         return {first.m_x + second.m_x, first.m_y + second.m_y};
     }
 
-    friend Point operator-(Point first, Point second) noexcept
+    friend BasicPoint operator-(BasicPoint first, BasicPoint second) noexcept
     {
         return first + -second;
     }
 
-    friend Point operator*(double scalar, Point point) noexcept
+    friend BasicPoint operator*(T scalar, BasicPoint point) noexcept
     {
         return {scalar * point.m_x, scalar * point.m_y};
     }
 
-    Point operator-() const noexcept
+    BasicPoint operator-() const noexcept
     {
         return {-m_x, -m_y};
     }
 };
 
+/**
+ * A POD rotation in two-dimensional space, stored as the cosine and sine of
+ * its angle.
+ *
+ * Rotating a point costs four multiplications, which makes it cheaper to
+ * rotate many points by the same angle than to decompose each of them into
+ * a norm and an angle.
+ */
+template<typename T>
+struct BasicRotation {
+    /// The cosine of this rotation's angle.
+    T m_cos{1};
+
+    /// The sine of this rotation's angle.
+    T m_sin{0};
+
+    [[nodiscard]]
+    /**
+     * Constructs the counterclockwise rotation by the given angle.
+     */
+    static BasicRotation from_angle(BinaryAngle angle)
+    {
+        BasicRotation rotation;
+        sin_cos(angle, rotation.m_sin, rotation.m_cos);
+        return rotation;
+    }
+
+    [[nodiscard]]
+    /**
+     * Returns the unit vector with this rotation's angle between itself and
+     * the +x axis.
+     */
+    BasicPoint<T> unit() const noexcept
+    {
+        return {m_cos, m_sin};
+    }
+
+    [[nodiscard]]
+    /// Rotates the given point counterclockwise by this rotation's angle.
+    BasicPoint<T> rotate(BasicPoint<T> point) const noexcept
+    {
+        return {m_cos * point.m_x - m_sin * point.m_y, m_sin * point.m_x + m_cos * point.m_y};
+    }
+
+    [[nodiscard]]
+    /// Rotates the given point clockwise by this rotation's angle.
+    BasicPoint<T> rotate_inverse(BasicPoint<T> point) const noexcept
+    {
+        return {m_cos * point.m_x + m_sin * point.m_y, m_cos * point.m_y - m_sin * point.m_x};
+    }
+};
+
+/// Angle using the scalar type selected for this sketch.
+using Angle = BasicAngle<Scalar>;
+
+/// Point using the scalar type selected for this sketch.
+using Point = BasicPoint<Scalar>;
+
+/// Rotation using the scalar type selected for this sketch.
+using Rotation = BasicRotation<Scalar>;
+
 } // namespace subsonic_ipt
 #endif //SUBSONIC_IPT_POINT_H
@@ -0,0 +1,151 @@
+/**
+ * profiler.cpp - Scope-based timing probes for the sketch's hot paths.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "profiler.h"
+
+#include <stdio.h>
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#else
+#include <chrono>
+#endif
+
+namespace {
+
+using subsonic_ipt::profiler::ProbeStats;
+using subsonic_ipt::profiler::PROBE_COUNT;
+
+/**
+ * The times recorded for each probe.
+ */
+ProbeStats g_probe_stats[PROBE_COUNT]{};
+
+/**
+ * The names of each probe.
+ */
+const char* const PROBE_NAMES[PROBE_COUNT]{
+    "mpu",
+    "dmp",
+    "pos",
+    "nav",
+    "lcd",
+    "btn",
+};
+
+#ifdef __AVR__
+/**
+ * The number of times that Timer1 has overflowed, which forms the upper half
+ * of the profiler's clock.
+ */
+volatile uint16_t g_timer1_overflows{0};
+#endif
+
+} // namespace
+
+#ifdef __AVR__
+ISR(TIMER1_OVF_vect)
+{
+    ++g_timer1_overflows;
+}
+#endif
+
+namespace subsonic_ipt {
+namespace profiler {
+
+void begin()
+{
+#ifdef __AVR__
+    // Count every CPU cycle from 0 to 0xFFFF in normal mode, interrupting on
+    // each overflow.
+    cli();
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10);
+    TCNT1 = 0;
+    TIFR1 = _BV(TOV1);
+    TIMSK1 = _BV(TOIE1);
+    sei();
+#endif
+    reset();
+}
+
+uint32_t ticks() noexcept
+{
+#ifdef __AVR__
+    const uint8_t sreg = SREG;
+    cli();
+    const uint16_t low = TCNT1;
+    uint16_t high = g_timer1_overflows;
+    // An overflow that happened after interrupts were disabled has not been
+    // counted yet. A small count means that it happened before the read.
+    if ((TIFR1 & _BV(TOV1)) && low < 0x8000) {
+        ++high;
+    }
+    SREG = sreg;
+    return (static_cast<uint32_t>(high) << 16u) | low;
+#else
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+#endif
+}
+
+void record(Probe probe, uint32_t elapsed) noexcept
+{
+    ProbeStats& stats = g_probe_stats[static_cast<uint8_t>(probe)];
+    if (stats.count == 0 || elapsed < stats.min_ticks) {
+        stats.min_ticks = elapsed;
+    }
+    if (elapsed > stats.max_ticks) {
+        stats.max_ticks = elapsed;
+    }
+    // Halve the history rather than let the total wrap, which keeps the
+    // mean intact.
+    if (stats.total_ticks + elapsed < stats.total_ticks) {
+        stats.total_ticks /= 2;
+        stats.count /= 2;
+    }
+    stats.total_ticks += elapsed;
+    ++stats.count;
+}
+
+const ProbeStats& stats(Probe probe) noexcept
+{
+    return g_probe_stats[static_cast<uint8_t>(probe)];
+}
+
+const char* probe_name(Probe probe) noexcept
+{
+    return PROBE_NAMES[static_cast<uint8_t>(probe)];
+}
+
+void reset() noexcept
+{
+    for (auto& stats : g_probe_stats) {
+        stats = ProbeStats{};
+    }
+}
+
+int format_stats(char* buffer, size_t size, Probe probe) noexcept
+{
+    const ProbeStats& probe_stats = stats(probe);
+    return snprintf(
+        buffer,
+        size,
+        "%-4s%lu/%lu/%lu",
+        probe_name(probe),
+        static_cast<unsigned long>(probe_stats.min_ticks / TICKS_PER_MICRO),
+        static_cast<unsigned long>(probe_stats.avg_ticks() / TICKS_PER_MICRO),
+        static_cast<unsigned long>(probe_stats.max_ticks / TICKS_PER_MICRO)
+    );
+}
+
+} // namespace profiler
+} // namespace subsonic_ipt
@@ -0,0 +1,165 @@
+/**
+ * profiler.h - Scope-based timing probes for the sketch's hot paths.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_PROFILER_H
+#define SUBSONIC_IPT_PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// When nonzero, the time spent in each probed scope is recorded. Otherwise
+// the probes compile to nothing. On the Uno, Timer1 is taken over as a free
+// running counter, so pins 9 and 10 lose their PWM output.
+#ifndef SUBSONIC_PROFILE
+#define SUBSONIC_PROFILE 1
+#endif
+
+#if SUBSONIC_PROFILE
+#define SUBSONIC_PROFILE_CONCAT_(A, B) A##B
+#define SUBSONIC_PROFILE_CONCAT(A, B) SUBSONIC_PROFILE_CONCAT_(A, B)
+/**
+ * Records the time from this point to the end of the enclosing scope
+ * against the given probe.
+ */
+#define SUBSONIC_PROFILE_SCOPE(PROBE) \
+    const ::subsonic_ipt::profiler::ScopedProbe SUBSONIC_PROFILE_CONCAT(subsonic_probe_, __LINE__){PROBE}
+#else
+#define SUBSONIC_PROFILE_SCOPE(PROBE) static_cast<void>(0)
+#endif
+
+namespace subsonic_ipt {
+namespace profiler {
+
+/**
+ * The scopes timed by the profiler.
+ */
+enum class Probe : uint8_t {
+    /// A single step of `service_mpu`, including the packets it integrates.
+    ServiceMpu,
+    /// Decoding a single DMP packet in `compute_device_motion`.
+    DecodeMotion,
+    /// Integrating a single packet in the sketch's `update_position`.
+    UpdatePosition,
+    /// `Navigator::compute_direction`.
+    ComputeDirection,
+    /// Rendering a frame in `MenuManager::refresh_display`.
+    RefreshDisplay,
+    /// `refresh_buttons`.
+    RefreshButtons,
+    /// The number of probes.
+    Count,
+};
+
+/**
+ * The number of probes.
+ */
+constexpr uint8_t PROBE_COUNT{static_cast<uint8_t>(Probe::Count)};
+
+/**
+ * The number of profiler ticks in a microsecond: the CPU clock on the Uno,
+ * and nanoseconds on the host.
+ */
+#ifdef __AVR__
+constexpr uint32_t TICKS_PER_MICRO{F_CPU / 1000000UL};
+#else
+constexpr uint32_t TICKS_PER_MICRO{1000};
+#endif
+
+/**
+ * The times recorded for a single probe, in profiler ticks.
+ */
+struct ProbeStats {
+    /// The number of times the probed scope has run.
+    uint32_t count;
+    /// The shortest and longest run of the probed scope.
+    uint32_t min_ticks;
+    uint32_t max_ticks;
+    /// The total time spent in the probed scope.
+    uint32_t total_ticks;
+
+    [[nodiscard]]
+    /// The mean time spent in a run of the probed scope.
+    uint32_t avg_ticks() const noexcept
+    {
+        return count == 0 ? 0 : total_ticks / count;
+    }
+};
+
+/**
+ * Starts the profiler's clock.
+ *
+ * On the Uno, this configures Timer1. Should be called once during setup.
+ */
+void begin();
+
+[[nodiscard]]
+/**
+ * Returns the current time of the profiler's clock, in ticks.
+ */
+uint32_t ticks() noexcept;
+
+/**
+ * Records a run of the given probe that took the given number of ticks.
+ */
+void record(Probe probe, uint32_t elapsed) noexcept;
+
+[[nodiscard]]
+/**
+ * Returns the times recorded for the given probe.
+ */
+const ProbeStats& stats(Probe probe) noexcept;
+
+[[nodiscard]]
+/**
+ * Returns a name of at most four characters that labels the given probe.
+ */
+const char* probe_name(Probe probe) noexcept;
+
+/**
+ * Clears the times recorded for every probe.
+ */
+void reset() noexcept;
+
+/**
+ * Writes the given probe's name followed by the shortest, mean and longest
+ * time recorded for it in microseconds, separated by slashes, to the given
+ * buffer.
+ *
+ * Returns the number of characters that the full line would contain, as
+ * `snprintf` does.
+ */
+int format_stats(char* buffer, size_t size, Probe probe) noexcept;
+
+/**
+ * Records the time from its construction to its destruction against a
+ * probe.
+ */
+class ScopedProbe {
+    Probe m_probe;
+
+    uint32_t m_start;
+
+  public:
+    explicit ScopedProbe(Probe probe) noexcept : m_probe(probe), m_start(ticks()) {}
+
+    ScopedProbe(const ScopedProbe&) = delete;
+
+    ScopedProbe& operator=(const ScopedProbe&) = delete;
+
+    ~ScopedProbe()
+    {
+        record(m_probe, ticks() - m_start);
+    }
+};
+
+} // namespace profiler
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_PROFILER_H
@@ -0,0 +1,134 @@
+/**
+ * ring_buffer.h - A fixed-capacity FIFO queue.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_RING_BUFFER_H
+#define SUBSONIC_IPT_RING_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace subsonic_ipt {
+
+/**
+ * A first-in first-out queue of at most `N` elements, stored in place.
+ *
+ * Elements are written directly into their slot with `back()` and then
+ * committed with `push()`, so that large elements such as MPU packets can
+ * be filled without an intermediate copy.
+ */
+template<typename T, uint8_t N>
+class RingBuffer {
+    static_assert(N != 0);
+
+    /// Storage for the queued elements.
+    T m_slots[N]{};
+
+    /// The index of the oldest element.
+    uint8_t m_head{0};
+
+    /// The number of queued elements.
+    uint8_t m_size{0};
+
+  public:
+    [[nodiscard]]
+    /// The maximum number of elements that can be queued.
+    constexpr static uint8_t capacity() noexcept
+    {
+        return N;
+    }
+
+    [[nodiscard]]
+    /// The number of elements currently queued.
+    constexpr uint8_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    [[nodiscard]]
+    constexpr bool empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    [[nodiscard]]
+    constexpr bool full() const noexcept
+    {
+        return m_size == N;
+    }
+
+    [[nodiscard]]
+    /**
+     * Returns the oldest queued element.
+     *
+     * The queue must not be empty.
+     */
+    T& front() noexcept
+    {
+        return m_slots[m_head];
+    }
+
+    [[nodiscard]]
+    /**
+     * Returns the free slot that the next call to `push()` will commit.
+     *
+     * The queue must not be full.
+     */
+    T& back() noexcept
+    {
+        return m_slots[(m_head + m_size) % N];
+    }
+
+    /**
+     * Commits the slot returned by `back()` as the newest element.
+     *
+     * The queue must not be full.
+     */
+    void push() noexcept
+    {
+        ++m_size;
+    }
+
+    /**
+     * Copies the given element into the queue.
+     *
+     * Returns `false` without modifying the queue if it is full.
+     */
+    bool push(const T& element) noexcept
+    {
+        if (full()) {
+            return false;
+        }
+        back() = element;
+        push();
+        return true;
+    }
+
+    /**
+     * Removes the oldest element.
+     *
+     * The queue must not be empty.
+     */
+    void pop() noexcept
+    {
+        m_head = (m_head + 1) % N;
+        --m_size;
+    }
+
+    /// Removes every element.
+    void clear() noexcept
+    {
+        m_head = 0;
+        m_size = 0;
+    }
+};
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_RING_BUFFER_H
@@ -0,0 +1,54 @@
+/**
+ * scalar.h - Compile-time selection of the scalar type used for positions
+ *            and angles.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_SCALAR_H
+#define SUBSONIC_IPT_SCALAR_H
+
+#include "fixed.h"
+
+// When defined, positions, angles and guidance are computed with Q16.16
+// fixed-point arithmetic instead of the AVR's software floating point.
+//#define SUBSONIC_FIXED_POINT
+
+namespace subsonic_ipt {
+
+/**
+ * The scalar type used by the sketch's navigation state.
+ */
+#ifdef SUBSONIC_FIXED_POINT
+using Scalar = Fixed;
+#else
+using Scalar = double;
+#endif
+
+/**
+ * Converts a duration in microseconds to seconds.
+ */
+template<typename T>
+T seconds_from_micros(unsigned long micros);
+
+template<>
+inline double seconds_from_micros<double>(unsigned long micros)
+{
+    return static_cast<double>(micros) / 1e6;
+}
+
+template<>
+inline Fixed seconds_from_micros<Fixed>(unsigned long micros)
+{
+    // 2^16 / 10^6 == 4398046.511 / 2^26
+    const uint64_t raw = (static_cast<uint64_t>(micros) * 4398047u) >> 26u;
+    return Fixed::from_raw(raw > static_cast<uint64_t>(Fixed::MAX_RAW) ? Fixed::MAX_RAW : static_cast<int32_t>(raw));
+}
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_SCALAR_H
@@ -0,0 +1,197 @@
+/**
+ * scheduler.h - A cooperative scheduler for the periodic work of the sketch.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_SCHEDULER_H
+#define SUBSONIC_IPT_SCHEDULER_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+namespace subsonic_ipt {
+
+/**
+ * A unit of work run by a `Scheduler`.
+ */
+struct Task {
+    /// A short name that labels this task in debugging output.
+    const char* name;
+
+    /// The function that does the task's work. Must return promptly.
+    void (* run)();
+
+    /// The time in microseconds between releases of this task, or zero if
+    /// the task should run on every pass.
+    unsigned long period_u;
+
+    /// The time in microseconds after its release by which each run of this
+    /// task should have finished.
+    unsigned long deadline_u;
+
+    /// The order in which due tasks are run, lowest first.
+    uint8_t priority;
+};
+
+/**
+ * Counters recording how a task has kept to its deadline.
+ */
+struct TaskStats {
+    /// The number of times the task has run.
+    unsigned long runs;
+
+    /// The number of runs that finished after their deadline.
+    unsigned long overruns;
+
+    /// The longest time in microseconds taken by a single run.
+    unsigned long max_run_u;
+
+    /// The longest time in microseconds from a release to the end of the
+    /// run it released.
+    unsigned long max_response_u;
+};
+
+/**
+ * Runs a fixed table of `N` tasks, each on its own period.
+ *
+ * Each call to `run_pass` runs every task that has been released, in order
+ * of priority. A periodic task is released again one period after its last
+ * release, so a late run does not delay the next. If a task falls more than
+ * a whole period behind, the missed releases are skipped rather than run
+ * back to back.
+ *
+ * A run overruns if it finishes more than the task's deadline after its
+ * release, which counts both the time the task waited behind the tasks ahead
+ * of it and the time it took. Tasks that run on every pass are released when
+ * the pass starts.
+ *
+ * An optional function is called after each task that runs, for work that
+ * must keep up with the tasks at a finer grain than a whole pass.
+ *
+ * Times are kept as the low 32 bits of `micros()`, as on the AVR, and
+ * compared by their signed difference, so the schedule carries on across
+ * the wrap every 71 minutes.
+ */
+template<uint8_t N>
+class Scheduler {
+    static_assert(N != 0);
+
+    /// The tasks, sorted by priority.
+    Task m_tasks[N]{};
+
+    /// The time in microseconds since startup when each task is next
+    /// released, modulo 2^32.
+    uint32_t m_release_u[N]{};
+
+    /// Counters for each task.
+    TaskStats m_stats[N]{};
+
+    /// Called after each task that runs, or null.
+    void (* m_between_tasks)();
+
+  public:
+    explicit Scheduler(const Task (& tasks)[N], void (* between_tasks)() = nullptr)
+        : m_between_tasks(between_tasks)
+    {
+        // Insertion sort, so that tasks of equal priority keep their order.
+        for (uint8_t i = 0; i < N; ++i) {
+            uint8_t j = i;
+            for (; j > 0 && m_tasks[j - 1].priority > tasks[i].priority; --j) {
+                m_tasks[j] = m_tasks[j - 1];
+            }
+            m_tasks[j] = tasks[i];
+        }
+    }
+
+    [[nodiscard]]
+    /// The number of tasks in this scheduler.
+    constexpr static uint8_t size() noexcept
+    {
+        return N;
+    }
+
+    /**
+     * Releases every task now and clears their counters.
+     *
+     * Should be called once setup has finished, so that the time spent in
+     * setup is not counted against the tasks.
+     */
+    void start()
+    {
+        const uint32_t now_u = micros();
+        for (uint8_t i = 0; i < N; ++i) {
+            m_release_u[i] = now_u;
+            m_stats[i] = TaskStats{};
+        }
+    }
+
+    /**
+     * Runs each released task once, in order of priority.
+     *
+     * Returns the number of tasks that were run.
+     */
+    uint8_t run_pass()
+    {
+        uint8_t ran = 0;
+        const uint32_t pass_u = micros();
+        for (uint8_t i = 0; i < N; ++i) {
+            const Task& task = m_tasks[i];
+            const uint32_t start_u = micros();
+            if (static_cast<int32_t>(start_u - m_release_u[i]) < 0) {
+                continue;
+            }
+            const uint32_t release_u = task.period_u == 0 ? pass_u : m_release_u[i];
+            task.run();
+            const uint32_t end_u = micros();
+            ++ran;
+
+            TaskStats& stats = m_stats[i];
+            ++stats.runs;
+            const uint32_t run_u = end_u - start_u;
+            const uint32_t response_u = end_u - release_u;
+            stats.max_run_u = max(stats.max_run_u, run_u);
+            stats.max_response_u = max(stats.max_response_u, response_u);
+            if (response_u > task.deadline_u) {
+                ++stats.overruns;
+            }
+
+            m_release_u[i] = release_u + task.period_u;
+            if (static_cast<int32_t>(end_u - m_release_u[i]) >= static_cast<int32_t>(task.period_u)) {
+                m_release_u[i] = end_u;
+            }
+
+            if (m_between_tasks != nullptr) {
+                m_between_tasks();
+            }
+        }
+        return ran;
+    }
+
+    [[nodiscard]]
+    /**
+     * Returns the task at the given position in priority order.
+     */
+    const Task& task(uint8_t index) const noexcept
+    {
+        return m_tasks[index];
+    }
+
+    [[nodiscard]]
+    /**
+     * Returns the counters of the task at the given position in priority
+     * order.
+     */
+    const TaskStats& stats(uint8_t index) const noexcept
+    {
+        return m_stats[index];
+    }
+};
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_SCHEDULER_H
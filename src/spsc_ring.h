@@ -0,0 +1,101 @@
+/**
+ * spsc_ring.h - Lock-free queue between one producer and one consumer.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_SPSC_RING_H
+#define SUBSONIC_IPT_SPSC_RING_H
+
+#include <stdint.h>
+
+namespace subsonic_ipt {
+
+/**
+ * A fixed-capacity FIFO queue that may be pushed to by one context (e.g. an
+ * interrupt handler or a thread) while being popped from by another, without
+ * disabling interrupts or taking a lock.
+ *
+ * Each side only writes its own counter, which is a single byte and so is
+ * read and written atomically even on the AVR. The atomic builtins order the
+ * element accesses around the counter updates.
+ */
+template<typename T, uint8_t N>
+class SpscRing {
+    static_assert(N != 0 && (N & (N - 1u)) == 0 && N <= 128, "capacity must be a power of two no greater than 128");
+
+    T m_slots[N]{};
+
+    /// The number of elements pushed, wrapping at 256. Written by the producer.
+    uint8_t m_pushed{0};
+
+    /// The number of elements popped, wrapping at 256. Written by the consumer.
+    uint8_t m_popped{0};
+
+  public:
+    [[nodiscard]]
+    constexpr uint8_t capacity() const noexcept
+    {
+        return N;
+    }
+
+    /**
+     * Appends a copy of the given element. Producer only.
+     *
+     * Returns `false` without modifying the queue if it is full.
+     */
+    bool push(const T& value) noexcept
+    {
+        const uint8_t pushed = m_pushed;
+        if (static_cast<uint8_t>(pushed - __atomic_load_n(&m_popped, __ATOMIC_ACQUIRE)) == N) {
+            return false;
+        }
+        m_slots[pushed & (N - 1u)] = value;
+        __atomic_store_n(&m_pushed, static_cast<uint8_t>(pushed + 1), __ATOMIC_RELEASE);
+        return true;
+    }
+
+    [[nodiscard]]
+    /**
+     * Returns `true` if the queue holds no elements. Consumer only.
+     */
+    bool empty() const noexcept
+    {
+        return __atomic_load_n(&m_pushed, __ATOMIC_ACQUIRE) == m_popped;
+    }
+
+    [[nodiscard]]
+    /**
+     * Returns the number of elements in the queue. Consumer only. Elements
+     * pushed concurrently may or may not be included.
+     */
+    uint8_t size() const noexcept
+    {
+        return static_cast<uint8_t>(__atomic_load_n(&m_pushed, __ATOMIC_ACQUIRE) - m_popped);
+    }
+
+    [[nodiscard]]
+    /**
+     * Returns the oldest element. The queue must not be empty. Consumer only.
+     */
+    const T& front() const noexcept
+    {
+        return m_slots[m_popped & (N - 1u)];
+    }
+
+    /**
+     * Removes the oldest element. The queue must not be empty. Consumer only.
+     */
+    void pop() noexcept
+    {
+        __atomic_store_n(&m_popped, static_cast<uint8_t>(m_popped + 1), __ATOMIC_RELEASE);
+    }
+};
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_SPSC_RING_H
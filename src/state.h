@@ -12,6 +12,7 @@
 #define SUBSONIC_IPT_STATE_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include "point.h"
 #include "units.h"
 #include "inputs/mpu.h"
@@ -22,11 +23,34 @@ struct IPTState {
     /// The current position of the device
     Point position;
     /// The direction the device is currently facing.
-    Angle facing;
+    BinaryAngle facing;
+    /// The rotation by `facing`, cached for each update of the facing.
+    Rotation facing_rotation;
     /// The user-selected unit to report distances in.
     LengthUnit localized_unit;
     /// The most recently measured motion data for the device.
     DeviceMotion device_motion;
+    /**
+     * Counter that is advanced whenever a change to this state or to the
+     * navigator's destinations invalidates results derived from them.
+     */
+    uint16_t epoch;
+
+    /// Marks every result derived from the previous state as out of date.
+    void advance_epoch()
+    {
+        ++epoch;
+    }
+
+    /**
+     * Sets the direction the device is facing and refreshes its cached
+     * rotation.
+     */
+    void update_facing(BinaryAngle angle)
+    {
+        facing = angle;
+        facing_rotation = Rotation::from_angle(angle);
+    }
 };
 
 } // namespace subsonic_ipt
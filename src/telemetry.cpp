@@ -0,0 +1,217 @@
+/**
+ * telemetry.cpp - Implementation for framed binary telemetry records.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "telemetry.h"
+
+#include <string.h>
+
+#include "crc16.h"
+
+/******************************************************************************\
+ * Internal definitions
+\******************************************************************************/
+namespace {
+using namespace subsonic_ipt::telemetry;
+
+/**
+ * Appends little-endian fields to a record.
+ */
+class RecordWriter {
+    uint8_t* m_out;
+
+  public:
+    explicit RecordWriter(uint8_t* out) : m_out(out) {}
+
+    void put_u8(uint8_t value)
+    {
+        *m_out++ = value;
+    }
+
+    void put_u16(uint16_t value)
+    {
+        put_u8(static_cast<uint8_t>(value));
+        put_u8(static_cast<uint8_t>(value >> 8u));
+    }
+
+    void put_u32(uint32_t value)
+    {
+        put_u16(static_cast<uint16_t>(value));
+        put_u16(static_cast<uint16_t>(value >> 16u));
+    }
+
+    void put_float(float value)
+    {
+        static_assert(sizeof(float) == sizeof(uint32_t));
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        put_u32(bits);
+    }
+};
+
+/**
+ * Reads little-endian fields from a record.
+ */
+class RecordReader {
+    const uint8_t* m_in;
+
+  public:
+    explicit RecordReader(const uint8_t* in) : m_in(in) {}
+
+    uint8_t get_u8()
+    {
+        return *m_in++;
+    }
+
+    uint16_t get_u16()
+    {
+        const uint16_t low = get_u8();
+        return static_cast<uint16_t>(low | (static_cast<uint16_t>(get_u8()) << 8u));
+    }
+
+    uint32_t get_u32()
+    {
+        const uint32_t low = get_u16();
+        return low | (static_cast<uint32_t>(get_u16()) << 16u);
+    }
+
+    float get_float()
+    {
+        const uint32_t bits = get_u32();
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+} // namespace
+
+/******************************************************************************\
+ * Public definitions
+\******************************************************************************/
+namespace subsonic_ipt {
+namespace telemetry {
+
+size_t cobs_encode(const uint8_t* data, size_t length, uint8_t* out) noexcept
+{
+    // Each block starts with the offset to the next zero, which is replaced.
+    size_t code_index = 0;
+    size_t out_index = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length; ++i) {
+        if (data[i] != 0) {
+            out[out_index++] = data[i];
+            ++code;
+        }
+        if (data[i] == 0 || code == 0xFF) {
+            out[code_index] = code;
+            code_index = out_index++;
+            code = 1;
+        }
+    }
+    out[code_index] = code;
+    return out_index;
+}
+
+size_t cobs_decode(const uint8_t* data, size_t length, uint8_t* out) noexcept
+{
+    size_t in_index = 0;
+    size_t out_index = 0;
+    while (in_index < length) {
+        const uint8_t code = data[in_index++];
+        if (code == 0 || in_index + code - 1 > length) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; ++i) {
+            if (data[in_index] == 0) {
+                return 0;
+            }
+            out[out_index++] = data[in_index++];
+        }
+        // A block shorter than the maximum stands for a zero, except at the
+        // end of the frame.
+        if (code != 0xFF && in_index != length) {
+            out[out_index++] = 0;
+        }
+    }
+    return out_index;
+}
+
+void encode_motion(const MotionRecord& record, uint8_t* frame) noexcept
+{
+    uint8_t bytes[MOTION_RECORD_SIZE];
+    RecordWriter writer(bytes);
+    writer.put_u8(SCHEMA_VERSION);
+    writer.put_u8(static_cast<uint8_t>(RecordType::Motion));
+    writer.put_u8(record.sequence);
+    writer.put_u32(record.timestamp_u);
+    writer.put_float(record.x);
+    writer.put_float(record.y);
+    writer.put_u16(record.facing);
+    for (const auto angle : record.ypr) {
+        writer.put_u16(angle);
+    }
+    for (const auto accel : record.world_accel) {
+        writer.put_u16(static_cast<uint16_t>(accel));
+    }
+    writer.put_u16(record.latency_u);
+    writer.put_u16(record.loop_max_u);
+    writer.put_u16(record.fifo_count);
+    writer.put_u16(record.dropped);
+    writer.put_u16(crc16(bytes, MOTION_RECORD_SIZE - 2));
+
+    frame[0] = 0;
+    cobs_encode(bytes, MOTION_RECORD_SIZE, frame + 1);
+    frame[MOTION_FRAME_SIZE - 1] = 0;
+}
+
+bool decode_motion(const uint8_t* data, size_t length, MotionRecord& record) noexcept
+{
+    uint8_t bytes[MOTION_RECORD_SIZE + 1];
+    if (length != MOTION_FRAME_SIZE - 2 || cobs_decode(data, length, bytes) != MOTION_RECORD_SIZE) {
+        return false;
+    }
+    RecordReader reader(bytes);
+    if (reader.get_u8() != SCHEMA_VERSION || reader.get_u8() != static_cast<uint8_t>(RecordType::Motion)) {
+        return false;
+    }
+    record.sequence = reader.get_u8();
+    record.timestamp_u = reader.get_u32();
+    record.x = reader.get_float();
+    record.y = reader.get_float();
+    record.facing = reader.get_u16();
+    for (auto& angle : record.ypr) {
+        angle = reader.get_u16();
+    }
+    for (auto& accel : record.world_accel) {
+        accel = static_cast<int16_t>(reader.get_u16());
+    }
+    record.latency_u = reader.get_u16();
+    record.loop_max_u = reader.get_u16();
+    record.fifo_count = reader.get_u16();
+    record.dropped = reader.get_u16();
+    return reader.get_u16() == crc16(bytes, MOTION_RECORD_SIZE - 2);
+}
+
+bool TelemetryStream::send(MotionRecord record)
+{
+    record.sequence = m_sequence++;
+    record.dropped = m_dropped;
+    if (m_port.availableForWrite() < MOTION_FRAME_SIZE) {
+        ++m_dropped;
+        return false;
+    }
+    uint8_t frame[MOTION_FRAME_SIZE];
+    encode_motion(record, frame);
+    m_port.write(frame, sizeof(frame));
+    return true;
+}
+
+} // namespace telemetry
+} // namespace subsonic_ipt
@@ -0,0 +1,160 @@
+/**
+ * telemetry.h - Framed binary telemetry records for the serial port.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_TELEMETRY_H
+#define SUBSONIC_IPT_TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Arduino.h>
+
+namespace subsonic_ipt {
+namespace telemetry {
+
+/**
+ * The version of the record layouts below. Must be incremented whenever a
+ * layout changes.
+ */
+constexpr uint8_t SCHEMA_VERSION{2};
+
+/**
+ * The kinds of record that may be sent.
+ */
+enum class RecordType : uint8_t {
+    Motion = 1,
+};
+
+/**
+ * The device's motion and the sketch's health after a single DMP packet.
+ *
+ * Angles are binary angles in units of 2^-16 turns.
+ */
+struct MotionRecord {
+    /// Counts every record sent or dropped, wrapping at 256.
+    uint8_t sequence;
+    /// The time in microseconds since startup when the packet was sampled.
+    uint32_t timestamp_u;
+    /// The device's position in meters.
+    float x;
+    float y;
+    /// The direction faced, counterclockwise from the x axis.
+    uint16_t facing;
+    /// The yaw, pitch and roll reported by the DMP.
+    uint16_t ypr[3];
+    /// The world-frame acceleration reported by the DMP, in raw units.
+    int16_t world_accel[3];
+    /// The time from the packet's interrupt until its motion was integrated.
+    uint16_t latency_u;
+    /// The longest main loop iteration since the previous record.
+    uint16_t loop_max_u;
+    /// The number of bytes in the MPU's FIFO when it was last counted.
+    uint16_t fifo_count;
+    /// The number of records dropped since startup, wrapping at 65536.
+    uint16_t dropped;
+};
+
+/**
+ * The number of bytes in an encoded motion record: the schema version and
+ * record type, the fields above in little-endian order, and a CRC.
+ */
+constexpr uint8_t MOTION_RECORD_SIZE{2 + 1 + 4 + 4 + 4 + 2 + 6 + 6 + 2 + 2 + 2 + 2 + 2};
+
+/**
+ * The number of bytes in a framed motion record.
+ *
+ * Each record is COBS encoded, which adds one byte for records shorter than
+ * 254 bytes, and is both preceded and followed by a zero byte. The leading
+ * delimiter lets a receiver resynchronize after any text printed between
+ * records.
+ */
+constexpr uint8_t MOTION_FRAME_SIZE{MOTION_RECORD_SIZE + 3};
+
+/**
+ * Encodes the given bytes with Consistent Overhead Byte Stuffing, so that the
+ * output contains no zero bytes.
+ *
+ * The output must hold at least `length + length / 254 + 1` bytes. Returns the
+ * number of bytes written.
+ */
+size_t cobs_encode(const uint8_t* data, size_t length, uint8_t* out) noexcept;
+
+/**
+ * Decodes the given COBS encoded bytes, which must not include the frame
+ * delimiters.
+ *
+ * The output must hold at least `length` bytes. Returns the number of bytes
+ * written, or zero if the input is not validly encoded.
+ */
+size_t cobs_decode(const uint8_t* data, size_t length, uint8_t* out) noexcept;
+
+/**
+ * Writes the given record to `frame` as a complete frame of
+ * `MOTION_FRAME_SIZE` bytes.
+ */
+void encode_motion(const MotionRecord& record, uint8_t* frame) noexcept;
+
+[[nodiscard]]
+/**
+ * Decodes a motion record from the bytes between two frame delimiters.
+ *
+ * Returns `false` if the bytes are not a well-formed motion record of the
+ * current schema version with a matching CRC.
+ */
+bool decode_motion(const uint8_t* data, size_t length, MotionRecord& record) noexcept;
+
+/**
+ * Sends records to a serial port without ever waiting for it.
+ *
+ * A record is only written if the port's transmit buffer, which the UART
+ * interrupt drains in the background, has room for the entire frame.
+ * Otherwise the record is dropped and counted.
+ */
+class TelemetryStream {
+    Print& m_port;
+
+    uint8_t m_sequence{0};
+
+    uint16_t m_dropped{0};
+
+  public:
+    explicit TelemetryStream(Print& port) : m_port(port) {}
+
+    /**
+     * Sends the given record, filling in its sequence number and drop count.
+     *
+     * Returns `false` if the record was dropped.
+     */
+    bool send(MotionRecord record);
+
+    [[nodiscard]]
+    /**
+     * Returns whether the port has room for a whole frame, so that the next
+     * record sent will not be dropped.
+     */
+    bool writable() const
+    {
+        return m_port.availableForWrite() >= MOTION_FRAME_SIZE;
+    }
+
+    [[nodiscard]]
+    /**
+     * Returns the number of records dropped since startup.
+     */
+    uint16_t dropped() const noexcept
+    {
+        return m_dropped;
+    }
+};
+
+} // namespace telemetry
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_TELEMETRY_H
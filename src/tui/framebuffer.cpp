@@ -0,0 +1,180 @@
+/**
+ * framebuffer.cpp - Implementation for the off-screen SerLCD character buffer.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "framebuffer.h"
+
+#include <string.h>
+
+#include <SerLCD.h>
+
+/******************************************************************************\
+ * Internal definitions
+\******************************************************************************/
+namespace {
+using subsonic_ipt::Framebuffer;
+
+/**
+ * The display RAM addresses of the first cell of each row.
+ */
+constexpr uint8_t ROW_OFFSETS[Framebuffer::ROWS] = {0x00, 0x40, 0x14, 0x54};
+
+/**
+ * The number of bytes in a SerLCD cursor move command.
+ */
+constexpr uint8_t CURSOR_MOVE_SIZE{2};
+
+/**
+ * The number of bytes sent to the display per write by `flush_to`. Each write
+ * is a single I2C transmission, which the Wire library limits to 32 bytes.
+ */
+constexpr uint8_t FLUSH_WRITE_SIZE{32};
+
+} // namespace
+
+/******************************************************************************\
+ * Public definitions
+\******************************************************************************/
+namespace subsonic_ipt {
+
+Framebuffer::Framebuffer()
+{
+    clear();
+}
+
+void Framebuffer::clear()
+{
+    memset(m_cells, ' ', sizeof(m_cells));
+    m_row = 0;
+    m_column = 0;
+}
+
+void Framebuffer::setCursor(uint8_t col, uint8_t row)
+{
+    m_row = min(row, static_cast<uint8_t>(ROWS - 1));
+    m_column = min(col, static_cast<uint8_t>(COLUMNS - 1));
+}
+
+void Framebuffer::setContrast(uint8_t new_value)
+{
+    m_pending_contrast = new_value;
+    m_contrast_pending = true;
+}
+
+void Framebuffer::setBacklight(unsigned long rgb)
+{
+    m_pending_backlight = rgb;
+    m_backlight_pending = true;
+}
+
+size_t Framebuffer::write(uint8_t b)
+{
+    // Like the display, ignore control characters (e.g. the CR/LF emitted
+    // by println).
+    if (b < 0x20) {
+        return 1;
+    }
+    m_cells[m_row][m_column] = static_cast<char>(b);
+    // The display wraps onto the following row in display order.
+    if (++m_column == COLUMNS) {
+        m_column = 0;
+        m_row = (m_row + 1) % ROWS;
+    }
+    return 1;
+}
+
+void Framebuffer::invalidate()
+{
+    memset(m_sent, 0, sizeof(m_sent));
+    m_lcd_cursor_known = false;
+}
+
+uint8_t Framebuffer::next_chunk(uint8_t* buffer, uint8_t capacity)
+{
+    uint8_t length = 0;
+
+    if (m_contrast_pending) {
+        m_contrast_pending = false;
+        buffer[length++] = SETTING_COMMAND;
+        buffer[length++] = CONTRAST_COMMAND;
+        buffer[length++] = m_pending_contrast;
+    }
+
+    if (m_backlight_pending && length + 5 <= capacity) {
+        m_backlight_pending = false;
+        buffer[length++] = SETTING_COMMAND;
+        buffer[length++] = SET_RGB_COMMAND;
+        buffer[length++] = static_cast<uint8_t>(m_pending_backlight >> 16u);
+        buffer[length++] = static_cast<uint8_t>(m_pending_backlight >> 8u);
+        buffer[length++] = static_cast<uint8_t>(m_pending_backlight);
+    }
+
+    while (m_flush_row < ROWS) {
+        const uint8_t row = m_flush_row;
+        const uint8_t col = m_flush_column;
+        if (col == COLUMNS) {
+            ++m_flush_row;
+            m_flush_column = 0;
+            continue;
+        }
+        if (m_cells[row][col] == m_sent[row][col]) {
+            ++m_flush_column;
+            continue;
+        }
+
+        // Extend the run across any unchanged cells that are cheaper to
+        // rewrite than to skip with a cursor move.
+        uint8_t end = col + 1;
+        for (uint8_t next = end; next < COLUMNS && next - end < CURSOR_MOVE_SIZE + 1; ++next) {
+            if (m_cells[row][next] != m_sent[row][next]) {
+                end = next + 1;
+            }
+        }
+
+        // Send as much of the run as fits, along with its cursor move. The
+        // rest follows in the next chunk without needing another move.
+        const bool cursor_in_place = m_lcd_cursor_known && m_lcd_row == row && m_lcd_column == col;
+        const uint8_t move_size = cursor_in_place ? 0 : CURSOR_MOVE_SIZE;
+        if (length + move_size >= capacity) {
+            break;
+        }
+        end = min(end, static_cast<uint8_t>(col + (capacity - length - move_size)));
+
+        if (!cursor_in_place) {
+            buffer[length++] = SPECIAL_COMMAND;
+            buffer[length++] = LCD_SETDDRAMADDR | (col + ROW_OFFSETS[row]);
+        }
+        memcpy(&buffer[length], &m_cells[row][col], end - col);
+        memcpy(&m_sent[row][col], &m_cells[row][col], end - col);
+        length += end - col;
+
+        m_lcd_cursor_known = true;
+        m_lcd_row = row;
+        m_lcd_column = end;
+        if (m_lcd_column == COLUMNS) {
+            m_lcd_column = 0;
+            m_lcd_row = (row + 1) % ROWS;
+        }
+        m_flush_column = end;
+    }
+    return length;
+}
+
+size_t Framebuffer::flush_to(Print& lcd)
+{
+    uint8_t chunk[FLUSH_WRITE_SIZE];
+    size_t total = 0;
+    begin_flush();
+    while (const uint8_t length = next_chunk(chunk, sizeof(chunk))) {
+        total += lcd.write(chunk, length);
+    }
+    return total;
+}
+
+} // namespace subsonic_ipt
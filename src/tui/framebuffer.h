@@ -0,0 +1,150 @@
+/**
+ * framebuffer.h - Off-screen character buffer for the SerLCD display.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_FRAMEBUFFER_H
+#define SUBSONIC_IPT_FRAMEBUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Arduino.h>
+
+namespace subsonic_ipt {
+
+/**
+ * A 20x4 character screen that menus render into instead of the LCD.
+ *
+ * Rendering follows the SerLCD's text semantics: control characters are
+ * ignored and text wraps onto the following row. Nothing is sent to the
+ * display until the frame is flushed, which writes only the cells that
+ * differ from the previously flushed frame.
+ *
+ * A flush may be spread over many calls to `next_chunk`. The frame must not
+ * be rendered into until the flush finishes, or the display may show parts of
+ * two different frames.
+ */
+class Framebuffer : public Print {
+  public:
+    constexpr static uint8_t ROWS = 4;
+    constexpr static uint8_t COLUMNS = 20;
+
+  private:
+    /// The frame being rendered.
+    char m_cells[ROWS][COLUMNS];
+
+    /// The frame last sent to the display, or zeros where it is unknown.
+    char m_sent[ROWS][COLUMNS]{};
+
+    /// The render cursor.
+    uint8_t m_row{0};
+    uint8_t m_column{0};
+
+    /// The display's cursor after the last flush, if known.
+    uint8_t m_lcd_row{0};
+    uint8_t m_lcd_column{0};
+    bool m_lcd_cursor_known{false};
+
+    /// Contrast setting waiting to be sent with the next flush.
+    uint8_t m_pending_contrast{0};
+    bool m_contrast_pending{false};
+
+    /// Backlight color waiting to be sent with the next flush.
+    unsigned long m_pending_backlight{0};
+    bool m_backlight_pending{false};
+
+    /// The next cell to compare during the flush in progress.
+    uint8_t m_flush_row{ROWS};
+    uint8_t m_flush_column{0};
+
+  public:
+    Framebuffer();
+
+    /**
+     * Fills the frame with spaces and moves the cursor to the top left.
+     *
+     * Unlike `SerLCD::clear`, this does not cause the display to blank.
+     */
+    void clear();
+
+    void setCursor(uint8_t col, uint8_t row);
+
+    /**
+     * Changes the display's contrast when the frame is next flushed.
+     */
+    void setContrast(uint8_t new_value);
+
+    /**
+     * Changes the display's backlight to the given 0xRRGGBB color when the
+     * frame is next flushed.
+     */
+    void setBacklight(unsigned long rgb);
+
+    size_t write(uint8_t b) override;
+
+    using Print::write;
+
+    /**
+     * Forgets what the display is showing, so that the next flush repaints
+     * every cell.
+     */
+    void invalidate();
+
+    /**
+     * Starts sending this frame to the display.
+     */
+    void begin_flush() noexcept
+    {
+        m_flush_row = 0;
+        m_flush_column = 0;
+    }
+
+    [[nodiscard]]
+    /**
+     * Returns `true` if a flush has been started and not yet finished.
+     */
+    bool flushing() const noexcept
+    {
+        return m_flush_row < ROWS || m_contrast_pending || m_backlight_pending;
+    }
+
+    [[nodiscard]]
+    /**
+     * Writes the next SerLCD commands and text of the flush in progress to
+     * the given buffer, returning the number of bytes written. Returns zero
+     * once the display is up to date with this frame.
+     *
+     * Each changed run of cells is preceded by a cursor move unless the
+     * display's cursor is already there. Runs separated by fewer unchanged
+     * cells than a cursor move costs are merged. Commands are never split
+     * across two chunks, so `capacity` must be at least 5.
+     */
+    uint8_t next_chunk(uint8_t* buffer, uint8_t capacity);
+
+    /**
+     * Sends the entire frame to the given stream, which is typically the
+     * `SerLCD` itself, in writes of up to 32 bytes.
+     *
+     * Returns the number of bytes written.
+     */
+    size_t flush_to(Print& lcd);
+
+    [[nodiscard]]
+    /**
+     * Returns the character in the given cell of the frame being rendered.
+     */
+    char cell(uint8_t col, uint8_t row) const noexcept
+    {
+        return m_cells[row][col];
+    }
+};
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_FRAMEBUFFER_H
@@ -0,0 +1,46 @@
+/**
+ * lcd_writer.cpp - Implementation for time-sliced SerLCD transmission.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#include "lcd_writer.h"
+
+#include <Arduino.h>
+
+namespace subsonic_ipt {
+
+LcdWriter::LcdWriter(Framebuffer& frame, uint8_t address)
+    : m_frame(frame),
+      m_transaction{address, m_chunk, 0, nullptr, 0, nullptr, nullptr, I2CResult::Success}
+{
+}
+
+void LcdWriter::service()
+{
+    // The previous chunk is finished once its result is set. Its callback is
+    // left to whichever task polls the bus.
+    const auto time = micros();
+    if (m_transaction.result == I2CResult::Pending || time - m_last_chunk_u < SUBSONIC_LCD_SETTLE_US) {
+        return;
+    }
+
+    // A chunk that cannot be queued is kept and retried on the next call.
+    if (m_chunk_length == 0) {
+        m_chunk_length = m_frame.next_chunk(m_chunk, sizeof(m_chunk));
+        if (m_chunk_length == 0) {
+            return;
+        }
+    }
+    m_transaction.write_length = m_chunk_length;
+    if (i2c_submit(m_transaction)) {
+        m_last_chunk_u = time;
+        m_chunk_length = 0;
+    }
+}
+
+} // namespace subsonic_ipt
@@ -0,0 +1,90 @@
+/**
+ * lcd_writer.h - Time-sliced transmission of framebuffers to the SerLCD.
+ *
+ * Copyright (c) 2020 Brian Schubert
+ *
+ * This file is distributed under the MIT License. If a copy of the
+ * MIT License was not distributed with this file, you can obtain one
+ * at https://opensource.org/licenses/MIT.
+ */
+
+#ifndef SUBSONIC_IPT_LCD_WRITER_H
+#define SUBSONIC_IPT_LCD_WRITER_H
+
+#include <stdint.h>
+
+#include "framebuffer.h"
+#include "../async_i2c.h"
+
+// The most bytes sent to the display per I2C transaction. Bounds both the
+// work done per call to `LcdWriter::service` and how long the display holds
+// the bus while an MPU read waits.
+#ifndef SUBSONIC_LCD_CHUNK
+#define SUBSONIC_LCD_CHUNK 16
+#endif
+
+static_assert(SUBSONIC_LCD_CHUNK >= 5, "SUBSONIC_LCD_CHUNK must fit a backlight command");
+
+// The minimum number of microseconds between transactions sent to the
+// display, giving OpenLCD time to process each one. Matches the delay the
+// SerLCD library makes after each write.
+#ifndef SUBSONIC_LCD_SETTLE_US
+#define SUBSONIC_LCD_SETTLE_US 10000
+#endif
+
+namespace subsonic_ipt {
+
+/**
+ * Sends a framebuffer to the display a chunk at a time through the
+ * non-blocking I2C engine, so that no call waits on the display.
+ */
+class LcdWriter {
+    Framebuffer& m_frame;
+
+    uint8_t m_chunk[SUBSONIC_LCD_CHUNK]{};
+
+    /// The length of the chunk waiting to be submitted, if any.
+    uint8_t m_chunk_length{0};
+
+    I2CTransaction m_transaction;
+
+    /// The time at which the last chunk was submitted.
+    unsigned long m_last_chunk_u{0};
+
+  public:
+    LcdWriter(Framebuffer& frame, uint8_t address);
+
+    /**
+     * Starts sending the framebuffer's current frame.
+     *
+     * The framebuffer must not be rendered into until `busy` returns `false`.
+     */
+    void begin_frame()
+    {
+        m_frame.begin_flush();
+    }
+
+    [[nodiscard]]
+    /**
+     * Returns `true` while part of the current frame is yet to reach the
+     * display.
+     */
+    bool busy() const noexcept
+    {
+        return m_frame.flushing() || m_chunk_length != 0 || m_transaction.result == I2CResult::Pending;
+    }
+
+    /**
+     * Submits the next chunk of the current frame if the previous chunk has
+     * been sent and the display has had time to settle.
+     *
+     * Must be called regularly from the main loop. Never blocks. Does not
+     * call `i2c_poll`, so that the callbacks of other devices are not run
+     * from here; the caller must poll the bus as well.
+     */
+    void service();
+};
+
+} // namespace subsonic_ipt
+
+#endif //SUBSONIC_IPT_LCD_WRITER_H
@@ -17,7 +17,7 @@
  */
 constexpr size_t DISPLAY_WIDTH = 20;
 
-void subsonic_ipt::ListViewMenu::refresh_display(SerLCD& lcd)
+void subsonic_ipt::ListViewMenu::refresh_display(Framebuffer& lcd)
 {
     m_content_changed = false;
 
@@ -25,7 +25,7 @@ void subsonic_ipt::ListViewMenu::refresh_display(SerLCD& lcd)
 
     // Determine which entries should be printed
     const size_t top_entry = m_selected_entry == max_index
-        ? max(m_selected_entry - 2, 0)
+        ? (m_selected_entry < 2 ? 0 : m_selected_entry - 2)
         : m_selected_entry == 0 ? 0 : m_selected_entry - 1;
     const size_t bottom_entry = min(top_entry + 2, entry_count() - 1);
 
@@ -12,7 +12,6 @@
 #ifndef SUBSONIC_IPT_LIST_VIEW_MENU_H
 #define SUBSONIC_IPT_LIST_VIEW_MENU_H
 
-#include "SerLCD.h"
 #include "ipt_menu.h"
 
 namespace subsonic_ipt {
@@ -67,7 +66,7 @@ class ListViewMenu : public IPTMenu {
   public:
     explicit ListViewMenu(IPTState* device_state) : IPTMenu(device_state) {}
 
-    void refresh_display(SerLCD& lcd) override;
+    void refresh_display(Framebuffer& lcd) override;
 
     void interact(const Input& input) override;
 
@@ -11,7 +11,7 @@
 #ifndef SUBSONIC_IPT_MENU_H
 #define SUBSONIC_IPT_MENU_H
 
-#include <SerLCD.h>
+#include "framebuffer.h"
 
 namespace subsonic_ipt {
 
@@ -44,9 +44,9 @@ class Menu {
     virtual const char* get_menu_name() const noexcept = 0;
 
     /**
-     * Writes this menu's representation to the given LCD.
+     * Renders this menu's representation into the given frame.
      */
-    virtual void refresh_display(SerLCD& lcd) = 0;
+    virtual void refresh_display(Framebuffer& lcd) = 0;
 
     /**
      * Updates that state of this menu according to the given user input.
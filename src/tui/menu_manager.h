@@ -16,7 +16,7 @@
 #include <assert.h>
 
 #include "menu.h"
-#include "SerLCD.h"
+#include "../profiler.h"
 
 namespace subsonic_ipt {
 
@@ -67,11 +67,13 @@ class MenuManager : public Menu {
 
     void interact(const Input& input) override;
 
-    void refresh_display(SerLCD& lcd) override
+    void refresh_display(Framebuffer& lcd) override
     {
-        // Clear and refresh the screen if either the state of this menu manager
-        // has changed or if the state of the currently displayed menu has
-        // changed.
+        SUBSONIC_PROFILE_SCOPE(profiler::Probe::RefreshDisplay);
+
+        // Redraw the frame if either the state of this menu manager has
+        // changed or if the state of the currently displayed menu has changed.
+        // Clearing the frame only blanks the cells that are not redrawn.
         if (m_content_changed || m_menus[m_current_menu]->content_changed()) {
             m_content_changed = false;
             lcd.clear();
@@ -84,7 +86,7 @@ class MenuManager : public Menu {
      * Helper function to print the titles of the menus contained in this menu
      * manager.
      */
-    static void lcd_print_title(SerLCD& lcd, const char* title, bool current, size_t count = MAX_MENU_NAME_LEN)
+    static void lcd_print_title(Framebuffer& lcd, const char* title, bool current, size_t count = MAX_MENU_NAME_LEN)
     {
         char title_buff[MAX_MENU_NAME_LEN + 1];
         memcpy(title_buff, title, count);
@@ -101,12 +103,12 @@ class MenuManager : public Menu {
      * Writes this menu manager's title bar to the given LCD and calls the
      * refresh display function of the currently active menu.
      */
-    void force_refresh_display(SerLCD& lcd);
+    void force_refresh_display(Framebuffer& lcd);
 
 };
 
 template<>
-void MenuManager<1>::force_refresh_display(SerLCD& lcd)
+void MenuManager<1>::force_refresh_display(Framebuffer& lcd)
 {
     lcd.setCursor(0, 0);
     lcd_print_title(lcd, m_menus[0]->get_menu_name(), true);
@@ -116,7 +118,7 @@ void MenuManager<1>::force_refresh_display(SerLCD& lcd)
 }
 
 template<>
-void MenuManager<2>::force_refresh_display(SerLCD& lcd)
+void MenuManager<2>::force_refresh_display(Framebuffer& lcd)
 {
     lcd.setCursor(0, 0);
     lcd_print_title(lcd, m_menus[0]->get_menu_name(), m_current_menu == 0);
@@ -128,7 +130,7 @@ void MenuManager<2>::force_refresh_display(SerLCD& lcd)
 }
 
 template<>
-void MenuManager<3>::force_refresh_display(SerLCD& lcd)
+void MenuManager<3>::force_refresh_display(Framebuffer& lcd)
 {
     lcd.setCursor(0, 0);
     lcd_print_title(lcd, m_menus[0]->get_menu_name(), m_current_menu == 0);
@@ -142,7 +144,7 @@ void MenuManager<3>::force_refresh_display(SerLCD& lcd)
 }
 
 template<size_t S>
-void MenuManager<S>::force_refresh_display(SerLCD& lcd)
+void MenuManager<S>::force_refresh_display(Framebuffer& lcd)
 {
     lcd.setCursor(0, 0);
 
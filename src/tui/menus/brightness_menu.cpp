@@ -17,7 +17,7 @@ const char* BrightnessMenu::get_menu_name() const noexcept
     return "DIM ";
 }
 
-void BrightnessMenu::refresh_display(SerLCD& lcd)
+void BrightnessMenu::refresh_display(Framebuffer& lcd)
 {
     // Only update the brightness if the refresh was caused by this
     // menu changing.
@@ -48,7 +48,7 @@ class BrightnessMenu : public Menu {
     [[nodiscard]]
     const char* get_menu_name() const noexcept override;
 
-    void refresh_display(SerLCD& lcd) override;
+    void refresh_display(Framebuffer& lcd) override;
 
     void interact(const Input& input) override;
 
@@ -10,8 +10,16 @@
 
 #include "debug_menu.h"
 
+#include "../../profiler.h"
+
 namespace subsonic_ipt {
 
+/**
+ * The number of entries that show the device's state, which come before the
+ * profiler's entries.
+ */
+constexpr size_t STATE_ENTRY_COUNT = 5;
+
 ListViewMenu::LabelStyle DebugMenu::label_style() const
 {
     return LabelStyle::Bullet;
@@ -19,7 +27,12 @@ ListViewMenu::LabelStyle DebugMenu::label_style() const
 
 size_t DebugMenu::entry_count() const
 {
-    return 4;
+#if SUBSONIC_PROFILE
+    // Each profiler probe has an entry after the readouts.
+    return STATE_ENTRY_COUNT + profiler::PROBE_COUNT;
+#else
+    return STATE_ENTRY_COUNT;
+#endif
 }
 
 bool DebugMenu::entry_is_active(size_t index) const
@@ -37,7 +50,7 @@ void DebugMenu::print_entry(char (& entry)[20], size_t index)
         case 1: {
             sprintf(entry + 5,
                 "Agl: %3d",
-                static_cast<int>(m_device_state->facing.deg()));
+                static_cast<int>(m_device_state->facing.deg<Scalar>()));
             break;
         }
 
@@ -56,8 +69,25 @@ void DebugMenu::print_entry(char (& entry)[20], size_t index)
                 static_cast<int>(m_device_state->device_motion.pitch),
                 static_cast<int>(m_device_state->device_motion.roll)
             );
+            break;
+        }
+        case 4: {
+            sprintf(entry + 5,
+                "Dst: %5d",
+                static_cast<int>(m_guidance->snapshot().distance));
+            break;
+        }
+        default: {
+#if SUBSONIC_PROFILE
+            // Shortest, mean and longest time in microseconds.
+            profiler::format_stats(
+                entry + 5,
+                sizeof(entry) - 5,
+                static_cast<profiler::Probe>(index - STATE_ENTRY_COUNT)
+            );
+#endif
+            break;
         }
-
     }
 }
 
@@ -66,7 +96,7 @@ const char* DebugMenu::get_menu_name() const noexcept
     return "DBUG";
 }
 
-void DebugMenu::refresh_display(SerLCD& lcd)
+void DebugMenu::refresh_display(Framebuffer& lcd)
 {
     // Update the last-refreshed timestamp during each screen refresh.
     m_last_refresh = millis();
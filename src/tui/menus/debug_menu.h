@@ -12,10 +12,17 @@
 #define SUBSONIC_IPT_DEBUG_MENU_H
 
 #include "../list_view_menu.h"
+#include "../../guidance.h"
 
 namespace subsonic_ipt {
 
 class DebugMenu : public ListViewMenu {
+    /**
+     * The directions to the current destination, shared with the sketch
+     * loop.
+     */
+    Guidance* const m_guidance;
+
     /**
      * The during in milliseconds that this screen should wait before
      * signalling for a refresh.
@@ -43,15 +50,16 @@ class DebugMenu : public ListViewMenu {
     void interact_entry(size_t index) override {}
 
   public:
-    explicit DebugMenu(IPTState* device_state, unsigned long refresh_timeout)
+    DebugMenu(IPTState* device_state, Guidance* guidance, unsigned long refresh_timeout)
         : ListViewMenu(device_state),
+          m_guidance(guidance),
           m_refresh_timeout(refresh_timeout),
           m_last_refresh(0) {}
 
     [[nodiscard]]
     const char* get_menu_name() const noexcept override;
 
-    void refresh_display(SerLCD& lcd) override;
+    void refresh_display(Framebuffer& lcd) override;
 
     [[nodiscard]]
     bool content_changed() const override;
@@ -42,5 +42,6 @@ void DestinationMenu::print_entry(char (& entry)[20], size_t index)
 void DestinationMenu::interact_entry(size_t index)
 {
     m_navigator->set_current_destination_index(index);
+    m_device_state->advance_epoch();
 }
 } //namespace subsonic_ipt
@@ -84,35 +84,19 @@ const char* GuidanceMenu::get_menu_name() const noexcept
     return "GUID";
 }
 
-void GuidanceMenu::refresh_display(SerLCD& lcd)
+void GuidanceMenu::refresh_display(Framebuffer& lcd)
 {
     print_screen_title(lcd);
 
-    const auto direction = m_navigator->compute_direction(
-        m_device_state->position,
-        m_device_state->facing
-    );
+    const GuidanceSnapshot& guidance = m_guidance->snapshot();
 
-    constexpr Angle backwards = Angle{M_PI};
-    const auto travel_angle = direction.angle();
-
-    // Whether the travel angle is within the snap tolerance of the forward direction.
-    bool near_forward = ((travel_angle < m_snap_tolerance) || (travel_angle > m_snap_tolerance.conjugate()));
-    // Whether the travel angle is with the snap tolerance of the backward direction.
-    bool near_backward = (travel_angle > (backwards - m_snap_tolerance))
-        && (travel_angle < (backwards + m_snap_tolerance));
-
-    const auto dist_meters = direction.norm();
     char dist_buff[DIST_WIDTH];
-    format_distance(
-        dist_buff,
-        abs(meters_to_unit(dist_meters, m_device_state->localized_unit))
-    );
+    format_distance(dist_buff, guidance.localized_distance);
     // Uncomment the below to override the "rich" formatting of the distance
     // of the distance display. Useful for debugging the display of very large
     // of very small distances due to the user selecting unusual units of
     // measurement.
-//    snprintf(dist_buff, DIST_WIDTH, "%3d", static_cast<int>(abs(meters_to_unit(dist_meters, m_device_state->localized_unit))));
+//    snprintf(dist_buff, DIST_WIDTH, "%3d", static_cast<int>(guidance.localized_distance));
     const char* symbol = unit_symbol(m_device_state->localized_unit);
 
     lcd.setCursor(20 - DIST_WIDTH - strlen(symbol), 2);
@@ -121,17 +105,15 @@ void GuidanceMenu::refresh_display(SerLCD& lcd)
 
 
     lcd.setCursor(0, 3);
-    // When the device is at its original position, we denote the travel angle
-    // as NaN. When this occurs, invoke the forward handler.
-    if (direction.norm() <= m_arrival_tolerance || travel_angle.is_nan()) {
+    if (guidance.arrived) {
         lcd.print("You Have Arrived");
-    } else if (near_forward) {
+    } else if (guidance.near_forward) {
         lcd.print("Go forward ");
-    } else if (near_backward) {
+    } else if (guidance.near_backward) {
         lcd.print("Turn around");
-    } else if (direction.m_y > 0) {
+    } else if (guidance.direction.m_y > 0) {
         lcd.print("Turn ");
-        lcd.print(static_cast<int>(direction.angle().deg()));
+        lcd.print(static_cast<int>(guidance.relative_angle.deg<Scalar>()));
         if constexpr (INVERT_LEFT_RIGHT) {
             lcd.print("* Right");
         } else {
@@ -139,7 +121,7 @@ void GuidanceMenu::refresh_display(SerLCD& lcd)
         }
     } else {
         lcd.print("Turn ");
-        lcd.print(360 - static_cast<int>(direction.angle().deg()));
+        lcd.print(360 - static_cast<int>(guidance.relative_angle.deg<Scalar>()));
         if constexpr (INVERT_LEFT_RIGHT) {
             lcd.print("* Left");
         } else {
@@ -162,6 +144,9 @@ void GuidanceMenu::interact(const Menu::Input& input)
     if (input.enter) {
         m_navigator->overwrite_destination(m_device_state->position);
     }
+    if (input.up || input.down || input.enter) {
+        m_device_state->advance_epoch();
+    }
 }
 
 bool GuidanceMenu::content_changed() const
@@ -12,11 +12,10 @@
 #ifndef SUBSONIC_IPT_GUIDANCE_MENU_H
 #define SUBSONIC_IPT_GUIDANCE_MENU_H
 
-#include "SerLCD.h"
-
 #include "../menu.h"
 #include "../ipt_menu.h"
 #include "../../state.h"
+#include "../../guidance.h"
 #include "../../navigator.h"
 
 namespace subsonic_ipt {
@@ -29,23 +28,10 @@ class GuidanceMenu : public IPTMenu {
     Navigator* const m_navigator;
 
     /**
-     * The tolerance used when determining whether the user needs to travel
-     * "forward" or "backward".
-     *
-     * Angles within this tolerance of `0` or `pi` radians will result in
-     * the direction "snapping" to a forward or backward directions instead of
-     * a small rotation direction.
-     */
-    const Angle m_snap_tolerance;
-
-    /**
-     * The tolerance used when determining whether the user has arrived at
-     * a waypoint.
-     *
-     * Whenever the user is within this distance in meters of a waypoint, they
-     * will receive a "you have arrived" message instead of a direction.
+     * The directions to the current destination, shared with the sketch
+     * loop.
      */
-    const double m_arrival_tolerance;
+    Guidance* const m_guidance;
 
     /**
      * The time in milliseconds that this screen should wait before signalling
@@ -63,21 +49,19 @@ class GuidanceMenu : public IPTMenu {
     explicit GuidanceMenu(
         IPTState* device_state,
         Navigator* navigator,
-        Angle snap_tolerance,
-        double arrival_tolerance,
+        Guidance* guidance,
         unsigned long refresh_timeout
     )
         : IPTMenu(device_state),
           m_navigator(navigator),
-          m_snap_tolerance(snap_tolerance),
-          m_arrival_tolerance(arrival_tolerance),
+          m_guidance(guidance),
           m_refresh_timeout(refresh_timeout),
           m_last_refresh(0) {}
 
     [[nodiscard]]
     const char* get_menu_name() const noexcept override;
 
-    void refresh_display(SerLCD& lcd) override;
+    void refresh_display(Framebuffer& lcd) override;
 
     void interact(const Input& input) override;
 
@@ -89,7 +73,7 @@ class GuidanceMenu : public IPTMenu {
      * Prints the waypoint title to the lcd screen that is common to all
      * direction messages.
      */
-    void print_screen_title(SerLCD& lcd)
+    void print_screen_title(Framebuffer& lcd)
     {
         lcd.print("Navigating to");
         lcd.setCursor(17, 1);
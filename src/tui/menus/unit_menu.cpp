@@ -61,6 +61,7 @@ void UnitMenu::print_entry(char (& entry)[20], size_t index)
 void UnitMenu::interact_entry(size_t index)
 {
     m_device_state->localized_unit = ALL_UNITS[index];
+    m_device_state->advance_epoch();
 }
 
 const char* UnitMenu::get_menu_name() const noexcept
@@ -1,8 +1,42 @@
+#include "../src/async_i2c.h"
+#include "../src/crc16.h"
+#include "../src/dead_reckoning.h"
+#include "../src/guidance.h"
+#include "../src/inputs/buttons.h"
+#include "../src/inputs/dmp_math.h"
+#include "../src/inputs/dmp_packet.h"
+#include "../src/inputs/gyro_bias.h"
+#include "../src/inputs/mpu.h"
+#include "../src/inputs/mpu_calibration.h"
 #include "../src/navigator.h"
+#include "../src/pin.h"
+#include "../src/profiler.h"
+#include "../src/ring_buffer.h"
+#include "../src/scheduler.h"
+#include "../src/spsc_ring.h"
+#include "../src/telemetry.h"
+#include "../src/tui/framebuffer.h"
+#include "../src/tui/lcd_writer.h"
 
 #include <iostream>
 #include <algorithm>
+#include <atomic>
 #include <array>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <avr/eeprom.h>
+
+#include "dmp_batch.h"
+#include "host.h"
+#include "i2c_device.h"
+#include "motion.h"
+#include "mpu6050_emulator.h"
+#include "openlcd.h"
+#include "work_stealing_pool.h"
 
 #define TEST_CASE(LABEL) test_case_t{LABEL, #LABEL}
 
@@ -14,6 +48,21 @@ using namespace subsonic_ipt;
 
 constexpr double POINT_TOLERANCE{1e-8};
 
+/// Tolerance for fixed-point results compared against the double reference.
+constexpr double FIXED_TOLERANCE{1e-4};
+
+/// Tolerance for trigonometry at the accuracy level selected in fast_trig.h.
+constexpr double TRIG_TOLERANCE{
+    fast_trig::TRIG_ACCURACY == fast_trig::TrigAccuracy::TableNearest ? 7e-3 : FIXED_TOLERANCE
+};
+
+/// Tolerance for results computed with the sketch's selected scalar type.
+constexpr double SCALAR_TOLERANCE{
+    std::is_same_v<Scalar, double> && fast_trig::TRIG_ACCURACY == fast_trig::TrigAccuracy::Library
+        ? POINT_TOLERANCE
+        : TRIG_TOLERANCE
+};
+
 /// Trivial structure representing a labeled test case.
 struct test_case_t {
     bool (* body)();
@@ -25,19 +74,1394 @@ bool test_navigator_directions()
 {
     Navigator nav{};
 
-    nav.apply_displacement(Point{10, 0});
+    Point direction = nav.compute_direction(Point{10, 0}, Rotation{});
 
-    Point direction = nav.compute_direction();
+    const Point expected{-10, 0};
+    if (direction.dist_to(expected) > SCALAR_TOLERANCE * (1 + expected.norm())) {
+        return false;
+    }
+    return true;
+}
+
+/// Returns the absolute difference between two angles, modulo 2pi.
+double angle_error(double first, double second)
+{
+    return std::fabs(std::remainder(first - second, 2 * M_PI));
+}
+
+/// Deterministic pseudo-random value in [low, high).
+double next_uniform(uint32_t& state, double low, double high)
+{
+    state = state * 1664525u + 1013904223u;
+    return low + (high - low) * (state >> 8u) / static_cast<double>(1u << 24u);
+}
+
+bool test_fixed_arithmetic()
+{
+    const Fixed a{1.5};
+    const Fixed b{-2.25};
+    if (static_cast<double>(a + b) != -0.75 || static_cast<double>(a * b) != -3.375) {
+        return false;
+    }
+    // Overflow saturates instead of wrapping.
+    if (Fixed{30000} + Fixed{30000} != Fixed::from_raw(Fixed::MAX_RAW)
+        || Fixed{-30000} - Fixed{30000} != Fixed::from_raw(Fixed::MIN_RAW)
+        || Fixed{300} * Fixed{-300} != Fixed::from_raw(Fixed::MIN_RAW)) {
+        return false;
+    }
+    // NaN propagates through arithmetic.
+    if (!isnan(Fixed{NAN} + a) || !isnan(a * Fixed::nan()) || !isnan(-Fixed::nan())) {
+        return false;
+    }
+    for (unsigned long micros : {0ul, 1ul, 999ul, 10000ul, 5500000ul, 30000000ul}) {
+        const double seconds = static_cast<double>(seconds_from_micros<Fixed>(micros));
+        if (std::fabs(seconds - seconds_from_micros<double>(micros)) > 2.0 / Fixed::ONE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool test_fixed_trig_accuracy()
+{
+    for (double rad = -20; rad < 20; rad += 0.0007) {
+        const Fixed angle{rad};
+        const double exact = static_cast<double>(angle);
+        if (std::fabs(static_cast<double>(sin(angle)) - std::sin(exact)) > TRIG_TOLERANCE
+            || std::fabs(static_cast<double>(cos(angle)) - std::cos(exact)) > TRIG_TOLERANCE) {
+            return false;
+        }
+    }
+    uint32_t state = 1;
+    for (int i = 0; i < 20000; ++i) {
+        // Span several orders of magnitude, including the axes.
+        const double scale = std::pow(10.0, next_uniform(state, -3, 4));
+        double x = next_uniform(state, -scale, scale);
+        double y = next_uniform(state, -scale, scale);
+        if (i % 10 == 0) { x = 0; }
+        if (i % 10 == 1) { y = 0; }
+        const BasicPoint<Fixed> fixed{x, y};
+        const BasicPoint<double> reference{static_cast<double>(fixed.m_x), static_cast<double>(fixed.m_y)};
+
+        const double norm = reference.norm();
+        if (std::fabs(static_cast<double>(fixed.norm()) - norm) > FIXED_TOLERANCE * (1 + norm)) {
+            return false;
+        }
+        if (reference.angle().is_nan() != fixed.angle().is_nan()) {
+            return false;
+        }
+        // Angles of vectors shorter than the fixed-point resolution are
+        // meaningless, so only compare well-resolved vectors.
+        if (norm > 1 && angle_error(static_cast<double>(fixed.angle().m_rad), reference.angle().m_rad) > TRIG_TOLERANCE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool test_fixed_navigator_matches_double()
+{
+    BasicNavigator<double> reference_nav{};
+    BasicNavigator<Fixed> fixed_nav{};
+
+    uint32_t state = 7;
+    for (int i = 0; i < 5000; ++i) {
+        const BasicPoint<Fixed> dest{next_uniform(state, -1000, 1000), next_uniform(state, -1000, 1000)};
+        const BasicPoint<Fixed> pos{next_uniform(state, -1000, 1000), next_uniform(state, -1000, 1000)};
+        const auto facing = BinaryAngle::from_degrees(next_uniform(state, 0, 360));
+
+        fixed_nav.overwrite_destination(dest);
+        reference_nav.overwrite_destination({static_cast<double>(dest.m_x), static_cast<double>(dest.m_y)});
+
+        const auto fixed = fixed_nav.compute_direction(pos, BasicRotation<Fixed>::from_angle(facing));
+        const auto reference = reference_nav.compute_direction(
+            {static_cast<double>(pos.m_x), static_cast<double>(pos.m_y)},
+            BasicRotation<double>::from_angle(facing)
+        );
+        const BasicPoint<double> error{
+            static_cast<double>(fixed.m_x) - reference.m_x,
+            static_cast<double>(fixed.m_y) - reference.m_y,
+        };
+        if (error.norm() > FIXED_TOLERANCE * (1 + reference.norm())) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    if (direction.dist_to(Point{-10, 0}) > POINT_TOLERANCE) {
+bool test_binary_angle()
+{
+    // Arithmetic wraps around a full turn.
+    const auto quarter = BinaryAngle::from_degrees(90);
+    const auto three_quarters = BinaryAngle::from_degrees(270);
+    if (quarter + three_quarters != BinaryAngle{} || quarter - three_quarters != BinaryAngle::from_degrees(180)) {
+        return false;
+    }
+    if (quarter.conjugate() != three_quarters || !(quarter < three_quarters)) {
         return false;
     }
+    // Negative and out-of-range radians normalize onto [0, 2pi).
+    if (BinaryAngle::from_radians(-M_PI / 2) != three_quarters
+        || BinaryAngle::from_radians(5 * M_PI / 2) != quarter
+        || BinaryAngle::from_radians(Fixed{-M_PI / 2}) != three_quarters) {
+        return false;
+    }
+
+    // Conversions round trip to within half a step.
+    constexpr double step = 2 * M_PI / BinaryAngle::STEPS_PER_TURN;
+    uint32_t state = 3;
+    for (int i = 0; i < 10000; ++i) {
+        const double rad = next_uniform(state, -4 * M_PI, 4 * M_PI);
+        const auto from_double = BinaryAngle::from_radians(rad);
+        const auto from_fixed = BinaryAngle::from_radians(Fixed{rad});
+        if (angle_error(from_double.radians<double>(), rad) > step / 2 + 1e-12
+            || angle_error(from_fixed.radians<double>(), rad) > step) {
+            return false;
+        }
+        // Fixed-point conversions are accurate to their last bit.
+        constexpr double lsb = 1.0 / Fixed::ONE;
+        if (std::fabs(static_cast<double>(from_double.radians<Fixed>()) - from_double.radians<double>()) > lsb
+            || std::fabs(static_cast<double>(from_double.deg<Fixed>()) - from_double.deg<double>()) > lsb) {
+            return false;
+        }
+        if (Angle::from_binary(from_double).binary() != from_double) {
+            return false;
+        }
+    }
     return true;
 }
 
+bool test_rotation_matches_angles()
+{
+    uint32_t state = 5;
+    for (int i = 0; i < 5000; ++i) {
+        const BasicPoint<double> point{next_uniform(state, -1000, 1000), next_uniform(state, -1000, 1000)};
+        const auto facing = BinaryAngle::from_degrees(next_uniform(state, 0, 360));
+        const auto rotation = BasicRotation<double>::from_angle(facing);
+
+        // Rotating by -facing agrees with decomposing the point into its
+        // norm and angle. Both paths, and the round trip, accumulate the
+        // error of several trigonometric functions.
+        const BasicAngle<double> relative{point.angle().m_rad - facing.radians<double>()};
+        const auto expected = point.norm() * BasicPoint<double>::unit_from_angle(relative);
+        const double tolerance = 3 * SCALAR_TOLERANCE * (1 + point.norm());
+        if (rotation.rotate_inverse(point).dist_to(expected) > tolerance) {
+            return false;
+        }
+        if (rotation.rotate(rotation.rotate_inverse(point)).dist_to(point) > tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool test_guidance_snapshot_epoch()
+{
+    IPTState state{};
+    Navigator nav{};
+    nav.overwrite_destination(Point{0, 10});
+    Guidance guidance(&state, &nav, BinaryAngle::from_degrees(10), 1);
+
+    const auto& first = guidance.snapshot();
+    if (std::fabs(static_cast<double>(first.distance) - 10) > SCALAR_TOLERANCE * 11 || first.arrived) {
+        return false;
+    }
+    // Destination straight to the left.
+    if (first.near_forward || first.near_backward || first.direction.m_y < 0) {
+        return false;
+    }
+
+    // Changes are not observed until the epoch advances.
+    state.position = Point{0, 9.5};
+    if (guidance.snapshot().arrived) {
+        return false;
+    }
+    state.advance_epoch();
+    if (!guidance.snapshot().arrived) {
+        return false;
+    }
+
+    state.update_facing(BinaryAngle::from_degrees(90));
+    state.position = Point{0, -5};
+    state.advance_epoch();
+    const auto& facing_destination = guidance.snapshot();
+    return facing_destination.near_forward && !facing_destination.arrived
+        && std::fabs(facing_destination.localized_distance - 15) < SCALAR_TOLERANCE * 16;
+}
+
+bool test_fast_trig_accuracy()
+{
+    using fast_trig::Phase;
+    using fast_trig::SinCos;
+
+    // The largest errors, in radians or unit lengths, that each
+    // implementation may make against the C library.
+    constexpr double NEAREST_TOLERANCE{7e-3};
+    constexpr double PRECISE_TOLERANCE{1e-4};
+
+    const auto sin_cos_error = [](SinCos value, double angle) {
+        return std::max(
+            std::fabs(value.sin / 65536.0 - std::sin(angle)),
+            std::fabs(value.cos / 65536.0 - std::cos(angle))
+        );
+    };
+
+    uint32_t state = 11;
+    for (int i = 0; i < 20000; ++i) {
+        const auto phase = static_cast<Phase>(next_uniform(state, 0, 4294967296.0));
+        const double angle = phase * (2 * M_PI / 4294967296.0);
+        if (sin_cos_error(fast_trig::table_sin_cos(phase, false), angle) > NEAREST_TOLERANCE
+            || sin_cos_error(fast_trig::table_sin_cos(phase, true), angle) > PRECISE_TOLERANCE
+            || sin_cos_error(fast_trig::cordic_sin_cos(phase, 16), angle) > PRECISE_TOLERANCE) {
+            return false;
+        }
+
+        const auto x = static_cast<int32_t>(next_uniform(state, -2e9, 2e9));
+        const auto y = static_cast<int32_t>(next_uniform(state, -2e9, 2e9));
+        const double reference = std::atan2(y, x);
+        const auto atan2_error = [reference](Phase result) {
+            return angle_error(result * (2 * M_PI / 4294967296.0), reference);
+        };
+        if (atan2_error(fast_trig::table_atan2(y, x, false)) > NEAREST_TOLERANCE
+            || atan2_error(fast_trig::table_atan2(y, x, true)) > PRECISE_TOLERANCE
+            || atan2_error(fast_trig::cordic_atan2(y, x, 16)) > PRECISE_TOLERANCE
+            || angle_error(fast_trig::atan2(y * 1e-3, x * 1e-3), reference) > NEAREST_TOLERANCE) {
+            return false;
+        }
+    }
+    // Axis-aligned vectors and the zero vector.
+    return fast_trig::table_atan2(0, 5, true) == 0
+        && fast_trig::table_atan2(0, -5, true) == static_cast<Phase>(1) << 31u
+        && fast_trig::table_atan2(0, 0, true) == 0;
+}
+
+bool test_ring_buffer_order()
+{
+    RingBuffer<int, 3> ring;
+    if (!ring.empty() || ring.full()) {
+        return false;
+    }
+
+    // Wrap around the end of the storage several times.
+    int next_pushed = 0;
+    int next_popped = 0;
+    for (int round = 0; round < 5; ++round) {
+        while (!ring.full()) {
+            ring.back() = next_pushed++;
+            ring.push();
+        }
+        if (ring.push(-1) || ring.size() != 3) {
+            return false;
+        }
+        // Leave one element behind so that the head moves each round.
+        while (ring.size() > 1) {
+            if (ring.front() != next_popped++) {
+                return false;
+            }
+            ring.pop();
+        }
+    }
+    ring.clear();
+    return ring.empty() && ring.push(7) && ring.front() == 7;
+}
+
+bool test_spsc_ring_threads()
+{
+    // Timestamped events, as pushed by the MPU interrupt.
+    struct Event {
+        unsigned long capture_u;
+        uint16_t check;
+    };
+    constexpr unsigned long EVENT_COUNT{200000};
+    SpscRing<Event, 8> ring;
+
+    // A thread stands in for the interrupt handler.
+    std::thread producer([&ring]() {
+        for (unsigned long i = 0; i < EVENT_COUNT; ++i) {
+            while (!ring.push({i, static_cast<uint16_t>(i * 7919u)})) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    bool ordered = true;
+    for (unsigned long expected = 0; expected < EVENT_COUNT;) {
+        if (ring.empty()) {
+            std::this_thread::yield();
+            continue;
+        }
+        ordered &= ring.size() != 0 && ring.size() <= ring.capacity();
+        const Event& event = ring.front();
+        ordered &= event.capture_u == expected && event.check == static_cast<uint16_t>(expected * 7919u);
+        ring.pop();
+        ++expected;
+    }
+    producer.join();
+    return ordered && ring.empty();
+}
+
+/// Simulated I2C device with a small auto-incrementing register file.
+class RegisterDevice : public host::I2CDevice {
+  public:
+    uint8_t registers[16]{};
+    uint8_t pointer{0};
+
+    void on_write(const uint8_t* data, size_t length) override
+    {
+        pointer = data[0];
+        for (size_t i = 1; i < length; ++i) {
+            registers[pointer++ % 16] = data[i];
+        }
+    }
+
+    size_t on_read(uint8_t* data, size_t length) override
+    {
+        for (size_t i = 0; i < length; ++i) {
+            data[i] = registers[pointer++ % 16];
+        }
+        return length;
+    }
+};
+
+bool test_async_i2c_transactions()
+{
+    constexpr uint8_t ADDRESS{0x30};
+    RegisterDevice device;
+    host::attach_i2c_device(ADDRESS, &device);
+    i2c_begin(400000);
+
+    int completions = 0;
+    const auto count_completion = [](I2CTransaction& transaction) {
+        ++*static_cast<int*>(transaction.context);
+    };
+    const uint8_t write_data[]{2, 0xAB, 0xCD};
+    const uint8_t select_register{2};
+    uint8_t read_data[2]{};
+    uint8_t unread{};
+    I2CTransaction store{ADDRESS, write_data, 3, nullptr, 0, count_completion, &completions, I2CResult::Success};
+    I2CTransaction load{ADDRESS, &select_register, 1, read_data, 2, count_completion, &completions, I2CResult::Success};
+    I2CTransaction missing{ADDRESS + 1, &select_register, 1, &unread, 1, count_completion, &completions, I2CResult::Success};
+    if (!i2c_submit(store) || !i2c_submit(load) || !i2c_submit(missing)) {
+        return false;
+    }
+    // A transaction cannot be queued again until it has completed.
+    if (i2c_submit(store)) {
+        return false;
+    }
+
+    // Nothing completes until the bus has had time to clock the bytes.
+    i2c_poll();
+    if (completions != 0 || i2c_idle()) {
+        return false;
+    }
+    i2c_wait_idle();
+    i2c_poll();
+    host::attach_i2c_device(ADDRESS, nullptr);
+
+    return completions == 3
+        && store.result == I2CResult::Success
+        && load.result == I2CResult::Success
+        && read_data[0] == 0xAB && read_data[1] == 0xCD
+        && missing.result == I2CResult::AddressNack;
+}
+
+/**
+ * Returns the number of scheduler passes taken to read several registers
+ * while the tasks keep the CPU busy.
+ */
+template<uint8_t N>
+int passes_to_read(Scheduler<N>& scheduler, RegisterDevice& device)
+{
+    const uint8_t select_register{0};
+    uint8_t read_data[8]{};
+    I2CTransaction load{0x30, &select_register, 1, read_data, 8, nullptr, nullptr, I2CResult::Success};
+    host::attach_i2c_device(load.address, &device);
+    i2c_begin(400000);
+    if (!i2c_submit(load)) {
+        return -1;
+    }
+    scheduler.start();
+    int passes = 0;
+    while (load.result == I2CResult::Pending && passes < 100) {
+        scheduler.run_pass();
+        ++passes;
+    }
+    host::attach_i2c_device(load.address, nullptr);
+    return load.result == I2CResult::Success && read_data[7] == device.registers[7] ? passes : -1;
+}
+
+bool test_i2c_between_tasks()
+{
+    RegisterDevice device;
+    for (uint8_t i = 0; i < 8; ++i) {
+        device.registers[i] = static_cast<uint8_t>(0x10 + i);
+    }
+    // Each task outlasts a byte on the bus. The first polls the I2C engine,
+    // as the IMU task does.
+    constexpr Task tasks[]{
+        {"imu", [] { i2c_poll(); delayMicroseconds(50); }, 0, 1000, 0},
+        {"a", [] { delayMicroseconds(50); }, 0, 1000, 1},
+        {"b", [] { delayMicroseconds(50); }, 0, 1000, 2},
+        {"c", [] { delayMicroseconds(50); }, 0, 1000, 3},
+    };
+    // The read takes 13 bus operations, one for each start condition,
+    // address and byte. Advancing the bus after each task overlaps several
+    // of them with each pass.
+    Scheduler advancing{tasks, i2c_advance};
+    const int overlapped = passes_to_read(advancing, device);
+    if (overlapped < 1 || overlapped > 3) {
+        return false;
+    }
+    // Otherwise, the polled engine only moves once per pass.
+    Scheduler polling{tasks};
+    const int stepped = passes_to_read(polling, device);
+    return SUBSONIC_TWI_ISR ? stepped <= 3 : stepped >= 13;
+}
+
+/// Stream that records the bytes written to it.
+class ByteSink : public Print {
+  public:
+    std::vector<uint8_t> bytes;
+    /// The space reported to be free in the stream's transmit buffer.
+    int room{0};
+
+    size_t write(uint8_t b) override
+    {
+        bytes.push_back(b);
+        return 1;
+    }
+
+    int availableForWrite() override
+    {
+        return room;
+    }
+
+    using Print::write;
+};
+
+bool test_framebuffer_diff()
+{
+    Framebuffer frame;
+    ByteSink sink;
+
+    // The first flush repaints every cell, moving the cursor only once since
+    // the display wraps from each row to the next.
+    frame.print("Hello");
+    if (frame.flush_to(sink) != 2 + Framebuffer::ROWS * Framebuffer::COLUMNS
+        || sink.bytes[0] != 254 || sink.bytes[1] != 0x80 || sink.bytes[2] != 'H') {
+        return false;
+    }
+
+    // Redrawing the same frame sends nothing.
+    sink.bytes.clear();
+    frame.clear();
+    frame.println("Hello");
+    if (frame.flush_to(sink) != 0) {
+        return false;
+    }
+
+    // Changes separated by a short gap are sent as one run, while distant
+    // changes each get a cursor move. Row 2 starts at address 0x14.
+    frame.setCursor(3, 2);
+    frame.print("ab c");
+    frame.setCursor(15, 2);
+    frame.print('d');
+    frame.flush_to(sink);
+    const std::vector<uint8_t> expected{254, 0x80 | 0x17, 'a', 'b', ' ', 'c', 254, 0x80 | 0x23, 'd'};
+    if (sink.bytes != expected || frame.cell(15, 2) != 'd') {
+        return false;
+    }
+
+    // Text past the end of a row continues on the next one.
+    frame.setCursor(19, 0);
+    frame.print("xy");
+    if (frame.cell(19, 0) != 'x' || frame.cell(0, 1) != 'y') {
+        return false;
+    }
+
+    // A backlight change is sent whole at the start of the next flush.
+    sink.bytes.clear();
+    frame.flush_to(sink);
+    frame.setBacklight(0x10FF00);
+    uint8_t chunk[5];
+    return frame.flushing() && frame.next_chunk(chunk, sizeof(chunk)) == 5
+        && chunk[0] == 0x7C && chunk[1] == 0x2B && chunk[2] == 0x10 && chunk[3] == 0xFF && chunk[4] == 0x00
+        && !frame.flushing();
+}
+
+bool test_lcd_writer_chunks()
+{
+    constexpr uint8_t ADDRESS{0x72};
+    host::OpenLCD display;
+    host::attach_i2c_device(ADDRESS, &display);
+    i2c_begin(400000);
+
+    Framebuffer frame;
+    LcdWriter writer(frame, ADDRESS);
+    frame.print("Subsonic IPT");
+    frame.setCursor(0, 3);
+    frame.print("Line four wraps around");
+    writer.begin_frame();
+
+    // Each call submits at most one chunk, so the frame takes several calls.
+    int calls = 0;
+    while (writer.busy() && calls < 10000) {
+        writer.service();
+        i2c_poll();
+        delayMicroseconds(100);
+        ++calls;
+    }
+    // Release the last chunk, which refers to the writer.
+    i2c_poll();
+    host::attach_i2c_device(ADDRESS, nullptr);
+
+    const uint64_t bytes_sent = 2 + Framebuffer::ROWS * Framebuffer::COLUMNS;
+    if (writer.busy() || display.bytes_received() != bytes_sent || static_cast<uint64_t>(calls) < bytes_sent / SUBSONIC_LCD_CHUNK) {
+        return false;
+    }
+    for (uint8_t row = 0; row < Framebuffer::ROWS; ++row) {
+        for (uint8_t col = 0; col < Framebuffer::COLUMNS; ++col) {
+            if (display.at(col, row) != frame.cell(col, row)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool test_telemetry_frames()
+{
+    using namespace telemetry;
+
+    // COBS round trips data with zeros and with runs longer than one block.
+    std::vector<uint8_t> data(600);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(i < 300 ? i % 7 : 1 + i % 255);
+    }
+    std::vector<uint8_t> encoded(data.size() + data.size() / 254 + 1);
+    std::vector<uint8_t> decoded(encoded.size());
+    const size_t encoded_size = cobs_encode(data.data(), data.size(), encoded.data());
+    if (std::count(encoded.begin(), encoded.begin() + encoded_size, 0) != 0
+        || cobs_decode(encoded.data(), encoded_size, decoded.data()) != data.size()
+        || !std::equal(data.begin(), data.end(), decoded.begin())) {
+        return false;
+    }
+
+    // The check value of CRC-16/CCITT-FALSE.
+    const uint8_t check[]{'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    if (crc16(check, sizeof(check)) != 0x29B1) {
+        return false;
+    }
+
+    // Records survive the stream, and are dropped when the port is full.
+    ByteSink port;
+    TelemetryStream stream(port);
+    MotionRecord record{};
+    record.timestamp_u = 123456789;
+    record.x = -1.5f;
+    record.y = 1e3f;
+    record.facing = 0x8000;
+    record.ypr[0] = 0xFFFF;
+    record.world_accel[2] = -4096;
+    record.latency_u = 1500;
+    record.fifo_count = 42;
+    port.room = MOTION_FRAME_SIZE - 1;
+    if (stream.send(record) || stream.dropped() != 1 || !port.bytes.empty()) {
+        return false;
+    }
+    port.room = MOTION_FRAME_SIZE;
+    if (!stream.send(record) || port.bytes.size() != MOTION_FRAME_SIZE
+        || port.bytes.front() != 0 || port.bytes.back() != 0) {
+        return false;
+    }
+    MotionRecord received{};
+    if (!decode_motion(&port.bytes[1], MOTION_FRAME_SIZE - 2, received)
+        || received.sequence != 1 || received.dropped != 1
+        || received.timestamp_u != record.timestamp_u
+        || received.x != record.x || received.y != record.y
+        || received.facing != record.facing || received.ypr[0] != record.ypr[0]
+        || received.world_accel[2] != record.world_accel[2]
+        || received.latency_u != record.latency_u
+        || received.fifo_count != record.fifo_count) {
+        return false;
+    }
+
+    // Corruption is caught by the CRC.
+    port.bytes[10] ^= 0x10;
+    return !decode_motion(&port.bytes[1], MOTION_FRAME_SIZE - 2, received);
+}
+
 /// All test cases that will be run.
+bool test_button_events()
+{
+    constexpr Pin ENTER{static_cast<Pin>(ButtonPin::Enter)};
+    constexpr Pin LEFT{static_cast<Pin>(ButtonPin::Left)};
+    setup_buttons();
+
+    std::vector<ButtonEvent> events;
+    const auto settle = [&events](unsigned long duration_u) {
+        for (unsigned long elapsed = 0; elapsed < duration_u; elapsed += 1000) {
+            delayMicroseconds(1000);
+            refresh_buttons();
+            ButtonEvent event{};
+            while (next_button_event(event)) {
+                events.push_back(event);
+            }
+        }
+    };
+    const auto bounce = [](Pin pin, bool high) {
+        for (int i = 0; i < 4; ++i) {
+            host::set_pin_level(pin, (i % 2 == 0) == high);
+            delayMicroseconds(500);
+        }
+        host::set_pin_level(pin, high);
+    };
+
+    // A bouncing press and release of Enter are each reported once, timed
+    // from their first edge.
+    const auto press_u = micros();
+    bounce(ENTER, false);
+    if (!button_closed(ButtonEnter) || button_closed(ButtonLeft)) {
+        return false;
+    }
+    settle(100000);
+    const auto release_u = micros();
+    bounce(ENTER, true);
+    settle(100000);
+
+    // A tap shorter than the debounce interval is reported when the interval
+    // ends, from the main loop rather than an interrupt.
+    host::set_pin_level(LEFT, false);
+    delayMicroseconds(2000);
+    host::set_pin_level(LEFT, true);
+    settle(100000);
+
+    return events.size() == 4
+           && events[0].button == ButtonEnter && events[0].closed && events[0].time_u - press_u < 100
+           && events[1].button == ButtonEnter && !events[1].closed && events[1].time_u - release_u < 100
+           && events[2].button == ButtonLeft && events[2].closed
+           && events[3].button == ButtonLeft && !events[3].closed
+           && events[3].time_u - events[2].time_u >= SUBSONIC_BUTTON_DEBOUNCE_US
+           && button_open(static_cast<Button>(ButtonEnter | ButtonLeft));
+}
+
+bool test_calibration_storage()
+{
+    host::erase_eeprom();
+    const uint16_t first_boot = count_boot();
+    MpuCalibration loaded{};
+    if (first_boot != 0 || load_calibration(loaded, first_boot, 0) != CalibrationStatus::Missing) {
+        return false;
+    }
+
+    const MpuCalibration stored{{-40, 30, -60}, {-47, 25, -19}, -3920, first_boot};
+    store_calibration(stored);
+    const uint16_t boot = count_boot();
+    if (boot != first_boot + 1 || load_calibration(loaded, boot, -3920 + 340) != CalibrationStatus::Valid
+        || loaded.accel_offsets[2] != -60 || loaded.gyro_offsets[0] != -47 || loaded.boot != first_boot) {
+        return false;
+    }
+
+    // Stale and drifted calibrations are still loaded, but reported as such.
+    const bool checks = load_calibration(loaded, first_boot + SUBSONIC_CALIBRATION_MAX_BOOTS + 1, -3920) == CalibrationStatus::Expired
+        && load_calibration(loaded, boot, -3920 - 340 * (SUBSONIC_CALIBRATION_MAX_DRIFT_C + 1)) == CalibrationStatus::TemperatureDrift;
+
+    // Any corrupted byte is caught by the CRC.
+    auto* const offset_byte = reinterpret_cast<uint8_t*>(SUBSONIC_CALIBRATION_EEPROM_ADDRESS + 4);
+    eeprom_write_byte(offset_byte, static_cast<uint8_t>(eeprom_read_byte(offset_byte) ^ 0x10u));
+    return checks && load_calibration(loaded, boot, -3920) == CalibrationStatus::Missing;
+}
+
+bool test_gyro_bias_stillness()
+{
+    GyroBiasTracker tracker;
+    const VectorInt16 at_rest(20, -30, 5);
+    int completed = 0;
+
+    // A bias of 10, -7 and 3 LSB with a little noise, held still.
+    const auto still_packet = [&tracker, &at_rest](int i) {
+        const auto noise = static_cast<int16_t>(i % 3 - 1);
+        return tracker.update(VectorInt16(10 + noise, -7 - noise, 3), at_rest);
+    };
+    for (int i = 0; i < SUBSONIC_GYRO_BIAS_WINDOW; ++i) {
+        completed += still_packet(i);
+    }
+    const int16_t* correction = tracker.correction();
+    if (completed != 1 || correction[0] != 20 || correction[1] != -14 || correction[2] != 6) {
+        return false;
+    }
+
+    // Any movement or slow turn partway through a window discards it.
+    for (int i = 0; i < SUBSONIC_GYRO_BIAS_WINDOW - 1; ++i) {
+        completed += still_packet(i);
+    }
+    completed += tracker.update(VectorInt16(10, -7, 3), VectorInt16(2000, 0, 0));
+    for (int i = 0; i < SUBSONIC_GYRO_BIAS_WINDOW - 1; ++i) {
+        completed += tracker.update(VectorInt16(0, 0, static_cast<int16_t>(i / 8)), at_rest);
+    }
+    completed += tracker.update(VectorInt16(200, 0, 0), at_rest);
+    return completed == 1;
+}
+
+/// The order in which the scheduler test tasks ran.
+std::vector<char> g_task_log;
+
+bool test_scheduler_priorities()
+{
+    constexpr Task tasks[]{
+        {"slow", [] { g_task_log.push_back('s'); delayMicroseconds(3000); }, 10000, 2000, 2},
+        {"fast", [] { g_task_log.push_back('f'); }, 1000, 1000, 0},
+        {"idle", [] { g_task_log.push_back('i'); }, 0, 1000, 1},
+    };
+    Scheduler scheduler{tasks};
+    if (std::string_view(scheduler.task(0).name) != "fast" || std::string_view(scheduler.task(2).name) != "slow") {
+        return false;
+    }
+
+    // Every task is released at the start, and runs in order of priority.
+    g_task_log.clear();
+    scheduler.start();
+    scheduler.run_pass();
+    if (g_task_log != std::vector<char>{'f', 'i', 's'}) {
+        return false;
+    }
+
+    // Each run of the slow task takes longer than its deadline. The fast
+    // task misses the releases that fall during it, rather than running for
+    // each of them afterwards.
+    g_task_log.clear();
+    const auto start_u = micros();
+    while (micros() - start_u < 50000) {
+        scheduler.run_pass();
+        delayMicroseconds(100);
+    }
+    const auto runs = [](char task) { return std::count(g_task_log.begin(), g_task_log.end(), task); };
+    const TaskStats& fast = scheduler.stats(0);
+    const TaskStats& slow = scheduler.stats(2);
+    if (runs('s') != 5 || runs('f') < 30 || runs('f') > 40
+        || slow.runs != 6 || slow.overruns != 6 || slow.max_run_u < 3000
+        || fast.overruns == 0 || fast.max_response_u < 3000
+        || runs('i') <= runs('f')) {
+        return false;
+    }
+
+    // A task that runs on every pass is released when the pass starts, so
+    // the time spent waiting behind the tasks ahead of it counts against its
+    // deadline.
+    constexpr Task every_pass[]{
+        {"block", [] { delayMicroseconds(500); }, 0, 1000, 0},
+        {"quick", [] {}, 0, 100, 1},
+    };
+    Scheduler passes{every_pass};
+    passes.start();
+    passes.run_pass();
+    const TaskStats& quick = passes.stats(1);
+    return quick.runs == 1 && quick.overruns == 1 && quick.max_run_u < 100 && quick.max_response_u >= 500;
+}
+
+bool test_scheduler_wrap()
+{
+    constexpr Task tasks[]{
+        {"fast", [] { g_task_log.push_back('f'); }, 1000, 1000, 0},
+        {"slow", [] { g_task_log.push_back('s'); }, 10000, 1000, 1},
+    };
+    Scheduler scheduler{tasks};
+
+    // Start just before the low 32 bits of the clock wrap, and keep the
+    // tasks running until well after.
+    host::advance_to_us(UINT32_MAX - 5000);
+    g_task_log.clear();
+    scheduler.start();
+    const uint64_t start_u = host::now_us();
+    while (host::now_us() - start_u < 50000) {
+        scheduler.run_pass();
+        delayMicroseconds(100);
+    }
+    const auto runs = [](char task) { return std::count(g_task_log.begin(), g_task_log.end(), task); };
+    const TaskStats& fast = scheduler.stats(0);
+    const TaskStats& slow = scheduler.stats(1);
+    return runs('f') >= 49 && runs('f') <= 51 && runs('s') == 5
+           && fast.overruns == 0 && slow.overruns == 0 && fast.max_response_u < 1000;
+}
+
+bool test_profiler_stats()
+{
+    using namespace profiler;
+    reset();
+    for (const uint32_t elapsed : {3000u, 1000u, 8000u}) {
+        record(Probe::RefreshButtons, elapsed * TICKS_PER_MICRO);
+    }
+    const ProbeStats& recorded = stats(Probe::RefreshButtons);
+    char line[20];
+    format_stats(line, sizeof(line), Probe::RefreshButtons);
+    if (recorded.count != 3 || recorded.min_ticks != 1000 * TICKS_PER_MICRO
+        || recorded.avg_ticks() != 4000 * TICKS_PER_MICRO || recorded.max_ticks != 8000 * TICKS_PER_MICRO
+        || std::string_view(line) != "btn 1000/4000/8000") {
+        return false;
+    }
+
+    // A total that would wrap is halved along with the count.
+    record(Probe::RefreshButtons, UINT32_MAX - 1000);
+    if (recorded.count != 2 || recorded.max_ticks != UINT32_MAX - 1000) {
+        return false;
+    }
+
+    // The navigator is probed whenever it is asked for directions.
+    Navigator nav{};
+    static_cast<void>(nav.compute_direction(Point{10, 0}, Rotation{}));
+    return stats(Probe::ComputeDirection).count == SUBSONIC_PROFILE;
+}
+
+/// A DMP packet captured while the device was yawed 30 degrees and rolled
+/// 10 degrees, followed by a second packet in the same buffer.
+constexpr uint8_t CAPTURED_PACKETS[2 * DmpPacketView::SIZE]{
+    0x3D, 0x95, 0x81, 0xCF, 0x05, 0x63, 0x4D, 0x9B, 0x01, 0x71, 0x95, 0x4A, 0x10, 0x80,
+    0x5A, 0xDA, 0x00, 0x64, 0x00, 0x00, 0xFF, 0xCE, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00,
+    0x00, 0x78, 0x00, 0x00, 0xFA, 0x6A, 0x00, 0x00, 0x1F, 0x72, 0x00, 0x00, 0x00, 0x00,
+    0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+// The fields can be read at compile time.
+static_assert(DmpPacketView(CAPTURED_PACKETS).accel(2) == 8050);
+
+bool test_dmp_packet_view()
+{
+    const DmpPacketView first(CAPTURED_PACKETS);
+    const DmpPacketView second(CAPTURED_PACKETS + DmpPacketView::SIZE);
+
+    const int32_t quaternion[4]{1033208271, 90394011, 24221002, 276847322};
+    for (uint8_t i = 0; i < 4; ++i) {
+        if (first.quaternion(i) != quaternion[i] || first.quaternion_q14(i) != quaternion[i] >> 16) {
+            return false;
+        }
+    }
+    const Quaternion q = first.quaternion();
+    const VectorInt16 gyro = first.gyro();
+    const VectorInt16 accel = first.accel();
+    if (q.w != 15765 / 16384.0f || q.z != 4224 / 16384.0f
+        || gyro.x != 100 || gyro.y != -50 || gyro.z != 7
+        || accel.x != 120 || accel.y != -1430 || accel.z != 8050) {
+        return false;
+    }
+
+    // The second packet is level and turning slowly.
+    return second.quaternion(0) == DmpPacketView::QUATERNION_ONE && second.quaternion(3) == 0
+           && second.gyro(1) == -1 && second.accel(2) == DmpPacketView::ACCEL_ONE_G;
+}
+
+bool test_motion_field_decode()
+{
+    const DmpPacketView packet(CAPTURED_PACKETS);
+    DeviceMotion full;
+    decode_device_motion(full, packet, MotionAll);
+    if (full.fields != MotionAll) {
+        return false;
+    }
+
+    // Returns whether the given field of two motions is the same.
+    const auto same = [](const DeviceMotion& first, const DeviceMotion& second, MotionField field) {
+        const auto equal = [](const VectorInt16& a, const VectorInt16& b) {
+            return a.x == b.x && a.y == b.y && a.z == b.z;
+        };
+        switch (field) {
+            case MotionYaw: return first.yaw == second.yaw;
+            case MotionTilt: return first.pitch == second.pitch && first.roll == second.roll;
+            case MotionGravity: return equal(first.gravity, second.gravity);
+            case MotionRawAccel: return equal(first.raw_accel, second.raw_accel);
+            case MotionRealAccel: return equal(first.real_accel, second.real_accel);
+            case MotionWorldAccel: return equal(first.world_accel, second.world_accel);
+            case MotionGyro: return equal(first.gyro, second.gyro);
+            default: return false;
+        }
+    };
+
+    DeviceMotion untouched;
+    const VectorInt16 sentinel(12345, -12345, 321);
+    untouched.world_accel = untouched.real_accel = untouched.raw_accel = untouched.gravity = untouched.gyro = sentinel;
+    untouched.yaw = untouched.pitch = untouched.roll = 99.0f;
+
+    // Each field requested, and each field it is derived from, matches the
+    // full decode. The rest are left as they were.
+    const MotionField masks[]{
+        MotionYaw,
+        static_cast<MotionField>(MotionTilt | MotionGyro),
+        MotionWorldAccel,
+    };
+    const MotionField expected[]{
+        MotionYaw,
+        static_cast<MotionField>(MotionTilt | MotionGravity | MotionGyro),
+        static_cast<MotionField>(MotionWorldAccel | MotionRealAccel | MotionRawAccel | MotionGravity),
+    };
+    for (size_t i = 0; i < std::size(masks); ++i) {
+        DeviceMotion partial = untouched;
+        decode_device_motion(partial, packet, masks[i]);
+        if (partial.fields != expected[i]) {
+            return false;
+        }
+        for (uint8_t bit = 0; bit < 7; ++bit) {
+            const auto field = static_cast<MotionField>(1u << bit);
+            if (!same(partial, (partial.fields & field) ? full : untouched, field)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/// Passes transactions through to an MPU, corrupting the firmware written to
+/// one byte of its memory banks.
+class CorruptingMpu : public host::I2CDevice {
+    host::I2CDevice& m_mpu;
+    uint8_t m_pointer{0};
+    uint8_t m_bank{0};
+    uint8_t m_address{0};
+
+  public:
+    /// The offset into the memory banks to corrupt.
+    uint16_t target{0};
+    /// The number of writes to `target` still to be corrupted.
+    uint8_t corruptions{0};
+    /// The number of bytes written to the memory banks.
+    uint32_t memory_bytes{0};
+
+    explicit CorruptingMpu(host::I2CDevice& mpu) : m_mpu(mpu) {}
+
+    void on_write(const uint8_t* data, size_t length) override
+    {
+        std::vector<uint8_t> bytes(data, data + length);
+        m_pointer = data[0];
+        if (length > 1 && m_pointer == MPU6050_RA_BANK_SEL) {
+            m_bank = data[1] & 0x1Fu;
+        } else if (length > 1 && m_pointer == MPU6050_RA_MEM_START_ADDR) {
+            m_address = data[1];
+        } else if (m_pointer == MPU6050_RA_MEM_R_W) {
+            const uint16_t start = static_cast<uint16_t>(m_bank << 8u | m_address);
+            if (corruptions != 0 && target >= start && target < start + length - 1) {
+                bytes[1 + target - start] ^= 0x5Au;
+                --corruptions;
+            }
+            memory_bytes += static_cast<uint32_t>(length - 1);
+            m_address = static_cast<uint8_t>(m_address + length - 1);
+        }
+        m_mpu.on_write(bytes.data(), length);
+    }
+
+    size_t on_read(uint8_t* data, size_t length) override
+    {
+        if (m_pointer == MPU6050_RA_MEM_R_W) {
+            m_address = static_cast<uint8_t>(m_address + length);
+        }
+        return m_mpu.on_read(data, length);
+    }
+};
+
+/// Returns the emulated MPU shared by the tests. The emulator schedules its
+/// own events, so it must outlive every test.
+host::MPU6050Emulator& emulated_mpu()
+{
+    static host::CircleWalk motion;
+    static host::MPU6050Emulator mpu(&motion, INTERRUPT_PIN);
+    return mpu;
+}
+
+/// Loads the DMP firmware, giving up after ten seconds.
+DmpLoadState load_dmp()
+{
+    begin_dmp_load();
+    const uint64_t start_u = host::now_us();
+    auto state = DmpLoadState::Resetting;
+    while (state < DmpLoadState::Done && host::now_us() - start_u < 10000000) {
+        state = service_dmp_load();
+    }
+    return state;
+}
+
+bool test_dmp_load_retries()
+{
+    CorruptingMpu device(emulated_mpu());
+    host::attach_i2c_device(host::MPU6050Emulator::ADDRESS, &device);
+    host::set_serial_sink(nullptr);
+    i2c_begin(400000);
+
+    // The image is written once, along with the FIFO rate in the firmware.
+    const bool intact = load_dmp() == DmpLoadState::Done;
+    const uint32_t intact_bytes = device.memory_bytes;
+
+    // A corrupted chunk is caught, and only that chunk, or the image with
+    // SUBSONIC_DMP_VERIFY=2, is written again.
+    device.target = 1000;
+    device.corruptions = 1;
+    device.memory_bytes = 0;
+    const bool recovered = load_dmp() == DmpLoadState::Done;
+    const uint32_t rewritten = SUBSONIC_DMP_VERIFY == 1 ? MPU6050_DMP_MEMORY_CHUNK_SIZE : intact_bytes - 2;
+    const bool retried = device.corruptions == 0 && device.memory_bytes == intact_bytes + rewritten;
+
+    // A chunk that never verifies fails the load after a few attempts.
+    device.corruptions = UINT8_MAX;
+    const bool failed = load_dmp() == DmpLoadState::Failed;
+    const int attempts = UINT8_MAX - device.corruptions;
+
+    host::attach_i2c_device(host::MPU6050Emulator::ADDRESS, nullptr);
+    host::set_serial_sink(stdout);
+    return intact && recovered && retried && failed && attempts > 1 && attempts < 10;
+}
+
+/// The motion delivered by `service_mpu`, in order.
+std::vector<DeviceMotion> g_delivered_motion;
+
+bool test_mpu_batch_timestamps()
+{
+    host::MPU6050Emulator& mpu = emulated_mpu();
+    host::attach_i2c_device(host::MPU6050Emulator::ADDRESS, &mpu);
+    host::set_serial_sink(nullptr);
+    host::erase_eeprom();
+    i2c_begin(400000);
+    if (load_dmp() != DmpLoadState::Done || setup_mpu(false, [] {}) != 0) {
+        return false;
+    }
+    constexpr unsigned long PERIOD_U{10000};
+    if (mpu.packet_rate_hz() != 1e6 / PERIOD_U) {
+        return false;
+    }
+    const auto deliver = [](const DeviceMotion& motion) { g_delivered_motion.push_back(motion); };
+
+    // Delivers every packet that arrives over the next few periods.
+    const auto drain = [deliver] {
+        const uint64_t end_u = host::now_us() + 5 * PERIOD_U;
+        while (host::now_us() < end_u) {
+            service_mpu(deliver);
+            // Keep the bus moving while waiting, as the sketch does between
+            // its tasks.
+            for (int i = 0; i < 4; ++i) {
+                delayMicroseconds(25);
+                i2c_advance();
+            }
+        }
+    };
+    // Catch up with the packets produced during setup.
+    drain();
+
+    // Leave several packets to queue up, so that they are counted and read
+    // together.
+    bool ok = true;
+    for (int batch = 0; batch < 5 && ok; ++batch) {
+        g_delivered_motion.clear();
+        const uint64_t start_u = host::now_us();
+        const uint64_t produced = mpu.counters().packets_produced;
+        host::advance_us(3 * PERIOD_U + PERIOD_U / 2);
+        const uint64_t wait_end_u = host::now_us();
+        const auto queued = static_cast<size_t>(mpu.counters().packets_produced - produced);
+        drain();
+
+        // The queued packets are delivered together, or only the newest
+        // without SUBSONIC_MPU_BATCH. Packets from before and after the
+        // batch are skipped.
+        std::vector<DeviceMotion> motion;
+        for (const DeviceMotion& delivered : g_delivered_motion) {
+            if (delivered.timestamp_u > start_u && delivered.timestamp_u <= wait_end_u) {
+                motion.push_back(delivered);
+            }
+        }
+        const size_t expected = SUBSONIC_MPU_BATCH ? queued : 1;
+        ok &= queued >= 3 && motion.size() == expected && motion.back().batch_remaining == 0;
+        for (size_t i = 1; ok && i < motion.size(); ++i) {
+            // Spaced at the packet period, or slightly less if the DMP runs
+            // fast.
+            const unsigned long spacing_u = motion[i].timestamp_u - motion[i - 1].timestamp_u;
+            ok &= motion[i - 1].batch_remaining == motion[i].batch_remaining + 1
+                  && spacing_u <= PERIOD_U && spacing_u > PERIOD_U * 9 / 10;
+        }
+        // The batch ends at the newest interrupt counted.
+        ok = ok && wait_end_u - motion.back().timestamp_u < PERIOD_U;
+    }
+
+    detachInterrupt(digitalPinToInterrupt(INTERRUPT_PIN));
+    host::attach_i2c_device(host::MPU6050Emulator::ADDRESS, nullptr);
+    host::set_serial_sink(stdout);
+    return ok;
+}
+
+bool test_dmp_math_matches_float()
+{
+    uint32_t state = 0x2545F491;
+    int max_gravity_error = 0;
+    int max_world_error = 0;
+    for (int trial = 0; trial < 2000; ++trial) {
+        // A random orientation, quantized as the DMP reports it.
+        double components[4];
+        double norm = 0;
+        for (double& component : components) {
+            component = next_uniform(state, -1, 1);
+            norm += component * component;
+        }
+        norm = std::sqrt(norm);
+        int16_t q14[4];
+        for (int i = 0; i < 4; ++i) {
+            q14[i] = static_cast<int16_t>(std::lround(components[i] / norm * 16384));
+        }
+        const dmp_math::QuaternionQ14 q{q14[0], q14[1], q14[2], q14[3]};
+        VectorInt16 accel(
+            static_cast<int16_t>(next_uniform(state, -16000, 16000)),
+            static_cast<int16_t>(next_uniform(state, -16000, 16000)),
+            static_cast<int16_t>(next_uniform(state, -16000, 16000))
+        );
+
+        // The float reference, as computed by MPU6050::dmpGetGravity,
+        // dmpGetLinearAccel and dmpGetLinearAccelInWorld.
+        Quaternion reference_q(q.w / 16384.0f, q.x / 16384.0f, q.y / 16384.0f, q.z / 16384.0f);
+        const VectorFloat reference_gravity(
+            2 * (reference_q.x * reference_q.z - reference_q.w * reference_q.y),
+            2 * (reference_q.w * reference_q.x + reference_q.y * reference_q.z),
+            reference_q.w * reference_q.w - reference_q.x * reference_q.x
+                - reference_q.y * reference_q.y + reference_q.z * reference_q.z
+        );
+        VectorInt16 reference_world(
+            static_cast<int16_t>(accel.x - reference_gravity.x * 8192),
+            static_cast<int16_t>(accel.y - reference_gravity.y * 8192),
+            static_cast<int16_t>(accel.z - reference_gravity.z * 8192)
+        );
+        reference_world.rotate(&reference_q);
+
+        const VectorInt16 gravity = dmp_math::gravity(q);
+        const VectorInt16 world = dmp_math::rotate(dmp_math::rotation(q), dmp_math::linear_accel(accel, gravity));
+        max_gravity_error = std::max({
+            max_gravity_error,
+            static_cast<int>(std::lround(std::fabs(gravity.x - reference_gravity.x * 8192))),
+            static_cast<int>(std::lround(std::fabs(gravity.y - reference_gravity.y * 8192))),
+            static_cast<int>(std::lround(std::fabs(gravity.z - reference_gravity.z * 8192))),
+        });
+        max_world_error = std::max({
+            max_world_error,
+            std::abs(world.x - reference_world.x),
+            std::abs(world.y - reference_world.y),
+            std::abs(world.z - reference_world.z),
+        });
+    }
+    return max_gravity_error <= 1 && max_world_error <= 3;
+}
+
+bool test_dmp_batch_matches_scalar()
+{
+    // Not a multiple of any vector width, so the padded tail is exercised.
+    constexpr size_t PACKETS{1001};
+    uint32_t state = 0x9E3779B9;
+    host::DmpTrace trace;
+    for (size_t i = 0; i < PACKETS; ++i) {
+        double components[4];
+        double norm = 0;
+        for (double& component : components) {
+            component = next_uniform(state, -1, 1);
+            norm += component * component;
+        }
+        norm = std::sqrt(norm);
+        trace.qw.push_back(static_cast<int16_t>(std::lround(components[0] / norm * 16384)));
+        trace.qx.push_back(static_cast<int16_t>(std::lround(components[1] / norm * 16384)));
+        trace.qy.push_back(static_cast<int16_t>(std::lround(components[2] / norm * 16384)));
+        trace.qz.push_back(static_cast<int16_t>(std::lround(components[3] / norm * 16384)));
+        trace.accel_x.push_back(static_cast<int16_t>(next_uniform(state, -32768, 32768)));
+        trace.accel_y.push_back(static_cast<int16_t>(next_uniform(state, -32768, 32768)));
+        trace.accel_z.push_back(static_cast<int16_t>(next_uniform(state, -32768, 32768)));
+    }
+    // A device lying flat, whose roll is on the branch cut of atan2.
+    for (auto* field : {&trace.qx, &trace.qz, &trace.accel_x, &trace.accel_y}) {
+        field->back() = 0;
+    }
+    trace.qw.back() = 0;
+    trace.qy.back() = 16384;
+    trace.accel_z.back() = -8192;
+
+    host::MotionTrace reference;
+    host::process_trace(trace, reference, host::BatchKernel::Scalar);
+    for (const auto kernel : {host::BatchKernel::Sse41, host::BatchKernel::Avx2}) {
+        if (!host::kernel_supported(kernel)) {
+            continue;
+        }
+        host::MotionTrace motion;
+        host::process_trace(trace, motion, kernel);
+        if (motion.size() != PACKETS) {
+            return false;
+        }
+        for (size_t i = 0; i < PACKETS; ++i) {
+            if (motion.gravity_x[i] != reference.gravity_x[i] || motion.gravity_y[i] != reference.gravity_y[i]
+                || motion.gravity_z[i] != reference.gravity_z[i] || motion.world_x[i] != reference.world_x[i]
+                || motion.world_y[i] != reference.world_y[i] || motion.world_z[i] != reference.world_z[i]) {
+                return false;
+            }
+            if (angle_error(motion.yaw[i], reference.yaw[i]) > TRIG_TOLERANCE
+                || angle_error(motion.pitch[i], reference.pitch[i]) > TRIG_TOLERANCE
+                || angle_error(motion.roll[i], reference.roll[i]) > TRIG_TOLERANCE) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool test_device_decode_matches_batch()
+{
+    // Random packets, then a device lying flat, whose roll is on the branch
+    // cut of atan2.
+    constexpr size_t PACKETS{1000};
+    std::vector<std::array<uint8_t, DmpPacketView::SIZE>> packets(PACKETS + 1);
+    const auto put_word = [](uint8_t* bytes, int16_t value) {
+        bytes[0] = static_cast<uint8_t>(static_cast<uint16_t>(value) >> 8u);
+        bytes[1] = static_cast<uint8_t>(value);
+    };
+    uint32_t state = 0x2545F491;
+    for (size_t i = 0; i < PACKETS; ++i) {
+        double components[4];
+        double norm = 0;
+        for (double& component : components) {
+            component = next_uniform(state, -1, 1);
+            norm += component * component;
+        }
+        norm = std::sqrt(norm);
+        for (uint8_t c = 0; c < 4; ++c) {
+            const auto q14 = static_cast<int16_t>(std::lround(components[c] / norm * 16384));
+            put_word(&packets[i][DmpPacketView::QUATERNION_OFFSET + 4 * c], q14);
+        }
+        for (uint8_t axis = 0; axis < 3; ++axis) {
+            const auto accel = static_cast<int16_t>(next_uniform(state, -32768, 32768));
+            put_word(&packets[i][DmpPacketView::ACCEL_OFFSET + 4 * axis], accel);
+        }
+    }
+    put_word(&packets[PACKETS][DmpPacketView::QUATERNION_OFFSET + 8], 16384);
+    put_word(&packets[PACKETS][DmpPacketView::ACCEL_OFFSET + 8], -8192);
+
+    host::DmpTrace trace;
+    for (const auto& bytes : packets) {
+        trace.append(DmpPacketView(bytes.data()));
+    }
+    host::MotionTrace batch;
+    host::process_trace(trace, batch, host::BatchKernel::Scalar);
+
+    // The host's copy of the sketch's decode gives the same bits.
+    const auto same_bits = [](float a, float b) { return std::memcmp(&a, &b, sizeof(float)) == 0; };
+    for (size_t i = 0; i < packets.size(); ++i) {
+        DeviceMotion motion;
+        decode_device_motion(motion, DmpPacketView(packets[i].data()), MotionAll);
+        if (motion.gravity.x != batch.gravity_x[i] || motion.gravity.y != batch.gravity_y[i]
+            || motion.gravity.z != batch.gravity_z[i] || motion.world_accel.x != batch.world_x[i]
+            || motion.world_accel.y != batch.world_y[i] || motion.world_accel.z != batch.world_z[i]
+            || !same_bits(motion.yaw, batch.yaw[i]) || !same_bits(motion.pitch, batch.pitch[i])
+            || !same_bits(motion.roll, batch.roll[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool test_dead_reckoning_motion()
+{
+    constexpr DeadReckoning::PitchVelocity mapping[] = {{10, 0}, {45, 1.5}};
+    DeadReckoning dead_reckoning{mapping, &DeviceMotion::roll};
+    if (dead_reckoning.pitch_to_vel(Angle::from_degrees(5)) != Scalar{0}
+        || dead_reckoning.pitch_to_vel(Angle::from_degrees(30)) != Scalar{1.5}
+        || dead_reckoning.pitch_to_vel(Angle::from_degrees(60)) != Scalar{1}) {
+        return false;
+    }
+
+    // Facing 90 degrees counterclockwise, which the MPU reports as a yaw of
+    // -90 degrees, with the roll selected as the true pitch.
+    IPTState state{};
+    DeviceMotion motion{};
+    motion.yaw = static_cast<float>(-M_PI / 2);
+    motion.pitch = 0;
+    motion.roll = static_cast<float>(30 * M_PI / 180);
+    const uint16_t epoch = state.epoch;
+    // The first packet only starts the clock, even when it is stamped zero.
+    for (const unsigned long timestamp_u : {0ul, 2000000ul}) {
+        motion.timestamp_u = timestamp_u;
+        dead_reckoning.update(state, motion);
+    }
+    // The time between packets is kept across the wrap of micros().
+    DeadReckoning wrapping{mapping, &DeviceMotion::roll};
+    for (const unsigned long timestamp_u : {UINT32_MAX - 999999ul, 1000000ul}) {
+        motion.timestamp_u = timestamp_u;
+        wrapping.update(state, motion);
+    }
+    return state.epoch == epoch + 4 && state.position.dist_to(Point{0, 6}) < SCALAR_TOLERANCE * 8;
+}
+
+bool test_work_stealing_pool()
+{
+    constexpr int TASKS{200};
+    std::atomic<int> runs{0};
+    std::vector<int> results(2 * TASKS, 0);
+    {
+        host::WorkStealingPool pool(4);
+        if (pool.size() != 4) {
+            return false;
+        }
+        for (int i = 0; i < TASKS; ++i) {
+            pool.submit([&, i] {
+                // Tasks of uneven length, which submit tasks of their own.
+                volatile int sink = 0;
+                for (int j = 0; j < (i % 7) * 1000; ++j) {
+                    sink = sink + j;
+                }
+                results[i] = i;
+                ++runs;
+                pool.submit([&, i] {
+                    results[TASKS + i] = i;
+                    ++runs;
+                });
+            });
+        }
+        pool.wait();
+        if (runs != 2 * TASKS) {
+            return false;
+        }
+        // The pool can be reused after waiting.
+        pool.submit([&] { ++runs; });
+    }
+    if (runs != 2 * TASKS + 1) {
+        return false;
+    }
+    for (int i = 0; i < TASKS; ++i) {
+        if (results[i] != i || results[TASKS + i] != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
 constexpr auto TEST_CASES = std::array{
     TEST_CASE(test_navigator_directions),
+    TEST_CASE(test_fixed_arithmetic),
+    TEST_CASE(test_fixed_trig_accuracy),
+    TEST_CASE(test_fixed_navigator_matches_double),
+    TEST_CASE(test_binary_angle),
+    TEST_CASE(test_rotation_matches_angles),
+    TEST_CASE(test_guidance_snapshot_epoch),
+    TEST_CASE(test_fast_trig_accuracy),
+    TEST_CASE(test_ring_buffer_order),
+    TEST_CASE(test_spsc_ring_threads),
+    TEST_CASE(test_async_i2c_transactions),
+    TEST_CASE(test_i2c_between_tasks),
+    TEST_CASE(test_framebuffer_diff),
+    TEST_CASE(test_lcd_writer_chunks),
+    TEST_CASE(test_telemetry_frames),
+    TEST_CASE(test_button_events),
+    TEST_CASE(test_calibration_storage),
+    TEST_CASE(test_gyro_bias_stillness),
+    TEST_CASE(test_scheduler_priorities),
+    TEST_CASE(test_dead_reckoning_motion),
+    TEST_CASE(test_profiler_stats),
+    TEST_CASE(test_dmp_packet_view),
+    TEST_CASE(test_motion_field_decode),
+#if SUBSONIC_DMP_VERIFY
+    TEST_CASE(test_dmp_load_retries),
+#endif
+    TEST_CASE(test_mpu_batch_timestamps),
+    TEST_CASE(test_dmp_math_matches_float),
+    TEST_CASE(test_dmp_batch_matches_scalar),
+    TEST_CASE(test_device_decode_matches_batch),
+    TEST_CASE(test_work_stealing_pool),
+    // Moves the clock on by over an hour, so runs last.
+    TEST_CASE(test_scheduler_wrap),
 };
 
 } // namespace